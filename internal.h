@@ -105,12 +105,23 @@ typedef unsigned short sa_family_t;
 #define HAVE_EPOLL
 #endif
 
+#if defined(HAVE_ZLIB_H) && defined(HAVE_LIBZ)
+#include <zlib.h>
+#define HAVE_ZLIB
+#endif
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_LIBPTHREAD)
+#include <pthread.h>
+#define HAVE_PTHREAD
+#endif
+
 #ifndef _WIN32
 #include <sys/param.h>
 #include <sys/time.h>
 #include <sys/uio.h>
 #include <sys/socket.h>
 #include <sys/param.h>
+#include <sys/file.h>
 #include <sys/wait.h>
 #include <sys/resource.h>
 #include <sys/un.h>
@@ -158,6 +169,10 @@ typedef unsigned short sa_family_t;
 #include <poll.h>
 #endif
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 #if defined(__linux__)
 #include <netpacket/packet.h>
 #include <net/ethernet.h>
@@ -170,6 +185,8 @@ typedef unsigned short sa_family_t;
 #define SOL_PACKET 263
 #endif
 #define HAVE_IPTABLES
+#include <sys/inotify.h>
+#define HAVE_INOTIFY
 #endif
 
 #if defined(__sun__)
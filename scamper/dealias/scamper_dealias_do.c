@@ -2616,6 +2616,13 @@ static int dealias_probedef_args(scamper_dealias_probedef_t *def, char *str)
 	}
       def->un.icmp.csum = csum;
       def->un.icmp.id   = scamper_sport_default();
+
+      /* tracemap claims replies to echo requests with these ICMP ids */
+      if(scamper_icmpid_isreserved(def->un.icmp.id) != 0)
+	{
+	  scamper_debug(__func__, "icmp id %d is reserved", def->un.icmp.id);
+	  goto err;
+	}
     }
   else if(SCAMPER_DEALIAS_PROBEDEF_PROTO_IS_TCP(def))
     {
@@ -36,34 +36,38 @@ static const char rcsid[] =
 #include "scamper_list.h"
 #include "scamper_dealias.h"
 #include "scamper_file.h"
+#include "scamper_file_json.h"
 #include "scamper_dealias_json.h"
 
 #include "utils.h"
 
-static char *dealias_flags_encode(char *buf, size_t len, uint8_t flags,
-				  const char **f2s, size_t f2sc)
+static void dealias_flags_encode(json_buf_t *jb, uint8_t flags,
+				 const char **f2s, size_t f2sc)
 {
-  size_t off = 0;
   int i, f = 0;
   uint8_t u8;
 
-  string_concat(buf, len, &off, ", \"flags\":[");
+  json_buf_lit(jb, ", \"flags\":[");
   for(i=0; i<8; i++)
     {
       if((u8 = flags & (0x1 << i)) == 0) continue;
-      if(f > 0) string_concat(buf, len, &off, ",");
+      if(f > 0) json_buf_lit(jb, ",");
       if(i < f2sc)
-	string_concat(buf, len, &off, "\"%s\"", f2s[i]);
-      else
-	string_concat(buf, len, &off, "%u", u8);
+	{
+	  json_buf_lit(jb, "\"");
+	  json_buf_str(jb, f2s[i]);
+	  json_buf_lit(jb, "\"");
+	}
+      else json_buf_u32(jb, u8);
       f++;
     }
-  string_concat(buf, len, &off, "]");
+  json_buf_lit(jb, "]");
 
-  return buf;
+  return;
 }
 
-static char *dealias_header_tostr(const scamper_dealias_t *dealias)
+static void dealias_header_tostr(json_buf_t *jb,
+				 const scamper_dealias_t *dealias)
 {
   static const char *pf_flags[] = {"nobs", "csa"};
   static const char *rg_flags[] = {"nobs"};
@@ -73,124 +77,167 @@ static char *dealias_header_tostr(const scamper_dealias_t *dealias)
   scamper_dealias_radargun_t *rg;
   scamper_dealias_prefixscan_t *pf;
   scamper_dealias_bump_t *bump;
-  char buf[512], tmp[64];
-  size_t off = 0;
+  char tmp[64];
   uint16_t u16;
 
-  string_concat(buf, sizeof(buf), &off,
-		"{\"version\":\"0.2\", \"type\":\"dealias\", \"method\":\"%s\"",
-		scamper_dealias_method_tostr(dealias, tmp, sizeof(tmp)));
-  string_concat(buf, sizeof(buf), &off, ", \"userid\":%u, \"result\":\"%s\"",
-		dealias->userid,
-		scamper_dealias_result_tostr(dealias, tmp, sizeof(tmp)));
-  string_concat(buf, sizeof(buf), &off, ", \"start\":{\"sec\":%u, \"usec\":%u}",
-		dealias->start.tv_sec, dealias->start.tv_usec);
+  json_buf_lit(jb,
+	       "{\"version\":\"0.2\", \"type\":\"dealias\", \"method\":\"");
+  json_buf_str(jb, scamper_dealias_method_tostr(dealias, tmp, sizeof(tmp)));
+  json_buf_lit(jb, "\", \"userid\":");
+  json_buf_u32(jb, dealias->userid);
+  json_buf_lit(jb, ", \"result\":\"");
+  json_buf_str(jb, scamper_dealias_result_tostr(dealias, tmp, sizeof(tmp)));
+  json_buf_lit(jb, "\", \"start\":{\"sec\":");
+  json_buf_u32(jb, dealias->start.tv_sec);
+  json_buf_lit(jb, ", \"usec\":");
+  json_buf_u32(jb, dealias->start.tv_usec);
+  json_buf_lit(jb, "}");
 
   if(SCAMPER_DEALIAS_METHOD_IS_MERCATOR(dealias))
     {
       mc = dealias->data;
-      string_concat(buf, sizeof(buf), &off,
-		    ", \"attempts\":%u, \"wait_timeout\":%u",
-		    mc->attempts, mc->wait_timeout);
+      json_buf_lit(jb, ", \"attempts\":");
+      json_buf_u32(jb, mc->attempts);
+      json_buf_lit(jb, ", \"wait_timeout\":");
+      json_buf_u32(jb, mc->wait_timeout);
     }
   else if(SCAMPER_DEALIAS_METHOD_IS_ALLY(dealias))
     {
       ally = dealias->data;
-      string_concat(buf, sizeof(buf), &off,
-		    ", \"wait_probe\":%u, \"wait_timeout\":%u",
-		    ally->wait_probe, ally->wait_timeout);
-      string_concat(buf, sizeof(buf), &off, ", \"attempts\":%u, \"fudge\":%u",
-		    ally->attempts, ally->fudge);
+      json_buf_lit(jb, ", \"wait_probe\":");
+      json_buf_u32(jb, ally->wait_probe);
+      json_buf_lit(jb, ", \"wait_timeout\":");
+      json_buf_u32(jb, ally->wait_timeout);
+      json_buf_lit(jb, ", \"attempts\":");
+      json_buf_u32(jb, ally->attempts);
+      json_buf_lit(jb, ", \"fudge\":");
+      json_buf_u32(jb, ally->fudge);
       if(ally->flags != 0)
-	{
-	  dealias_flags_encode(tmp, sizeof(tmp), ally->flags, ally_flags,
-			       sizeof(ally_flags)/sizeof(char *));
-	  string_concat(buf, sizeof(buf), &off, "%s", tmp);
-	}
+	dealias_flags_encode(jb, ally->flags, ally_flags,
+			     sizeof(ally_flags)/sizeof(char *));
     }
   else if(SCAMPER_DEALIAS_METHOD_IS_RADARGUN(dealias))
     {
       rg = dealias->data;
-      string_concat(buf, sizeof(buf), &off,
-		    ", \"attempts\":%u, \"wait_probe\":%u",
-		    rg->attempts, rg->wait_probe);
-      string_concat(buf, sizeof(buf), &off,
-		    ", \"wait_round\":%u, \"wait_timeout\":%u",
-		    rg->wait_round, rg->wait_timeout);
+      json_buf_lit(jb, ", \"attempts\":");
+      json_buf_u32(jb, rg->attempts);
+      json_buf_lit(jb, ", \"wait_probe\":");
+      json_buf_u32(jb, rg->wait_probe);
+      json_buf_lit(jb, ", \"wait_round\":");
+      json_buf_u32(jb, rg->wait_round);
+      json_buf_lit(jb, ", \"wait_timeout\":");
+      json_buf_u32(jb, rg->wait_timeout);
       if(rg->flags != 0)
-	string_concat(buf, sizeof(buf), &off, "%s",
-		      dealias_flags_encode(tmp,sizeof(tmp),rg->flags,rg_flags,
-					   sizeof(rg_flags)/sizeof(char *)));
+	dealias_flags_encode(jb, rg->flags, rg_flags,
+			     sizeof(rg_flags)/sizeof(char *));
     }
   else if(SCAMPER_DEALIAS_METHOD_IS_PREFIXSCAN(dealias))
     {
       pf = dealias->data;
-      string_concat(buf, sizeof(buf), &off, ", \"a\":\"%s\"",
-		    scamper_addr_tostr(pf->a, tmp, sizeof(tmp)));
-      string_concat(buf, sizeof(buf), &off, ", \"b\":\"%s/%u\"",
-		    scamper_addr_tostr(pf->b, tmp, sizeof(tmp)), pf->prefix);
+      json_buf_lit(jb, ", \"a\":\"");
+      json_buf_addr(jb, pf->a);
+      json_buf_lit(jb, "\", \"b\":\"");
+      json_buf_addr(jb, pf->b);
+      json_buf_lit(jb, "/");
+      json_buf_u32(jb, pf->prefix);
+      json_buf_lit(jb, "\"");
       if(pf->ab != NULL)
-	string_concat(buf, sizeof(buf), &off, ", \"ab\":\"%s/%u\"",
-		      scamper_addr_tostr(pf->ab, tmp, sizeof(tmp)),
-		      scamper_addr_prefixhosts(pf->b, pf->ab));
+	{
+	  json_buf_lit(jb, ", \"ab\":\"");
+	  json_buf_addr(jb, pf->ab);
+	  json_buf_lit(jb, "/");
+	  json_buf_u32(jb, scamper_addr_prefixhosts(pf->b, pf->ab));
+	  json_buf_lit(jb, "\"");
+	}
       if(pf->xc > 0)
 	{
-	  string_concat(buf, sizeof(buf), &off, ", \"xs\":[\"%s\"",
-			scamper_addr_tostr(pf->xs[0], tmp, sizeof(tmp)));
+	  json_buf_lit(jb, ", \"xs\":[\"");
+	  json_buf_addr(jb, pf->xs[0]);
+	  json_buf_lit(jb, "\"");
 	  for(u16=1; u16 < pf->xc; u16++)
-	    string_concat(buf, sizeof(buf), &off, ", \"%s\"",
-			  scamper_addr_tostr(pf->xs[u16], tmp, sizeof(tmp)));
-	  string_concat(buf, sizeof(buf), &off, "]");
+	    {
+	      json_buf_lit(jb, ", \"");
+	      json_buf_addr(jb, pf->xs[u16]);
+	      json_buf_lit(jb, "\"");
+	    }
+	  json_buf_lit(jb, "]");
 	}
-      string_concat(buf, sizeof(buf), &off,
-		    ", \"attempts\":%u, \"replyc\":%u, \"fudge\":%u",
-		    pf->attempts, pf->replyc, pf->fudge);
-      string_concat(buf, sizeof(buf), &off,
-		    ", \"wait_probe\":%u, \"wait_timeout\":%u",
-		    pf->wait_probe, pf->wait_timeout);
+      json_buf_lit(jb, ", \"attempts\":");
+      json_buf_u32(jb, pf->attempts);
+      json_buf_lit(jb, ", \"replyc\":");
+      json_buf_u32(jb, pf->replyc);
+      json_buf_lit(jb, ", \"fudge\":");
+      json_buf_u32(jb, pf->fudge);
+      json_buf_lit(jb, ", \"wait_probe\":");
+      json_buf_u32(jb, pf->wait_probe);
+      json_buf_lit(jb, ", \"wait_timeout\":");
+      json_buf_u32(jb, pf->wait_timeout);
       if(pf->flags != 0)
-	string_concat(buf, sizeof(buf), &off, "%s",
-		      dealias_flags_encode(tmp,sizeof(tmp),pf->flags,pf_flags,
-					   sizeof(pf_flags)/sizeof(char *)));
+	dealias_flags_encode(jb, pf->flags, pf_flags,
+			     sizeof(pf_flags)/sizeof(char *));
     }
   else if(SCAMPER_DEALIAS_METHOD_IS_BUMP(dealias))
     {
       bump = dealias->data;
-      string_concat(buf, sizeof(buf), &off,
-		    ", \"wait_probe\":%u, \"bump_limit\":%u, \"attempts\":%u",
-		    bump->wait_probe, bump->bump_limit, bump->attempts);
+      json_buf_lit(jb, ", \"wait_probe\":");
+      json_buf_u32(jb, bump->wait_probe);
+      json_buf_lit(jb, ", \"bump_limit\":");
+      json_buf_u32(jb, bump->bump_limit);
+      json_buf_lit(jb, ", \"attempts\":");
+      json_buf_u32(jb, bump->attempts);
     }
 
-  return strdup(buf);
+  return;
 }
 
-static char *dealias_probedef_tostr(const scamper_dealias_probedef_t *def)
+static void dealias_probedef_tostr(json_buf_t *jb,
+				   const scamper_dealias_probedef_t *def)
 {
-  char buf[256], tmp[64];
-  size_t off = 0;
-  string_concat(buf, sizeof(buf), &off, "{\"id\":%u, \"src\":\"%s\"",
-		def->id, scamper_addr_tostr(def->src, tmp, sizeof(tmp)));
-  string_concat(buf, sizeof(buf), &off,
-		", \"dst\":\"%s\", \"ttl\":%u, \"size\":%u",
-		scamper_addr_tostr(def->dst, tmp, sizeof(tmp)), def->ttl,
-		def->size);
-  string_concat(buf, sizeof(buf), &off, ", \"method\":\"%s\"",
-		scamper_dealias_probedef_method_tostr(def, tmp, sizeof(tmp)));
+  char tmp[64];
+
+  json_buf_lit(jb, "{\"id\":");
+  json_buf_u32(jb, def->id);
+  json_buf_lit(jb, ", \"src\":\"");
+  json_buf_addr(jb, def->src);
+  json_buf_lit(jb, "\", \"dst\":\"");
+  json_buf_addr(jb, def->dst);
+  json_buf_lit(jb, "\", \"ttl\":");
+  json_buf_u32(jb, def->ttl);
+  json_buf_lit(jb, ", \"size\":");
+  json_buf_u32(jb, def->size);
+  json_buf_lit(jb, ", \"method\":\"");
+  json_buf_str(jb, scamper_dealias_probedef_method_tostr(def,tmp,sizeof(tmp)));
+  json_buf_lit(jb, "\"");
   if(SCAMPER_DEALIAS_PROBEDEF_PROTO_IS_ICMP(def))
-    string_concat(buf, sizeof(buf), &off, ", \"icmp_id\":%u, \"icmp_csum\":%u",
-		  def->un.icmp.id, def->un.icmp.csum);
+    {
+      json_buf_lit(jb, ", \"icmp_id\":");
+      json_buf_u32(jb, def->un.icmp.id);
+      json_buf_lit(jb, ", \"icmp_csum\":");
+      json_buf_u32(jb, def->un.icmp.csum);
+    }
   else if(SCAMPER_DEALIAS_PROBEDEF_PROTO_IS_UDP(def))
-    string_concat(buf, sizeof(buf), &off,
-		  ", \"udp_sport\":%u, \"udp_dport\":%u",
-		  def->un.udp.sport, def->un.udp.dport);
+    {
+      json_buf_lit(jb, ", \"udp_sport\":");
+      json_buf_u32(jb, def->un.udp.sport);
+      json_buf_lit(jb, ", \"udp_dport\":");
+      json_buf_u32(jb, def->un.udp.dport);
+    }
   else if(SCAMPER_DEALIAS_PROBEDEF_PROTO_IS_TCP(def))
-    string_concat(buf, sizeof(buf), &off,
-		  ", \"tcp_sport\":%u, \"tcp_dport\":%u, \"tcp_flags\":%u",
-		  def->un.tcp.sport, def->un.tcp.dport, def->un.tcp.flags);
+    {
+      json_buf_lit(jb, ", \"tcp_sport\":");
+      json_buf_u32(jb, def->un.tcp.sport);
+      json_buf_lit(jb, ", \"tcp_dport\":");
+      json_buf_u32(jb, def->un.tcp.dport);
+      json_buf_lit(jb, ", \"tcp_flags\":");
+      json_buf_u32(jb, def->un.tcp.flags);
+    }
   if(def->mtu > 0)
-    string_concat(buf, sizeof(buf), &off, ", \"mtu\":%u", def->mtu);
-  string_concat(buf, sizeof(buf), &off, "}");
-  return strdup(buf);
+    {
+      json_buf_lit(jb, ", \"mtu\":");
+      json_buf_u32(jb, def->mtu);
+    }
+  json_buf_lit(jb, "}");
+  return;
 }
 
 static int dealias_probedefs_get(const scamper_dealias_t *dealias,
@@ -236,233 +283,112 @@ static int dealias_probedefs_get(const scamper_dealias_t *dealias,
   return 0;
 }
 
-static char *dealias_reply_tostr(const scamper_dealias_reply_t *reply)
+static void dealias_reply_tostr(json_buf_t *jb,
+				const scamper_dealias_reply_t *reply)
 {
-  char buf[256], tmp[64];
-  size_t off = 0;
-  string_concat(buf, sizeof(buf), &off,
-		"{\"src\":\"%s\", \"rx\":{\"sec\":%u, \"usec\":%u}, \"ttl\":%u",
-		scamper_addr_tostr(reply->src, tmp, sizeof(tmp)),
-		reply->rx.tv_sec, reply->rx.tv_usec, reply->ttl);
+  json_buf_lit(jb, "{\"src\":\"");
+  json_buf_addr(jb, reply->src);
+  json_buf_lit(jb, "\", \"rx\":{\"sec\":");
+  json_buf_u32(jb, reply->rx.tv_sec);
+  json_buf_lit(jb, ", \"usec\":");
+  json_buf_u32(jb, reply->rx.tv_usec);
+  json_buf_lit(jb, "}, \"ttl\":");
+  json_buf_u32(jb, reply->ttl);
   if(SCAMPER_ADDR_TYPE_IS_IPV4(reply->src))
-    string_concat(buf, sizeof(buf), &off, ", \"ipid\": %u", reply->ipid);
+    {
+      json_buf_lit(jb, ", \"ipid\": ");
+      json_buf_u32(jb, reply->ipid);
+    }
   else if(reply->flags & SCAMPER_DEALIAS_REPLY_FLAG_IPID32)
-    string_concat(buf, sizeof(buf), &off, ", \"ipid\": %u", reply->ipid32);
-  string_concat(buf, sizeof(buf), &off, ", \"proto\":%u", reply->proto);
+    {
+      json_buf_lit(jb, ", \"ipid\": ");
+      json_buf_u32(jb, reply->ipid32);
+    }
+  json_buf_lit(jb, ", \"proto\":");
+  json_buf_u32(jb, reply->proto);
 
   if(SCAMPER_DEALIAS_REPLY_IS_ICMP(reply))
     {
-      string_concat(buf, sizeof(buf), &off,
-		    ", \"icmp_type\":%u, \"icmp_code\":%u",
-		    reply->icmp_type, reply->icmp_code);
+      json_buf_lit(jb, ", \"icmp_type\":");
+      json_buf_u32(jb, reply->icmp_type);
+      json_buf_lit(jb, ", \"icmp_code\":");
+      json_buf_u32(jb, reply->icmp_code);
 
       if(SCAMPER_DEALIAS_REPLY_IS_ICMP_UNREACH(reply) ||
 	 SCAMPER_DEALIAS_REPLY_IS_ICMP_TTL_EXP(reply))
-	string_concat(buf, sizeof(buf), &off,
-		      ", \"icmp_q_ttl\":%u",reply->icmp_q_ip_ttl);
+	{
+	  json_buf_lit(jb, ", \"icmp_q_ttl\":");
+	  json_buf_u32(jb, reply->icmp_q_ip_ttl);
+	}
     }
   else if(SCAMPER_DEALIAS_REPLY_IS_TCP(reply))
     {
-      string_concat(buf, sizeof(buf), &off, ", \"tcp_flags\":%u",
-		    reply->tcp_flags);
+      json_buf_lit(jb, ", \"tcp_flags\":");
+      json_buf_u32(jb, reply->tcp_flags);
     }
 
-  string_concat(buf, sizeof(buf), &off, "}");
-  return strdup(buf);
+  json_buf_lit(jb, "}");
+  return;
 }
 
-static char *dealias_probe_tostr(const scamper_dealias_probe_t *probe)
+static void dealias_probe_tostr(json_buf_t *jb,
+				const scamper_dealias_probe_t *probe)
 {
-  char header[256], **replies = NULL, *rc = NULL, *str = NULL;
-  size_t len, wc = 0, header_len = 0, *reply_lens = NULL;
   int i;
 
-  string_concat(header, sizeof(header), &header_len,
-		"{\"probedef_id\":%u, \"seq\":%u, \"tx\":{\"sec\":%u, \"usec\":%u}",
-		probe->def->id, probe->seq, probe->tx.tv_sec, probe->tx.tv_usec);
+  json_buf_lit(jb, "{\"probedef_id\":");
+  json_buf_u32(jb, probe->def->id);
+  json_buf_lit(jb, ", \"seq\":");
+  json_buf_u32(jb, probe->seq);
+  json_buf_lit(jb, ", \"tx\":{\"sec\":");
+  json_buf_u32(jb, probe->tx.tv_sec);
+  json_buf_lit(jb, ", \"usec\":");
+  json_buf_u32(jb, probe->tx.tv_usec);
+  json_buf_lit(jb, "}");
   if(SCAMPER_ADDR_TYPE_IS_IPV4(probe->def->dst))
-    string_concat(header, sizeof(header), &header_len,
-		  ", \"ipid\":%u", probe->ipid);
-  string_concat(header, sizeof(header), &header_len, ", \"replies\":[");
-  len = header_len;
-  if(probe->replyc > 0)
     {
-      if((replies = malloc_zero(sizeof(char *) * probe->replyc)) == NULL ||
-	 (reply_lens = malloc_zero(sizeof(size_t) * probe->replyc)) == NULL)
-	goto done;
-      for(i=0; i<probe->replyc; i++)
-	{
-	  if(i > 0) len += 2; /* , */
-	  if((replies[i] = dealias_reply_tostr(probe->replies[i])) == NULL)
-	    goto done;
-	  reply_lens[i] = strlen(replies[i]);
-	  len += reply_lens[i];
-	}
+      json_buf_lit(jb, ", \"ipid\":");
+      json_buf_u32(jb, probe->ipid);
     }
-  len += 3; /* ]}\0 */
-
-  if((str = malloc(len)) == NULL)
-    goto done;
-  memcpy(str, header, header_len); wc += header_len;
-  if(probe->replyc > 0)
+  json_buf_lit(jb, ", \"replies\":[");
+  for(i=0; i<probe->replyc; i++)
     {
-      for(i=0; i<probe->replyc; i++)
-	{
-	  if(i > 0)
-	    {
-	      memcpy(str+wc, ", ", 2);
-	      wc += 2;
-	    }
-	  memcpy(str+wc, replies[i], reply_lens[i]);
-	  wc += reply_lens[i];
-	}
+      if(i > 0) json_buf_lit(jb, ", ");
+      dealias_reply_tostr(jb, probe->replies[i]);
     }
-  memcpy(str+wc, "]}\0", 3); wc += 3;
-  assert(wc == len);
-
-  rc = str;
-
- done:
-  if(rc == NULL && str != NULL)
-    free(str);
-  if(replies != NULL) {
-    for(i=0; i<probe->replyc; i++)
-      if(replies[i] != NULL)
-	free(replies[i]);
-    free(replies);
-  }
-  if(reply_lens != NULL)
-    free(reply_lens);
-  return rc;
+  json_buf_lit(jb, "]}");
+  return;
 }
 
 int scamper_file_json_dealias_write(const scamper_file_t *sf,
 				    const scamper_dealias_t *dealias)
 {
-  int       fd          = scamper_file_getfd(sf);
-  off_t     off         = 0;
-  char     *str         = NULL;
-  size_t    len         = 0;
-  size_t    wc          = 0;
-  char     *header      = NULL;
-  size_t    header_len  = 0;
-  char    **pds         = NULL;
-  size_t   *pd_lens     = NULL;
-  char    **prs         = NULL;
-  size_t   *pr_lens     = NULL;
-  int       i, rc       = -1;
-
-  scamper_dealias_probedef_t *defs; int defc;
-
-  /* get current position incase trunction is required */
-  if(fd != 1 && (off = lseek(fd, 0, SEEK_CUR)) == -1)
-    return -1;
-
-  /* get the header string */
-  if((header = dealias_header_tostr(dealias)) == NULL)
-    goto cleanup;
-  len = (header_len = strlen(header));
-  len += 2; /* }\n" */
-
-  /* get the probedef strings */
-  if(dealias_probedefs_get(dealias, &defs, &defc) != 0 ||
-     (pds = malloc_zero(sizeof(char *) * defc)) == NULL ||
-     (pd_lens = malloc_zero(sizeof(size_t) * defc)) == NULL)
-    goto cleanup;
-  len += 16; /* , "probedefs":[] */
-  for(i=0; i<defc; i++)
-    {
-      if(i > 0) len += 2; /* , */
-      pds[i] = dealias_probedef_tostr(&defs[i]);
-      pd_lens[i] = strlen(pds[i]);
-      len += pd_lens[i];
-    }
+  scamper_dealias_probedef_t *defs;
+  json_buf_t jb;
+  char buf[4096];
+  int i, defc, rc;
 
-  /* get the probe strings */
-  len += 13; /* , "probes":[] */
-  if(dealias->probec > 0)
-    {
-      if((prs = malloc_zero(sizeof(char *) * dealias->probec)) == NULL ||
-	 (pr_lens = malloc_zero(sizeof(size_t) * dealias->probec)) == NULL)
-	goto cleanup;
+  if(dealias_probedefs_get(dealias, &defs, &defc) != 0)
+    return -1;
 
-      for(i=0; i<dealias->probec; i++)
-	{
-	  if(i > 0) len += 2; /* , */
-	  if((prs[i] = dealias_probe_tostr(dealias->probes[i])) == NULL)
-	    goto cleanup;
-	  pr_lens[i] = strlen(prs[i]);
-	  len += pr_lens[i];
-	}
-    }
+  json_buf_init(&jb, buf, sizeof(buf));
+  dealias_header_tostr(&jb, dealias);
 
-  if((str = malloc(len)) == NULL)
-    goto cleanup;
-  memcpy(str+wc, header, header_len); wc += header_len;
-  memcpy(str+wc, ", \"probedefs\":[", 15); wc += 15;
+  json_buf_lit(&jb, ", \"probedefs\":[");
   for(i=0; i<defc; i++)
     {
-      if(i > 0)
-	{
-	  memcpy(str+wc, ", ", 2);
-	  wc += 2;
-	}
-      memcpy(str+wc, pds[i], pd_lens[i]);
-      wc += pd_lens[i];
+      if(i > 0) json_buf_lit(&jb, ", ");
+      dealias_probedef_tostr(&jb, &defs[i]);
     }
-  memcpy(str+wc, "]", 1); wc++;
-  memcpy(str+wc, ", \"probes\":[", 12); wc += 12;
-  if(dealias->probec > 0)
+  json_buf_lit(&jb, "], \"probes\":[");
+  for(i=0; i<dealias->probec; i++)
     {
-      for(i=0; i<dealias->probec; i++)
-	{
-	  if(i > 0 )
-	    {
-	      memcpy(str+wc, ", ", 2);
-	      wc += 2;
-	    }
-	  memcpy(str+wc, prs[i], pr_lens[i]);
-	  wc += pr_lens[i];
-	}
+      if(i > 0) json_buf_lit(&jb, ", ");
+      dealias_probe_tostr(&jb, dealias->probes[i]);
     }
-  memcpy(str+wc, "]", 1); wc++;
-  memcpy(str+wc, "}\n", 2); wc += 2;
+  json_buf_lit(&jb, "]}\n");
 
-  assert(wc == len);
-
-  /*
-   * try and write the string to disk.  if it fails, then truncate the
-   * write and fail
-   */
-  if(write_wrap(fd, str, &wc, len) != 0)
-    {
-      if(fd != 1)
-	{
-	  if(ftruncate(fd, off) != 0)
-	    goto cleanup;
-	}
-      goto cleanup;
-    }
-  rc = 0; /* we succeeded */
-
- cleanup:
-  if(str != NULL) free(str);
-  if(header != NULL) free(header);
-  if(pd_lens != NULL) free(pd_lens);
-  if(pr_lens != NULL) free(pr_lens);
-  if(pds != NULL)
-    {
-      for(i=0; i<defc; i++)
-	if(pds[i] != NULL)
-	  free(pds[i]);
-      free(pds);
-    }
-  if(prs != NULL)
-    {
-      for(i=0; i<dealias->probec; i++)
-	if(prs[i] != NULL)
-	  free(prs[i]);
-      free(prs);
-    }
+  rc = json_buf_write(&jb, sf);
+  json_buf_free(&jb);
   return rc;
 }
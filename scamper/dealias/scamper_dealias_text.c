@@ -44,7 +44,6 @@ int scamper_file_text_dealias_write(const scamper_file_t *sf,
 {
   scamper_dealias_ally_t *ally;
   char buf[256], a[64], b[64], c[32];
-  int fd = scamper_file_getfd(sf);
 
   if(SCAMPER_DEALIAS_METHOD_IS_ALLY(dealias))
     {
@@ -63,7 +62,7 @@ int scamper_file_text_dealias_write(const scamper_file_t *sf,
 	       scamper_addr_tostr(ally->probedefs[1].dst, b, sizeof(b)),
 	       c);
 
-      write_wrap(fd, buf, NULL, strlen(buf));
+      scamper_file_write_bytes(sf, buf, strlen(buf));
     }
   return 0;
 }
@@ -1567,7 +1567,7 @@ int scamper_file_warts_dealias_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   uint32_t off = 0;
   uint32_t i;
 
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   if(warts_read(sf, &buf, hdr->len) != 0)
     {
@@ -1619,12 +1619,10 @@ int scamper_file_warts_dealias_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   assert(off == hdr->len);
   warts_addrtable_clean(&table);
   *dealias_out = dealias;
-  free(buf);
   return 0;
 
  err:
   warts_addrtable_clean(&table);
-  if(buf != NULL) free(buf);
   if(dealias != NULL) scamper_dealias_free(dealias);
   return -1;
 }
@@ -1678,7 +1676,7 @@ int scamper_file_warts_dealias_write(const scamper_file_t *sf,
   warts_addrtable_t        table;
 
   memset(&data, 0, sizeof(data));
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   /* figure out which dealias data items we'll store in this record */
   warts_dealias_params(dealias, flags, &flags_len, &params_len);
@@ -430,7 +430,7 @@ int scamper_file_warts_neighbourdisc_write(const scamper_file_t *sf,
   size_t   size;
   int      i;
 
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   /* figure out which neighbourdisc items we'll store in this record */
   warts_neighbourdisc_params(nd, &table, flags, &flags_len, &params_len);
@@ -508,7 +508,7 @@ int scamper_file_warts_neighbourdisc_read(scamper_file_t *sf,
   uint32_t off = 0;
   uint16_t i;
 
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   if(warts_read(sf, &buf, hdr->len) != 0)
     {
@@ -557,12 +557,10 @@ int scamper_file_warts_neighbourdisc_read(scamper_file_t *sf,
   assert(off == hdr->len);
   warts_addrtable_clean(&table);
   *nd_out = nd;
-  free(buf);
   return 0;
 
  err:
   warts_addrtable_clean(&table);
-  if(buf != NULL) free(buf);
   if(nd != NULL) scamper_neighbourdisc_free(nd);
   return -1;
 }
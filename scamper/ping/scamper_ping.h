@@ -116,6 +116,7 @@
 #define SCAMPER_PING_FLAG_TSANDADDR       0x10 /* -T tsandaddr */
 #define SCAMPER_PING_FLAG_ICMPSUM         0x20 /* -C csum */
 #define SCAMPER_PING_FLAG_DL              0x40 /* always use datalink socket */
+#define SCAMPER_PING_FLAG_RTTWAIT         0x80 /* -A: wait from rtt estimates */
 
 /*
  * scamper_ping_reply_v4rr
@@ -48,6 +48,7 @@ static const char rcsid[] =
 #include "scamper_queue.h"
 #include "scamper_file.h"
 #include "scamper_debug.h"
+#include "scamper_rtt.h"
 #include "scamper_ping_do.h"
 #include "scamper_options.h"
 #include "scamper_icmp4.h"
@@ -149,11 +150,13 @@ typedef struct ping_state
 #define PING_OPT_PROBETOS     17
 #define PING_OPT_REPLYPMTU    18
 #define PING_OPT_PROBETIMEOUT 19
+#define PING_OPT_RTTWAIT      20
 
 #define PING_MODE_PROBE       0
 #define PING_MODE_PTB         1
 
 static const scamper_option_in_t opts[] = {
+  {'A', NULL, PING_OPT_RTTWAIT,      SCAMPER_OPTION_TYPE_NULL},
   {'B', NULL, PING_OPT_PAYLOAD,      SCAMPER_OPTION_TYPE_STR},
   {'c', NULL, PING_OPT_PROBECOUNT,   SCAMPER_OPTION_TYPE_NUM},
   {'C', NULL, PING_OPT_PROBEICMPSUM, SCAMPER_OPTION_TYPE_STR},
@@ -179,7 +182,7 @@ static const int opts_cnt = SCAMPER_OPTION_COUNT(opts);
 
 const char *scamper_do_ping_usage(void)
 {
-  return "ping [-R] [-B payload] [-c count] [-C icmp-sum] [-d dport]\n"
+  return "ping [-AR] [-B payload] [-c count] [-C icmp-sum] [-d dport]\n"
          "     [-F sport] [-i wait-probe] [-m ttl] [-M pmtu]\n"
          "     [-o reply-count] [-O option] [-p pattern] [-P method]\n"
          "     [-U userid] [-s probe-size] [-S srcaddr]\n"
@@ -382,10 +385,15 @@ static void do_ping_handle_dl(scamper_task_t *task, scamper_dl_rec_t *dl)
 
   /*
    * if this is the first reply we have for this hop, then increment
-   * the replies counter we keep state with
+   * the replies counter we keep state with.  a reply from the
+   * destination is also a sample of the RTT towards its prefix.
    */
   if(ping->ping_replies[seq] == NULL)
-    state->replies++;
+    {
+      state->replies++;
+      if(scamper_addr_cmp(reply->addr, ping->dst) == 0)
+	scamper_rtt_sample(ping->dst, SCAMPER_RTT_DST, &reply->rtt);
+    }
 
   /* put the reply into the ping table */
   scamper_ping_reply_append(ping, reply);
@@ -659,10 +667,15 @@ static void do_ping_handle_icmp(scamper_task_t *task, scamper_icmp_resp_t *ir)
 
   /*
    * if this is the first reply we have for this hop, then increment
-   * the replies counter we keep state with
+   * the replies counter we keep state with.  a reply from the
+   * destination is also a sample of the RTT towards its prefix.
    */
   if(ping->ping_replies[seq] == NULL)
-    state->replies++;
+    {
+      state->replies++;
+      if(scamper_addr_cmp(reply->addr, ping->dst) == 0)
+	scamper_rtt_sample(ping->dst, SCAMPER_RTT_DST, &reply->rtt);
+    }
 
   /* put the reply into the ping table */
   scamper_ping_reply_append(ping, reply);
@@ -1053,6 +1066,10 @@ static void do_ping_probe(scamper_task_t *task)
 	  timeval_add_s(&wait_tv, &probe.pr_tx, ping->probe_wait);
 	  timeval_add_us(&wait_tv, &wait_tv, ping->probe_wait_us);
 	}
+      else if((ping->flags & SCAMPER_PING_FLAG_RTTWAIT) != 0)
+	timeval_add_ms(&wait_tv, &probe.pr_tx,
+		       scamper_rtt_wait(ping->dst, SCAMPER_RTT_DST,
+					ping->probe_timeout * 1000));
       else
 	timeval_add_s(&wait_tv, &probe.pr_tx, ping->probe_timeout);
     }
@@ -1522,6 +1539,10 @@ void *scamper_do_ping_alloc(char *str)
 	  flags |= SCAMPER_PING_FLAG_V4RR;
 	  break;
 
+	case PING_OPT_RTTWAIT:
+	  flags |= SCAMPER_PING_FLAG_RTTWAIT;
+	  break;
+
 	case PING_OPT_SRCADDR:
 	  if(src != NULL)
 	    goto err;
@@ -1690,6 +1711,14 @@ void *scamper_do_ping_alloc(char *str)
 	probe_sport = (pid & 0xffff) | 0x8000;
     }
 
+  /* tracemap claims replies to echo requests with these ICMP ids */
+  if(SCAMPER_PING_METHOD_IS_ICMP_ECHO(ping) &&
+     scamper_icmpid_isreserved(probe_sport) != 0)
+    {
+      scamper_debug(__func__, "icmp id %d is reserved", probe_sport);
+      goto err;
+    }
+
   if(probe_dport == -1)
     {
       if(SCAMPER_PING_METHOD_IS_ICMP(ping))
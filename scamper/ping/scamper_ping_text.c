@@ -191,8 +191,6 @@ int scamper_file_text_ping_write(const scamper_file_t *sf,
 				 const scamper_ping_t *ping)
 {
   scamper_ping_reply_t *reply;
-  int       fd          = scamper_file_getfd(sf);
-  off_t     off         = 0;
   uint32_t  reply_count = scamper_ping_reply_count(ping);
   char     *header      = NULL;
   size_t    header_len  = 0;
@@ -206,10 +204,6 @@ int scamper_file_text_ping_write(const scamper_file_t *sf,
   int       ret         = -1;
   uint32_t  i,j;
 
-  /* get current position incase trunction is required */
-  if(fd != 1 && (off = lseek(fd, 0, SEEK_CUR)) == -1)
-    return -1;
-
   /* get the header string */
   if((header = ping_header(ping)) == NULL)
     goto cleanup;
@@ -262,19 +256,9 @@ int scamper_file_text_ping_write(const scamper_file_t *sf,
       wc += stats_len;
     }
 
-  /*
-   * try and write the string to disk.  if it fails, then truncate the
-   * write and fail
-   */
-  if(write_wrap(fd, str, &wc, len) != 0)
-    {
-      if(fd != 1)
-	{
-	  if(ftruncate(fd, off) != 0)
-	    goto cleanup;
-	}
-      goto cleanup;
-    }
+  /* try and write the string out */
+  if(scamper_file_write_bytes(sf, str, len) != 0)
+    goto cleanup;
 
   ret = 0; /* we succeeded */
 
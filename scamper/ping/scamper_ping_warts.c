@@ -718,7 +718,7 @@ int scamper_file_warts_ping_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   uint16_t reply_count;
   warts_addrtable_t table;
 
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   if(warts_read(sf, &buf, hdr->len) != 0)
     {
@@ -782,12 +782,10 @@ int scamper_file_warts_ping_read(scamper_file_t *sf, const warts_hdr_t *hdr,
  done:
   warts_addrtable_clean(&table);
   *ping_out = ping;
-  free(buf);
   return 0;
 
  err:
   warts_addrtable_clean(&table);
-  if(buf != NULL) free(buf);
   if(ping != NULL) scamper_ping_free(ping);
   return -1;
 }
@@ -806,7 +804,7 @@ int scamper_file_warts_ping_write(const scamper_file_t *sf,
   size_t   size;
   int      i, j;
 
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   /* figure out which ping data items we'll store in this record */
   warts_ping_params(ping, &table, flags, &flags_len, &params_len);
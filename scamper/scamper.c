@@ -50,6 +50,7 @@ static const char rcsid[] =
 #include "scamper_queue.h"
 #include "scamper_getsrc.h"
 #include "scamper_addr2mac.h"
+#include "scamper_rtt.h"
 #include "scamper_icmp4.h"
 #include "scamper_icmp6.h"
 #include "scamper_udp4.h"
@@ -63,6 +64,7 @@ static const char rcsid[] =
 #include "scamper_control.h"
 #include "scamper_osinfo.h"
 #include "trace/scamper_trace_do.h"
+#include "trace/scamper_trace_lss.h"
 #include "ping/scamper_ping_do.h"
 #include "tracelb/scamper_tracelb_do.h"
 #include "dealias/scamper_dealias_do.h"
@@ -70,6 +72,7 @@ static const char rcsid[] =
 #include "neighbourdisc/scamper_neighbourdisc_do.h"
 #include "tbit/scamper_tbit_do.h"
 #include "sniff/scamper_sniff_do.h"
+#include "trace/scamper_tracemap_do.h"
 
 #include "utils.h"
 
@@ -102,6 +105,10 @@ static const char rcsid[] =
 #define OPT_EPOLL           0x04000000
 #define OPT_RAWTCP          0x08000000
 #define OPT_DEBUGFILEAPPEND 0x10000000
+#define OPT_CHECKPOINT      0x20000000 /* k: */
+#define OPT_RESUME          0x40000000
+#define OPT_METRICS         0x100000000ULL /* m: */
+#define OPT_OUTTHREAD       0x200000000ULL
 
 /*
  * parameters configurable by the command line:
@@ -124,8 +131,10 @@ static const char rcsid[] =
  * debugfile:   place to write debugging output
  * firewall:    scamper should use the system firewall when needed
  * pidfile:     place to write process id
+ * checkpoint:  place to periodically record the position of sources
+ * metrics:     file to use for unix domain metrics socket
  */
-static uint32_t options = 0;
+static uint64_t options = 0;
 static char  *command      = NULL;
 static int    pps          = SCAMPER_PPS_DEF;
 static int    window       = SCAMPER_WINDOW_DEF;
@@ -143,6 +152,23 @@ static int    arglist_len  = 0;
 static char  *debugfile    = NULL;
 static char  *firewall     = NULL;
 static char  *pidfile      = NULL;
+static char  *checkpoint   = NULL;
+static char  *metrics      = NULL;
+
+/*
+ * outbuf:   the number of bytes of records held in memory for each outfile
+ * outsync:  when the outfiles are synced to stable storage
+ * addrdict: the number of addresses in each warts outfile's dictionary
+ * dedup:    the number of targets per cycle the dedup filter is sized for
+ * lssdir:   directory that doubletree local stop sets are kept in
+ * lssmem:   the number of bytes used by each local stop set
+ */
+static size_t   outbuf     = 65536;
+static int      outsync    = SCAMPER_FILE_SYNC_NONE;
+static uint32_t addrdict   = 0;
+static uint32_t dedup      = 0;
+static char    *lssdir     = NULL;
+static size_t   lssmem     = 0;
 
 /*
  * parameters calculated by scamper at run time:
@@ -155,6 +181,19 @@ static int    wait_between   = 1000000 / SCAMPER_PPS_DEF;
 static int    probe_window   = 250000;
 static int    exit_when_done = 1;
 
+/*
+ * statistics on the main loop kept at run time:
+ *
+ * loop_hist:    histogram of the time spent processing each loop, which
+ *               includes the callbacks run by scamper_fds_poll but not
+ *               the time spent blocked waiting for an event
+ * loop_usec:    total time spent processing, in microseconds
+ * pps_achieved: the number of probes sent in the last full second
+ */
+static uint64_t loop_hist[SCAMPER_LOOP_HIST];
+static uint64_t loop_usec      = 0;
+static int      pps_achieved   = 0;
+
 /* central cache of addresses that scamper is dealing with */
 scamper_addrcache_t *addrcache = NULL;
 
@@ -181,7 +220,7 @@ static void version(void)
   return;
 }
 
-static void usage(uint32_t opt_mask)
+static void usage(uint64_t opt_mask)
 {
   char buf[256];
   size_t off;
@@ -191,9 +230,12 @@ static void usage(uint32_t opt_mask)
     "               [-M monitorname] [-l listname] [-L listid] [-C cycleid]\n"
     "               [-o outfile] [-O options] [-F firewall] [-e pidfile]\n"
 #ifndef WITHOUT_DEBUGFILE
-    "               [-d debugfile]\n"
+    "               [-d debugfile] [-k checkpoint]\n"
+#else
+    "               [-k checkpoint]\n"
 #endif
-    "               [-i IPs | -I cmds | -f file | -P port | -U unix-dom]\n");
+    "               [-i IPs | -I cmds | -f file | -P port | -U unix-dom]\n"
+    "               [-m metrics]\n");
 
   if(opt_mask == 0) return;
 
@@ -230,6 +272,9 @@ static void usage(uint32_t opt_mask)
   if((opt_mask & OPT_IP) != 0)
     usage_str('i', "list of IP addresses provided on the command line");
 
+  if((opt_mask & OPT_CHECKPOINT) != 0)
+    usage_str('k', "periodically record the position of input files");
+
   if((opt_mask & OPT_CMDLIST) != 0)
     usage_str('I', "list of scamper commands provided on the command line");
 
@@ -250,6 +295,13 @@ static void usage(uint32_t opt_mask)
       off = 0;
       string_concat(buf, sizeof(buf), &off, "specify options [warts | text | json | csv");
       string_concat(buf, sizeof(buf), &off, " | outcopy | tsps | dlts");
+      string_concat(buf, sizeof(buf), &off, " | resume | dedup[=N]");
+      string_concat(buf, sizeof(buf), &off, " | outbuf=N | fsync | fsynccycle");
+      string_concat(buf, sizeof(buf), &off, " | addrdict=N");
+      string_concat(buf, sizeof(buf), &off, " | lssdir=D | lssmem=N");
+#ifdef HAVE_PTHREAD
+      string_concat(buf, sizeof(buf), &off, " | outthread");
+#endif
       string_concat(buf, sizeof(buf), &off, " | rawtcp");
 #ifndef WITHOUT_DEBUGFILE
       string_concat(buf, sizeof(buf), &off, " | debugfileappend");
@@ -283,6 +335,9 @@ static void usage(uint32_t opt_mask)
   if((opt_mask & OPT_CTRL_UNIX) != 0)
     usage_str('U', "name of control socket in the file system");
 
+  if((opt_mask & OPT_METRICS) != 0)
+    usage_str('m', "name of metrics socket in the file system");
+
   if((opt_mask & OPT_VERSION) != 0)
     usage_str('v', "output the version of scamper this binary is");
 
@@ -429,6 +484,8 @@ static int check_options(int argc, char *argv[])
      scamper_do_tbit_arg_validate, scamper_do_tbit_usage},
     {"scamper-sniff", "sniff",
      scamper_do_sniff_arg_validate, scamper_do_sniff_usage},
+    {"scamper-tracemap", "tracemap",
+     scamper_do_tracemap_arg_validate, scamper_do_tracemap_usage},
   };
   int   i;
   long  lo, lo_w = window, lo_p = pps;
@@ -437,6 +494,7 @@ static int check_options(int argc, char *argv[])
   char *opt_ctrl_port = NULL, *opt_ctrl_unix = NULL, *opt_monitorname = NULL;
   char *opt_pps = NULL, *opt_command = NULL, *opt_window = NULL;
   char *opt_debugfile = NULL, *opt_firewall = NULL, *opt_pidfile = NULL;
+  char *opt_checkpoint = NULL;
   size_t argv0 = strlen(argv[0]);
   size_t m, len;
   size_t off;
@@ -452,12 +510,12 @@ static int check_options(int argc, char *argv[])
     }
 
   off = 0;
-  string_concat(opts, sizeof(opts), &off, "c:C:d:e:fF:iIl:L:M:o:O:p:P:vw:?");
+  string_concat(opts, sizeof(opts), &off, "c:C:d:e:fF:iIk:l:L:M:o:O:p:P:vw:?");
 #if !defined(__sun__) && !defined(_WIN32)
   string_concat(opts, sizeof(opts), &off, "D");
 #endif
 #if defined(AF_UNIX)
-  string_concat(opts, sizeof(opts), &off, "U:");
+  string_concat(opts, sizeof(opts), &off, "m:U:");
 #endif
 
   while((i = getopt(argc, argv, opts)) != -1)
@@ -505,6 +563,11 @@ static int check_options(int argc, char *argv[])
 	  options |= OPT_CMDLIST;
 	  break;
 
+	case 'k':
+	  options |= OPT_CHECKPOINT;
+	  opt_checkpoint = optarg;
+	  break;
+
 	case 'l':
 	  options |= OPT_LISTNAME;
 	  opt_listname = optarg;
@@ -530,6 +593,10 @@ static int check_options(int argc, char *argv[])
 	    outtype = optarg;
 	  else if(strcasecmp(optarg, "warts") == 0)
 	    outtype = optarg;
+#ifdef HAVE_ZLIB
+	  else if(strcasecmp(optarg, "warts.gz") == 0)
+	    outtype = optarg;
+#endif
 	  else if(strcasecmp(optarg, "json") == 0)
 	    outtype = optarg;
 	  else if(strcasecmp(optarg, "csv") == 0)
@@ -550,6 +617,65 @@ static int check_options(int argc, char *argv[])
 	    options |= OPT_SELECT;
 	  else if(strcasecmp(optarg, "rawtcp") == 0)
 	    options |= OPT_RAWTCP;
+	  else if(strcasecmp(optarg, "resume") == 0)
+	    options |= OPT_RESUME;
+	  else if(strcasecmp(optarg, "dedup") == 0)
+	    dedup = 1000000;
+	  else if(strncasecmp(optarg, "dedup=", 6) == 0)
+	    {
+	      if(string_isnumber(optarg+6) == 0 ||
+		 string_tolong(optarg+6, &lo) != 0 ||
+		 lo < 1 || lo > 100000000)
+		{
+		  usage(OPT_OPTION);
+		  return -1;
+		}
+	      dedup = lo;
+	    }
+	  else if(strcasecmp(optarg, "fsync") == 0)
+	    outsync = SCAMPER_FILE_SYNC_FLUSH;
+	  else if(strcasecmp(optarg, "fsynccycle") == 0)
+	    outsync = SCAMPER_FILE_SYNC_CYCLE;
+	  else if(strncasecmp(optarg, "outbuf=", 7) == 0)
+	    {
+	      if(string_isnumber(optarg+7) == 0 ||
+		 string_tolong(optarg+7, &lo) != 0 ||
+		 lo < 0 || lo > 16 * 1024 * 1024)
+		{
+		  usage(OPT_OPTION);
+		  return -1;
+		}
+	      outbuf = lo;
+	    }
+#ifdef HAVE_PTHREAD
+	  else if(strcasecmp(optarg, "outthread") == 0)
+	    options |= OPT_OUTTHREAD;
+#endif
+	  else if(strncasecmp(optarg, "addrdict=", 9) == 0)
+	    {
+	      if(string_isnumber(optarg+9) == 0 ||
+		 string_tolong(optarg+9, &lo) != 0 ||
+		 lo < 0 || lo > SCAMPER_FILE_ADDRDICT_MAX)
+		{
+		  usage(OPT_OPTION);
+		  return -1;
+		}
+	      addrdict = lo;
+	    }
+	  else if(strncasecmp(optarg, "lssdir=", 7) == 0 && optarg[7] != '\0')
+	    lssdir = optarg+7;
+	  else if(strncasecmp(optarg, "lssmem=", 7) == 0)
+	    {
+	      if(string_isnumber(optarg+7) == 0 ||
+		 string_tolong(optarg+7, &lo) != 0 ||
+		 lo < SCAMPER_TRACE_LSS_SIZE_MIN ||
+		 lo > SCAMPER_TRACE_LSS_SIZE_MAX)
+		{
+		  usage(OPT_OPTION);
+		  return -1;
+		}
+	      lssmem = lo;
+	    }
 #ifdef HAVE_KQUEUE
 	  else if(strcasecmp(optarg, "kqueue") == 0)
 	    options |= OPT_KQUEUE;
@@ -584,6 +710,11 @@ static int check_options(int argc, char *argv[])
 	  opt_ctrl_unix = optarg;
 	  break;
 
+	case 'm':
+	  options |= OPT_METRICS;
+	  metrics = optarg;
+	  break;
+
 	case 'v':
 	  options |= OPT_VERSION;
 	  break;
@@ -595,7 +726,7 @@ static int check_options(int argc, char *argv[])
 
 	case '?':
 	  options |= OPT_HELP;
-	  usage(0xffffffff);
+	  usage(0xffffffffffffffffULL);
 	  return -1;
 
 	default:
@@ -683,6 +814,20 @@ static int check_options(int argc, char *argv[])
       return -1;
     }
 
+  if(options & OPT_CHECKPOINT &&
+     (checkpoint = strdup(opt_checkpoint)) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not strdup checkpoint");
+      return -1;
+    }
+
+  /* resuming requires a checkpoint file to resume from */
+  if((options & OPT_RESUME) && (options & OPT_CHECKPOINT) == 0)
+    {
+      usage(OPT_CHECKPOINT);
+      return -1;
+    }
+
   /* only one of the following should be specified */
   o = options & (OPT_IP|OPT_CTRL_PORT|OPT_CTRL_UNIX|OPT_CMDLIST|OPT_INFILE);
   if(((o & OPT_IP)        != 0 && (o & ~OPT_IP)        != 0) ||
@@ -815,6 +960,25 @@ int scamper_pps_get()
   return pps;
 }
 
+int scamper_pps_achieved(void)
+{
+  return pps_achieved;
+}
+
+/*
+ * scamper_loop_stats
+ *
+ * report the histogram of time spent processing each main loop, and the
+ * total time spent.  the upper bound of bucket i is 10^(i+1) microseconds,
+ * except for the last bucket which has no upper bound.
+ */
+void scamper_loop_stats(uint64_t *hist, uint64_t *usec)
+{
+  memcpy(hist, loop_hist, sizeof(loop_hist));
+  *usec = loop_usec;
+  return;
+}
+
 int scamper_pps_set(const int p)
 {
   return ppswindow_set(p, window);
@@ -912,6 +1076,50 @@ int scamper_option_debugfileappend(void)
   return 0;
 }
 
+uint32_t scamper_option_dedup(void)
+{
+  return dedup;
+}
+
+size_t scamper_option_outbuf(void)
+{
+  return outbuf;
+}
+
+uint32_t scamper_option_addrdict(void)
+{
+  return addrdict;
+}
+
+const char *scamper_option_lssdir(void)
+{
+  return lssdir;
+}
+
+size_t scamper_option_lssmem(void)
+{
+  return lssmem;
+}
+
+int scamper_option_fsync(void)
+{
+  return outsync;
+}
+
+int scamper_option_outthread(void)
+{
+  if(options & OPT_OUTTHREAD)
+    return 1;
+  return 0;
+}
+
+int scamper_option_outcopy(void)
+{
+  if(options & OPT_OUTCOPY)
+    return 1;
+  return 0;
+}
+
 static int scamper_pidfile(void)
 {
   char buf[32];
@@ -991,6 +1199,32 @@ uint16_t scamper_sport_default(void)
   return default_sport;
 }
 
+/*
+ * scamper_icmpid_reserved
+ *
+ * the ICMP echo ids whose high byte is returned here are reserved for
+ * tracemap, which matches replies by the ICMP id alone.  the byte differs
+ * from the high byte of default_sport, and from the high byte of the
+ * process id that ping uses by default.
+ */
+uint16_t scamper_icmpid_reserved(void)
+{
+  return (((default_sport >> 8) & 0x7f) ^ 0x40) << 8;
+}
+
+/*
+ * scamper_icmpid_isreserved
+ *
+ * return non-zero if a measurement other than tracemap may not send ICMP
+ * echo requests with this id, as tracemap would claim the replies.
+ */
+int scamper_icmpid_isreserved(uint16_t id)
+{
+  if((id & 0xff00) == scamper_icmpid_reserved())
+    return 1;
+  return 0;
+}
+
 /*
  * scamper:
  * this bit of code contains most of the logic for driving the parallel
@@ -1001,13 +1235,18 @@ static int scamper(int argc, char *argv[])
   struct timeval           tv;
   struct timeval           lastprobe;
   struct timeval           nextprobe;
+  struct timeval           nextcheckpoint;
+  struct timeval           nextflush;
+  struct timeval           loopstart;
+  struct timeval           loopend;
+  struct timeval           waited;
   struct timeval          *timeout;
-  const char              *sofname;
   scamper_source_params_t  ssp;
   scamper_source_t        *source = NULL;
   scamper_task_t          *task;
-  scamper_outfile_t       *sof, *sof2;
-  scamper_file_t          *file;
+  uint64_t                 tx, err, pps_tx = 0;
+  time_t                   pps_sec = 0;
+  int                      i, us, flush = 0;
 
   if(check_options(argc, argv) == -1)
     {
@@ -1109,6 +1348,9 @@ static int scamper(int argc, char *argv[])
       exit_when_done = 0;
     }
 
+  if((options & OPT_METRICS) && scamper_control_init_metrics(metrics) != 0)
+    return -1;
+
   /* initialise the subsystem responsible for obtaining source addresses */
   if(scamper_getsrc_init() == -1)
     {
@@ -1121,6 +1363,12 @@ static int scamper(int argc, char *argv[])
       return -1;
     }
 
+  /* initialise the RTT estimates used to decide how long to wait */
+  if(scamper_rtt_init() == -1)
+    {
+      return -1;
+    }
+
   if(scamper_rtsock_init() == -1)
     {
       return -1;
@@ -1164,7 +1412,14 @@ static int scamper(int argc, char *argv[])
      scamper_do_sting_init() != 0 ||
      scamper_do_neighbourdisc_init() != 0 ||
      scamper_do_tbit_init() != 0 ||
-     scamper_do_sniff_init() != 0)
+     scamper_do_sniff_init() != 0 ||
+     scamper_do_tracemap_init() != 0)
+    {
+      return -1;
+    }
+
+  /* read the position of sources from a previous run */
+  if((options & OPT_RESUME) && scamper_sources_resume(checkpoint) != 0)
     {
       return -1;
     }
@@ -1213,6 +1468,7 @@ static int scamper(int argc, char *argv[])
     }
 
   gettimeofday_wrap(&lastprobe);
+  timeval_add_s(&nextcheckpoint, &lastprobe, SCAMPER_CHECKPOINT_INTERVAL);
 
 #ifndef _WIN32
   srandom(lastprobe.tv_usec);
@@ -1220,6 +1476,8 @@ static int scamper(int argc, char *argv[])
 
   for(;;)
     {
+      gettimeofday_wrap(&loopstart);
+
       if(scamper_queue_readycount() > 0 ||
 	 ((window == 0 || scamper_queue_windowcount() < window) &&
 	  scamper_sources_isready() != 0))
@@ -1250,6 +1508,14 @@ static int scamper(int argc, char *argv[])
 	  timeout = NULL;
 	}
 
+      /* wake up when buffered records are due to be written out */
+      if(flush != 0 &&
+	 (timeout == NULL || timeval_cmp(&nextflush, &nextprobe) < 0))
+	{
+	  timeval_cpy(&nextprobe, &nextflush);
+	  timeout = &tv;
+	}
+
       if(timeout != NULL)
 	{
 	  /*
@@ -1284,29 +1550,22 @@ static int scamper(int argc, char *argv[])
       while((task = scamper_queue_getdone(&tv)) != NULL)
 	{
 	  /* write the data out */
-	  if((source = scamper_task_getsource(task)) != NULL &&
-	     (sofname = scamper_source_getoutfile(source)) != NULL &&
-	     (sof = scamper_outfiles_get(sofname)) != NULL)
-	    {
-	      file = scamper_outfile_getfile(sof);
-	      scamper_task_write(task, file);
-
-	      /*
-	       * write a copy of the data out if asked to, and it has not
-	       * already been written to this output file.
-	       */
-	      if((options & OPT_OUTCOPY) != 0 &&
-		 (sof2 = scamper_outfiles_get(NULL)) != NULL && sof != sof2)
-		{
-		  file = scamper_outfile_getfile(sof2);
-		  scamper_task_write(task, file);
-		}
-	    }
+	  scamper_task_output(task);
 
 	  /* cleanup the task */
 	  scamper_task_free(task);
 	}
 
+      /* write out records that have been buffered for long enough */
+      flush = scamper_outfiles_flush(&tv, &nextflush);
+
+      /* record the position of the sources if it is time to do so */
+      if(checkpoint != NULL && timeval_cmp(&tv, &nextcheckpoint) >= 0)
+	{
+	  scamper_sources_checkpoint(checkpoint);
+	  timeval_add_s(&nextcheckpoint, &tv, SCAMPER_CHECKPOINT_INTERVAL);
+	}
+
       /*
        * if there is something waiting to be probed, then find out if it is
        * time to probe yet
@@ -1359,6 +1618,15 @@ static int scamper(int argc, char *argv[])
 		      break;
 		    }
 
+		  /*
+		   * if the outfiles are behind in writing out results,
+		   * don't add any new tasks until they catch up
+		   */
+		  if(scamper_outfiles_isbusy() != 0)
+		    {
+		      break;
+		    }
+
 		  /*
 		   * if there are no more tasks ready to be added yet, there's
 		   * nothing more to be done in the loop
@@ -1373,8 +1641,39 @@ static int scamper(int argc, char *argv[])
 	      timeval_cpy(&lastprobe, &nextprobe);
 	    }
 	}
+
+      /*
+       * record how long it took to process the events of this loop,
+       * leaving out the time spent idle in poll.
+       */
+      gettimeofday_wrap(&loopend);
+      scamper_fds_waited(&waited);
+      us = timeval_diff_us(&loopend, &loopstart) -
+	((waited.tv_sec * 1000000) + waited.tv_usec);
+      if(us < 0)
+	us = 0;
+      loop_usec += us;
+      for(i=0; i<SCAMPER_LOOP_HIST-1 && us >= 10; i++)
+	us /= 10;
+      loop_hist[i]++;
+
+      /* record the number of probes sent in the last second */
+      if(loopend.tv_sec != pps_sec)
+	{
+	  scamper_probe_stats(&tx, &err);
+	  if(loopend.tv_sec == pps_sec + 1)
+	    pps_achieved = tx - pps_tx;
+	  else
+	    pps_achieved = 0;
+	  pps_tx = tx;
+	  pps_sec = loopend.tv_sec;
+	}
     }
 
+  /* all sources are finished, so record that there is nothing to resume */
+  if(checkpoint != NULL)
+    scamper_sources_checkpoint(checkpoint);
+
   return 0;
 }
 
@@ -1395,6 +1694,7 @@ static void cleanup(void)
   scamper_tcp4_cleanup();
 
   scamper_addr2mac_cleanup();
+  scamper_rtt_cleanup();
 
   scamper_do_trace_cleanup();
   scamper_do_ping_cleanup();
@@ -1404,12 +1704,13 @@ static void cleanup(void)
   scamper_do_neighbourdisc_cleanup();
   scamper_do_tbit_cleanup();
   scamper_do_sniff_cleanup();
+  scamper_do_tracemap_cleanup();
 
   scamper_sources_cleanup();
 
   scamper_dl_cleanup();
 
-  if(options & (OPT_CTRL_PORT|OPT_CTRL_UNIX))
+  if(options & (OPT_CTRL_PORT|OPT_CTRL_UNIX|OPT_METRICS))
     scamper_control_cleanup();
 
   scamper_outfiles_cleanup();
@@ -1462,6 +1763,12 @@ static void cleanup(void)
       pidfile = NULL;
     }
 
+  if(checkpoint != NULL)
+    {
+      free(checkpoint);
+      checkpoint = NULL;
+    }
+
   return;
 }
 
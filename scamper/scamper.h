@@ -30,6 +30,7 @@
 #define SCAMPER_PPS_MAX       1000
 int scamper_pps_get(void);
 int scamper_pps_set(const int pps);
+int scamper_pps_achieved(void);
 
 #define SCAMPER_WINDOW_MIN    0
 #define SCAMPER_WINDOW_DEF    0
@@ -52,10 +53,27 @@ int scamper_option_kqueue(void);
 int scamper_option_epoll(void);
 int scamper_option_rawtcp(void);
 int scamper_option_debugfileappend(void);
+uint32_t scamper_option_dedup(void);
+size_t scamper_option_outbuf(void);
+uint32_t scamper_option_addrdict(void);
+const char *scamper_option_lssdir(void);
+size_t scamper_option_lssmem(void);
+int scamper_option_fsync(void);
+int scamper_option_outthread(void);
+int scamper_option_outcopy(void);
 
 void scamper_exitwhendone(int on);
 
+/* number of buckets in the histogram of main loop processing time */
+#define SCAMPER_LOOP_HIST 7
+void scamper_loop_stats(uint64_t *hist, uint64_t *usec);
+
+/* number of seconds between writes of the checkpoint file */
+#define SCAMPER_CHECKPOINT_INTERVAL 60
+
 uint16_t scamper_sport_default(void);
+uint16_t scamper_icmpid_reserved(void);
+int scamper_icmpid_isreserved(uint16_t id);
 
 #define SCAMPER_VERSION "20140404"
 
@@ -48,6 +48,10 @@ static const char rcsid[] =
 #include "scamper_source_control.h"
 #include "scamper_source_tsps.h"
 #include "scamper_privsep.h"
+#include "scamper_addr.h"
+#include "scamper_dl.h"
+#include "scamper_probe.h"
+#include "scamper_icmp_resp.h"
 #include "mjl_list.h"
 #include "utils.h"
 
@@ -58,11 +62,13 @@ static const char rcsid[] =
 /*
  * client_obj_t
  *
+ * a record waiting to be sent to a client.  the bytes of the record are
+ * held in the same allocation, following the structure.
  */
 typedef struct client_obj
 {
-  void   *data;
-  size_t  len;
+  uint8_t *data;
+  size_t   len;
 } client_obj_t;
 
 /*
@@ -115,6 +121,10 @@ typedef struct client
    *  sof_txt:    text strings to pass over socket when able to.
    *  sof_obj:    current object partially written over socket.
    *  sof_off:    offset into current object being written.
+   *  sof_format: how objects are framed over the socket.
+   *  batch:      commands of a batch that are being received.
+   *  batch_c:    the number of commands in the batch.
+   *  batch_i:    the number of commands of the batch received so far.
    */
   scamper_source_t   *source;
   scamper_outfile_t  *sof;
@@ -122,12 +132,21 @@ typedef struct client
   slist_t            *sof_objs;
   client_obj_t       *sof_obj;
   size_t              sof_off;
+  int                 sof_format;
+  char              **batch;
+  int                 batch_c;
+  int                 batch_i;
 } client_t;
 
+#define CLIENT_BATCH_MAX 100000
+
 #define CLIENT_MODE_INTERACTIVE 0
 #define CLIENT_MODE_ATTACHED    1
 #define CLIENT_MODE_FLUSH       2
 
+#define CLIENT_FORMAT_UUENCODE  0
+#define CLIENT_FORMAT_BINARY    1
+
 typedef struct command
 {
   char *word;
@@ -150,6 +169,13 @@ static scamper_fd_t *fdn          = NULL;
 #if defined(AF_UNIX) && !defined(_WIN32)
 static char         *ctrl_unix_name = NULL;
 static int           ctrl_unix_num  = 0;
+
+/*
+ * metrics_fdn: a unix domain socket that reports counters when connected to
+ * metrics_unix_name: the path of the metrics socket
+ */
+static scamper_fd_t *metrics_fdn       = NULL;
+static char         *metrics_unix_name = NULL;
 #endif
 
 static int command_handler(command_t *handler, int cnt, client_t *client,
@@ -248,8 +274,6 @@ static void client_obj_free(client_obj_t *obj)
 {
   if(obj == NULL)
     return;
-  if(obj->data != NULL)
-    free(obj->data);
   free(obj);
   return;
 }
@@ -293,6 +317,26 @@ static char *client_sockaddr_tostr(client_t *client, char *buf, size_t len)
   return buf;
 }
 
+/*
+ * client_batch_free
+ *
+ * free any commands of a batch that have been received.
+ */
+static void client_batch_free(client_t *client)
+{
+  int i;
+
+  if(client->batch == NULL)
+    return;
+  for(i=0; i<client->batch_i; i++)
+    free(client->batch[i]);
+  free(client->batch);
+  client->batch = NULL;
+  client->batch_c = 0;
+  client->batch_i = 0;
+  return;
+}
+
 /*
  * client_free
  *
@@ -368,6 +412,8 @@ static void client_free(client_t *client)
       client->sof_txt = NULL;
     }
 
+  client_batch_free(client);
+
   free(client);
   return;
 }
@@ -469,7 +515,8 @@ static int client_send(client_t *client, char *fs, ...)
     }
   str[len++] = '\n';
 
-  if(client->mode == CLIENT_MODE_ATTACHED)
+  if(client->mode == CLIENT_MODE_ATTACHED &&
+     client->sof_format == CLIENT_FORMAT_UUENCODE)
     {
       if(str == msg && (str = memdup(msg, len)) == NULL)
 	goto err;
@@ -676,6 +723,8 @@ static int client_data_send(void *param, const void *vdata, size_t len)
   client_t *client = param;
   client_obj_t *obj = NULL;
   const uint8_t *data = vdata;
+  struct iovec iov[2];
+  char hdr[32];
 
   assert(len >= 8);
 
@@ -695,18 +744,32 @@ static int client_data_send(void *param, const void *vdata, size_t len)
   if(data[2] == 0 && data[3] == 0x04)
     client->mode = CLIENT_MODE_FLUSH;
 
-  if((obj = malloc_zero(sizeof(client_obj_t))) == NULL)
+  /*
+   * in binary mode the object is framed with a line giving its length,
+   * and both are queued on the writebuf together without encoding.
+   */
+  if(client->sof_format == CLIENT_FORMAT_BINARY)
     {
-      printerror(errno, strerror, __func__, "could not alloc obj");
-      goto err;
+      iov[0].iov_base = hdr;
+      iov[0].iov_len  = snprintf(hdr, sizeof(hdr), "BDATA %d\n", (int)len);
+      iov[1].iov_base = (void *)vdata;
+      iov[1].iov_len  = len;
+      if(scamper_writebuf_sendv(client->wb, iov, 2) != 0)
+	{
+	  printerror(errno, strerror, __func__, "could not send BDATA");
+	  goto err;
+	}
+      return 0;
     }
 
-  if((obj->data = memdup(vdata, len)) == NULL)
+  if((obj = malloc(sizeof(client_obj_t) + len)) == NULL)
     {
-      printerror(errno, strerror, __func__, "could not memdup");
+      printerror(errno, strerror, __func__, "could not alloc obj");
       goto err;
     }
-  obj->len = len;
+  obj->data = (uint8_t *)(obj + 1);
+  obj->len  = len;
+  memcpy(obj->data, vdata, len);
 
   if(slist_tail_push(client->sof_objs, obj) == NULL)
     {
@@ -723,10 +786,13 @@ static int client_data_send(void *param, const void *vdata, size_t len)
   return -1;
 }
 
-static void client_signalmore(void *param)
+static void client_signalmore(void *param, int credits)
 {
   client_t *client = (client_t *)param;
-  client_send(client, "MORE");
+  if(credits == 0)
+    client_send(client, "MORE");
+  else
+    client_send(client, "MORE %d", credits);
   return;
 }
 
@@ -755,11 +821,14 @@ static int command_attach(client_t *client, char *buf)
   scamper_source_params_t ssp;
   scamper_file_t *sf;
   char sab[128];
-  long priority = 1;
-  char *priority_str = NULL, *params[2], *next;
+  long priority = 1, window = 0;
+  char *priority_str = NULL, *format_str = NULL, *window_str = NULL;
+  char *params[6], *next;
   int i, cnt = sizeof(params) / sizeof(char *);
   param_t handlers[] = {
+    {"format",   &format_str},
     {"priority", &priority_str},
+    {"window",   &window_str},
   };
   int handler_cnt = sizeof(handlers) / sizeof(param_t);
 
@@ -786,6 +855,24 @@ static int command_attach(client_t *client, char *buf)
       return 0;
     }
 
+  if(window_str != NULL && (string_tolong(window_str, &window) != 0 ||
+			    window < 1 || window > 100000))
+    {
+      client_send(client, "ERR invalid window");
+      return 0;
+    }
+
+  if(format_str != NULL)
+    {
+      if(strcasecmp(format_str, "binary") == 0)
+	client->sof_format = CLIENT_FORMAT_BINARY;
+      else if(strcasecmp(format_str, "uuencode") != 0)
+	{
+	  client_send(client, "ERR invalid format");
+	  return 0;
+	}
+    }
+
   client_sockaddr_tostr(client, sab, sizeof(sab));
 
   if((client->sof_objs = slist_alloc()) == NULL)
@@ -822,6 +909,8 @@ static int command_attach(client_t *client, char *buf)
 		 "could not allocate source '%s'", sab);
       goto err;
     }
+  if(window != 0)
+    scamper_source_control_window(client->source, window);
 
   /* put the source into rotation */
   if(scamper_sources_add(client->source) != 0)
@@ -1913,6 +2002,172 @@ static int command_shutdown(client_t *client, char *buf)
   return 0;
 }
 
+/*
+ * stats_t
+ *
+ * state used when reporting counters to a client, either in reply to a
+ * stats command, or to a client that connected to the metrics socket.
+ */
+typedef struct stats
+{
+  client_t   *client;
+  const char *pfx;
+  int         tasks;  /* stats_source reports tasks rather than commands */
+} stats_t;
+
+static void stats_send(stats_t *st, const char *name, const char *label,
+		       unsigned long long val)
+{
+  client_send(st->client, "%s%s%s %llu", st->pfx, name, label, val);
+  return;
+}
+
+/*
+ * stats_type
+ *
+ * announce the type of a metric, ahead of the lines that report it.
+ */
+static void stats_type(stats_t *st, const char *name, const char *type)
+{
+  client_send(st->client, "%s# TYPE %s %s", st->pfx, name, type);
+  return;
+}
+
+static int stats_source(void *param, scamper_source_t *source)
+{
+  stats_t *st = (stats_t *)param;
+  char label[128];
+  int c;
+
+  snprintf(label, sizeof(label), "{source=\"%s\"}",
+	   scamper_source_getname(source));
+  if(st->tasks == 0)
+    {
+      if((c = scamper_source_getcommandcount(source)) < 0) c = 0;
+      stats_send(st, "scamper_source_commands", label, c);
+    }
+  else
+    {
+      if((c = scamper_source_gettaskcount(source)) < 0) c = 0;
+      stats_send(st, "scamper_source_tasks", label, c);
+    }
+  return 0;
+}
+
+static int stats_outfile(void *param, scamper_outfile_t *sof)
+{
+  stats_t *st = (stats_t *)param;
+  char label[128];
+
+  snprintf(label, sizeof(label), "{outfile=\"%s\"}",
+	   scamper_outfile_getname(sof));
+  stats_send(st, "scamper_outfile_bytes", label,
+	     scamper_file_getbytes(scamper_outfile_getfile(sof)));
+  return 0;
+}
+
+/*
+ * stats_report
+ *
+ * report the counters scamper keeps, one per line.  the names and labels
+ * follow the prometheus text exposition format, so that the same lines can
+ * be served over the metrics socket without a prefix.  each metric is
+ * preceded by a line with its type, and the lines of a metric are kept
+ * together.
+ */
+static void stats_report(client_t *client, const char *pfx)
+{
+  static const char *le[] = {"10", "100", "1000", "10000", "100000",
+			     "1000000", "+Inf"};
+  uint64_t hist[SCAMPER_LOOP_HIST], a, b, sum;
+  dlist_node_t *dn;
+  client_t *c;
+  stats_t st;
+  char label[32];
+  int i, probe, wait, done;
+  size_t backlog = 0;
+
+  st.client = client;
+  st.pfx = pfx;
+  st.tasks = 0;
+
+  scamper_probe_stats(&a, &b);
+  stats_type(&st, "scamper_probes_sent", "counter");
+  stats_send(&st, "scamper_probes_sent", "", a);
+  stats_type(&st, "scamper_probes_failed", "counter");
+  stats_send(&st, "scamper_probes_failed", "", b);
+
+  scamper_icmp_resp_stats(&a, &b);
+  stats_type(&st, "scamper_icmp_matched", "counter");
+  stats_send(&st, "scamper_icmp_matched", "", a);
+  stats_type(&st, "scamper_icmp_unmatched", "counter");
+  stats_send(&st, "scamper_icmp_unmatched", "", b);
+
+  scamper_queue_stats(&probe, &wait, &done, &a);
+  stats_type(&st, "scamper_queue_depth", "gauge");
+  stats_send(&st, "scamper_queue_depth", "{queue=\"probe\"}", probe);
+  stats_send(&st, "scamper_queue_depth", "{queue=\"wait\"}", wait);
+  stats_send(&st, "scamper_queue_depth", "{queue=\"done\"}", done);
+  stats_type(&st, "scamper_timeouts", "counter");
+  stats_send(&st, "scamper_timeouts", "", a);
+
+  /* the histogram buckets are cumulative */
+  scamper_loop_stats(hist, &sum);
+  stats_type(&st, "scamper_loop_usec", "histogram");
+  a = 0;
+  for(i=0; i<SCAMPER_LOOP_HIST; i++)
+    {
+      a += hist[i];
+      snprintf(label, sizeof(label), "{le=\"%s\"}", le[i]);
+      stats_send(&st, "scamper_loop_usec_bucket", label, a);
+    }
+  stats_send(&st, "scamper_loop_usec_sum", "", sum);
+  stats_send(&st, "scamper_loop_usec_count", "", a);
+
+  stats_type(&st, "scamper_pps_target", "gauge");
+  stats_send(&st, "scamper_pps_target", "", scamper_pps_get());
+  stats_type(&st, "scamper_pps_achieved", "gauge");
+  stats_send(&st, "scamper_pps_achieved", "", scamper_pps_achieved());
+  stats_type(&st, "scamper_window_used", "gauge");
+  stats_send(&st, "scamper_window_used", "", scamper_queue_windowcount());
+  stats_type(&st, "scamper_window_max", "gauge");
+  stats_send(&st, "scamper_window_max", "", scamper_window_get());
+  stats_type(&st, "scamper_fds", "gauge");
+  stats_send(&st, "scamper_fds", "", scamper_fds_count());
+  stats_type(&st, "scamper_dedup_suppressed", "counter");
+  stats_send(&st, "scamper_dedup_suppressed", "", scamper_sources_dedup_count());
+
+  for(dn=dlist_head_node(client_list); dn != NULL; dn=dlist_node_next(dn))
+    {
+      c = dlist_node_item(dn);
+      if(c->wb != NULL)
+	backlog += scamper_writebuf_len(c->wb);
+    }
+  stats_type(&st, "scamper_control_backlog_bytes", "gauge");
+  stats_send(&st, "scamper_control_backlog_bytes", "", backlog);
+
+  stats_type(&st, "scamper_source_commands", "gauge");
+  scamper_sources_foreach(&st, stats_source);
+  st.tasks = 1;
+  stats_type(&st, "scamper_source_tasks", "gauge");
+  scamper_sources_foreach(&st, stats_source);
+  stats_type(&st, "scamper_outfile_bytes", "counter");
+  scamper_outfiles_foreach(&st, stats_outfile);
+  return;
+}
+
+/*
+ * command_stats
+ *
+ * stats
+ */
+static int command_stats(client_t *client, char *buf)
+{
+  stats_report(client, "INFO ");
+  client_send(client, "OK");
+  return 0;
+}
+
 static int client_isdone(client_t *client)
 {
   size_t len;
@@ -1988,9 +2243,55 @@ static int client_attached_cb(client_t *client, uint8_t *buf, size_t len)
   char *str;
   long l;
   uint32_t id;
+  int i, rc;
 
   assert(client->source != NULL);
 
+  /* collect the commands of a batch, and submit them together */
+  if(client->batch != NULL)
+    {
+      if((client->batch[client->batch_i] = memdup(buf, len+1)) == NULL)
+	{
+	  printerror(errno, strerror, __func__, "could not memdup command");
+	  client_batch_free(client);
+	  return client_send(client, "ERR internal error");
+	}
+      if(++client->batch_i < client->batch_c)
+	return 0;
+
+      if(scamper_source_commandv(client->source, client->batch,
+				 client->batch_c, &id, &i) != 0)
+	{
+	  if(i >= 0)
+	    rc = client_send(client, "ERR batch command %d not accepted", i+1);
+	  else
+	    rc = client_send(client, "ERR batch not accepted");
+	}
+      else
+	{
+	  rc = client_send(client, "OK id-%u-%u", id, id + client->batch_c - 1);
+	}
+
+      scamper_source_control_received(client->source, client->batch_c);
+      client_batch_free(client);
+      return rc;
+    }
+
+  if(len >= 6 && strncasecmp((char *)buf, "batch ", 6) == 0)
+    {
+      str = string_nextword((char *)buf);
+      if(str == NULL || string_isnumber(str) == 0 ||
+	 string_tolong(str, &l) != 0 || l < 1 || l > CLIENT_BATCH_MAX)
+	return client_send(client, "ERR usage: batch [count]");
+      if((client->batch = malloc_zero(sizeof(char *) * l)) == NULL)
+	{
+	  printerror(errno, strerror, __func__, "could not alloc batch");
+	  return client_send(client, "ERR internal error");
+	}
+      client->batch_c = l;
+      return 0;
+    }
+
   /* the control socket will not be supplying any more tasks */
   if(len == 4 && strcasecmp((char *)buf, "done") == 0)
     {
@@ -2014,9 +2315,13 @@ static int client_attached_cb(client_t *client, uint8_t *buf, size_t len)
 
   /* try the command to see if it is valid and acceptable */
   if(scamper_source_command2(client->source, (char *)buf, &id) != 0)
-    return client_send(client, "ERR command not accepted");
+    rc = client_send(client, "ERR command not accepted");
+  else
+    rc = client_send(client, "OK id-%d", id);
 
-  return client_send(client, "OK id-%d", id);
+  /* the command used up a credit, which may be granted again */
+  scamper_source_control_received(client->source, 1);
+  return rc;
 }
 
 static int client_interactive_cb(client_t *client, uint8_t *buf, size_t len)
@@ -2034,6 +2339,7 @@ static int client_interactive_cb(client_t *client, uint8_t *buf, size_t len)
     {"set",        command_set},
     {"shutdown",   command_shutdown},
     {"source",     command_source},
+    {"stats",      command_stats},
   };
   static int handler_cnt = sizeof(handlers) / sizeof(command_t);
   char *next;
@@ -2223,7 +2529,7 @@ static void control_accept(const int fd, void *param)
 
 static int control_init(int fd)
 {
-  if((client_list = dlist_alloc()) == NULL)
+  if(client_list == NULL && (client_list = dlist_alloc()) == NULL)
     {
       printerror(errno, strerror, __func__, "could not alloc client_list");
       return -1;
@@ -2238,9 +2544,14 @@ static int control_init(int fd)
   return 0;
 }
 
-int scamper_control_init_unix(const char *file)
-{
 #if defined(AF_UNIX) && !defined(_WIN32)
+/*
+ * control_unix_open
+ *
+ * open a unix domain socket at the given path and listen on it.
+ */
+static int control_unix_open(const char *file)
+{
   int fd = -1;
 
 #ifdef WITHOUT_PRIVSEP
@@ -2285,6 +2596,32 @@ int scamper_control_init_unix(const char *file)
     }
 #endif
 
+  return fd;
+
+ err:
+  if(fd != -1) close(fd);
+  return -1;
+}
+
+static void control_unix_unlink(const char *file)
+{
+#ifndef WITHOUT_PRIVSEP
+  scamper_privsep_unlink(file);
+#else
+  unlink(file);
+#endif
+  return;
+}
+#endif
+
+int scamper_control_init_unix(const char *file)
+{
+#if defined(AF_UNIX) && !defined(_WIN32)
+  int fd = -1;
+
+  if((fd = control_unix_open(file)) == -1)
+    goto err;
+
   if(control_init(fd) != 0)
     goto err;
 
@@ -2304,6 +2641,75 @@ int scamper_control_init_unix(const char *file)
   return -1;
 }
 
+/*
+ * metrics_accept
+ *
+ * a client that connects to the metrics socket is sent the current
+ * counters, and the connection is closed once they have been written.
+ */
+static void metrics_accept(const int fd, void *param)
+{
+  struct sockaddr_storage ss;
+  socklen_t socklen;
+  client_t *client;
+  int s;
+
+  socklen = sizeof(ss);
+  if((s = accept(fd, (struct sockaddr *)&ss, &socklen)) == -1)
+    return;
+
+  if((client = client_alloc((struct sockaddr *)&ss, socklen, s)) == NULL)
+    {
+      shutdown(s, SHUT_RDWR);
+      close(s);
+      return;
+    }
+
+  stats_report(client, "");
+  scamper_fd_read_pause(client->fdn);
+  if(client_isdone(client) != 0)
+    client_free(client);
+  else
+    client->mode = CLIENT_MODE_FLUSH;
+  return;
+}
+
+int scamper_control_init_metrics(const char *file)
+{
+#if defined(AF_UNIX) && !defined(_WIN32)
+  int fd = -1;
+
+  if(client_list == NULL && (client_list = dlist_alloc()) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not alloc client_list");
+      goto err;
+    }
+
+  if((fd = control_unix_open(file)) == -1)
+    goto err;
+
+  if((metrics_fdn = scamper_fd_private(fd, metrics_accept,
+				       NULL, NULL, NULL)) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not add fd");
+      goto err;
+    }
+
+  if((metrics_unix_name = strdup(file)) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not strdup file");
+      goto err;
+    }
+
+  return 0;
+
+ err:
+  if(fd != -1 && metrics_fdn == NULL)
+    close(fd);
+#endif
+  return -1;
+}
+
 int scamper_control_init_port(int port)
 {
   struct sockaddr_in sin;
@@ -2392,11 +2798,7 @@ void scamper_control_cleanup()
 
 #if defined(AF_UNIX) && !defined(_WIN32)
 	  if(ctrl_unix_name != NULL)
-#ifndef WITHOUT_PRIVSEP
-	    scamper_privsep_unlink(ctrl_unix_name);
-#else
-	    unlink(ctrl_unix_name);
-#endif
+	    control_unix_unlink(ctrl_unix_name);
 #endif
 	}
 
@@ -2410,6 +2812,25 @@ void scamper_control_cleanup()
       free(ctrl_unix_name);
       ctrl_unix_name = NULL;
     }
+
+  /* stop serving metrics */
+  if(metrics_fdn != NULL)
+    {
+      if((fd = scamper_fd_fd_get(metrics_fdn)) != -1)
+	{
+	  close(fd);
+	  if(metrics_unix_name != NULL)
+	    control_unix_unlink(metrics_unix_name);
+	}
+      scamper_fd_free(metrics_fdn);
+      metrics_fdn = NULL;
+    }
+
+  if(metrics_unix_name != NULL)
+    {
+      free(metrics_unix_name);
+      metrics_unix_name = NULL;
+    }
 #endif
 
   return;
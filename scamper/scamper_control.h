@@ -27,6 +27,7 @@
 
 int scamper_control_init_port(int port);
 int scamper_control_init_unix(const char *name);
+int scamper_control_init_metrics(const char *name);
 void scamper_control_cleanup(void);
 
 #endif
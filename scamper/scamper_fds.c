@@ -187,6 +187,29 @@ static dlist_t       *write_queue = NULL;
 static dlist_t       *refcnt_0    = NULL;
 static int            planetlab   = 0;
 static int          (*pollfunc)(struct timeval *timeout) = NULL;
+static struct timeval wait_start;
+static struct timeval wait_tv;
+
+/*
+ * fds_wait_begin, fds_wait_end
+ *
+ * bracket the system call that blocks waiting for events, so that the
+ * time spent idle can be told apart from the time spent in callbacks.
+ */
+static void fds_wait_begin(void)
+{
+  gettimeofday_wrap(&wait_start);
+  return;
+}
+
+static void fds_wait_end(void)
+{
+  struct timeval tv;
+  gettimeofday_wrap(&tv);
+  if(timeval_cmp(&tv, &wait_start) > 0)
+    timeval_diff_tv(&wait_tv, &wait_start, &tv);
+  return;
+}
 
 #ifdef HAVE_SCAMPER_DEBUG
 
@@ -549,6 +572,7 @@ static int fds_select(struct timeval *timeout)
   wfdsp = fds_select_assemble(write_fds, &wfds, &nfds);
 
   /* find out which file descriptors have an event */
+  fds_wait_begin();
 #ifdef _WIN32
   if(nfds == -1)
     {
@@ -563,6 +587,7 @@ static int fds_select(struct timeval *timeout)
       printerror(errno, strerror, __func__, "select failed");
       return -1;
     }
+  fds_wait_end();
 
   /* if there are fds to check, then check them */
   if(count > 0)
@@ -679,11 +704,13 @@ static int fds_poll(struct timeval *tv)
       timeout = -1;
     }
 
+  fds_wait_begin();
   if((rc = poll(poll_fds, count, timeout)) < 0)
     {
       printerror(errno, strerror, __func__, "could not poll");
       return -1;
     }
+  fds_wait_end();
 
   if(rc > 0)
     {
@@ -757,11 +784,13 @@ static int fds_kqueue(struct timeval *tv)
       tsp = &ts;
     }
 
+  fds_wait_begin();
   if((c = kevent(kq, NULL, 0, kevlist, kevlistlen, tsp)) == -1)
     {
       printerror(errno, strerror, __func__, "kevent failed");
       return -1;
     }
+  fds_wait_end();
 
   for(i=0; i<c; i++)
     {
@@ -875,11 +904,13 @@ static int fds_epoll(struct timeval *tv)
       timeout = -1;
     }
 
+  fds_wait_begin();
   if((rc = epoll_wait(ep, ep_events, ep_event_c, timeout)) == -1)
     {
       printerror(errno, strerror, __func__, "could not epoll_wait");
       return -1;
     }
+  fds_wait_end();
 
   for(i=0; i<rc; i++)
     {
@@ -1306,9 +1337,22 @@ int scamper_fds_poll(struct timeval *timeout)
 	}
     }
 
+  memset(&wait_tv, 0, sizeof(wait_tv));
   return pollfunc(timeout);
 }
 
+/*
+ * scamper_fds_waited
+ *
+ * return how long the last call to scamper_fds_poll spent blocked waiting
+ * for an event, as opposed to running callbacks.
+ */
+void scamper_fds_waited(struct timeval *tv)
+{
+  timeval_cpy(tv, &wait_tv);
+  return;
+}
+
 /*
  * scamper_fd_fd_get
  *
@@ -1321,6 +1365,16 @@ int scamper_fd_fd_get(const scamper_fd_t *fdn)
   return fdn->pl->fd;
 }
 
+/*
+ * scamper_fds_count
+ *
+ * return the number of file descriptors being managed.
+ */
+int scamper_fds_count(void)
+{
+  return dlist_count(fd_list);
+}
+
 /*
  * scamper_fd_fd_set
  *
@@ -1328,7 +1382,36 @@ int scamper_fd_fd_get(const scamper_fd_t *fdn)
  */
 int scamper_fd_fd_set(scamper_fd_t *fdn, int fd)
 {
+  size_t size;
+  int i, rd, wr;
+
+  if(fd+1 > fd_array_s)
+    {
+      size = sizeof(scamper_fd_t *) * (fd+1);
+      if(realloc_wrap((void **)&fd_array, size) != 0)
+	return -1;
+      for(i=fd_array_s; i<fd+1; i++)
+	fd_array[i] = NULL;
+      fd_array_s = fd+1;
+    }
+
+  /*
+   * stop monitoring the old file descriptor so that a kernel event
+   * mechanism is not left with a registration for it
+   */
+  rd = (fdn->read.flags & SCAMPER_FD_POLL_FLAG_INACTIVE) == 0;
+  wr = (fdn->write.flags & SCAMPER_FD_POLL_FLAG_INACTIVE) == 0;
+  if(rd) scamper_fd_read_pause(fdn);
+  if(wr) scamper_fd_write_pause(fdn);
+
+  if(fdn->fd >= 0 && fdn->fd < fd_array_s && fd_array[fdn->fd] == fdn)
+    fd_array[fdn->fd] = NULL;
   fdn->fd = fd;
+  fd_array[fd] = fdn;
+
+  if(rd) scamper_fd_read_unpause(fdn);
+  if(wr) scamper_fd_write_unpause(fdn);
+
   return 0;
 }
 
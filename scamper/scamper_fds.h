@@ -89,6 +89,10 @@ scamper_dl_t *scamper_fd_dl_get(const scamper_fd_t *fdn);
 
 /* function to check the status of all file descriptors managed */
 int scamper_fds_poll(struct timeval *timeout);
+void scamper_fds_waited(struct timeval *tv);
+
+/* the number of file descriptors managed */
+int scamper_fds_count(void);
 
 /* functions used to initialise or cleanup the fd monitoring state */
 int scamper_fds_init(void);
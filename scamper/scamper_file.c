@@ -75,6 +75,7 @@ static const char rcsid[] =
 #define SCAMPER_FILE_WARTS       2
 #define SCAMPER_FILE_JSON        3
 #define SCAMPER_FILE_CSV         4
+#define SCAMPER_FILE_WARTS_GZ    5
 
 typedef int (*write_obj_func_t)(scamper_file_t *sf, const void *);
 
@@ -89,8 +90,14 @@ struct scamper_file
   int                       eof;
   scamper_file_writefunc_t  writefunc;
   void                     *writeparam;
+  scamper_file_fdfunc_t     fdfunc;
+  void                     *fdparam;
   scamper_file_readfunc_t   readfunc;
   void                     *readparam;
+  size_t                    bufsize;
+  int                       sync;
+  uint32_t                  addrdict;
+  uint64_t                  bytes;
 };
 
 struct scamper_file_filter
@@ -141,6 +148,9 @@ struct handler
   int (*write_sniff)(const scamper_file_t *sf,
 		     const struct scamper_sniff *sniff);
 
+  int (*flush)(const scamper_file_t *sf);
+  int (*buffered)(const scamper_file_t *sf, struct timeval *tv);
+
   void (*free_state)(scamper_file_t *sf);
 };
 
@@ -161,6 +171,8 @@ static struct handler handlers[] = {
    NULL,                                   /* write_neighbourdisc */
    scamper_file_text_tbit_write,           /* write_tbit */
    NULL,                                   /* write_sniff */
+   NULL,                                   /* flush */
+   NULL,                                   /* buffered */
    NULL,                                   /* free_state */
   },
   {"arts",                                 /* type */
@@ -179,6 +191,8 @@ static struct handler handlers[] = {
    NULL,                                   /* write_neighbourdisc */
    NULL,                                   /* write_tbit */
    NULL,                                   /* write_sniff */
+   NULL,                                   /* flush */
+   NULL,                                   /* buffered */
    scamper_file_arts_free_state,           /* free_state */
   },
   {"warts",                                /* type */
@@ -197,6 +211,8 @@ static struct handler handlers[] = {
    scamper_file_warts_neighbourdisc_write, /* write_neighbourdisc */
    scamper_file_warts_tbit_write,          /* write_tbit */
    scamper_file_warts_sniff_write,         /* write_sniff */
+   scamper_file_warts_flush,               /* flush */
+   scamper_file_warts_buffered,            /* buffered */
    scamper_file_warts_free_state,          /* free_state */
   },
   {"json",                                 /* type */
@@ -215,6 +231,8 @@ static struct handler handlers[] = {
    NULL,                                   /* write_neighbourdisc */
    NULL,                                   /* write_tbit */
    NULL,                                   /* write_sniff */
+   NULL,                                   /* flush */
+   NULL,                                   /* buffered */
    NULL,                                   /* free_state */
   },
   {"csv",                                  /* type */
@@ -233,8 +251,32 @@ static struct handler handlers[] = {
    NULL,                                   /* write_neighbourdisc */
    NULL,                                   /* write_tbit */
    NULL,                                   /* write_sniff */
+   NULL,                                   /* flush */
+   NULL,                                   /* buffered */
    NULL,                                   /* free_state */
   },
+#ifdef HAVE_ZLIB
+  {"warts.gz",                             /* type */
+   scamper_file_warts_gz_is,               /* detect */
+   scamper_file_warts_init_read,           /* init_read */
+   scamper_file_warts_gz_init_write,       /* init_write */
+   scamper_file_warts_gz_init_append,      /* init_append */
+   scamper_file_warts_read,                /* read */
+   scamper_file_warts_trace_write,         /* write_trace */
+   scamper_file_warts_cyclestart_write,    /* write_cycle_start */
+   scamper_file_warts_cyclestop_write,     /* write_cycle_stop */
+   scamper_file_warts_ping_write,          /* write_ping */
+   scamper_file_warts_tracelb_write,       /* write_tracelb */
+   scamper_file_warts_sting_write,         /* write_sting */
+   scamper_file_warts_dealias_write,       /* write_dealias */
+   scamper_file_warts_neighbourdisc_write, /* write_neighbourdisc */
+   scamper_file_warts_tbit_write,          /* write_tbit */
+   scamper_file_warts_sniff_write,         /* write_sniff */
+   scamper_file_warts_flush,               /* flush */
+   scamper_file_warts_buffered,            /* buffered */
+   scamper_file_warts_free_state,          /* free_state */
+  },
+#endif
 };
 
 static int handler_cnt = sizeof(handlers) / sizeof(struct handler);
@@ -296,6 +338,186 @@ void *scamper_file_getwriteparam(const scamper_file_t *sf)
   return sf->writeparam;
 }
 
+/*
+ * scamper_file_setfdfunc
+ *
+ * have a function take the bytes that would be written to the file
+ * descriptor, and the requests to sync them to stable storage, so that
+ * the I/O can be done elsewhere.
+ */
+void scamper_file_setfdfunc(scamper_file_t *sf,
+			    void *param, scamper_file_fdfunc_t fdfunc)
+{
+  sf->fdfunc  = fdfunc;
+  sf->fdparam = param;
+  return;
+}
+
+/*
+ * scamper_file_fdwrite
+ *
+ * write bytes to the file descriptor.  if they cannot all be written,
+ * the file is truncated back to where it was.  that offset is worked
+ * out from how much was written only when the write fails, so that a
+ * successful write costs no more than the write itself.
+ */
+int scamper_file_fdwrite(const scamper_file_t *sf, const void *buf, size_t len)
+{
+  size_t wc = 0;
+  off_t off;
+
+  if(sf->fdfunc != NULL)
+    return sf->fdfunc(sf->fdparam, buf, len);
+
+  if(write_wrap(sf->fd, buf, &wc, len) != 0)
+    {
+      if(sf->fd != STDOUT_FILENO &&
+	 (off = lseek(sf->fd, 0, SEEK_CUR)) != -1 && off >= (off_t)wc)
+	{
+	  off -= wc;
+	  if(ftruncate(sf->fd, off) == 0)
+	    lseek(sf->fd, off, SEEK_SET);
+	}
+      return -1;
+    }
+
+  return 0;
+}
+
+/*
+ * scamper_file_fdsync
+ *
+ * sync what has been written to the file descriptor to stable storage.
+ * a function given the file's I/O is passed a NULL buffer.
+ */
+int scamper_file_fdsync(const scamper_file_t *sf)
+{
+  if(sf->fdfunc != NULL)
+    return sf->fdfunc(sf->fdparam, NULL, 0);
+  return fsync(sf->fd);
+}
+
+/*
+ * scamper_file_write_bytes
+ *
+ * write bytes already formatted for the file.  they are passed to the
+ * write function, if there is one, otherwise to the file descriptor.
+ */
+int scamper_file_write_bytes(const scamper_file_t *sf,
+			     const void *buf, size_t len)
+{
+  scamper_file_addbytes(sf, len);
+  if(sf->writefunc != NULL)
+    return sf->writefunc(sf->writeparam, buf, len);
+  return scamper_file_fdwrite(sf, buf, len);
+}
+
+/*
+ * scamper_file_addbytes
+ *
+ * count the bytes of records passed in to be written to the file, before
+ * they are buffered or compressed.  the records are written through a
+ * const handle to the file, so the count is updated through a cast.
+ */
+void scamper_file_addbytes(const scamper_file_t *sf, size_t len)
+{
+  ((scamper_file_t *)sf)->bytes += len;
+  return;
+}
+
+uint64_t scamper_file_getbytes(const scamper_file_t *sf)
+{
+  return sf->bytes;
+}
+
+/*
+ * scamper_file_isshared
+ *
+ * return non-zero if a record formatted for one file can be written to
+ * the other as is.  this is the case when the files are the same type,
+ * and that type keeps no state across the records in a file.  warts
+ * does, as records refer to lists and cycles by numbers that each file
+ * assigns itself.
+ */
+int scamper_file_isshared(const scamper_file_t *a, const scamper_file_t *b)
+{
+  if(a->type != b->type || a->type == SCAMPER_FILE_NONE ||
+     handlers[a->type].init_write != NULL)
+    return 0;
+  return 1;
+}
+
+/*
+ * scamper_file_setbuf
+ *
+ * set the number of bytes of records that may be held in memory before
+ * they are written to the file, and when the file should be synced to
+ * stable storage.  a size of zero writes each record as it is passed in.
+ */
+void scamper_file_setbuf(scamper_file_t *sf, size_t size, int sync)
+{
+  sf->bufsize = size;
+  sf->sync    = sync;
+  return;
+}
+
+size_t scamper_file_getbufsize(const scamper_file_t *sf)
+{
+  return sf->bufsize;
+}
+
+int scamper_file_getsync(const scamper_file_t *sf)
+{
+  return sf->sync;
+}
+
+/*
+ * scamper_file_setaddrdict
+ *
+ * keep a dictionary of up to size addresses across the records written
+ * to a warts file, so that an address seen in an earlier record can be
+ * referred to rather than written out again.  files written this way
+ * cannot be read by versions of scamper without the dictionary.  the
+ * dictionary has to be set before the first record is written.
+ */
+void scamper_file_setaddrdict(scamper_file_t *sf, uint32_t size)
+{
+  if(size > SCAMPER_FILE_ADDRDICT_MAX)
+    size = SCAMPER_FILE_ADDRDICT_MAX;
+  sf->addrdict = size;
+  return;
+}
+
+uint32_t scamper_file_getaddrdict(const scamper_file_t *sf)
+{
+  return sf->addrdict;
+}
+
+/*
+ * scamper_file_flush
+ *
+ * write out any records held in memory.
+ */
+int scamper_file_flush(scamper_file_t *sf)
+{
+  if(sf->type != SCAMPER_FILE_NONE && handlers[sf->type].flush != NULL)
+    return handlers[sf->type].flush(sf);
+  return 0;
+}
+
+/*
+ * scamper_file_buffered
+ *
+ * return non-zero if there are records held in memory, and the time the
+ * oldest of them was passed in.
+ */
+int scamper_file_buffered(const scamper_file_t *sf, struct timeval *tv)
+{
+  if(sf->type != SCAMPER_FILE_NONE && handlers[sf->type].buffered != NULL)
+    return handlers[sf->type].buffered(sf, tv);
+  return 0;
+}
+
 int scamper_file_write_trace(scamper_file_t *sf,
 			     const struct scamper_trace *trace)
 {
@@ -572,6 +794,80 @@ void scamper_file_seteof(scamper_file_t *sf)
   return;
 }
 
+/*
+ * scamper_file_index
+ *
+ * write an index of the records in the file, so that records can later
+ * be found with the scamper_file_seek functions.  if no filename is
+ * given, the index is written alongside the file with a .idx suffix.
+ */
+int scamper_file_index(scamper_file_t *sf, const char *filename)
+{
+  char *path = NULL;
+  size_t len;
+  int rc;
+
+  if(sf->type != SCAMPER_FILE_WARTS)
+    return -1;
+
+  if(filename == NULL)
+    {
+      if(sf->filename == NULL)
+	return -1;
+      len = strlen(sf->filename) + 5;
+      if((path = malloc(len)) == NULL)
+	return -1;
+      snprintf(path, len, "%s.idx", sf->filename);
+      filename = path;
+    }
+
+  rc = scamper_file_warts_index(sf, filename);
+  if(path != NULL) free(path);
+  return rc;
+}
+
+/*
+ * scamper_file_seek_dst
+ *
+ * position the file at the next record of the type that measured dst,
+ * using the index kept alongside the file.  returns one if there is such
+ * a record, which the next call to scamper_file_read returns, zero if
+ * there are no more, and -1 on error.  a type of zero matches any type.
+ */
+int scamper_file_seek_dst(scamper_file_t *sf, uint16_t type,
+			  const scamper_addr_t *dst)
+{
+  if(sf->type != SCAMPER_FILE_WARTS || dst == NULL)
+    return -1;
+  return scamper_file_warts_seek(sf, type, dst, 0, 0);
+}
+
+/*
+ * scamper_file_seek_time
+ *
+ * position the file at the next record of the type that started between
+ * start and finish, inclusive.
+ */
+int scamper_file_seek_time(scamper_file_t *sf, uint16_t type,
+			   time_t start, time_t finish)
+{
+  if(sf->type != SCAMPER_FILE_WARTS || finish < start || finish == 0)
+    return -1;
+  return scamper_file_warts_seek(sf, type, NULL, start, finish);
+}
+
+/*
+ * scamper_file_seek_reset
+ *
+ * start the next seek from the first record in the file again.
+ */
+void scamper_file_seek_reset(scamper_file_t *sf)
+{
+  if(sf->type == SCAMPER_FILE_WARTS)
+    scamper_file_warts_seek_reset(sf);
+  return;
+}
+
 /*
  * scamper_file_free
  *
@@ -592,6 +888,11 @@ void scamper_file_free(scamper_file_t *sf)
  */
 void scamper_file_close(scamper_file_t *sf)
 {
+  /* write out anything held in memory before closing */
+  scamper_file_flush(sf);
+  if(sf->sync != SCAMPER_FILE_SYNC_NONE && sf->fd != -1)
+    scamper_file_fdsync(sf);
+
   /* free state associated with the type of scamper_file_t */
   if(sf->type != SCAMPER_FILE_NONE && handlers[sf->type].free_state != NULL)
     {
@@ -681,7 +982,7 @@ static int file_open_append(scamper_file_t *sf)
 
   if(sb.st_size == 0)
     {
-      if(sf->type == SCAMPER_FILE_WARTS)
+      if(sf->type == SCAMPER_FILE_WARTS || sf->type == SCAMPER_FILE_WARTS_GZ)
 	return handlers[sf->type].init_write(sf);
       else if(sf->type == SCAMPER_FILE_TEXT || sf->type == SCAMPER_FILE_JSON)
 	return 0;
@@ -705,6 +1006,9 @@ static scamper_file_t *file_open(int fd, char *fn, char mode, int type)
 {
   scamper_file_t *sf;
   int (*open_func)(scamper_file_t *);
+#ifdef HAVE_ZLIB
+  size_t len;
+#endif
 
   if(mode == 'r')      open_func = file_open_read;
   else if(mode == 'w') open_func = file_open_write;
@@ -716,6 +1020,13 @@ static scamper_file_t *file_open(int fd, char *fn, char mode, int type)
       return NULL;
     }
 
+#ifdef HAVE_ZLIB
+  /* a warts file to be written with a .gz suffix is compressed */
+  if(type == SCAMPER_FILE_WARTS && mode != 'r' && fn != NULL &&
+     (len = strlen(fn)) > 3 && strcasecmp(fn + len - 3, ".gz") == 0)
+    type = SCAMPER_FILE_WARTS_GZ;
+#endif
+
   sf->type = type;
   sf->fd   = fd;
 
@@ -34,6 +34,8 @@ typedef struct scamper_file_filter scamper_file_filter_t;
 
 typedef int (*scamper_file_writefunc_t)(void *param,
 					const void *data, size_t len);
+typedef int (*scamper_file_fdfunc_t)(void *param,
+				     const void *data, size_t len);
 
 typedef int (*scamper_file_readfunc_t)(void *param,
 				       uint8_t **data, size_t len);
@@ -52,6 +54,11 @@ typedef int (*scamper_file_readfunc_t)(void *param,
 #define SCAMPER_FILE_OBJ_TBIT          0x0b
 #define SCAMPER_FILE_OBJ_STING         0x0c
 #define SCAMPER_FILE_OBJ_SNIFF         0x0d
+#define SCAMPER_FILE_OBJ_ADDRDICT      0x0e /* warts address dictionary */
+
+#define SCAMPER_FILE_SYNC_NONE         0x00 /* never fsync */
+#define SCAMPER_FILE_SYNC_CYCLE        0x01 /* fsync at cycle stop and close */
+#define SCAMPER_FILE_SYNC_FLUSH        0x02 /* fsync whenever flushed */
 
 scamper_file_t *scamper_file_open(char *fn, char mode, char *type);
 scamper_file_t *scamper_file_openfd(int fd, char *fn, char mode, char *type);
@@ -106,6 +113,14 @@ struct scamper_sniff;
 int scamper_file_write_sniff(scamper_file_t *sf,
 			     const struct scamper_sniff *sniff);
 
+struct scamper_addr;
+int scamper_file_index(scamper_file_t *sf, const char *filename);
+int scamper_file_seek_dst(scamper_file_t *sf, uint16_t type,
+			  const struct scamper_addr *dst);
+int scamper_file_seek_time(scamper_file_t *sf, uint16_t type,
+			   time_t start, time_t finish);
+void scamper_file_seek_reset(scamper_file_t *sf);
+
 char *scamper_file_type_tostr(scamper_file_t *sf, char *buf, size_t len);
 char *scamper_file_getfilename(scamper_file_t *sf);
 
@@ -121,6 +136,26 @@ void  scamper_file_setwritefunc(scamper_file_t *sf, void *param,
 				scamper_file_writefunc_t writefunc);
 scamper_file_writefunc_t scamper_file_getwritefunc(const scamper_file_t *sf);
 void *scamper_file_getwriteparam(const scamper_file_t *sf);
+void  scamper_file_setfdfunc(scamper_file_t *sf, void *param,
+			     scamper_file_fdfunc_t fdfunc);
+int   scamper_file_fdwrite(const scamper_file_t *sf,
+			   const void *buf, size_t len);
+int   scamper_file_fdsync(const scamper_file_t *sf);
+int   scamper_file_write_bytes(const scamper_file_t *sf,
+			       const void *buf, size_t len);
+int   scamper_file_isshared(const scamper_file_t *a, const scamper_file_t *b);
+void  scamper_file_addbytes(const scamper_file_t *sf, size_t len);
+uint64_t scamper_file_getbytes(const scamper_file_t *sf);
+
+void   scamper_file_setbuf(scamper_file_t *sf, size_t size, int sync);
+size_t scamper_file_getbufsize(const scamper_file_t *sf);
+int    scamper_file_getsync(const scamper_file_t *sf);
+int    scamper_file_flush(scamper_file_t *sf);
+int    scamper_file_buffered(const scamper_file_t *sf, struct timeval *tv);
+
+#define SCAMPER_FILE_ADDRDICT_MAX 65535
+void     scamper_file_setaddrdict(scamper_file_t *sf, uint32_t size);
+uint32_t scamper_file_getaddrdict(const scamper_file_t *sf);
 
 int   scamper_file_getfd(const scamper_file_t *sf);
 void *scamper_file_getstate(const scamper_file_t *sf);
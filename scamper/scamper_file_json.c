@@ -0,0 +1,222 @@
+/*
+ * scamper_file_json.c
+ *
+ * routines shared by the json writers to format a record into a single
+ * buffer without building intermediate strings.
+ *
+ * Copyright (C) 2014 The Regents of the University of California
+ * Author: Matthew Luckie
+ *
+ * $Id: scamper_file_json.c,v 1.1 2014/03/20 00:00:00 mjl Exp $
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef lint
+static const char rcsid[] =
+  "$Id: scamper_file_json.c,v 1.1 2014/03/20 00:00:00 mjl Exp $";
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper_addr.h"
+#include "scamper_file.h"
+#include "scamper_file_json.h"
+#include "utils.h"
+
+/*
+ * json_buf_grow
+ *
+ * make room for at least len more bytes.  the buffer is doubled so that
+ * a large record is only copied a few times.
+ */
+static int json_buf_grow(json_buf_t *jb, size_t len)
+{
+  size_t size = jb->len;
+  char *buf;
+
+  if(jb->error != 0)
+    return -1;
+
+  while(size - jb->off < len)
+    size = size * 2;
+
+  if(jb->buf == jb->stack)
+    {
+      if((buf = malloc(size)) != NULL)
+	memcpy(buf, jb->buf, jb->off);
+    }
+  else buf = realloc(jb->buf, size);
+
+  if(buf == NULL)
+    {
+      jb->error = 1;
+      return -1;
+    }
+
+  jb->buf = buf;
+  jb->len = size;
+  return 0;
+}
+
+void json_buf_init(json_buf_t *jb, char *buf, size_t len)
+{
+  jb->buf   = buf;
+  jb->len   = len;
+  jb->off   = 0;
+  jb->stack = buf;
+  jb->error = 0;
+  return;
+}
+
+void json_buf_free(json_buf_t *jb)
+{
+  if(jb->buf != jb->stack)
+    free(jb->buf);
+  jb->buf = jb->stack = NULL;
+  return;
+}
+
+void json_buf_mem(json_buf_t *jb, const void *ptr, size_t len)
+{
+  if(jb->len - jb->off < len && json_buf_grow(jb, len) != 0)
+    return;
+  memcpy(jb->buf + jb->off, ptr, len);
+  jb->off += len;
+  return;
+}
+
+void json_buf_str(json_buf_t *jb, const char *str)
+{
+  json_buf_mem(jb, str, strlen(str));
+  return;
+}
+
+void json_buf_u32(json_buf_t *jb, uint32_t u32)
+{
+  char buf[10];
+  size_t i = sizeof(buf);
+
+  do
+    {
+      buf[--i] = '0' + (u32 % 10);
+      u32 /= 10;
+    }
+  while(u32 != 0);
+
+  json_buf_mem(jb, buf+i, sizeof(buf)-i);
+  return;
+}
+
+void json_buf_int(json_buf_t *jb, int i)
+{
+  if(i < 0)
+    {
+      json_buf_lit(jb, "-");
+      json_buf_u32(jb, 0 - (uint32_t)i);
+    }
+  else json_buf_u32(jb, (uint32_t)i);
+  return;
+}
+
+/*
+ * json_buf_rtt
+ *
+ * format a time as milliseconds with three decimal places, as
+ * timeval_tostr does.
+ */
+void json_buf_rtt(json_buf_t *jb, const struct timeval *tv)
+{
+  uint32_t usec = (tv->tv_sec * 1000000) + tv->tv_usec;
+  uint32_t frac = usec % 1000;
+  char buf[4];
+
+  json_buf_u32(jb, usec / 1000);
+  buf[0] = '.';
+  buf[1] = '0' + (frac / 100);
+  buf[2] = '0' + ((frac / 10) % 10);
+  buf[3] = '0' + (frac % 10);
+  json_buf_mem(jb, buf, 4);
+  return;
+}
+
+/*
+ * json_buf_addr
+ *
+ * IPv4 addresses are formatted here; anything else is passed to
+ * scamper_addr_tostr.
+ */
+void json_buf_addr(json_buf_t *jb, const scamper_addr_t *addr)
+{
+  const uint8_t *a;
+  char buf[128];
+  int i;
+
+  if(addr->type != SCAMPER_ADDR_TYPE_IPV4)
+    {
+      json_buf_str(jb, scamper_addr_tostr(addr, buf, sizeof(buf)));
+      return;
+    }
+
+  a = addr->addr;
+  for(i=0; i<4; i++)
+    {
+      if(i > 0) json_buf_lit(jb, ".");
+      json_buf_u32(jb, a[i]);
+    }
+  return;
+}
+
+/*
+ * json_buf_printf
+ *
+ * for the odd value that has no formatter of its own.
+ */
+void json_buf_printf(json_buf_t *jb, const char *fs, ...)
+{
+  char buf[256];
+  va_list ap;
+  int wc;
+
+  va_start(ap, fs);
+  wc = vsnprintf(buf, sizeof(buf), fs, ap);
+  va_end(ap);
+
+  if(wc < 0)
+    {
+      jb->error = 1;
+      return;
+    }
+  if((size_t)wc >= sizeof(buf))
+    wc = sizeof(buf) - 1;
+
+  json_buf_mem(jb, buf, wc);
+  return;
+}
+
+/*
+ * json_buf_write
+ *
+ * write the formatted record to the file with a single write.
+ */
+int json_buf_write(json_buf_t *jb, const scamper_file_t *sf)
+{
+  if(jb->error != 0)
+    return -1;
+  return scamper_file_write_bytes(sf, jb->buf, jb->off);
+}
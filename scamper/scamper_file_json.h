@@ -0,0 +1,59 @@
+/*
+ * scamper_file_json.h
+ *
+ * $Id: scamper_file_json.h,v 1.1 2014/03/20 00:00:00 mjl Exp $
+ *
+ * Copyright (C) 2014 The Regents of the University of California
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef _SCAMPER_FILE_JSON_H
+#define _SCAMPER_FILE_JSON_H
+
+/*
+ * json_buf_t
+ *
+ * a record is formatted into one buffer, which starts out as memory
+ * the caller has on its stack and moves to the heap if the record does
+ * not fit.  if the buffer cannot be grown, the error is remembered and
+ * the record is not written.
+ */
+typedef struct json_buf
+{
+  char   *buf;
+  size_t  len;
+  size_t  off;
+  char   *stack;
+  int     error;
+} json_buf_t;
+
+void json_buf_init(json_buf_t *jb, char *buf, size_t len);
+void json_buf_free(json_buf_t *jb);
+
+void json_buf_mem(json_buf_t *jb, const void *ptr, size_t len);
+void json_buf_str(json_buf_t *jb, const char *str);
+void json_buf_u32(json_buf_t *jb, uint32_t u32);
+void json_buf_int(json_buf_t *jb, int i);
+void json_buf_rtt(json_buf_t *jb, const struct timeval *tv);
+void json_buf_addr(json_buf_t *jb, const struct scamper_addr *addr);
+void json_buf_printf(json_buf_t *jb, const char *fs, ...);
+
+#define json_buf_lit(jb, str) json_buf_mem((jb), (str), sizeof(str)-1)
+
+int json_buf_write(json_buf_t *jb, const scamper_file_t *sf);
+
+#endif /* _SCAMPER_FILE_JSON_H */
@@ -62,10 +62,46 @@ static const char rcsid[] =
 #define WARTS_MAGIC 0x1205
 #define WARTS_HDRLEN 8
 
+/* the length byte of an address that refers to a dictionary slot */
+#define WARTS_ADDR_DICT 0xff
+
 /* how many entries to grow the table by each time */
 #define WARTS_ADDR_TABLEGROW  1000
+#define WARTS_ADDR_HASHMIN    16
 #define WARTS_LIST_TABLEGROW  1
 #define WARTS_CYCLE_TABLEGROW 1
+#define WARTS_READBUF_LEN     1048576
+
+/* the index kept alongside a warts file: a header, then fixed entries */
+#define WARTS_IDX_MAGIC   0x57494458
+#define WARTS_IDX_VERSION 1
+#define WARTS_IDX_HDRLEN  8
+#define WARTS_IDX_LEN     32
+
+/* the size of the buffer used to hold compressed data in transit */
+#define WARTS_GZBUF_LEN   65536
+
+#ifdef HAVE_ZLIB
+/*
+ * warts_gz
+ *
+ * the state of a compressed warts file.  the file is a sequence of gzip
+ * members, one for each time the file was opened for writing.  buf holds
+ * compressed data that has been read but not inflated, or that has been
+ * deflated but not written.
+ */
+struct warts_gz
+{
+  z_stream  in;
+  z_stream  out;
+  int       inok;
+  int       outok;
+  int       eof;
+  int       pending;
+  uint8_t  *buf;
+  size_t    buf_len;
+};
+#endif
 
 /*
  * the optional bits of a list structure
@@ -184,33 +220,415 @@ int warts_str_size(const char *str)
   return strlen(str) + 1;
 }
 
-static int warts_addr_cmp(const warts_addr_t *a, const warts_addr_t *b)
+/*
+ * warts_addr_hash
+ *
+ * FNV-1a over the address type and the address.
+ */
+static uint32_t warts_addr_hash(const scamper_addr_t *addr)
+{
+  const uint8_t *a = addr->addr;
+  uint32_t hash = 2166136261U;
+  size_t i, len = scamper_addr_size(addr);
+
+  hash = (hash ^ (uint8_t)addr->type) * 16777619U;
+  for(i=0; i<len; i++)
+    hash = (hash ^ a[i]) * 16777619U;
+  return hash;
+}
+
+/*
+ * warts_addr_bucket
+ *
+ * return the bucket in the hash table that holds the address, or the
+ * empty bucket where it would be put.
+ */
+static uint32_t warts_addr_bucket(const warts_addrtable_t *t,
+				  const scamper_addr_t *addr)
+{
+  uint32_t i = warts_addr_hash(addr) & (t->addrm - 1);
+
+  while(t->addrs[i] != NULL && scamper_addr_cmp(t->addrs[i]->addr, addr) != 0)
+    i = (i + 1) & (t->addrm - 1);
+
+  return i;
+}
+
+/*
+ * warts_addr_grow
+ *
+ * double the number of buckets in the hash table, keeping it no more
+ * than half full.
+ */
+static int warts_addr_grow(warts_addrtable_t *t)
+{
+  warts_addr_t **old = t->addrs;
+  uint32_t i, oldm = t->addrm;
+
+  t->addrm = oldm == 0 ? WARTS_ADDR_HASHMIN : oldm * 2;
+  if((t->addrs = malloc_zero(sizeof(warts_addr_t *) * t->addrm)) == NULL)
+    {
+      t->addrs = old;
+      t->addrm = oldm;
+      return -1;
+    }
+
+  for(i=0; i<oldm; i++)
+    if(old[i] != NULL)
+      t->addrs[warts_addr_bucket(t, old[i]->addr)] = old[i];
+
+  if(old != NULL)
+    free(old);
+  return 0;
+}
+
+static int warts_write_rec(const scamper_file_t *sf, const void *buf,
+			   size_t len);
+
+static int warts_dict_addr_cmp(const warts_dict_addr_t *a,
+			       const warts_dict_addr_t *b)
 {
   return scamper_addr_cmp(a->addr, b->addr);
 }
 
-uint32_t warts_addr_size(warts_addrtable_t *t, scamper_addr_t *addr)
+static void warts_dict_free(warts_dict_t *dict)
 {
-  warts_addr_t f, *wa;
+  uint32_t i;
 
-  memset(&f, 0, sizeof(f));
-  f.addr = addr;
-  if(array_find((void **)t->addrs, t->addrc, &f,
-		(array_cmp_t)warts_addr_cmp) != NULL)
+  if(dict->tree != NULL)
+    splaytree_free(dict->tree, NULL);
+  if(dict->ents != NULL)
     {
-      return 1 + 4;
+      for(i=0; i<dict->entc; i++)
+	if(dict->ents[i].addr != NULL)
+	  scamper_addr_free(dict->ents[i].addr);
+      free(dict->ents);
     }
+  if(dict->pend != NULL)
+    free(dict->pend);
+  free(dict);
+  return;
+}
 
-  if((wa = malloc_zero(sizeof(warts_addr_t))) != NULL)
+/*
+ * warts_dict_alloc
+ *
+ * allocate a dictionary.  a writer's dictionary has a fixed number of
+ * slots; a reader's dictionary grows as slots are defined.
+ */
+static warts_dict_t *warts_dict_alloc(uint32_t size)
+{
+  warts_dict_t *dict;
+
+  if((dict = malloc_zero(sizeof(warts_dict_t))) == NULL)
+    return NULL;
+  if(size == 0)
+    return dict;
+
+  if((dict->ents = malloc_zero(sizeof(warts_dict_addr_t) * size)) == NULL ||
+     (dict->pend = malloc(sizeof(uint16_t) * size)) == NULL ||
+     (dict->tree = splaytree_alloc((splaytree_cmp_t)warts_dict_addr_cmp))
+     == NULL)
     {
-      wa->addr = scamper_addr_use(addr);
-      wa->id   = t->addrc;
+      warts_dict_free(dict);
+      return NULL;
+    }
+  dict->size = size;
+  dict->head = dict->tail = size;
+  return dict;
+}
+
+/*
+ * warts_dict_reset
+ *
+ * forget the slots in a dictionary.  a writer does this when the records
+ * that define them could not be written, and the slots will be defined
+ * again as they are used.  a reader does this before reading the records
+ * that define them again from the start of the file.
+ */
+static void warts_dict_reset(warts_dict_t *dict)
+{
+  uint32_t i;
+
+  if(dict->tree != NULL)
+    splaytree_empty(dict->tree, NULL);
+  for(i=0; i<dict->entc; i++)
+    {
+      if(dict->ents[i].addr != NULL)
+	{
+	  scamper_addr_free(dict->ents[i].addr);
+	  dict->ents[i].addr = NULL;
+	}
+      dict->ents[i].pend = 0;
+      dict->ents[i].defd = 0;
+    }
+  dict->entc = 0;
+  dict->pendc = 0;
+  dict->head = dict->tail = dict->size;
+  return;
+}
+
+static void warts_dict_lru_eject(warts_dict_t *dict, warts_dict_addr_t *da)
+{
+  if(da->prev != dict->size) dict->ents[da->prev].next = da->next;
+  else dict->head = da->next;
+  if(da->next != dict->size) dict->ents[da->next].prev = da->prev;
+  else dict->tail = da->prev;
+  return;
+}
+
+static void warts_dict_lru_push(warts_dict_t *dict, warts_dict_addr_t *da)
+{
+  da->prev = dict->size;
+  da->next = dict->head;
+  if(dict->head != dict->size) dict->ents[dict->head].prev = da->slot;
+  else dict->tail = da->slot;
+  dict->head = da->slot;
+  return;
+}
+
+static warts_dict_addr_t *warts_dict_find(warts_dict_t *dict,
+					  const scamper_addr_t *addr)
+{
+  warts_dict_addr_t fm;
+  if(dict->tree == NULL)
+    return NULL;
+  fm.addr = (scamper_addr_t *)addr;
+  return splaytree_find(dict->tree, &fm);
+}
+
+/*
+ * warts_dict_use
+ *
+ * return zero if the address can be referred to by its slot in the
+ * dictionary.  the first time an address is used it is given a slot but
+ * not defined, and is written out in full; the slot is defined when a
+ * later record uses the address again.  a slot that is defined and that
+ * the record being encoded refers to is not taken for a new address; the
+ * address is then written out in full instead.
+ */
+static int warts_dict_use(warts_dict_t *dict, scamper_addr_t *addr)
+{
+  warts_dict_addr_t *da;
+
+  if((da = warts_dict_find(dict, addr)) != NULL)
+    {
+      if(dict->head != da->slot)
+	{
+	  warts_dict_lru_eject(dict, da);
+	  warts_dict_lru_push(dict, da);
+	}
+      if(da->defd == 0)
+	{
+	  if(da->stamp == dict->stamp)
+	    return -1;
+	  da->defd = 1;
+	  da->pend = 1;
+	  dict->pend[dict->pendc++] = da->slot;
+	}
+      da->stamp = dict->stamp;
+      return 0;
+    }
 
-      if(array_insert((void ***)&t->addrs, &t->addrc, wa,
-		      (array_cmp_t)warts_addr_cmp) != 0)
+  if(dict->entc < dict->size)
+    {
+      da = &dict->ents[dict->entc];
+      da->slot = dict->entc++;
+    }
+  else
+    {
+      da = &dict->ents[dict->tail];
+      if(da->defd != 0 && da->stamp == dict->stamp)
+	return -1;
+      if(da->addr != NULL)
 	{
-	  free(wa);
+	  splaytree_remove_item(dict->tree, da);
+	  scamper_addr_free(da->addr);
+	  da->addr = NULL;
 	}
+      da->defd = 0;
+      warts_dict_lru_eject(dict, da);
+    }
+
+  warts_dict_lru_push(dict, da);
+  da->addr = scamper_addr_use(addr);
+  if(splaytree_insert(dict->tree, da) == NULL)
+    {
+      scamper_addr_free(da->addr);
+      da->addr = NULL;
+    }
+  da->stamp = dict->stamp;
+  return -1;
+}
+
+/*
+ * warts_dict_write
+ *
+ * write an address dictionary record defining the slots that were
+ * assigned while encoding the record about to be written.
+ */
+static int warts_dict_write(const scamper_file_t *sf, warts_dict_t *dict)
+{
+  warts_dict_addr_t *da;
+  uint8_t *buf = NULL;
+  uint32_t i, len = 8 + 2, off = 0;
+  uint16_t u16, pendc = dict->pendc;
+  uint8_t size;
+
+  for(i=0; i<dict->pendc; i++)
+    {
+      da = &dict->ents[dict->pend[i]];
+      if(da->addr != NULL)
+	len += 2 + 1 + 1 + scamper_addr_size(da->addr);
+      else
+	pendc--;
+    }
+
+  if((buf = malloc(len)) == NULL)
+    goto err;
+
+  insert_wartshdr(buf, &off, len, SCAMPER_FILE_OBJ_ADDRDICT);
+  insert_uint16(buf, &off, len, &pendc, NULL);
+  for(i=0; i<dict->pendc; i++)
+    {
+      da = &dict->ents[dict->pend[i]];
+      da->pend = 0;
+      if(da->addr == NULL)
+	continue;
+      u16 = da->slot;
+      size = scamper_addr_size(da->addr);
+      insert_uint16(buf, &off, len, &u16, NULL);
+      buf[off++] = size;
+      buf[off++] = da->addr->type;
+      memcpy(buf + off, da->addr->addr, size);
+      off += size;
+    }
+  dict->pendc = 0;
+  assert(off == len);
+
+  if(warts_write_rec(sf, buf, len) != 0)
+    goto err;
+
+  free(buf);
+  return 0;
+
+ err:
+  warts_dict_reset(dict);
+  if(buf != NULL) free(buf);
+  return -1;
+}
+
+/*
+ * warts_addrdict_read
+ *
+ * read an address dictionary record, defining the slots it names.
+ */
+int warts_addrdict_read(scamper_file_t *sf, const warts_hdr_t *hdr,
+			warts_dict_t **dict_out)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+  warts_dict_t *dict;
+  warts_dict_addr_t *ents;
+  uint8_t *buf = NULL;
+  uint32_t i, off = 0, entc;
+  uint16_t count, slot;
+  uint8_t size;
+
+  if(warts_read(sf, &buf, hdr->len) != 0)
+    goto err;
+  if(buf == NULL)
+    {
+      *dict_out = NULL;
+      return 0;
+    }
+
+  if(state->dict == NULL && (state->dict = warts_dict_alloc(0)) == NULL)
+    goto err;
+  dict = state->dict;
+
+  if(extract_uint16(buf, &off, hdr->len, &count, NULL) != 0)
+    goto err;
+
+  for(i=0; i<count; i++)
+    {
+      if(extract_uint16(buf, &off, hdr->len, &slot, NULL) != 0 ||
+	 hdr->len - off < 2)
+	goto err;
+      size = buf[off++];
+      if(hdr->len - off < (uint32_t)size + 1)
+	goto err;
+
+      if(slot >= dict->entc)
+	{
+	  entc = ((slot / WARTS_ADDR_TABLEGROW) + 1) * WARTS_ADDR_TABLEGROW;
+	  if((ents = realloc(dict->ents, sizeof(warts_dict_addr_t) * entc))
+	     == NULL)
+	    goto err;
+	  memset(ents + dict->entc, 0,
+		 sizeof(warts_dict_addr_t) * (entc - dict->entc));
+	  dict->ents = ents;
+	  dict->entc = entc;
+	}
+
+      if(dict->ents[slot].addr != NULL)
+	scamper_addr_free(dict->ents[slot].addr);
+      if((dict->ents[slot].addr = scamper_addr_alloc(buf[off],&buf[off+1]))
+	 == NULL)
+	goto err;
+      off += 1 + size;
+    }
+
+  *dict_out = dict;
+  return 0;
+
+ err:
+  return -1;
+}
+
+/*
+ * warts_addrtable_init
+ *
+ * get the table of addresses for a record ready.  if the file keeps an
+ * address dictionary, the table refers to it.
+ */
+void warts_addrtable_init(const scamper_file_t *sf, warts_addrtable_t *table)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+  uint32_t size;
+
+  memset(table, 0, sizeof(warts_addrtable_t));
+
+  if(state->dict == NULL && (size = scamper_file_getaddrdict(sf)) > 0 &&
+     scamper_file_getwritefunc(sf) == NULL)
+    state->dict = warts_dict_alloc(size);
+
+  if((table->dict = state->dict) != NULL)
+    table->dict->stamp++;
+
+  return;
+}
+
+uint32_t warts_addr_size(warts_addrtable_t *t, scamper_addr_t *addr)
+{
+  warts_addr_t *wa;
+  uint32_t i;
+
+  if(t->dict != NULL && t->dict->size > 0 &&
+     warts_dict_use(t->dict, addr) == 0)
+    return 1 + 2;
+
+  if(t->addrm > 0 && t->addrs[warts_addr_bucket(t, addr)] != NULL)
+    return 1 + 4;
+
+  if((t->addrc + 1) * 2 > t->addrm && warts_addr_grow(t) != 0)
+    return 1 + 1 + scamper_addr_size(addr);
+
+  if((wa = malloc_zero(sizeof(warts_addr_t))) != NULL)
+    {
+      wa->addr = scamper_addr_use(addr);
+      wa->id   = t->addrc++;
+      i = warts_addr_bucket(t, addr);
+      t->addrs[i] = wa;
     }
 
   return 1 + 1 + scamper_addr_size(addr);
@@ -218,11 +636,13 @@ uint32_t warts_addr_size(warts_addrtable_t *t, scamper_addr_t *addr)
 
 void warts_addrtable_clean(warts_addrtable_t *table)
 {
-  int i;
+  uint32_t i;
   if(table->addrs != NULL)
     {
-      for(i=0; i<table->addrc; i++)
+      for(i=0; i<table->addrm; i++)
 	{
+	  if(table->addrs[i] == NULL)
+	    continue;
 	  scamper_addr_free(table->addrs[i]->addr);
 	  free(table->addrs[i]);
 	}
@@ -235,16 +655,25 @@ void insert_addr(uint8_t *buf, uint32_t *off, const uint32_t len,
 			const scamper_addr_t *addr, void *param)
 {
   warts_addrtable_t *table = param;
-  warts_addr_t *wa, f;
+  warts_dict_addr_t *da;
+  warts_addr_t *wa;
   uint32_t id;
   size_t size;
 
   assert(table != NULL);
   assert(len - *off >= 1 + 1);
 
-  f.addr = (scamper_addr_t *)addr;
-  wa = array_find((void **)table->addrs, table->addrc, &f,
-		  (array_cmp_t)warts_addr_cmp);
+  /* an address in the dictionary is referred to by its slot */
+  if(table->dict != NULL &&
+     (da = warts_dict_find(table->dict, addr)) != NULL && da->defd != 0)
+    {
+      buf[(*off)++] = WARTS_ADDR_DICT;
+      insert_uint16(buf, off, len, &da->slot, NULL);
+      return;
+    }
+
+  assert(table->addrm > 0);
+  wa = table->addrs[warts_addr_bucket(table, addr)];
   assert(wa != NULL);
 
   if(wa->ondisk == 0)
@@ -369,8 +798,9 @@ int extract_addr(const uint8_t *buf, uint32_t *off,
 			const uint32_t len, scamper_addr_t **out, void *param)
 {
   warts_addrtable_t *table = param;
-  warts_addr_t *wa;
+  warts_addr_t **addrs, *wa = NULL;
   uint32_t u32;
+  uint16_t slot;
   uint8_t size;
   uint8_t type;
 
@@ -393,22 +823,45 @@ int extract_addr(const uint8_t *buf, uint32_t *off,
 	return -1;
 
       memcpy(&u32, &buf[*off], 4); u32 = ntohl(u32);
+      if(u32 >= table->addrc)
+	return -1;
       *out = scamper_addr_use(table->addrs[u32]->addr);
       *off += 4;
       return 0;
     }
 
+  /* the address is in a slot of the file's address dictionary */
+  if(size == WARTS_ADDR_DICT)
+    {
+      if(extract_uint16(buf, off, len, &slot, NULL) != 0 ||
+	 table->dict == NULL || slot >= table->dict->entc ||
+	 table->dict->ents[slot].addr == NULL)
+	return -1;
+      *out = scamper_addr_use(table->dict->ents[slot].addr);
+      return 0;
+    }
+
   /*
    * we have an address defined inline.  extract the address out and store
    * it in a table, incase it is referenced shortly
    */
   type = buf[(*off)++];
+  if(table->addrc == table->addrm)
+    {
+      u32 = table->addrm == 0 ? WARTS_ADDR_HASHMIN : table->addrm * 2;
+      if((addrs = realloc(table->addrs, sizeof(warts_addr_t *) * u32)) == NULL)
+	return -1;
+      table->addrs = addrs;
+      memset(table->addrs + table->addrm, 0,
+	     sizeof(warts_addr_t *) * (u32 - table->addrm));
+      table->addrm = u32;
+    }
   if((wa = malloc_zero(sizeof(warts_addr_t))) == NULL ||
-     (wa->addr = scamper_addr_alloc(type, &buf[*off])) == NULL ||
-     array_insert((void ***)&table->addrs, &table->addrc, wa, NULL) != 0)
+     (wa->addr = scamper_addr_alloc(type, &buf[*off])) == NULL)
     {
       goto err;
     }
+  table->addrs[table->addrc++] = wa;
 
   *out = scamper_addr_use(wa->addr);
   *off += size;
@@ -792,161 +1245,558 @@ void warts_params_write(uint8_t *buf, uint32_t *off,
   return;
 }
 
+#ifdef HAVE_ZLIB
+static struct warts_gz *warts_gz_alloc(size_t len)
+{
+  struct warts_gz *gz;
+  if(len < WARTS_GZBUF_LEN)
+    len = WARTS_GZBUF_LEN;
+  if((gz = malloc_zero(sizeof(struct warts_gz))) == NULL ||
+     (gz->buf = malloc(len)) == NULL)
+    {
+      if(gz != NULL) free(gz);
+      return NULL;
+    }
+  gz->buf_len = len;
+  return gz;
+}
+
+static void warts_gz_free(struct warts_gz *gz)
+{
+  if(gz->inok != 0) inflateEnd(&gz->in);
+  if(gz->outok != 0) deflateEnd(&gz->out);
+  if(gz->buf != NULL) free(gz->buf);
+  free(gz);
+  return;
+}
+
+/*
+ * warts_gz_read_init
+ *
+ * the start of the file has the gzip magic.  take the bytes already read
+ * as the start of the compressed stream.  offsets in the file no longer
+ * correspond to offsets in the warts data, so nothing can be seeked over.
+ */
+static int warts_gz_read_init(warts_state_t *state,
+			      const uint8_t *buf, size_t len)
+{
+  if((state->gz = warts_gz_alloc(len)) == NULL)
+    return -1;
+  if(inflateInit2(&state->gz->in, 15 + 16) != Z_OK)
+    return -1;
+  state->gz->inok = 1;
+  memcpy(state->gz->buf, buf, len);
+  state->gz->in.next_in = state->gz->buf;
+  state->gz->in.avail_in = len;
+  state->isreg = 0;
+  return 0;
+}
+
+/*
+ * warts_gz_read
+ *
+ * inflate up to len bytes into buf, reading more of the file as needed.
+ * the return value has the same meaning as read(2).
+ */
+static ssize_t warts_gz_read(warts_state_t *state, int fd,
+			     uint8_t *buf, size_t len)
+{
+  struct warts_gz *gz = state->gz;
+  ssize_t rc;
+  int zrc;
+
+  gz->in.next_out = buf;
+  gz->in.avail_out = len;
+
+  while(gz->in.avail_out == len)
+    {
+      if(gz->in.avail_in == 0)
+	{
+	  if(gz->eof != 0)
+	    break;
+	  if((rc = read(fd, gz->buf, gz->buf_len)) < 0)
+	    return -1;
+	  if(rc == 0)
+	    {
+	      gz->eof = 1;
+	      break;
+	    }
+	  gz->in.next_in = gz->buf;
+	  gz->in.avail_in = rc;
+	}
+
+      /* at the end of a gzip member, the next one may follow */
+      if((zrc = inflate(&gz->in, Z_NO_FLUSH)) == Z_STREAM_END)
+	{
+	  if(inflateReset(&gz->in) != Z_OK)
+	    return -1;
+	}
+      else if(zrc != Z_OK && zrc != Z_BUF_ERROR)
+	{
+	  errno = EINVAL;
+	  return -1;
+	}
+    }
+
+  return len - gz->in.avail_out;
+}
+
+static int warts_gz_write_init(warts_state_t *state)
+{
+  if((state->gz = warts_gz_alloc(0)) == NULL)
+    return -1;
+  if(deflateInit2(&state->gz->out, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+		  15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    return -1;
+  state->gz->outok = 1;
+  return 0;
+}
+
+/*
+ * warts_gz_write
+ *
+ * deflate the buffer, writing out compressed data as it is produced.
+ * with Z_NO_FLUSH, zlib may hold on to some of the data until the stream
+ * is flushed with Z_SYNC_FLUSH, or finished with Z_FINISH.
+ */
+static int warts_gz_write(const scamper_file_t *sf, const void *buf,
+			  size_t len, int flush)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+  struct warts_gz *gz = state->gz;
+  size_t have;
+
+  gz->out.next_in = (Bytef *)buf;
+  gz->out.avail_in = len;
+
+  do
+    {
+      gz->out.next_out = gz->buf;
+      gz->out.avail_out = gz->buf_len;
+      if(deflate(&gz->out, flush) == Z_STREAM_ERROR)
+	return -1;
+      have = gz->buf_len - gz->out.avail_out;
+      if(have > 0 && scamper_file_fdwrite(sf, gz->buf, have) != 0)
+	return -1;
+    }
+  while(gz->out.avail_out == 0);
+
+  gz->pending = (flush == Z_NO_FLUSH) ? 1 : 0;
+  return 0;
+}
+#endif
+
+/*
+ * warts_read_fd
+ *
+ * read up to len bytes of warts data from the file.  if the file begins
+ * with the gzip magic, then it is compressed, and the rest of the file is
+ * inflated as it is read.
+ */
+static ssize_t warts_read_fd(scamper_file_t *sf, uint8_t *buf, size_t len)
+{
+#ifdef HAVE_ZLIB
+  warts_state_t *state = scamper_file_getstate(sf);
+#endif
+  int fd = scamper_file_getfd(sf);
+  ssize_t rc;
+
+#ifdef HAVE_ZLIB
+  if(state->gz != NULL)
+    return warts_gz_read(state, fd, buf, len);
+#endif
+
+  if((rc = read(fd, buf, len)) <= 0)
+    return rc;
+
+#ifdef HAVE_ZLIB
+  if(state->off == 0 && state->readlen == 0 && rc >= 2 &&
+     buf[0] == 0x1f && buf[1] == 0x8b)
+    {
+      if(warts_gz_read_init(state, buf, rc) != 0)
+	return -1;
+      return warts_gz_read(state, fd, buf, len);
+    }
+#endif
+
+  return rc;
+}
+
 /*
  * warts_read
  *
- * this function reads the requested number of bytes into a new piece of
- * memory returned in *buf.  as the underlying file descriptor may be
- * set O_NONBLOCK, most of this code is spent dealing with partial reads.
+ * this function returns a pointer in *buf to the requested number of bytes.
+ * the bytes are read from the file a block at a time, and the pointer is
+ * into that block, so it is only valid until the next call to warts_read.
+ * as the underlying file descriptor may be set O_NONBLOCK, a record that
+ * straddles the end of the block is kept at the front of the block until
+ * the rest of it can be read.
  */
 int warts_read(scamper_file_t *sf, uint8_t **buf, size_t len)
 {
   scamper_file_readfunc_t rf = scamper_file_getreadfunc(sf);
   warts_state_t *state = scamper_file_getstate(sf);
-  int            fd    = scamper_file_getfd(sf);
-  uint8_t       *tmp   = NULL;
+  uint8_t       *tmp;
+  size_t         size;
+  ssize_t        rc;
   int            ret;
-  size_t         rc;
 
   *buf = NULL;
 
+  /* the memory returned by the read function last time is finished with */
+  if(state->readfree != NULL)
+    {
+      free(state->readfree);
+      state->readfree = NULL;
+    }
+
   if(rf != NULL)
     {
       if((ret = rf(scamper_file_getreadparam(sf), buf, len)) == 0 || ret == -2)
 	{
 	  if(ret == -2)
 	    scamper_file_seteof(sf);
+	  state->readfree = *buf;
 	  return 0;
 	}
       return -1;
     }
 
-  /* if there is data left over from a prior read, then append to it. */
-  if(state->readbuf != NULL)
+  while(state->readlen - state->readoff < len)
     {
-      assert(state->readbuf_len == len);
+      /* move what is left of the block to the front, and make room */
+      if(state->readoff > 0)
+	{
+	  memmove(state->readbuf, state->readbuf + state->readoff,
+		  state->readlen - state->readoff);
+	  state->readlen -= state->readoff;
+	  state->readoff = 0;
+	}
+      if(state->readbuf_len < len || state->readbuf == NULL)
+	{
+	  size = len > WARTS_READBUF_LEN ? len : WARTS_READBUF_LEN;
+	  if((tmp = realloc(state->readbuf, size)) == NULL)
+	    return -1;
+	  state->readbuf = tmp;
+	  state->readbuf_len = size;
+	}
 
-      /* read */
-      if((ret = read_wrap(fd, state->readbuf + state->readlen, &rc,
-			  len - state->readlen)) != 0)
+      if((rc = warts_read_fd(sf, state->readbuf + state->readlen,
+			     state->readbuf_len - state->readlen)) > 0)
 	{
-	  /* rc will be zero if nothing was read, so safe to use */
 	  state->readlen += rc;
+	  continue;
+	}
 
-	  /*
-	   * we got an error (or EOF) without successfully reading whatever
-	   * was left over.
-	   */
-	  if((ret == -1 && errno != EAGAIN) || ret == -2)
-	    {
-	      if(ret == -2)
-		scamper_file_seteof(sf);
-	      return -1;
-	    }
-
-	  /*
-	   * read has not completed yet, but we haven't got a failure
-	   * condition either.
-	   */
+      /* if we got eof and we had a partial read, then we've got a problem */
+      if(rc == 0)
+	{
+	  scamper_file_seteof(sf);
+	  if(state->readlen != 0)
+	    return -1;
 	  return 0;
 	}
 
-      *buf = state->readbuf;
-      state->readlen = 0;
-      state->readbuf = NULL;
-      state->readbuf_len = 0;
-      state->off += len;
-      return 0;
+      /* if the read would block, then there's no problem */
+      if(errno == EINTR)
+	continue;
+      if(errno == EAGAIN)
+	return 0;
+      return -1;
     }
 
-  /* no data left over, reading from scratch */
-  if((tmp = malloc(len)) == NULL)
-    return -1;
+  *buf = state->readbuf + state->readoff;
+  state->readoff += len;
+  state->off += len;
+  return 0;
+}
+
+/*
+ * warts_skip
+ *
+ * skip over the state->skip bytes that follow in the file, without
+ * returning them.  bytes already in the block are stepped over; the rest
+ * are seeked over if the file is a regular file, or read and discarded
+ * otherwise.  returns one when done, zero if the skip has to be resumed
+ * when more data is available, and -1 on error.
+ */
+static int warts_skip(scamper_file_t *sf)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+  int            fd    = scamper_file_getfd(sf);
+  struct stat    sb;
+  uint8_t       *buf;
+  size_t         avail, len;
+  ssize_t        rc;
+  off_t          off;
+
+  avail = state->readlen - state->readoff;
+  if(avail >= state->skip)
+    {
+      state->readoff += state->skip;
+      state->off += state->skip;
+      state->skip = 0;
+      return 1;
+    }
 
-  /* try and read.  if we read the whole amount, everything is good */
-  if((ret = read_wrap(fd, tmp, &rc, len)) == 0)
+  /* step over what is left of the block */
+  state->off += avail;
+  state->skip -= avail;
+  state->readoff = state->readlen = 0;
+
+  if(scamper_file_getreadfunc(sf) != NULL)
     {
-      *buf = tmp;
-      state->off += len;
-      return 0;
+      if(warts_read(sf, &buf, state->skip) != 0 || buf == NULL)
+	return -1;
+      state->skip = 0;
+      return 1;
     }
 
-  /* if a partial read occured, then record the partial read in state */
-  if(rc != 0)
+  /*
+   * seek past the rest.  a record that runs past the end of the file is
+   * treated the same as a partial read at the end of the file.
+   */
+  if(state->isreg)
     {
-      state->readlen = rc;
-      state->readbuf = tmp;
-      state->readbuf_len = len;
+      if((off = lseek(fd, state->skip, SEEK_CUR)) == (off_t)-1 ||
+	 fstat(fd, &sb) != 0)
+	return -1;
+      if(off > sb.st_size)
+	{
+	  scamper_file_seteof(sf);
+	  return -1;
+	}
+      state->off += state->skip;
+      state->skip = 0;
+      return 1;
     }
-  else
+
+  if(state->readbuf == NULL)
     {
-      free(tmp);
+      if((state->readbuf = malloc(WARTS_READBUF_LEN)) == NULL)
+	return -1;
+      state->readbuf_len = WARTS_READBUF_LEN;
     }
 
-  /* if we got eof and we had a partial read, then we've got a problem */
-  if(ret == -2)
+  while(state->skip > 0)
     {
-      /* got eof */
-      scamper_file_seteof(sf);
+      len = state->skip;
+      if(len > state->readbuf_len)
+	len = state->readbuf_len;
+      if((rc = warts_read_fd(sf, state->readbuf, len)) > 0)
+	{
+	  state->off += rc;
+	  state->skip -= rc;
+	  continue;
+	}
+      if(rc == 0)
+	{
+	  scamper_file_seteof(sf);
+	  return -1;
+	}
+      if(errno == EINTR)
+	continue;
+      if(errno == EAGAIN)
+	return 0;
+      return -1;
+    }
 
-      /* partial read, so error condition */
-      if(rc != 0)
-	return -1;
+  return 1;
+}
 
-      return 0;
+/*
+ * warts_write_fd
+ *
+ * write the buffer to the file.  if the write fails for whatever reason
+ * (as in the disk is full and only a partial record can be written), then
+ * the write will be retracted in its entirety.  a write to a compressed
+ * file cannot be retracted, as the record has already been deflated.
+ */
+static int warts_write_fd(const scamper_file_t *sf, const void *buf,
+			  size_t len)
+{
+#ifdef HAVE_ZLIB
+  warts_state_t *state = scamper_file_getstate(sf);
+
+  if(state->gz != NULL)
+    {
+      if(state->gz->pending == 0 && state->writelen == 0)
+	gettimeofday_wrap(&state->writetv);
+      return warts_gz_write(sf, buf, len, Z_NO_FLUSH);
+    }
+#endif
+
+  /*
+   * if the buf cannot be written out, then the warts file is truncated
+   * at the end of the last record written out in full.
+   */
+  return scamper_file_fdwrite(sf, buf, len);
+}
+
+/*
+ * warts_pend_discard
+ *
+ * the definition records of the lists and cycles that were waiting in the
+ * write buffer were discarded, so forget the ids assigned to them.  they
+ * are the most recently assigned ids, so the counters are wound back.
+ */
+static void warts_pend_discard(warts_state_t *state)
+{
+  warts_list_t *wl;
+  warts_cycle_t *wc;
+
+  while(state->cycle_pendc > 0)
+    {
+      wc = state->cycle_pend[--state->cycle_pendc];
+      splaytree_remove_item(state->cycle_tree, wc);
+      warts_cycle_free(wc);
+      state->cycle_count--;
+    }
+
+  while(state->list_pendc > 0)
+    {
+      wl = state->list_pend[--state->list_pendc];
+      splaytree_remove_item(state->list_tree, wl);
+      warts_list_free(wl);
+      state->list_count--;
     }
 
-  /* if the read would block, then there's no problem */
-  if(ret == -1 && errno == EAGAIN)
+  return;
+}
+
+/*
+ * scamper_file_warts_flush
+ *
+ * write out the records that have been buffered.  if they cannot all be
+ * written, none of them are, and they are discarded.  a compressed file
+ * is then flushed so that a reader can inflate everything written so far.
+ */
+int scamper_file_warts_flush(const scamper_file_t *sf)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+  int wrote = 0, rc = 0;
+
+  if(state == NULL)
     return 0;
 
-  return -1;
+  if(state->writelen > 0)
+    {
+      if(warts_write_fd(sf, state->writebuf, state->writelen) != 0)
+	{
+	  warts_pend_discard(state);
+	  rc = -1;
+	}
+      state->list_pendc = 0;
+      state->cycle_pendc = 0;
+      state->writelen = 0;
+      wrote = 1;
+    }
+
+#ifdef HAVE_ZLIB
+  if(rc == 0 && state->gz != NULL && state->gz->pending != 0)
+    {
+      if(warts_gz_write(sf, NULL, 0, Z_SYNC_FLUSH) != 0)
+	rc = -1;
+      wrote = 1;
+    }
+#endif
+
+  if(rc == 0 && wrote != 0 &&
+     scamper_file_getsync(sf) == SCAMPER_FILE_SYNC_FLUSH &&
+     scamper_file_fdsync(sf) != 0)
+    rc = -1;
+
+  /* the dictionary records that were discarded have to be written again */
+  if(rc != 0 && state->dict != NULL)
+    warts_dict_reset(state->dict);
+
+  return rc;
+}
+
+int scamper_file_warts_buffered(const scamper_file_t *sf, struct timeval *tv)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+
+  if(state == NULL)
+    return 0;
+
+#ifdef HAVE_ZLIB
+  if(state->writelen == 0 && (state->gz == NULL || state->gz->pending == 0))
+    return 0;
+#else
+  if(state->writelen == 0)
+    return 0;
+#endif
+
+  timeval_cpy(tv, &state->writetv);
+  return 1;
 }
 
 /*
- * warts_write
+ * warts_write_rec
  *
  * this function will write a record to disk, appending a warts_header
- * on the way out to the disk.  if the write fails for whatever reason
- * (as in the disk is full and only a partial recrd can be written), then
- * the write will be retracted in its entirety.
+ * on the way out to the disk.  if the file has been given a buffer, the
+ * record is held in memory until the buffer fills, or it is flushed.
  */
-int warts_write(const scamper_file_t *sf, const void *buf, size_t len)
+static int warts_write_rec(const scamper_file_t *sf, const void *buf,
+			   size_t len)
 {
   scamper_file_writefunc_t wf = scamper_file_getwritefunc(sf);
   warts_state_t *state = scamper_file_getstate(sf);
+  size_t size;
   void *param;
-  off_t off = 0;
-  int fd;
 
-  if(wf == NULL)
-    {
-      fd = scamper_file_getfd(sf);
+  scamper_file_addbytes(sf, len);
 
-      if(state->isreg && (off = lseek(fd, 0, SEEK_CUR)) == (off_t)-1)
-	return -1;
-
-      if(write_wrap(fd, buf, NULL, len) != 0)
-	{
-	  /*
-	   * if we could not write the buf out, then truncate the warts file
-	   * at the hdr we just wrote out above.
-	   */
-	  if(state->isreg)
-	    {
-	      if(ftruncate(fd, off) != 0)
-		return -1;
-	    }
-	  return -1;
-	}
-    }
-  else
+  if(wf != NULL)
     {
       param = scamper_file_getwriteparam(sf);
       return wf(param, buf, len);
     }
 
-  return 0;
+  if((size = scamper_file_getbufsize(sf)) == 0)
+    return warts_write_fd(sf, buf, len);
+
+  /* make room for the record, if the buffer cannot hold it as well */
+  if(state->writelen + len > state->writebuf_len &&
+     scamper_file_warts_flush(sf) != 0)
+    return -1;
+
+  /* a record that is larger than the buffer is written immediately */
+  if(len >= size)
+    return warts_write_fd(sf, buf, len);
+
+  if(state->writebuf == NULL)
+    {
+      if((state->writebuf = malloc(size)) == NULL)
+	return -1;
+      state->writebuf_len = size;
+    }
+
+  if(state->writelen == 0)
+    gettimeofday_wrap(&state->writetv);
+  memcpy(state->writebuf + state->writelen, buf, len);
+  state->writelen += len;
+
+  return 0;
+}
+
+/*
+ * warts_write
+ *
+ * write a record out, after the address dictionary record that defines
+ * the slots the record refers to, if any.
+ */
+int warts_write(const scamper_file_t *sf, const void *buf, size_t len)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+
+  if(state->dict != NULL && state->dict->pendc > 0 &&
+     warts_dict_write(sf, state->dict) != 0)
+    return -1;
+
+  return warts_write_rec(sf, buf, len);
 }
 
 /*
@@ -972,7 +1822,6 @@ int warts_hdr_read(scamper_file_t *sf, warts_hdr_t *hdr)
   extract_uint16(buf, &off, len, &hdr->magic, NULL);
   extract_uint16(buf, &off, len, &hdr->type, NULL);
   extract_uint32(buf, &off, len, &hdr->len, NULL);
-  free(buf);
 
   assert(off == len);
   return 1;
@@ -1043,7 +1892,6 @@ int warts_addr_read(scamper_file_t *sf, const warts_hdr_t *hdr,
     }
 
   state->addr_table[state->addr_count++] = addr;
-  free(buf);
 
   if(addr_out != NULL)
     {
@@ -1054,7 +1902,6 @@ int warts_addr_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
  err:
   if(addr != NULL) scamper_addr_free(addr);
-  if(buf != NULL) free(buf);
   return -1;
 }
 
@@ -1240,7 +2087,6 @@ int warts_list_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
   state->list_table[state->list_count++] = wl;
   scamper_list_free(list);
-  free(buf);
 
   if(list_out != NULL)
     {
@@ -1251,7 +2097,6 @@ int warts_list_read(scamper_file_t *sf, const warts_hdr_t *hdr,
  err:
   if(list != NULL) scamper_list_free(list);
   if(wl != NULL)   warts_list_free(wl);
-  if(buf != NULL)  free(buf);
   return -1;
 }
 
@@ -1269,6 +2114,7 @@ int warts_list_write(const scamper_file_t *sf, scamper_list_t *list,
   uint8_t   flags[list_vars_mfb];
   uint32_t  off = 0, len;
   uint16_t  name_len, flags_len, params_len;
+  size_t    size;
 
   /* we require a list name */
   if(list->name == NULL)
@@ -1310,6 +2156,13 @@ int warts_list_write(const scamper_file_t *sf, scamper_list_t *list,
 
   assert(off == len);
 
+  /* make room to remember the list, should the record be buffered */
+  size = sizeof(warts_list_t *) * (state->list_pendc + 1);
+  if(realloc_wrap((void **)&state->list_pend, size) != 0)
+    {
+      goto err;
+    }
+
   if(splaytree_insert(state->list_tree, wl) == NULL)
     {
       goto err;
@@ -1322,6 +2175,8 @@ int warts_list_write(const scamper_file_t *sf, scamper_list_t *list,
     }
 
   state->list_count++;
+  if(state->writelen > 0)
+    state->list_pend[state->list_pendc++] = wl;
   *id = wl->id;
   free(buf);
   return 0;
@@ -1547,7 +2402,6 @@ int warts_cycle_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
   state->cycle_table[state->cycle_count++] = wc;
   scamper_cycle_free(cycle);
-  free(buf);
 
   if(cycle_out != NULL)
     {
@@ -1562,7 +2416,6 @@ int warts_cycle_read(scamper_file_t *sf, const warts_hdr_t *hdr,
       if(cycle->list != NULL) scamper_list_free(cycle->list);
       free(cycle);
     }
-  if(buf != NULL) free(buf);
   return -1;
 }
 
@@ -1588,6 +2441,7 @@ int warts_cycle_write(const scamper_file_t *sf, scamper_cycle_t *cycle,
   uint8_t  flags[cycle_vars_mfb];
   uint16_t flags_len, params_len;
   uint32_t off = 0, len;
+  size_t   size;
 
   /* find the list associated w/ the cycle, as we require the warts list id */
   if(warts_list_getid(sf, cycle->list, &warts_list_id) == -1)
@@ -1628,6 +2482,13 @@ int warts_cycle_write(const scamper_file_t *sf, scamper_cycle_t *cycle,
 
   assert(off == len);
 
+  /* make room to remember the cycle, should the record be buffered */
+  size = sizeof(warts_cycle_t *) * (state->cycle_pendc + 1);
+  if(realloc_wrap((void **)&state->cycle_pend, size) != 0)
+    {
+      goto err;
+    }
+
   if(splaytree_insert(state->cycle_tree, wc) == NULL)
     {
       goto err;
@@ -1640,6 +2501,8 @@ int warts_cycle_write(const scamper_file_t *sf, scamper_cycle_t *cycle,
 
   if(id != NULL) *id = wc->id;
   state->cycle_count++;
+  if(state->writelen > 0)
+    state->cycle_pend[state->cycle_pendc++] = wc;
   free(buf);
 
   return 0;
@@ -1718,12 +2581,10 @@ int warts_cycle_stop_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   warts_cycle_free(state->cycle_table[id]);
   state->cycle_table[id] = NULL;
 
-  free(buf);
 
   return 0;
 
  err:
-  if(buf != NULL) free(buf);
   return -1;
 }
 
@@ -1926,12 +2787,12 @@ int scamper_file_warts_read(scamper_file_t *sf, scamper_file_filter_t *filter,
     (warts_obj_read_t)scamper_file_warts_tbit_read,
     (warts_obj_read_t)scamper_file_warts_sting_read,
     (warts_obj_read_t)scamper_file_warts_sniff_read,
+    (warts_obj_read_t)warts_addrdict_read,
   };
   warts_state_t   *state = scamper_file_getstate(sf);
   warts_hdr_t      hdr;
   int              isfilter;
   int              tmp;
-  uint8_t         *buf;
   void            *ptr;
   char             offs[16];
 
@@ -1944,6 +2805,7 @@ int scamper_file_warts_read(scamper_file_t *sf, scamper_file_filter_t *filter,
       if(state->hdr.type == 0)
 	{
 	  /* read the header for the next record from the file */
+	  state->recoff = state->off;
 	  if((tmp = warts_hdr_read(sf, &hdr)) == 0)
 	    {
 	      *data = NULL;
@@ -1971,7 +2833,8 @@ int scamper_file_warts_read(scamper_file_t *sf, scamper_file_filter_t *filter,
 	 hdr.type == SCAMPER_FILE_OBJ_LIST        ||
 	 hdr.type == SCAMPER_FILE_OBJ_CYCLE_DEF   ||
 	 hdr.type == SCAMPER_FILE_OBJ_CYCLE_START ||
-	 hdr.type == SCAMPER_FILE_OBJ_CYCLE_STOP)
+	 hdr.type == SCAMPER_FILE_OBJ_CYCLE_STOP  ||
+	 hdr.type == SCAMPER_FILE_OBJ_ADDRDICT)
 	{
 	  if(objread[hdr.type](sf, &hdr, &ptr) != 0)
 	    goto err;
@@ -1984,6 +2847,9 @@ int scamper_file_warts_read(scamper_file_t *sf, scamper_file_filter_t *filter,
 	    }
 
 	  memset(&state->hdr, 0, sizeof(state->hdr));
+	  state->slotoff = state->off;
+	  if(state->dictoff < state->off)
+	    state->dictoff = state->off;
 
 	  if(isfilter != 0)
 	    {
@@ -2000,6 +2866,7 @@ int scamper_file_warts_read(scamper_file_t *sf, scamper_file_filter_t *filter,
 		  *data = scamper_cycle_use((scamper_cycle_t *)ptr);
 		  break;
 		case SCAMPER_FILE_OBJ_CYCLE_STOP:
+		case SCAMPER_FILE_OBJ_ADDRDICT:
 		  *data = ptr;
 		  break;
 		}
@@ -2012,16 +2879,16 @@ int scamper_file_warts_read(scamper_file_t *sf, scamper_file_filter_t *filter,
       else if(isfilter == 0)
 	{
 	  /* reader doesn't care what the data is, and neither do we */
-	  buf = NULL;
-	  if(warts_read(sf, &buf, hdr.len) != 0)
+	  if(state->hdr.type == 0)
+	    state->skip = hdr.len;
+	  if((tmp = warts_skip(sf)) == -1)
 	    goto err;
-	  if(buf == NULL)
+	  if(tmp == 0)
 	    {
-	      /* partial read.  return for now */
+	      /* partial skip.  return for now */
 	      state->hdr = hdr;
 	      return 0;
 	    }
-	  free(buf);
 	  memset(&state->hdr, 0, sizeof(state->hdr));
 	}
       else
@@ -2058,7 +2925,15 @@ int scamper_file_warts_cyclestart_write(const scamper_file_t *sf,
 int scamper_file_warts_cyclestop_write(const scamper_file_t *sf,
 				       scamper_cycle_t *c)
 {
-  return warts_cycle_stop_write(sf, c);
+  /* commit the records of the cycle when it is complete */
+  if(warts_cycle_stop_write(sf, c) != 0 ||
+     scamper_file_warts_flush(sf) != 0)
+    return -1;
+  if(scamper_file_getsync(sf) == SCAMPER_FILE_SYNC_CYCLE &&
+     scamper_file_getwritefunc(sf) == NULL &&
+     scamper_file_fdsync(sf) != 0)
+    return -1;
+  return 0;
 }
 
 /*
@@ -2072,6 +2947,8 @@ int scamper_file_warts_cyclestop_write(const scamper_file_t *sf,
 int scamper_file_warts_init_read(scamper_file_t *sf)
 {
   warts_state_t *state;
+  int fd = scamper_file_getfd(sf);
+  struct stat sb;
   size_t size;
 
   if((state = (warts_state_t *)malloc_zero(sizeof(warts_state_t))) == NULL)
@@ -2079,6 +2956,10 @@ int scamper_file_warts_init_read(scamper_file_t *sf)
       goto err;
     }
 
+  /* records that are not wanted can be seeked over in a regular file */
+  if(fd != -1 && fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode))
+    state->isreg = 1;
+
   size = sizeof(scamper_addr_t *) * WARTS_ADDR_TABLEGROW;
   if((state->addr_table = malloc(size)) == NULL)
     {
@@ -2174,7 +3055,7 @@ int scamper_file_warts_init_append(scamper_file_t *sf)
 {
   warts_state_t   *state;
   warts_hdr_t      hdr;
-  int              i, fd;
+  int              i;
   uint32_t         j;
   scamper_addr_t  *addr;
   scamper_list_t  *list;
@@ -2185,8 +3066,7 @@ int scamper_file_warts_init_append(scamper_file_t *sf)
     {
       return -1;
     }
-
-  fd = scamper_file_getfd(sf);
+  state = scamper_file_getstate(sf);
 
   for(;;)
     {
@@ -2231,8 +3111,14 @@ int scamper_file_warts_init_append(scamper_file_t *sf)
 	  scamper_cycle_free(cycle);
 	  break;
 
+	  /*
+	   * records appended to the file start a new address dictionary,
+	   * so the slots defined in the file so far are not needed
+	   */
+	case SCAMPER_FILE_OBJ_ADDRDICT:
 	default:
-	  if(lseek(fd, hdr.len, SEEK_CUR) == -1)
+	  state->skip = hdr.len;
+	  if(warts_skip(sf) != 1)
 	    {
 	      return -1;
 	    }
@@ -2240,9 +3126,6 @@ int scamper_file_warts_init_append(scamper_file_t *sf)
 	}
     }
 
-  /* get the state structure created in init_read */
-  state = scamper_file_getstate(sf);
-
   /*
    * all the lists are in a table.  put them into a splay tree so we can
    * find them quickly, and then trash the list table
@@ -2279,9 +3162,86 @@ int scamper_file_warts_init_append(scamper_file_t *sf)
     }
   free(state->cycle_table); state->cycle_table = NULL;
 
+  /* the block used to read the file is not needed when appending */
+  if(state->readbuf != NULL)
+    {
+      free(state->readbuf);
+      state->readbuf = NULL;
+      state->readbuf_len = state->readlen = state->readoff = 0;
+    }
+
   return 0;
 }
 
+#ifdef HAVE_ZLIB
+int scamper_file_warts_gz_init_write(scamper_file_t *sf)
+{
+  if(scamper_file_warts_init_write(sf) != 0)
+    return -1;
+  return warts_gz_write_init(scamper_file_getstate(sf));
+}
+
+/*
+ * scamper_file_warts_gz_init_append
+ *
+ * inflate the file to form the dictionaries, and then start a new gzip
+ * member at the end of the file for the records that are to be appended.
+ */
+int scamper_file_warts_gz_init_append(scamper_file_t *sf)
+{
+  warts_state_t *state;
+
+  if(scamper_file_warts_init_append(sf) != 0)
+    return -1;
+
+  state = scamper_file_getstate(sf);
+  if(state->gz != NULL)
+    {
+      warts_gz_free(state->gz);
+      state->gz = NULL;
+    }
+
+  return warts_gz_write_init(state);
+}
+
+/*
+ * scamper_file_warts_gz_is
+ *
+ * the file is a compressed warts file if it is gzip compressed, and the
+ * data inflates to something that begins with the warts magic.
+ */
+int scamper_file_warts_gz_is(const scamper_file_t *sf)
+{
+  int fd = scamper_file_getfd(sf);
+  uint8_t in[512], out[2];
+  z_stream z;
+  ssize_t len;
+  int rc = 0;
+
+  if(lseek(fd, 0, SEEK_SET) == -1)
+    return 0;
+
+  if((len = read(fd, in, sizeof(in))) >= 2 && in[0] == 0x1f && in[1] == 0x8b)
+    {
+      memset(&z, 0, sizeof(z));
+      if(inflateInit2(&z, 15 + 16) == Z_OK)
+	{
+	  z.next_in = in; z.avail_in = len;
+	  z.next_out = out; z.avail_out = sizeof(out);
+	  inflate(&z, Z_NO_FLUSH);
+	  if(z.avail_out == 0 && bytes_ntohs(out) == WARTS_MAGIC)
+	    rc = 1;
+	  inflateEnd(&z);
+	}
+    }
+
+  if(lseek(fd, 0, SEEK_SET) == -1)
+    return 0;
+
+  return rc;
+}
+#endif
+
 int scamper_file_warts_is(const scamper_file_t *sf)
 {
   uint16_t magic16;
@@ -2309,6 +3269,440 @@ int scamper_file_warts_is(const scamper_file_t *sf)
   return 0;
 }
 
+/*
+ * warts_idx_isdict
+ *
+ * records that define addresses, lists, and cycles that later records
+ * refer to.
+ */
+static int warts_idx_isdict(uint16_t type)
+{
+  if(type == SCAMPER_FILE_OBJ_ADDR ||
+     type == SCAMPER_FILE_OBJ_LIST ||
+     type == SCAMPER_FILE_OBJ_CYCLE_START ||
+     type == SCAMPER_FILE_OBJ_CYCLE_DEF ||
+     type == SCAMPER_FILE_OBJ_CYCLE_STOP ||
+     type == SCAMPER_FILE_OBJ_ADDRDICT)
+    return 1;
+  return 0;
+}
+
+/*
+ * warts_idx_obj
+ *
+ * get the address measured, and when the measurement started, from an
+ * object read from the file, and then free the object.
+ */
+static void warts_idx_obj(warts_idx_t *idx, void *data)
+{
+  scamper_addr_t *dst = NULL;
+  struct timeval *tv = NULL;
+  scamper_cycle_t *cycle;
+
+  switch(idx->type)
+    {
+    case SCAMPER_FILE_OBJ_TRACE:
+      dst = ((scamper_trace_t *)data)->dst;
+      tv = &((scamper_trace_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_PING:
+      dst = ((scamper_ping_t *)data)->dst;
+      tv = &((scamper_ping_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_TRACELB:
+      dst = ((scamper_tracelb_t *)data)->dst;
+      tv = &((scamper_tracelb_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_DEALIAS:
+      tv = &((scamper_dealias_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_NEIGHBOURDISC:
+      dst = ((scamper_neighbourdisc_t *)data)->dst_ip;
+      tv = &((scamper_neighbourdisc_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_TBIT:
+      dst = ((scamper_tbit_t *)data)->dst;
+      tv = &((scamper_tbit_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_STING:
+      dst = ((scamper_sting_t *)data)->dst;
+      tv = &((scamper_sting_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_SNIFF:
+      tv = &((scamper_sniff_t *)data)->start;
+      break;
+
+    case SCAMPER_FILE_OBJ_CYCLE_START:
+    case SCAMPER_FILE_OBJ_CYCLE_DEF:
+    case SCAMPER_FILE_OBJ_CYCLE_STOP:
+      cycle = (scamper_cycle_t *)data;
+      if(idx->type == SCAMPER_FILE_OBJ_CYCLE_STOP)
+	idx->start = cycle->stop_time;
+      else
+	idx->start = cycle->start_time;
+      break;
+    }
+
+  if(tv != NULL)
+    idx->start = tv->tv_sec;
+  if(dst != NULL && scamper_addr_size(dst) <= sizeof(idx->addr))
+    {
+      idx->addr_type = dst->type;
+      memcpy(idx->addr, dst->addr, scamper_addr_size(dst));
+    }
+
+  switch(idx->type)
+    {
+    case SCAMPER_FILE_OBJ_TRACE: scamper_trace_free(data); break;
+    case SCAMPER_FILE_OBJ_PING: scamper_ping_free(data); break;
+    case SCAMPER_FILE_OBJ_TRACELB: scamper_tracelb_free(data); break;
+    case SCAMPER_FILE_OBJ_DEALIAS: scamper_dealias_free(data); break;
+    case SCAMPER_FILE_OBJ_NEIGHBOURDISC: scamper_neighbourdisc_free(data); break;
+    case SCAMPER_FILE_OBJ_TBIT: scamper_tbit_free(data); break;
+    case SCAMPER_FILE_OBJ_STING: scamper_sting_free(data); break;
+    case SCAMPER_FILE_OBJ_SNIFF: scamper_sniff_free(data); break;
+    case SCAMPER_FILE_OBJ_ADDR: scamper_addr_free(data); break;
+    case SCAMPER_FILE_OBJ_LIST: scamper_list_free(data); break;
+    case SCAMPER_FILE_OBJ_CYCLE_START:
+    case SCAMPER_FILE_OBJ_CYCLE_DEF:
+    case SCAMPER_FILE_OBJ_CYCLE_STOP: scamper_cycle_free(data); break;
+    }
+
+  return;
+}
+
+/*
+ * scamper_file_warts_index
+ *
+ * read through the file and write an entry into the index file for each
+ * record.  each entry is 32 bytes: the offset of the record in 8 bytes,
+ * the start time in seconds in 4 bytes, the record type in 2 bytes, the
+ * type of the address measured in a byte, a reserved byte, and 16 bytes
+ * for the address.
+ */
+int scamper_file_warts_index(scamper_file_t *sf, const char *filename)
+{
+  static const uint16_t types[] = {
+    SCAMPER_FILE_OBJ_LIST,
+    SCAMPER_FILE_OBJ_CYCLE_START,
+    SCAMPER_FILE_OBJ_CYCLE_DEF,
+    SCAMPER_FILE_OBJ_CYCLE_STOP,
+    SCAMPER_FILE_OBJ_ADDR,
+    SCAMPER_FILE_OBJ_TRACE,
+    SCAMPER_FILE_OBJ_PING,
+    SCAMPER_FILE_OBJ_TRACELB,
+    SCAMPER_FILE_OBJ_DEALIAS,
+    SCAMPER_FILE_OBJ_NEIGHBOURDISC,
+    SCAMPER_FILE_OBJ_TBIT,
+    SCAMPER_FILE_OBJ_STING,
+    SCAMPER_FILE_OBJ_SNIFF,
+    SCAMPER_FILE_OBJ_ADDRDICT,
+  };
+  warts_state_t *state = scamper_file_getstate(sf);
+  scamper_file_filter_t *filter = NULL;
+  uint8_t buf[WARTS_IDX_LEN * 1024];
+  uint32_t off = 0;
+  warts_idx_t idx;
+  uint16_t type;
+  void *data;
+  int fd = -1;
+
+  filter = scamper_file_filter_alloc((uint16_t *)types,
+				     sizeof(types) / sizeof(uint16_t));
+  if(filter == NULL)
+    goto err;
+
+#ifndef _WIN32
+  fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC,
+	    S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+#else
+  fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY,
+	    _S_IREAD | _S_IWRITE);
+#endif
+  if(fd == -1)
+    goto err;
+
+  bytes_htonl(buf+0, WARTS_IDX_MAGIC);
+  bytes_htonl(buf+4, WARTS_IDX_VERSION);
+  off = WARTS_IDX_HDRLEN;
+
+  for(;;)
+    {
+      if(scamper_file_warts_read(sf, filter, &type, &data) != 0)
+	goto err;
+      if(data == NULL)
+	break;
+
+      memset(&idx, 0, sizeof(idx));
+      idx.off  = state->recoff;
+      idx.type = type;
+      warts_idx_obj(&idx, data);
+
+      if(off + WARTS_IDX_LEN > sizeof(buf))
+	{
+	  if(write_wrap(fd, buf, NULL, off) != 0)
+	    goto err;
+	  off = 0;
+	}
+
+      bytes_htonl(buf+off+0, (uint32_t)(idx.off >> 32));
+      bytes_htonl(buf+off+4, (uint32_t)(idx.off & 0xffffffff));
+      bytes_htonl(buf+off+8, idx.start);
+      bytes_htons(buf+off+12, idx.type);
+      buf[off+14] = idx.addr_type;
+      buf[off+15] = 0;
+      memcpy(buf+off+16, idx.addr, 16);
+      off += WARTS_IDX_LEN;
+    }
+
+  if(off > 0 && write_wrap(fd, buf, NULL, off) != 0)
+    goto err;
+
+  close(fd);
+  scamper_file_filter_free(filter);
+  return 0;
+
+ err:
+  if(fd != -1) close(fd);
+  if(filter != NULL) scamper_file_filter_free(filter);
+  return -1;
+}
+
+/*
+ * warts_idx_load
+ *
+ * read the index that was written alongside the file into memory.
+ */
+static int warts_idx_load(scamper_file_t *sf)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+  char *filename = scamper_file_getfilename(sf);
+  uint8_t *buf = NULL;
+  char *path = NULL;
+  struct stat sb;
+  size_t len, off;
+  uint32_t i, c;
+  int fd = -1;
+
+  if(filename == NULL)
+    goto err;
+
+  len = strlen(filename) + 5;
+  if((path = malloc(len)) == NULL)
+    goto err;
+  snprintf(path, len, "%s.idx", filename);
+
+#ifndef _WIN32
+  fd = open(path, O_RDONLY);
+#else
+  fd = open(path, O_RDONLY | O_BINARY);
+#endif
+  if(fd == -1 || fstat(fd, &sb) != 0 || sb.st_size < WARTS_IDX_HDRLEN ||
+     (sb.st_size - WARTS_IDX_HDRLEN) % WARTS_IDX_LEN != 0)
+    goto err;
+
+  len = sb.st_size;
+  if((buf = malloc(len)) == NULL || read_wrap(fd, buf, NULL, len) != 0 ||
+     bytes_ntohl(buf+0) != WARTS_IDX_MAGIC ||
+     bytes_ntohl(buf+4) != WARTS_IDX_VERSION)
+    goto err;
+
+  c = (len - WARTS_IDX_HDRLEN) / WARTS_IDX_LEN;
+  if(c > 0 && (state->idx = malloc_zero(sizeof(warts_idx_t) * c)) == NULL)
+    goto err;
+
+  off = WARTS_IDX_HDRLEN;
+  for(i=0; i<c; i++)
+    {
+      state->idx[i].off = ((uint64_t)bytes_ntohl(buf+off+0) << 32) |
+	bytes_ntohl(buf+off+4);
+      state->idx[i].start = bytes_ntohl(buf+off+8);
+      state->idx[i].type = bytes_ntohs(buf+off+12);
+      state->idx[i].addr_type = buf[off+14];
+      memcpy(state->idx[i].addr, buf+off+16, 16);
+      off += WARTS_IDX_LEN;
+    }
+  state->idxc = c;
+  state->idxpos = 0;
+  state->idxload = 1;
+
+  free(buf);
+  free(path);
+  close(fd);
+  return 0;
+
+ err:
+  if(buf != NULL) free(buf);
+  if(path != NULL) free(path);
+  if(fd != -1) close(fd);
+  return -1;
+}
+
+/*
+ * warts_idx_goto
+ *
+ * position the file so that the next record read is at the offset.
+ */
+static int warts_idx_goto(scamper_file_t *sf, uint64_t off)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+
+  if(lseek(scamper_file_getfd(sf), (off_t)off, SEEK_SET) != (off_t)off)
+    return -1;
+
+  state->readoff = state->readlen = 0;
+  state->skip = 0;
+  state->off = off;
+  memset(&state->hdr, 0, sizeof(state->hdr));
+  return 0;
+}
+
+/*
+ * warts_idx_dict
+ *
+ * before jumping to a record, read the address, list, and cycle records
+ * that precede it and that have not already been read, as the record may
+ * refer to them.  cycle stop records are not read, so that a later seek
+ * back into the cycle can still refer to it.  address dictionary records
+ * are read again from slotoff, as a slot may have been defined again
+ * later in the file than the record being jumped to.
+ */
+static int warts_idx_dict(scamper_file_t *sf, uint64_t target)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+  scamper_cycle_t *cycle;
+  warts_dict_t *dict;
+  scamper_list_t *list;
+  scamper_addr_t *addr;
+  warts_hdr_t hdr;
+  uint32_t l, r, m;
+
+  /* find the first record that has not been read */
+  l = 0; r = state->idxc;
+  while(l < r)
+    {
+      m = l + ((r - l) / 2);
+      if(state->idx[m].off < (uint64_t)state->slotoff)
+	l = m + 1;
+      else
+	r = m;
+    }
+
+  for(; l < state->idxc && state->idx[l].off < target; l++)
+    {
+      if(warts_idx_isdict(state->idx[l].type) == 0 ||
+	 state->idx[l].type == SCAMPER_FILE_OBJ_CYCLE_STOP)
+	continue;
+
+      /* the other tables only grow, so their records are read once */
+      if(state->idx[l].off < (uint64_t)state->dictoff &&
+	 state->idx[l].type != SCAMPER_FILE_OBJ_ADDRDICT)
+	continue;
+
+      if(warts_idx_goto(sf, state->idx[l].off) != 0 ||
+	 warts_hdr_read(sf, &hdr) != 1 ||
+	 hdr.magic != WARTS_MAGIC || hdr.type != state->idx[l].type)
+	return -1;
+
+      switch(hdr.type)
+	{
+	case SCAMPER_FILE_OBJ_ADDR:
+	  if(warts_addr_read(sf, &hdr, &addr) != 0 || addr == NULL)
+	    return -1;
+	  break;
+
+	case SCAMPER_FILE_OBJ_LIST:
+	  if(warts_list_read(sf, &hdr, &list) != 0 || list == NULL)
+	    return -1;
+	  break;
+
+	case SCAMPER_FILE_OBJ_CYCLE_START:
+	case SCAMPER_FILE_OBJ_CYCLE_DEF:
+	  if(warts_cycle_read(sf, &hdr, &cycle) != 0 || cycle == NULL)
+	    return -1;
+	  break;
+
+	case SCAMPER_FILE_OBJ_ADDRDICT:
+	  if(warts_addrdict_read(sf, &hdr, &dict) != 0 || dict == NULL)
+	    return -1;
+	  break;
+	}
+
+      state->slotoff = state->off;
+      if(state->dictoff < state->off)
+	state->dictoff = state->off;
+    }
+
+  return 0;
+}
+
+/*
+ * scamper_file_warts_seek
+ *
+ * use the index to position the file at the next record of the given type
+ * (any type, if zero), measuring the given address (any, if null), that
+ * started within the time range (any, if finish is zero).  returns one
+ * if a record was found, zero if there are no more, and -1 on error.
+ */
+int scamper_file_warts_seek(scamper_file_t *sf, uint16_t type,
+			    const scamper_addr_t *dst,
+			    uint32_t start, uint32_t finish)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+  warts_idx_t *idx;
+
+  if(scamper_file_getreadfunc(sf) != NULL || state->isreg == 0)
+    return -1;
+  if(state->idxload == 0 && warts_idx_load(sf) != 0)
+    return -1;
+
+  while(state->idxpos < state->idxc)
+    {
+      idx = &state->idx[state->idxpos++];
+      if(warts_idx_isdict(idx->type) != 0)
+	continue;
+      if(type != 0 && idx->type != type)
+	continue;
+      if(dst != NULL && (idx->addr_type != dst->type ||
+			 memcmp(idx->addr, dst->addr,
+				scamper_addr_size(dst)) != 0))
+	continue;
+      if(finish != 0 && (idx->start < start || idx->start > finish))
+	continue;
+
+      if(warts_idx_dict(sf, idx->off) != 0 ||
+	 warts_idx_goto(sf, idx->off) != 0)
+	return -1;
+      return 1;
+    }
+
+  return 0;
+}
+
+/*
+ * scamper_file_warts_seek_reset
+ *
+ * start the next seek from the first record again.  the address
+ * dictionary's slots are forgotten, so that they are defined again as
+ * they were at whichever record is sought.
+ */
+void scamper_file_warts_seek_reset(scamper_file_t *sf)
+{
+  warts_state_t *state = scamper_file_getstate(sf);
+  state->idxpos = 0;
+  state->slotoff = 0;
+  if(state->dict != NULL)
+    warts_dict_reset(state->dict);
+  return;
+}
+
 static void warts_free_state(splaytree_t *tree, void **table,
 			     unsigned int count, splaytree_free_t free_cb)
 {
@@ -2349,6 +3743,38 @@ void scamper_file_warts_free_state(scamper_file_t *sf)
       free(state->readbuf);
     }
 
+  if(state->readfree != NULL)
+    {
+      free(state->readfree);
+    }
+
+  if(state->idx != NULL)
+    {
+      free(state->idx);
+    }
+
+  if(state->dict != NULL)
+    {
+      warts_dict_free(state->dict);
+    }
+
+  if(state->writebuf != NULL)
+    {
+      free(state->writebuf);
+    }
+
+#ifdef HAVE_ZLIB
+  /* write the end of the gzip member out */
+  if(state->gz != NULL)
+    {
+      if(state->gz->outok != 0 &&
+	 warts_gz_write(sf, NULL, 0, Z_FINISH) == 0 &&
+	 scamper_file_getsync(sf) != SCAMPER_FILE_SYNC_NONE)
+	scamper_file_fdsync(sf);
+      warts_gz_free(state->gz);
+    }
+#endif
+
   warts_free_state(state->list_tree,
 		   (void **)state->list_table, state->list_count,
 		   (splaytree_free_t)warts_list_free);
@@ -2357,6 +3783,9 @@ void scamper_file_warts_free_state(scamper_file_t *sf)
 		   (void **)state->cycle_table, state->cycle_count,
 		   (splaytree_free_t)warts_cycle_free);
 
+  if(state->list_pend != NULL) free(state->list_pend);
+  if(state->cycle_pend != NULL) free(state->cycle_pend);
+
   if(state->addr_table != NULL)
     {
       for(i=1; i<state->addr_count; i++)
@@ -74,10 +74,46 @@ typedef struct warts_cycle
 
 
 
+/*
+ * warts_dict_addr, warts_dict
+ *
+ * a dictionary of addresses kept across the records of a file.  each
+ * address is held in a numbered slot that records refer to, and which is
+ * defined by an address dictionary record before the first record that
+ * refers to it.  a writer only defines a slot for an address when a
+ * second record refers to it, and keeps the slots in least-recently-used
+ * order, so that when the dictionary is full the slot used least recently
+ * is taken for a new address.
+ */
+typedef struct warts_dict_addr
+{
+  scamper_addr_t *addr;
+  uint32_t        stamp;  /* the record that last referred to the slot */
+  uint32_t        prev;   /* the slot used more recently than this one */
+  uint32_t        next;   /* the slot used less recently than this one */
+  uint16_t        slot;
+  uint8_t         pend;   /* the slot has to be defined in the file */
+  uint8_t         defd;   /* the slot has been defined in the file */
+} warts_dict_addr_t;
+typedef struct warts_dict
+{
+  warts_dict_addr_t *ents;
+  uint32_t           entc;
+  uint32_t           size;
+  splaytree_t       *tree;
+  uint32_t           head;
+  uint32_t           tail;
+  uint32_t           stamp;
+  uint16_t          *pend;
+  uint32_t           pendc;
+} warts_dict_t;
+
 /*
  * warts_addr, warts_addrtable
  *
- * keep track of addresses being written to disk.
+ * keep track of the addresses in a record.  when a record is written,
+ * addrs is a hash table with addrm buckets, found by open addressing;
+ * when a record is read, addrs is an array indexed by address id.
  */
 typedef struct warts_addr
 {
@@ -88,7 +124,9 @@ typedef struct warts_addr
 typedef struct warts_addrtable
 {
   warts_addr_t **addrs;
-  int            addrc;
+  uint32_t       addrc;
+  uint32_t       addrm;
+  warts_dict_t  *dict;
 } warts_addrtable_t;
 
 /*
@@ -107,6 +145,21 @@ typedef struct warts_hdr
   uint32_t len;
 } warts_hdr_t;
 
+/*
+ * warts_idx
+ *
+ * an entry of the index kept alongside a warts file: the offset of a
+ * record, when its measurement started, its type, and the address measured.
+ */
+typedef struct warts_idx
+{
+  uint64_t          off;
+  uint32_t          start;
+  uint16_t          type;
+  uint8_t           addr_type;
+  uint8_t           addr[16];
+} warts_idx_t;
+
 /*
  * warts_state
  *
@@ -121,10 +174,51 @@ typedef struct warts_state
   int               isreg;
   off_t             off;
 
-  /* temporary buffer for leftover partial reads */
+  /*
+   * block of data read from the file: the size of the block, the number
+   * of bytes read into it, and the offset of the first byte not returned.
+   * readfree holds memory returned by a read function until the next read.
+   */
   uint8_t          *readbuf;
-  size_t            readlen;
   size_t            readbuf_len;
+  size_t            readlen;
+  size_t            readoff;
+  uint8_t          *readfree;
+
+  /* the number of bytes left to skip over in a record that is not wanted */
+  size_t            skip;
+
+  /*
+   * recoff:  the offset of the record being read.
+   * dictoff: the offset after the last address, list, or cycle record read.
+   * slotoff: the offset after the last record the address dictionary's
+   *          slots are defined up to, which goes back to the start of the
+   *          file when a seek is reset.
+   */
+  off_t             recoff;
+  off_t             dictoff;
+  off_t             slotoff;
+
+  /* the index read from alongside the file, and the next entry to check */
+  warts_idx_t      *idx;
+  uint32_t          idxc;
+  uint32_t          idxpos;
+  int               idxload;
+
+  /*
+   * records waiting to be written to the file, and the time the first
+   * of them was buffered
+   */
+  uint8_t          *writebuf;
+  size_t            writelen;
+  size_t            writebuf_len;
+  struct timeval    writetv;
+
+  /* the zlib streams used to read or write a compressed file */
+  struct warts_gz  *gz;
+
+  /* the address dictionary kept across the records of the file */
+  warts_dict_t     *dict;
 
   /*
    * if a partial read was done on the last loop through but whatever
@@ -144,6 +238,16 @@ typedef struct warts_state
   warts_cycle_t   **cycle_table;
   warts_cycle_t     cycle_null;
 
+  /*
+   * lists and cycles whose definition records are in writebuf.  if the
+   * buffer is discarded, they are taken out of the trees and their ids
+   * are handed out again.
+   */
+  warts_list_t    **list_pend;
+  uint32_t          list_pendc;
+  warts_cycle_t   **cycle_pend;
+  uint32_t          cycle_pendc;
+
   /* address state */
   uint32_t          addr_count;
   scamper_addr_t  **addr_table;
@@ -174,6 +278,7 @@ uint16_t fold_flags(uint8_t *flags, const int max_id);
 
 int warts_str_size(const char *str);
 uint32_t warts_addr_size(warts_addrtable_t *t, scamper_addr_t *addr);
+void warts_addrtable_init(const scamper_file_t *sf, warts_addrtable_t *table);
 void warts_addrtable_clean(warts_addrtable_t *table);
 
 void insert_addr(uint8_t *buf, uint32_t *off, const uint32_t len,
@@ -248,6 +353,8 @@ int warts_write(const scamper_file_t *sf, const void *buf, size_t len);
 int warts_hdr_read(scamper_file_t *sf, warts_hdr_t *hdr);
 int warts_addr_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 			   scamper_addr_t **addr_out);
+int warts_addrdict_read(scamper_file_t *sf, const warts_hdr_t *hdr,
+			warts_dict_t **dict_out);
 int warts_list_cmp(const void *va, const void *vb);
 warts_list_t *warts_list_alloc(scamper_list_t *list, uint32_t id);
 void warts_list_free(warts_list_t *wl);
@@ -308,6 +415,21 @@ int scamper_file_warts_init_append(scamper_file_t *file);
 int scamper_file_warts_init_read(scamper_file_t *file);
 int scamper_file_warts_init_write(scamper_file_t *file);
 
+#ifdef HAVE_ZLIB
+int scamper_file_warts_gz_is(const scamper_file_t *file);
+int scamper_file_warts_gz_init_append(scamper_file_t *file);
+int scamper_file_warts_gz_init_write(scamper_file_t *file);
+#endif
+
+int scamper_file_warts_index(scamper_file_t *file, const char *filename);
+int scamper_file_warts_seek(scamper_file_t *file, uint16_t type,
+			    const scamper_addr_t *dst,
+			    uint32_t start, uint32_t finish);
+void scamper_file_warts_seek_reset(scamper_file_t *file);
+
+int scamper_file_warts_flush(const scamper_file_t *file);
+int scamper_file_warts_buffered(const scamper_file_t *file, struct timeval *tv);
+
 void scamper_file_warts_free_state(scamper_file_t *file);
 
 #endif /* __SCAMPER_FILE_WARTS_H */
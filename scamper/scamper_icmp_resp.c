@@ -365,12 +365,46 @@ void scamper_icmp_resp_clean(scamper_icmp_resp_t *ir)
   return;
 }
 
+/*
+ * the number of ICMP responses that did, and did not, match a task
+ */
+static uint64_t resp_matched = 0;
+static uint64_t resp_unmatched = 0;
+
+void scamper_icmp_resp_stats(uint64_t *matched, uint64_t *unmatched)
+{
+  *matched = resp_matched;
+  *unmatched = resp_unmatched;
+  return;
+}
+
 void scamper_icmp_resp_handle(scamper_icmp_resp_t *resp)
 {
   scamper_task_sig_t sig;
   scamper_task_t *task;
   scamper_addr_t  addr;
 
+  /*
+   * some tasks do not hold a signature for each destination they probe,
+   * and instead identify their probes by the ICMP id of an echo request.
+   */
+  memset(&sig, 0, sizeof(sig));
+  sig.sig_type = SCAMPER_TASK_SIG_TYPE_ICMP;
+  sig.sig_icmp_mask = 0xffff;
+  if(SCAMPER_ICMP_RESP_IS_ECHO_REPLY(resp))
+    sig.sig_icmp_id = resp->ir_icmp_id;
+  else if(SCAMPER_ICMP_RESP_INNER_IS_SET(resp) &&
+	  SCAMPER_ICMP_RESP_INNER_IS_ICMP_ECHO_REQ(resp))
+    sig.sig_icmp_id = resp->ir_inner_icmp_id;
+  else
+    sig.sig_icmp_mask = 0;
+  if(sig.sig_icmp_mask != 0 && (task = scamper_task_find(&sig)) != NULL)
+    {
+      resp_matched++;
+      scamper_task_handleicmp(task, resp);
+      return;
+    }
+
   if(SCAMPER_ICMP_RESP_IS_TTL_EXP(resp) ||
      SCAMPER_ICMP_RESP_IS_UNREACH(resp) ||
      SCAMPER_ICMP_RESP_IS_PACKET_TOO_BIG(resp) ||
@@ -398,6 +432,10 @@ void scamper_icmp_resp_handle(scamper_icmp_resp_t *resp)
   sig.sig_type = SCAMPER_TASK_SIG_TYPE_TX_IP;
   sig.sig_tx_ip_dst = &addr;
   if((task = scamper_task_find(&sig)) != NULL)
-    scamper_task_handleicmp(task, resp);
+    {
+      resp_matched++;
+      scamper_task_handleicmp(task, resp);
+    }
+  else resp_unmatched++;
   return;
 }
@@ -250,6 +250,7 @@ int scamper_icmp_resp_src(scamper_icmp_resp_t *resp, scamper_addr_t *addr);
 int scamper_icmp_resp_inner_dst(scamper_icmp_resp_t *resp, scamper_addr_t *a);
 
 void scamper_icmp_resp_handle(scamper_icmp_resp_t *resp);
+void scamper_icmp_resp_stats(uint64_t *matched, uint64_t *unmatched);
 
 void scamper_icmp_resp_clean(scamper_icmp_resp_t *ir);
 
@@ -44,6 +44,8 @@ struct scamper_linepoll
   void    *param;
   uint8_t *buf;
   size_t   len;
+  off_t    off;  /* number of bytes passed to scamper_linepoll_handle */
+  off_t    loff; /* offset of the line currently passed to the handler */
 };
 
 /*
@@ -63,6 +65,7 @@ int scamper_linepoll_flush(scamper_linepoll_t *lp)
 
   lp->buf = tmp;
   lp->buf[lp->len] = '\0';
+  lp->loff = lp->off - lp->len;
   lp->handler(lp->param, lp->buf, lp->len);
 
   free(lp->buf);
@@ -82,6 +85,7 @@ int scamper_linepoll_handle(scamper_linepoll_t *lp, uint8_t *buf, size_t len)
 {
   uint8_t *bbuf;
   size_t i = 0, s = 0, blen;
+  off_t base;
 
   assert(lp != NULL);
   assert(buf != NULL);
@@ -92,6 +96,10 @@ int scamper_linepoll_handle(scamper_linepoll_t *lp, uint8_t *buf, size_t len)
       return 0;
     }
 
+  /* record the offset of buf[0] in the stream of bytes */
+  base = lp->off;
+  lp->off += len;
+
   /*
    * there is a partial line from the previous read, deal with it now.
    * it is dealt with by scanning for the actual end of the line in this
@@ -120,6 +128,7 @@ int scamper_linepoll_handle(scamper_linepoll_t *lp, uint8_t *buf, size_t len)
 	  blen = lp->len+i;
 
 	  /* we don't need the old buf anymore */
+	  lp->loff = base - lp->len;
 	  free(lp->buf); lp->buf = NULL; lp->len = 0;
 
 	  /* drop the \r of a \r\n if necessary */
@@ -189,6 +198,7 @@ int scamper_linepoll_handle(scamper_linepoll_t *lp, uint8_t *buf, size_t len)
       if(s != i)
 	{
 	  buf[i] = '\0';
+	  lp->loff = base + s;
 	  if(buf[i-1] != '\r')
 	    {
 	      lp->handler(lp->param, buf+s, i-s);
@@ -232,10 +242,52 @@ scamper_linepoll_t *scamper_linepoll_alloc(scamper_linepoll_handler_t handler,
   lp->param = param;
   lp->buf = NULL;
   lp->len = 0;
+  lp->off = 0;
+  lp->loff = 0;
 
   return lp;
 }
 
+/*
+ * scamper_linepoll_lineoff
+ *
+ * return the offset, in the stream of bytes passed to the linepoll, of
+ * the line currently being passed to the handler.
+ */
+off_t scamper_linepoll_lineoff(const scamper_linepoll_t *lp)
+{
+  return lp->loff;
+}
+
+/*
+ * scamper_linepoll_getoff
+ *
+ * return the offset of the first byte that has not yet been passed to
+ * the handler as part of a complete line.
+ */
+off_t scamper_linepoll_getoff(const scamper_linepoll_t *lp)
+{
+  return lp->off - lp->len;
+}
+
+/*
+ * scamper_linepoll_setoff
+ *
+ * the caller has repositioned the stream.  any partial line that is
+ * held is discarded.
+ */
+void scamper_linepoll_setoff(scamper_linepoll_t *lp, off_t off)
+{
+  if(lp->buf != NULL)
+    {
+      free(lp->buf);
+      lp->buf = NULL;
+    }
+  lp->len = 0;
+  lp->off = off;
+  return;
+}
+
 void scamper_linepoll_free(scamper_linepoll_t *lp, int feedlastline)
 {
   assert(lp != NULL);
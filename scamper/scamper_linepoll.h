@@ -32,6 +32,10 @@ int scamper_linepoll_handle(scamper_linepoll_t *lp, uint8_t *buf, size_t len);
 
 int scamper_linepoll_flush(scamper_linepoll_t *lp);
 
+off_t scamper_linepoll_lineoff(const scamper_linepoll_t *lp);
+off_t scamper_linepoll_getoff(const scamper_linepoll_t *lp);
+void scamper_linepoll_setoff(scamper_linepoll_t *lp, off_t off);
+
 scamper_linepoll_t *scamper_linepoll_alloc(scamper_linepoll_handler_t handler,
 					   void *param);
 
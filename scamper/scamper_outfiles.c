@@ -33,6 +33,7 @@ static const char rcsid[] =
 #endif
 #include "internal.h"
 
+#include "scamper.h"
 #include "scamper_debug.h"
 #include "scamper_file.h"
 #include "scamper_privsep.h"
@@ -40,15 +41,294 @@ static const char rcsid[] =
 #include "utils.h"
 #include "mjl_splaytree.h"
 
+#ifdef HAVE_PTHREAD
+/*
+ * outfile_wbuf_t, outfile_writer_t
+ *
+ * with the outthread option, the bytes for an outfile are queued for a
+ * thread that writes them to the file, so that a slow disk or a full
+ * pipe does not hold up the main loop.  the queue is a ring with a
+ * single producer (the main loop), which advances tail, and a single
+ * consumer (the writer thread), which advances head.  the mutex and
+ * condition variables are only used when one side has to sleep until
+ * the other has made progress.  the writer thread has its own copy of
+ * the file descriptor, so that the outfile can be closed while the
+ * thread finishes writing.
+ */
+typedef struct outfile_wbuf
+{
+  uint8_t        *buf;   /* bytes to write, or NULL to sync */
+  size_t          len;
+  int             stop;  /* the thread should exit */
+} outfile_wbuf_t;
+
+#define OUTFILE_WRITER_SLOTS 256
+
+typedef struct outfile_writer
+{
+  pthread_t        thread;
+  pthread_mutex_t  mutex;
+  pthread_cond_t   more;    /* signalled when a slot is filled */
+  pthread_cond_t   space;   /* signalled when a slot is emptied */
+  int              fd;
+  outfile_wbuf_t   ring[OUTFILE_WRITER_SLOTS];
+  unsigned int     head;
+  unsigned int     tail;
+  size_t           bytes;   /* bytes queued and not yet written */
+  int              cwait;   /* the thread is waiting for a slot */
+  int              pwait;   /* the main loop is waiting for space */
+  int              error;   /* errno of the write that failed */
+  int              logged;  /* the error has been reported */
+} outfile_writer_t;
+
+/*
+ * the outfile is busy, and new tasks are not started, when its queue
+ * holds more than this many bytes, or has used three quarters of the
+ * slots.  the main loop checks again this often, in microseconds.
+ */
+#define OUTFILE_WRITER_BUSY  (4 * 1024 * 1024)
+#define OUTFILE_WRITER_CHECK 10000
+#endif
+
 struct scamper_outfile
 {
-  char           *name;
-  scamper_file_t *sf;
-  int             refcnt;
+  char             *name;
+  scamper_file_t   *sf;
+  int               refcnt;
+#ifdef HAVE_PTHREAD
+  outfile_writer_t *writer;
+#endif
 };
 
+/*
+ * outfile_flush_t
+ *
+ * state used when looking for buffered records that are due to be written.
+ */
+typedef struct outfile_flush
+{
+  struct timeval now;
+  struct timeval due;
+  int            set;
+} outfile_flush_t;
+
+/*
+ * outfile_enc_t
+ *
+ * a result formatted once, so that the bytes can be written to each
+ * outfile of the same type.
+ */
+typedef struct outfile_enc
+{
+  uint8_t *buf;
+  size_t   len;
+  size_t   size;
+} outfile_enc_t;
+
+/* the time, in microseconds, that records may be buffered for */
+#define OUTFILE_FLUSH_AGE 100000
+
 static splaytree_t       *outfiles = NULL;
 static scamper_outfile_t *outfile_def = NULL;
+static outfile_enc_t      enc_buf;
+
+#ifdef HAVE_PTHREAD
+/*
+ * outfile_writer_run
+ *
+ * write out the bytes put on the queue, in order.  once a write fails,
+ * nothing more is written, so that the file ends with the last block
+ * that was written in full.
+ */
+static void *outfile_writer_run(void *param)
+{
+  outfile_writer_t *w = param;
+  outfile_wbuf_t *wb;
+  unsigned int head = w->head;
+  off_t off;
+  int stop;
+
+  for(;;)
+    {
+      /* sleep until the main loop puts something on the queue */
+      if(__atomic_load_n(&w->tail, __ATOMIC_ACQUIRE) == head)
+	{
+	  pthread_mutex_lock(&w->mutex);
+	  __atomic_store_n(&w->cwait, 1, __ATOMIC_SEQ_CST);
+	  while(__atomic_load_n(&w->tail, __ATOMIC_SEQ_CST) == head)
+	    pthread_cond_wait(&w->more, &w->mutex);
+	  __atomic_store_n(&w->cwait, 0, __ATOMIC_SEQ_CST);
+	  pthread_mutex_unlock(&w->mutex);
+	}
+
+      wb = &w->ring[head % OUTFILE_WRITER_SLOTS];
+      if((stop = wb->stop) == 0 && w->error == 0)
+	{
+	  if(wb->buf == NULL)
+	    {
+	      if(fsync(w->fd) != 0)
+		__atomic_store_n(&w->error, errno, __ATOMIC_RELEASE);
+	    }
+	  else
+	    {
+	      off = lseek(w->fd, 0, SEEK_CUR);
+	      if(write_wrap(w->fd, wb->buf, NULL, wb->len) != 0)
+		{
+		  __atomic_store_n(&w->error, errno, __ATOMIC_RELEASE);
+		  if(off != -1 && ftruncate(w->fd, off) == 0)
+		    lseek(w->fd, off, SEEK_SET);
+		}
+	    }
+	}
+
+      if(wb->buf != NULL)
+	{
+	  free(wb->buf);
+	  wb->buf = NULL;
+	}
+      __atomic_sub_fetch(&w->bytes, wb->len, __ATOMIC_RELEASE);
+      __atomic_store_n(&w->head, ++head, __ATOMIC_SEQ_CST);
+
+      /* wake the main loop if it is waiting for space */
+      if(__atomic_load_n(&w->pwait, __ATOMIC_SEQ_CST) != 0)
+	{
+	  pthread_mutex_lock(&w->mutex);
+	  pthread_cond_signal(&w->space);
+	  pthread_mutex_unlock(&w->mutex);
+	}
+
+      if(stop != 0)
+	break;
+    }
+
+  return NULL;
+}
+
+/*
+ * outfile_writer_push
+ *
+ * put a copy of the bytes on the writer's queue, waiting for a slot if
+ * the queue is full.  a NULL buf asks for the file to be synced.
+ */
+static int outfile_writer_push(outfile_writer_t *w, const void *buf,
+			       size_t len, int stop)
+{
+  outfile_wbuf_t *wb;
+  unsigned int tail = w->tail;
+
+  if(__atomic_load_n(&w->error, __ATOMIC_ACQUIRE) != 0 && stop == 0)
+    return -1;
+
+  if(tail - __atomic_load_n(&w->head, __ATOMIC_ACQUIRE) ==
+     OUTFILE_WRITER_SLOTS)
+    {
+      pthread_mutex_lock(&w->mutex);
+      __atomic_store_n(&w->pwait, 1, __ATOMIC_SEQ_CST);
+      while(tail - __atomic_load_n(&w->head, __ATOMIC_SEQ_CST) ==
+	    OUTFILE_WRITER_SLOTS)
+	pthread_cond_wait(&w->space, &w->mutex);
+      __atomic_store_n(&w->pwait, 0, __ATOMIC_SEQ_CST);
+      pthread_mutex_unlock(&w->mutex);
+    }
+
+  wb = &w->ring[tail % OUTFILE_WRITER_SLOTS];
+  wb->stop = stop;
+  wb->len = 0;
+  wb->buf = NULL;
+  if(buf != NULL)
+    {
+      if((wb->buf = memdup(buf, len)) == NULL)
+	return -1;
+      wb->len = len;
+    }
+
+  __atomic_add_fetch(&w->bytes, wb->len, __ATOMIC_RELEASE);
+  __atomic_store_n(&w->tail, tail + 1, __ATOMIC_SEQ_CST);
+
+  /* wake the thread if it is waiting for something to write */
+  if(__atomic_load_n(&w->cwait, __ATOMIC_SEQ_CST) != 0)
+    {
+      pthread_mutex_lock(&w->mutex);
+      pthread_cond_signal(&w->more);
+      pthread_mutex_unlock(&w->mutex);
+    }
+
+  return 0;
+}
+
+/*
+ * outfile_writer_fd
+ *
+ * the scamper_file_t calls this in place of writing to its file
+ * descriptor.
+ */
+static int outfile_writer_fd(void *param, const void *buf, size_t len)
+{
+  return outfile_writer_push(param, buf, len, 0);
+}
+
+/*
+ * outfile_writer_busy
+ *
+ * return non-zero if the writer has too much queued for new tasks to
+ * be started.
+ */
+static int outfile_writer_busy(outfile_writer_t *w)
+{
+  unsigned int used;
+
+  used = __atomic_load_n(&w->tail, __ATOMIC_RELAXED) -
+    __atomic_load_n(&w->head, __ATOMIC_ACQUIRE);
+  if(used > OUTFILE_WRITER_SLOTS * 3 / 4 ||
+     __atomic_load_n(&w->bytes, __ATOMIC_ACQUIRE) > OUTFILE_WRITER_BUSY)
+    return 1;
+  return 0;
+}
+
+/*
+ * outfile_writer_free
+ *
+ * wait for the thread to write out everything on the queue, and then
+ * release the writer.
+ */
+static void outfile_writer_free(outfile_writer_t *w)
+{
+  if(outfile_writer_push(w, NULL, 0, 1) == 0)
+    pthread_join(w->thread, NULL);
+  pthread_cond_destroy(&w->space);
+  pthread_cond_destroy(&w->more);
+  pthread_mutex_destroy(&w->mutex);
+  close(w->fd);
+  free(w);
+  return;
+}
+
+static outfile_writer_t *outfile_writer_alloc(int fd)
+{
+  outfile_writer_t *w;
+
+  if((w = malloc_zero(sizeof(outfile_writer_t))) == NULL)
+    return NULL;
+  if((w->fd = dup(fd)) == -1)
+    {
+      free(w);
+      return NULL;
+    }
+  pthread_mutex_init(&w->mutex, NULL);
+  pthread_cond_init(&w->more, NULL);
+  pthread_cond_init(&w->space, NULL);
+  if(pthread_create(&w->thread, NULL, outfile_writer_run, w) != 0)
+    {
+      pthread_cond_destroy(&w->space);
+      pthread_cond_destroy(&w->more);
+      pthread_mutex_destroy(&w->mutex);
+      close(w->fd);
+      free(w);
+      return NULL;
+    }
+  return w;
+}
+#endif
 
 static int outfile_cmp(const void *a, const void *b)
 {
@@ -69,6 +349,24 @@ static scamper_outfile_t *outfile_alloc(char *name, scamper_file_t *sf)
   sof->sf = sf;
   sof->refcnt = 1;
 
+  /* hold records in memory so that they are written in blocks */
+  if(scamper_file_getfd(sf) != -1)
+    scamper_file_setbuf(sf, scamper_option_outbuf(), scamper_option_fsync());
+  scamper_file_setaddrdict(sf, scamper_option_addrdict());
+
+#ifdef HAVE_PTHREAD
+  /* write to the file from a thread of its own */
+  if(scamper_file_getfd(sf) != -1 && scamper_option_outthread() != 0)
+    {
+      if((sof->writer = outfile_writer_alloc(scamper_file_getfd(sf))) == NULL)
+	{
+	  printerror(errno, strerror, __func__, "could not alloc writer");
+	  goto err;
+	}
+      scamper_file_setfdfunc(sf, sof->writer, outfile_writer_fd);
+    }
+#endif
+
   if((sof->name = strdup(name)) == NULL)
     {
       printerror(errno, strerror, __func__, "could not strdup");
@@ -87,6 +385,13 @@ static scamper_outfile_t *outfile_alloc(char *name, scamper_file_t *sf)
  err:
   if(sof != NULL)
     {
+#ifdef HAVE_PTHREAD
+      if(sof->writer != NULL)
+	{
+	  scamper_file_setfdfunc(sf, NULL, NULL);
+	  outfile_writer_free(sof->writer);
+	}
+#endif
       if(sof->name != NULL) free(sof->name);
       free(sof);
     }
@@ -112,6 +417,12 @@ static void outfile_free(scamper_outfile_t *sof)
       scamper_file_close(sof->sf);
     }
 
+#ifdef HAVE_PTHREAD
+  /* wait for the bytes queued when the file was closed to be written */
+  if(sof->writer != NULL)
+    outfile_writer_free(sof->writer);
+#endif
+
   free(sof);
   return;
 }
@@ -164,9 +475,11 @@ int scamper_outfile_close(scamper_outfile_t *sof)
 
 scamper_outfile_t *scamper_outfiles_get(const char *name)
 {
-  const scamper_outfile_t findme = {(char *)name, NULL, 0};
+  scamper_outfile_t findme;
   if(name == NULL)
     return outfile_def;
+  memset(&findme, 0, sizeof(findme));
+  findme.name = (char *)name;
   return splaytree_find(outfiles, &findme);
 }
 
@@ -179,10 +492,21 @@ void scamper_outfiles_swap(scamper_outfile_t *a, scamper_outfile_t *b)
 {
   scamper_file_t *sf;
 
+#ifdef HAVE_PTHREAD
+  outfile_writer_t *w;
+#endif
+
   sf = b->sf;
   b->sf = a->sf;
   a->sf = sf;
 
+#ifdef HAVE_PTHREAD
+  /* the writer belongs with the file it writes to */
+  w = b->writer;
+  b->writer = a->writer;
+  a->writer = w;
+#endif
+
   return;
 }
 
@@ -355,6 +679,195 @@ void scamper_outfiles_foreach(void *p,
   return;
 }
 
+/*
+ * outfile_enc_write
+ *
+ * collect the bytes of a result as it is formatted.
+ */
+static int outfile_enc_write(void *param, const void *data, size_t len)
+{
+  outfile_enc_t *enc = param;
+  size_t size;
+  uint8_t *buf;
+
+  if(enc->len + len > enc->size)
+    {
+      size = enc->size > 0 ? enc->size : 4096;
+      while(size < enc->len + len)
+	size *= 2;
+      if((buf = realloc(enc->buf, size)) == NULL)
+	return -1;
+      enc->buf = buf;
+      enc->size = size;
+    }
+
+  memcpy(enc->buf + enc->len, data, len);
+  enc->len += len;
+  return 0;
+}
+
+/*
+ * outfile_enc
+ *
+ * format a result for outfiles of the same type as sf, without writing
+ * it to sf.
+ */
+static int outfile_enc(scamper_file_t *sf, void *obj,
+		       void (*write)(void *obj, scamper_file_t *sf))
+{
+  scamper_file_t *enc = NULL;
+  char type[16];
+
+  if(scamper_file_type_tostr(sf, type, sizeof(type)) == NULL ||
+     (enc = scamper_file_openfd(-1, NULL, 'w', type)) == NULL)
+    return -1;
+
+  scamper_file_setwritefunc(enc, &enc_buf, outfile_enc_write);
+  enc_buf.len = 0;
+  write(obj, enc);
+  scamper_file_close(enc);
+
+  return 0;
+}
+
+/*
+ * scamper_outfiles_write
+ *
+ * write a result to each of the outfiles.  the result is formatted
+ * once for outfiles of a type whose records can be shared, and the same
+ * bytes are written to each of them.  otherwise it is formatted for each
+ * outfile.
+ */
+void scamper_outfiles_write(scamper_outfile_t **sofs, int sofc, void *obj,
+			    void (*write)(void *obj, scamper_file_t *sf))
+{
+  scamper_file_t *sf;
+  int i, j, enc = -1;
+
+  for(i=0; i<sofc; i++)
+    {
+      sf = sofs[i]->sf;
+
+      /* the result has already been formatted for this type of file */
+      if(enc != -1 && scamper_file_isshared(sofs[enc]->sf, sf))
+	{
+	  scamper_file_write_bytes(sf, enc_buf.buf, enc_buf.len);
+	  continue;
+	}
+
+      /* format it once if another outfile will need the same bytes */
+      for(j=i+1; j<sofc; j++)
+	if(scamper_file_isshared(sf, sofs[j]->sf))
+	  break;
+      if(j < sofc && outfile_enc(sf, obj, write) == 0)
+	{
+	  enc = i;
+	  scamper_file_write_bytes(sf, enc_buf.buf, enc_buf.len);
+	  continue;
+	}
+
+      write(obj, sf);
+    }
+
+  return;
+}
+
+static int outfile_flush(void *param, scamper_outfile_t *sof)
+{
+  outfile_flush_t *of = (outfile_flush_t *)param;
+  struct timeval tv;
+#ifdef HAVE_PTHREAD
+  int error;
+
+  if(sof->writer != NULL)
+    {
+      /* report a write that failed in the writer thread */
+      if(sof->writer->logged == 0 &&
+	 (error = __atomic_load_n(&sof->writer->error, __ATOMIC_ACQUIRE)) != 0)
+	{
+	  printerror(error, strerror, __func__, "could not write %s",
+		     sof->name);
+	  sof->writer->logged = 1;
+	}
+
+      /* check again soon if the writer is too busy to start new tasks */
+      if(outfile_writer_busy(sof->writer) != 0)
+	{
+	  timeval_add_us(&tv, &of->now, OUTFILE_WRITER_CHECK);
+	  if(of->set == 0 || timeval_cmp(&tv, &of->due) < 0)
+	    {
+	      timeval_cpy(&of->due, &tv);
+	      of->set = 1;
+	    }
+	}
+    }
+#endif
+
+  if(scamper_file_buffered(sof->sf, &tv) == 0)
+    return 0;
+
+  timeval_add_us(&tv, &tv, OUTFILE_FLUSH_AGE);
+  if(timeval_cmp(&tv, &of->now) <= 0)
+    {
+      if(scamper_file_flush(sof->sf) != 0)
+	printerror(errno, strerror, __func__, "could not flush %s", sof->name);
+      return 0;
+    }
+
+  if(of->set == 0 || timeval_cmp(&tv, &of->due) < 0)
+    {
+      timeval_cpy(&of->due, &tv);
+      of->set = 1;
+    }
+
+  return 0;
+}
+
+/*
+ * scamper_outfiles_flush
+ *
+ * write out records that have been buffered for long enough.  if records
+ * remain buffered, return one and the time they will be due to be written.
+ */
+int scamper_outfiles_flush(const struct timeval *now, struct timeval *due)
+{
+  outfile_flush_t of;
+
+  memset(&of, 0, sizeof(of));
+  timeval_cpy(&of.now, now);
+  splaytree_inorder(outfiles, (splaytree_inorder_t)outfile_flush, &of);
+  if(of.set == 0)
+    return 0;
+
+  timeval_cpy(due, &of.due);
+  return 1;
+}
+
+#ifdef HAVE_PTHREAD
+static int outfile_busy(void *param, scamper_outfile_t *sof)
+{
+  if(sof->writer != NULL && outfile_writer_busy(sof->writer) != 0)
+    *((int *)param) = 1;
+  return 0;
+}
+#endif
+
+/*
+ * scamper_outfiles_isbusy
+ *
+ * return non-zero if an outfile has more queued for its writer thread
+ * than it should, so that new tasks should not be started yet.
+ */
+int scamper_outfiles_isbusy(void)
+{
+  int busy = 0;
+#ifdef HAVE_PTHREAD
+  if(scamper_option_outthread() != 0)
+    splaytree_inorder(outfiles, (splaytree_inorder_t)outfile_busy, &busy);
+#endif
+  return busy;
+}
+
 int scamper_outfiles_init(char *def_filename, char *def_type)
 {
   if((outfiles = splaytree_alloc(outfile_cmp)) == NULL)
@@ -370,6 +883,25 @@ int scamper_outfiles_init(char *def_filename, char *def_type)
   return 0;
 }
 
+/*
+ * outfile_drain
+ *
+ * write out what an outfile that is still open holds, before exiting.
+ */
+static int outfile_drain(void *param, scamper_outfile_t *sof)
+{
+  scamper_file_flush(sof->sf);
+#ifdef HAVE_PTHREAD
+  if(sof->writer != NULL)
+    {
+      scamper_file_setfdfunc(sof->sf, NULL, NULL);
+      outfile_writer_free(sof->writer);
+      sof->writer = NULL;
+    }
+#endif
+  return 0;
+}
+
 void scamper_outfiles_cleanup()
 {
   if(outfile_def != NULL)
@@ -386,9 +918,17 @@ void scamper_outfiles_cleanup()
 
   if(outfiles != NULL)
     {
+      splaytree_inorder(outfiles, (splaytree_inorder_t)outfile_drain, NULL);
       splaytree_free(outfiles, NULL);
       outfiles = NULL;
     }
 
+  if(enc_buf.buf != NULL)
+    {
+      free(enc_buf.buf);
+      enc_buf.buf = NULL;
+      enc_buf.size = 0;
+    }
+
   return;
 }
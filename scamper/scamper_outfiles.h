@@ -47,6 +47,12 @@ void scamper_outfiles_swap(scamper_outfile_t *a, scamper_outfile_t *b);
 void scamper_outfiles_foreach(void *p,
 			      int (*func)(void *p, scamper_outfile_t *sof));
 
+void scamper_outfiles_write(scamper_outfile_t **sofs, int sofc, void *obj,
+			    void (*write)(void *obj, struct scamper_file *sf));
+
+int scamper_outfiles_flush(const struct timeval *now, struct timeval *due);
+int scamper_outfiles_isbusy(void);
+
 int scamper_outfiles_init(char *def_filename, char *def_type);
 void scamper_outfiles_cleanup(void);
 
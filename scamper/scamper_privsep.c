@@ -43,6 +43,10 @@ static const char rcsid[] =
 #include "scamper_dl.h"
 #include "scamper_rtsock.h"
 #include "scamper_firewall.h"
+#include "scamper_outfiles.h"
+#include "scamper_task.h"
+#include "scamper_sources.h"
+#include "scamper_source_file.h"
 
 typedef struct privsep_msg
 {
@@ -84,8 +88,10 @@ static int   divert_on =  0; /* do not allow divert sockets by default */
 #define SCAMPER_PRIVSEP_IPFW_CLEANUP  0x0cU
 #define SCAMPER_PRIVSEP_IPFW_ADD      0x0dU
 #define SCAMPER_PRIVSEP_IPFW_DEL      0x0eU
+#define SCAMPER_PRIVSEP_OPEN_INOTIFY  0x0fU
+#define SCAMPER_PRIVSEP_RENAME        0x10U
 
-#define SCAMPER_PRIVSEP_MAXTYPE (SCAMPER_PRIVSEP_IPFW_DEL)
+#define SCAMPER_PRIVSEP_MAXTYPE (SCAMPER_PRIVSEP_RENAME)
 
 /*
  * privsep_open_rawsock
@@ -569,6 +575,37 @@ static int privsep_unlink(uint16_t plen, const uint8_t *param)
   return 0;
 }
 
+/*
+ * privsep_rename
+ *
+ * switch to the user running the process and rename a file.  the param
+ * has two null-terminated fields in it: the old name, and the new name.
+ */
+static int privsep_rename(uint16_t plen, const uint8_t *param)
+{
+  const char *from = (const char *)param, *to;
+  uid_t uid, euid;
+  size_t len;
+  int rc;
+
+  if(plen < 4 || from[plen-1] != '\0')
+    return -1;
+  len = strlen(from);
+  if(len == 0 || len + 2 >= plen)
+    return -1;
+  to = from + len + 1;
+
+  uid  = getuid();
+  euid = geteuid();
+  if(seteuid(uid) != 0)
+    return -1;
+  rc = rename(from, to);
+  if(seteuid(euid) != 0)
+    exit(-errno);
+
+  return rc;
+}
+
 static int privsep_open_unix(uint16_t plen, const uint8_t *param)
 {
   const char *name = (const char *)param;
@@ -610,6 +647,43 @@ static int privsep_open_unix(uint16_t plen, const uint8_t *param)
   return fd;
 }
 
+/*
+ * privsep_open_inotify
+ *
+ * switch to the user running the process and open an inotify fd that
+ * watches the file.
+ */
+static int privsep_open_inotify(uint16_t plen, const uint8_t *param)
+{
+#ifdef HAVE_INOTIFY
+  const char *name = (const char *)param;
+  uid_t uid, euid;
+  int fd;
+
+  if(plen < 2 || name[plen-1] != '\0')
+    return -1;
+
+  uid  = getuid();
+  euid = geteuid();
+  if(seteuid(uid) != 0)
+    return -1;
+
+  fd = scamper_source_file_watch_fd(name);
+
+  if(seteuid(euid) != 0)
+    {
+      if(fd != -1) close(fd);
+      exit(-errno);
+    }
+
+  return fd;
+#else
+  scamper_debug(__func__, "not on inotify system");
+  errno = EINVAL;
+  return -1;
+#endif
+}
+
 /*
  * privsep_open_file
  *
@@ -859,6 +933,8 @@ static int privsep_do(void)
     {privsep_ipfw_cleanup,  privsep_send_rc},
     {privsep_ipfw_add,      privsep_send_rc},
     {privsep_ipfw_del,      privsep_send_rc},
+    {privsep_open_inotify,  privsep_send_fd},
+    {privsep_rename,        privsep_send_rc},
   };
 
   privsep_msg_t   msg;
@@ -1039,6 +1115,15 @@ int scamper_privsep_open_unix(const char *file)
   return privsep_getfd(SCAMPER_PRIVSEP_OPEN_UNIX, len, (const uint8_t *)file);
 }
 
+#ifdef HAVE_INOTIFY
+int scamper_privsep_open_inotify(const char *file)
+{
+  int len = strlen(file) + 1;
+  return privsep_getfd(SCAMPER_PRIVSEP_OPEN_INOTIFY, len,
+		       (const uint8_t *)file);
+}
+#endif
+
 int scamper_privsep_open_file(const char *file,
 			      const int flags, const mode_t mode)
 {
@@ -1129,6 +1214,21 @@ int scamper_privsep_unlink(const char *file)
   return privsep_dotask(SCAMPER_PRIVSEP_UNLINK, len, (const uint8_t *)file);
 }
 
+int scamper_privsep_rename(const char *from, const char *to)
+{
+  size_t fl = strlen(from) + 1, tl = strlen(to) + 1;
+  uint8_t *param;
+  int rc;
+
+  if(fl + tl > 65535 || (param = malloc(fl + tl)) == NULL)
+    return -1;
+  memcpy(param, from, fl);
+  memcpy(param+fl, to, tl);
+  rc = privsep_dotask(SCAMPER_PRIVSEP_RENAME, fl + tl, param);
+  free(param);
+  return rc;
+}
+
 int scamper_privsep_ipfw_init(void)
 {
   return privsep_dotask(SCAMPER_PRIVSEP_IPFW_INIT, 0, NULL);
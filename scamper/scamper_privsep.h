@@ -49,6 +49,11 @@ int scamper_privsep_ipfw_add(int n,int af,int p,void *s,void *d,int sp,int dp);
 int scamper_privsep_ipfw_del(int n,int af);
 
 int scamper_privsep_unlink(const char *file);
+int scamper_privsep_rename(const char *from, const char *to);
+
+#ifdef HAVE_INOTIFY
+int scamper_privsep_open_inotify(const char *file);
+#endif
 
 int scamper_privsep_init(void);
 void scamper_privsep_cleanup(void);
@@ -94,6 +94,8 @@ static uint8_t *pktbuf = NULL;
 static size_t   pktbuf_len = 0;
 static int      ipid_dl = 0;
 static int      rawtcp = 0;
+static uint64_t probe_tx = 0;
+static uint64_t probe_err = 0;
 
 #ifdef HAVE_SCAMPER_DEBUG
 static char *tcp_flags(char *buf, size_t len, scamper_probe_t *probe)
@@ -594,7 +596,7 @@ static void probe_route_cb(scamper_route_t *rt)
   return;
 }
 
-int scamper_probe_task(scamper_probe_t *pr, scamper_task_t *task)
+static int probe_task_send(scamper_probe_t *pr, scamper_task_t *task)
 {
   probe_state_t *pt = NULL;
   scamper_fd_t *icmp = NULL;
@@ -806,7 +808,7 @@ int scamper_probe_task(scamper_probe_t *pr, scamper_task_t *task)
  *  2. handling any error condition incurred when sending the probe
  *  3. recording details of the probe with the trace's state
  */
-int scamper_probe(scamper_probe_t *probe)
+static int probe_send(scamper_probe_t *probe)
 {
   int (*send_func)(scamper_probe_t *) = NULL;
   int (*build_func)(scamper_probe_t *, uint8_t *, size_t *) = NULL;
@@ -936,6 +938,41 @@ int scamper_probe(scamper_probe_t *probe)
   return 0;
 }
 
+/*
+ * scamper_probe, scamper_probe_task
+ *
+ * send the probe, keeping a count of the probes sent and the probes that
+ * could not be sent.
+ */
+int scamper_probe(scamper_probe_t *probe)
+{
+  if(probe_send(probe) != 0)
+    {
+      probe_err++;
+      return -1;
+    }
+  probe_tx++;
+  return 0;
+}
+
+int scamper_probe_task(scamper_probe_t *pr, scamper_task_t *task)
+{
+  if(probe_task_send(pr, task) != 0)
+    {
+      probe_err++;
+      return -1;
+    }
+  probe_tx++;
+  return 0;
+}
+
+void scamper_probe_stats(uint64_t *tx, uint64_t *err)
+{
+  *tx = probe_tx;
+  *err = probe_err;
+  return;
+}
+
 int scamper_probe_init(void)
 {
   const scamper_osinfo_t *osinfo = scamper_osinfo_get();
@@ -176,6 +176,7 @@ typedef struct scamper_probe
 } scamper_probe_t;
 
 int scamper_probe(scamper_probe_t *probe);
+void scamper_probe_stats(uint64_t *tx, uint64_t *err);
 
 #ifdef __SCAMPER_TASK_H
 int scamper_probe_task(scamper_probe_t *probe, scamper_task_t *task);
@@ -59,6 +59,7 @@ static dlist_t *probe_queue = NULL;
 static heap_t  *wait_queue = NULL;
 static heap_t  *done_queue = NULL;
 static int      count = 0;
+static uint64_t timeouts = 0;
 
 /*
  * queue_cmp
@@ -320,6 +321,7 @@ int scamper_queue_readycount()
 
 	  queue_unlink(sq);
 
+	  timeouts++;
 	  scamper_task_handletimeout(sq->task);
 
 	  if(sq->queue == NULL)
@@ -363,6 +365,21 @@ int scamper_queue_count()
   return count;
 }
 
+/*
+ * scamper_queue_stats
+ *
+ * report the number of tasks in each queue, without expiring any tasks
+ * on the wait queue, and the number of times a task timed out.
+ */
+void scamper_queue_stats(int *probe, int *wait, int *done, uint64_t *to)
+{
+  *probe = dlist_count(probe_queue);
+  *wait  = heap_count(wait_queue);
+  *done  = heap_count(done_queue);
+  *to    = timeouts;
+  return;
+}
+
 scamper_queue_t *scamper_queue_alloc(scamper_task_t *task)
 {
   scamper_queue_t *sq;
@@ -71,6 +71,9 @@ int scamper_queue_readycount(void);
 /* return the number of tasks in the probe and wait queues */
 int scamper_queue_windowcount(void);
 
+/* return the number of tasks in each queue, and the count of timeouts */
+void scamper_queue_stats(int *probe, int *wait, int *done, uint64_t *to);
+
 /* flush the queues of all non-completed tasks */
 void scamper_queue_empty(void);
 
@@ -0,0 +1,212 @@
+/*
+ * scamper_rtt.c
+ *
+ * smoothed RTT estimates towards destination prefixes, used to decide
+ * how long to wait for a reply to a probe before giving up on it.
+ *
+ * $Id: scamper_rtt.c,v 1.1 2014/03/28 00:00:00 mjl Exp $
+ *
+ * Copyright (C) 2014 The Regents of the University of California
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef lint
+static const char rcsid[] =
+  "$Id: scamper_rtt.c,v 1.1 2014/03/28 00:00:00 mjl Exp $";
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper_addr.h"
+#include "scamper_debug.h"
+#include "scamper_rtt.h"
+#include "utils.h"
+
+/*
+ * rtt_est
+ *
+ * an estimate kept for a TTL towards a prefix (a /24 for IPv4, a /48 for
+ * IPv6).  the estimate with a TTL of SCAMPER_RTT_DST is of the RTT to
+ * destinations in the prefix, from replies sent by the destinations
+ * themselves.  times are in microseconds.
+ */
+typedef struct rtt_est
+{
+  uint8_t  type;
+  uint8_t  ttl;
+  uint8_t  prefix[6];
+  uint32_t srtt;
+  uint32_t rttvar;
+} rtt_est_t;
+
+/*
+ * the estimates are kept in a table of fixed size, indexed by a hash of
+ * the prefix and TTL.  an estimate for a different prefix that hashes to
+ * the same slot replaces what was there, so memory use is bounded and a
+ * lookup is a single probe of the table.
+ */
+#define RTT_TABLE_SIZE 65536
+
+static rtt_est_t *table = NULL;
+
+static rtt_est_t *rtt_est_get(const scamper_addr_t *dst, uint8_t ttl,
+			      int create)
+{
+  const uint8_t *a = dst->addr;
+  uint8_t prefix[6];
+  uint32_t h = 2166136261U;
+  rtt_est_t *est;
+  size_t i, len;
+
+  memset(prefix, 0, sizeof(prefix));
+  len = dst->type == SCAMPER_ADDR_TYPE_IPV4 ? 3 : 6;
+  memcpy(prefix, a, len);
+
+  h = (h ^ (uint8_t)dst->type) * 16777619U;
+  h = (h ^ ttl) * 16777619U;
+  for(i=0; i<len; i++)
+    h = (h ^ prefix[i]) * 16777619U;
+
+  est = &table[h & (RTT_TABLE_SIZE-1)];
+  if(est->type == dst->type && est->ttl == ttl &&
+     memcmp(est->prefix, prefix, sizeof(prefix)) == 0)
+    return est;
+
+  if(create == 0)
+    return NULL;
+
+  est->type   = dst->type;
+  est->ttl    = ttl;
+  memcpy(est->prefix, prefix, sizeof(prefix));
+  est->srtt   = 0;
+  est->rttvar = 0;
+  return est;
+}
+
+/*
+ * rtt_est_update
+ *
+ * fold a sample into the estimate as RFC 6298 does for TCP's
+ * retransmission timer.
+ */
+static void rtt_est_update(rtt_est_t *est, uint32_t rtt)
+{
+  uint32_t delta;
+
+  if(est->srtt == 0)
+    {
+      est->srtt   = rtt;
+      est->rttvar = rtt / 2;
+      return;
+    }
+
+  delta = est->srtt > rtt ? est->srtt - rtt : rtt - est->srtt;
+  est->rttvar = ((3 * (uint64_t)est->rttvar) + delta) / 4;
+  est->srtt   = ((7 * (uint64_t)est->srtt) + rtt) / 8;
+  if(est->srtt == 0)
+    est->srtt = 1;
+  return;
+}
+
+/*
+ * scamper_rtt_sample
+ *
+ * a reply to a probe sent with the given TTL towards the destination
+ * arrived after this long.  a TTL of SCAMPER_RTT_DST records a reply from
+ * the destination itself.
+ */
+void scamper_rtt_sample(const scamper_addr_t *dst, uint8_t ttl,
+			const struct timeval *rtt)
+{
+  rtt_est_t *est;
+  uint32_t us;
+
+  if(table == NULL || rtt->tv_sec < 0 || rtt->tv_sec > 60 ||
+     (dst->type != SCAMPER_ADDR_TYPE_IPV4 &&
+      dst->type != SCAMPER_ADDR_TYPE_IPV6))
+    return;
+
+  us = (rtt->tv_sec * 1000000) + rtt->tv_usec;
+  if(us == 0)
+    us = 1;
+
+  if((est = rtt_est_get(dst, ttl, 1)) != NULL)
+    rtt_est_update(est, us);
+
+  return;
+}
+
+/*
+ * scamper_rtt_wait
+ *
+ * return how long, in milliseconds, to wait for a reply to a probe sent
+ * with the given TTL towards the destination: the smoothed RTT plus four
+ * times its variation.  the samples for that TTL are used if there are
+ * any, otherwise those for the nearest lower TTL that has some, otherwise
+ * those from the destination.  the wait is no longer than max, which is
+ * also returned if there are no samples to use.
+ */
+uint32_t scamper_rtt_wait(const scamper_addr_t *dst, uint8_t ttl,
+			  uint32_t max)
+{
+  rtt_est_t *est = NULL;
+  uint64_t us;
+  uint32_t ms;
+  int i;
+
+  if(table == NULL ||
+     (dst->type != SCAMPER_ADDR_TYPE_IPV4 &&
+      dst->type != SCAMPER_ADDR_TYPE_IPV6))
+    return max;
+
+  for(i=ttl; i > SCAMPER_RTT_DST && est == NULL; i--)
+    est = rtt_est_get(dst, i, 0);
+  if(est == NULL && (est = rtt_est_get(dst, SCAMPER_RTT_DST, 0)) == NULL)
+    return max;
+
+  us = (uint64_t)est->srtt + (4 * (uint64_t)est->rttvar);
+  ms = (uint32_t)((us + 999) / 1000);
+  if(ms < SCAMPER_RTT_WAIT_MIN)
+    ms = SCAMPER_RTT_WAIT_MIN;
+  if(ms > max)
+    ms = max;
+
+  return ms;
+}
+
+int scamper_rtt_init(void)
+{
+  if((table = malloc_zero(sizeof(rtt_est_t) * RTT_TABLE_SIZE)) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not malloc table");
+      return -1;
+    }
+  return 0;
+}
+
+void scamper_rtt_cleanup(void)
+{
+  if(table != NULL)
+    {
+      free(table);
+      table = NULL;
+    }
+  return;
+}
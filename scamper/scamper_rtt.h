@@ -0,0 +1,42 @@
+/*
+ * scamper_rtt.h
+ *
+ * $Id: scamper_rtt.h,v 1.1 2014/03/28 00:00:00 mjl Exp $
+ *
+ * Copyright (C) 2014 The Regents of the University of California
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __SCAMPER_RTT_H
+#define __SCAMPER_RTT_H
+
+/* the shortest time, in milliseconds, that a probe is waited on */
+#define SCAMPER_RTT_WAIT_MIN 100
+
+/* the TTL the RTT to the destination itself is kept under */
+#define SCAMPER_RTT_DST 0
+
+void scamper_rtt_sample(const scamper_addr_t *dst, uint8_t ttl,
+			const struct timeval *rtt);
+
+uint32_t scamper_rtt_wait(const scamper_addr_t *dst, uint8_t ttl,
+			  uint32_t max);
+
+int scamper_rtt_init(void);
+void scamper_rtt_cleanup(void);
+
+#endif /* __SCAMPER_RTT_H */
@@ -0,0 +1,261 @@
+/*
+ * scamper_savefile.c
+ *
+ * replace the contents of files that scamper reads back when it is
+ * restarted, without leaving a partially written file if scamper stops
+ * partway through.
+ *
+ * $Id: scamper_savefile.c,v 1.1 2014/04/02 00:00:00 mjl Exp $
+ *
+ * Copyright (C) 2014 The Regents of the University of California
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef lint
+static const char rcsid[] =
+  "$Id: scamper_savefile.c,v 1.1 2014/04/02 00:00:00 mjl Exp $";
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper_privsep.h"
+#include "scamper_debug.h"
+#include "scamper_savefile.h"
+#include "utils.h"
+
+struct scamper_savefile
+{
+  char *file;
+  char *tmp;
+  int   fd;
+};
+
+/*
+ * scamper_savefile_open_file
+ *
+ * open a file, through the privileged process if there is one.
+ */
+int scamper_savefile_open_file(const char *file, int flags, mode_t mode)
+{
+#ifdef _WIN32
+  flags |= O_BINARY;
+#endif
+
+#if defined(WITHOUT_PRIVSEP)
+  return open(file, flags, mode);
+#else
+  return scamper_privsep_open_file(file, flags, mode);
+#endif
+}
+
+static int savefile_rename(const char *from, const char *to)
+{
+#if defined(_WIN32)
+  /* rename on windows will not replace an existing file */
+  unlink(to);
+#endif
+
+#if defined(WITHOUT_PRIVSEP)
+  return rename(from, to);
+#else
+  return scamper_privsep_rename(from, to);
+#endif
+}
+
+static void savefile_unlink(const char *file)
+{
+#if defined(WITHOUT_PRIVSEP)
+  unlink(file);
+#else
+  scamper_privsep_unlink(file);
+#endif
+  return;
+}
+
+static void savefile_free(scamper_savefile_t *sf)
+{
+  if(sf->file != NULL) free(sf->file);
+  if(sf->tmp != NULL) free(sf->tmp);
+  free(sf);
+  return;
+}
+
+/*
+ * scamper_savefile_open
+ *
+ * open a temporary file to write the new contents of the file into.  the
+ * name of the temporary file includes the process id so that scamper
+ * processes saving the same file do not write into each other's copy.
+ */
+scamper_savefile_t *scamper_savefile_open(const char *file)
+{
+  scamper_savefile_t *sf = NULL;
+  size_t len = strlen(file) + 32;
+  mode_t mode;
+
+#ifndef _WIN32
+  mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+#else
+  mode = _S_IREAD | _S_IWRITE;
+#endif
+
+  if((sf = malloc_zero(sizeof(scamper_savefile_t))) == NULL ||
+     (sf->file = strdup(file)) == NULL || (sf->tmp = malloc(len)) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not alloc savefile");
+      goto err;
+    }
+  snprintf(sf->tmp, len, "%s.%u.tmp", file, (uint32_t)getpid());
+
+  sf->fd = scamper_savefile_open_file(sf->tmp, O_WRONLY|O_CREAT|O_TRUNC, mode);
+  if(sf->fd == -1)
+    {
+      printerror(errno, strerror, __func__, "could not open %s", sf->tmp);
+      goto err;
+    }
+
+  return sf;
+
+ err:
+  if(sf != NULL) savefile_free(sf);
+  return NULL;
+}
+
+int scamper_savefile_fd(const scamper_savefile_t *sf)
+{
+  return sf->fd;
+}
+
+/*
+ * scamper_savefile_commit
+ *
+ * flush the temporary file to disk and rename it over the file.  the
+ * file is left as it was if any of this fails.
+ */
+int scamper_savefile_commit(scamper_savefile_t *sf)
+{
+  int rc = -1;
+
+#ifndef _WIN32
+  if(fsync(sf->fd) != 0)
+    {
+      printerror(errno, strerror, __func__, "could not fsync %s", sf->tmp);
+      goto done;
+    }
+#endif
+
+  if(close(sf->fd) != 0)
+    {
+      sf->fd = -1;
+      printerror(errno, strerror, __func__, "could not close %s", sf->tmp);
+      goto done;
+    }
+  sf->fd = -1;
+
+  if(savefile_rename(sf->tmp, sf->file) != 0)
+    {
+      printerror(errno, strerror, __func__, "could not rename %s", sf->tmp);
+      goto done;
+    }
+  rc = 0;
+
+ done:
+  if(rc != 0)
+    {
+      if(sf->fd != -1) close(sf->fd);
+      savefile_unlink(sf->tmp);
+    }
+  savefile_free(sf);
+  return rc;
+}
+
+/*
+ * scamper_savefile_abort
+ *
+ * discard the temporary file, leaving the file as it was.
+ */
+void scamper_savefile_abort(scamper_savefile_t *sf)
+{
+  if(sf->fd != -1)
+    close(sf->fd);
+  savefile_unlink(sf->tmp);
+  savefile_free(sf);
+  return;
+}
+
+/*
+ * scamper_savefile_lock
+ *
+ * take an exclusive lock held in a file alongside the file, so that
+ * processes that read, merge, and save the same file do so one at a
+ * time.  the lock cannot be held on the file itself, as the file is
+ * replaced when it is saved.  returns the fd holding the lock.
+ */
+int scamper_savefile_lock(const char *file)
+{
+  size_t len = strlen(file) + 6;
+  char *lock;
+  mode_t mode;
+  int fd;
+
+#ifndef _WIN32
+  mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+#else
+  mode = _S_IREAD | _S_IWRITE;
+#endif
+
+  if((lock = malloc(len)) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not alloc lock name");
+      return -1;
+    }
+  snprintf(lock, len, "%s.lock", file);
+
+  if((fd = scamper_savefile_open_file(lock, O_RDWR | O_CREAT, mode)) == -1)
+    {
+      printerror(errno, strerror, __func__, "could not open %s", lock);
+      free(lock);
+      return -1;
+    }
+
+#ifndef _WIN32
+  while(flock(fd, LOCK_EX) != 0)
+    {
+      if(errno == EINTR)
+	continue;
+      printerror(errno, strerror, __func__, "could not lock %s", lock);
+      close(fd);
+      free(lock);
+      return -1;
+    }
+#endif
+
+  free(lock);
+  return fd;
+}
+
+void scamper_savefile_unlock(int fd)
+{
+#ifndef _WIN32
+  flock(fd, LOCK_UN);
+#endif
+  close(fd);
+  return;
+}
@@ -0,0 +1,46 @@
+/*
+ * scamper_savefile.h
+ *
+ * $Id: scamper_savefile.h,v 1.1 2014/04/02 00:00:00 mjl Exp $
+ *
+ * Copyright (C) 2014 The Regents of the University of California
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __SCAMPER_SAVEFILE_H
+#define __SCAMPER_SAVEFILE_H
+
+/*
+ * scamper_savefile_t
+ *
+ * state kept while replacing a file: the contents are written to a
+ * temporary file alongside it, which is renamed over the file once it
+ * is complete, so that a reader never sees a partially written file.
+ */
+typedef struct scamper_savefile scamper_savefile_t;
+
+scamper_savefile_t *scamper_savefile_open(const char *file);
+int scamper_savefile_fd(const scamper_savefile_t *sf);
+int scamper_savefile_commit(scamper_savefile_t *sf);
+void scamper_savefile_abort(scamper_savefile_t *sf);
+
+int scamper_savefile_open_file(const char *file, int flags, mode_t mode);
+
+int scamper_savefile_lock(const char *file);
+void scamper_savefile_unlock(int fd);
+
+#endif /* __SCAMPER_SAVEFILE_H */
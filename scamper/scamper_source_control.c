@@ -46,13 +46,47 @@ typedef struct scamper_source_control
   /* variable that indicates if no more commands are coming */
   int                isfinished;
 
+  /*
+   * window:  the number of commands the client wants to have outstanding,
+   *          or zero if the client is given one command at a time.
+   * credits: the number of commands the client has been granted but has
+   *          not yet sent.
+   */
+  int                window;
+  int                credits;
+
   /* a function and a parameter to interact with the control socket */
-  void             (*signalmore)(void *param);
+  void             (*signalmore)(void *param, int credits);
   char *           (*tostr)(void *param, char *buf, size_t len);
   void              *param;
 
 } scamper_source_control_t;
 
+/*
+ * ssc_grant
+ *
+ * grant the client credits so that it can keep the window of commands
+ * outstanding.  the credits are granted in batches of a quarter of the
+ * window so that the client is not sent a line for every command taken.
+ */
+static void ssc_grant(scamper_source_control_t *ssc)
+{
+  int outstanding, batch;
+
+  outstanding = scamper_source_getcommandcount(ssc->source) + ssc->credits;
+  if(outstanding >= ssc->window)
+    return;
+
+  if((batch = ssc->window / 4) < 1)
+    batch = 1;
+  if(ssc->window - outstanding < batch && outstanding > 0)
+    return;
+
+  ssc->signalmore(ssc->param, ssc->window - outstanding);
+  ssc->credits += ssc->window - outstanding;
+  return;
+}
+
 /*
  * ssc_take
  *
@@ -62,10 +96,18 @@ typedef struct scamper_source_control
 static int ssc_take(void *data)
 {
   scamper_source_control_t *ssc = (scamper_source_control_t *)data;
-  if(scamper_source_getcommandcount(ssc->source) == 0 && ssc->isfinished == 0)
+
+  if(ssc->isfinished != 0)
+    return 0;
+
+  if(ssc->window == 0)
     {
-      ssc->signalmore(ssc->param);
+      if(scamper_source_getcommandcount(ssc->source) == 0)
+	ssc->signalmore(ssc->param, 0);
+      return 0;
     }
+
+  ssc_grant(ssc);
   return 0;
 }
 
@@ -99,6 +141,50 @@ static char *ssc_tostr(void *data, char *str, size_t len)
   return str;
 }
 
+/*
+ * scamper_source_control_window
+ *
+ * the control socket wants to keep the given number of commands
+ * outstanding, which it is told about with credits.
+ */
+void scamper_source_control_window(scamper_source_t *source, int window)
+{
+  scamper_source_control_t *ssc;
+
+  assert(scamper_source_gettype(source) == SCAMPER_SOURCE_TYPE_CONTROL);
+  ssc = (scamper_source_control_t *)scamper_source_getdata(source);
+  assert(ssc != NULL);
+  ssc->window = window;
+
+  return;
+}
+
+/*
+ * scamper_source_control_received
+ *
+ * the control socket sent commands, which used up its credits whether or
+ * not the commands were accepted.  if they were not accepted, the client
+ * may be owed some credits.
+ */
+void scamper_source_control_received(scamper_source_t *source, int count)
+{
+  scamper_source_control_t *ssc;
+
+  assert(scamper_source_gettype(source) == SCAMPER_SOURCE_TYPE_CONTROL);
+  ssc = (scamper_source_control_t *)scamper_source_getdata(source);
+  assert(ssc != NULL);
+
+  if(ssc->window == 0)
+    return;
+
+  if((ssc->credits -= count) < 0)
+    ssc->credits = 0;
+  if(ssc->isfinished == 0)
+    ssc_grant(ssc);
+
+  return;
+}
+
 /*
  * scamper_source_control_finish
  *
@@ -133,7 +219,7 @@ void scamper_source_control_finish(scamper_source_t *source)
  * (on / off) by using the acceptready callback provided.
  */
 scamper_source_t *scamper_source_control_alloc(scamper_source_params_t *ssp,
-				       void (*signalmore)(void *),
+				       void (*signalmore)(void *, int),
 				       char *(*tostr)(void *,char *,size_t),
 				       void *param)
 {
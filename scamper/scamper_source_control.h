@@ -25,10 +25,12 @@
 #define __SCAMPER_SOURCE_CONTROL_H
 
 scamper_source_t *scamper_source_control_alloc(scamper_source_params_t *ssp,
-				       void (*signalmore)(void *),
+				       void (*signalmore)(void *, int),
 				       char *(*tostr)(void *,char *,size_t),
 				       void *param);
 
 void scamper_source_control_finish(scamper_source_t *source);
+void scamper_source_control_window(scamper_source_t *source, int window);
+void scamper_source_control_received(scamper_source_t *source, int count);
 
 #endif /* __SCAMPER_SOURCE_CONTROL_H */
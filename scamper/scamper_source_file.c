@@ -56,16 +56,41 @@ typedef struct scamper_source_file
   int                 cycles;
   int                 autoreload;
 
-  /* run-time state */
+  /*
+   * run-time state.
+   *
+   * ifd: an inotify fd watching the file for appends and replacements
+   * eof: the last cycle has reached the end of a watched file, and is
+   *      waiting for more lines to be appended.
+   */
   int                 reload;
   time_t              mtime;
   scamper_fd_t       *fd;
   scamper_linepoll_t *lp;
+  scamper_fd_t       *ifd;
+  int                 eof;
 
 } scamper_source_file_t;
 
 static int stdin_used = 0;
 
+static void ssf_watch_reset(scamper_source_file_t *ssf);
+
+static void ssf_watch_stop(scamper_source_file_t *ssf)
+{
+  int fd;
+
+  if(ssf->ifd != NULL)
+    {
+      fd = scamper_fd_fd_get(ssf->ifd);
+      scamper_fd_free(ssf->ifd);
+      ssf->ifd = NULL;
+      close(fd);
+    }
+
+  return;
+}
+
 /*
  * ssf_free
  *
@@ -75,6 +100,8 @@ static void ssf_free(scamper_source_file_t *ssf)
 {
   int fd = -1;
 
+  ssf_watch_stop(ssf);
+
   if(ssf->lp != NULL)
     {
       scamper_linepoll_free(ssf->lp, 0);
@@ -148,18 +175,17 @@ static int ssf_open(const char *filename)
 }
 
 /*
- * ssf_read_line
+ * ssf_command
  *
- * this callback receives a single line per call, which should contain an
+ * this function receives a single line per call, which should contain an
  * address in string form.  it combines that address with the source's
  * default command and then passes the string to source_command for further
  * processing.  the line eventually ends up in the commands queue.
  */
-static int ssf_read_line(void *param, uint8_t *buf, size_t len)
+static int ssf_command(void *param, char *str, size_t len, off_t off)
 {
-  scamper_source_file_t *ssf = (scamper_source_file_t *)param;
+  scamper_source_file_t *ssf = param;
   scamper_source_t *source = ssf->source;
-  char *str = (char *)buf;
   char cmd_buf[256], *cmd = NULL;
   size_t reqd_len;
 
@@ -204,7 +230,7 @@ static int ssf_read_line(void *param, uint8_t *buf, size_t len)
     }
 
   /* add the command to the source */
-  if(scamper_source_command(source, cmd) != 0)
+  if(scamper_source_command_off(source, cmd, off) != 0)
     {
       goto err;
     }
@@ -217,6 +243,18 @@ static int ssf_read_line(void *param, uint8_t *buf, size_t len)
   return -1;
 }
 
+/*
+ * ssf_read_line
+ *
+ * this callback receives a single line per call from the linepoll.
+ */
+static int ssf_read_line(void *param, uint8_t *buf, size_t len)
+{
+  scamper_source_file_t *ssf = (scamper_source_file_t *)param;
+  off_t off = scamper_linepoll_lineoff(ssf->lp);
+  return ssf_command(ssf, (char *)buf, len, off);
+}
+
 static void ssf_read(const int fd, void *param)
 {
   scamper_source_file_t *ssf = (scamper_source_file_t *)param;
@@ -243,6 +281,16 @@ static void ssf_read(const int fd, void *param)
 	  scamper_fd_read_pause(ssf->fd);
 	}
     }
+  else if(rc == 0 && ssf->cycles == 1 && ssf->ifd != NULL)
+    {
+      /*
+       * got EOF on the last cycle over a file that is being watched.
+       * wait for lines to be appended to the file.  a partial line is
+       * held until the rest of it arrives.
+       */
+      ssf->eof = 1;
+      scamper_fd_read_pause(ssf->fd);
+    }
   else if(rc == 0 && ssf->cycles == 1)
     {
       /* got EOF; this is the last cycle over an input file */
@@ -261,7 +309,13 @@ static void ssf_read(const int fd, void *param)
 	}
 
       /* decide if we should reload the file at this point */
-      if(ssf->reload == 1)
+      if(ssf->ifd != NULL)
+	{
+	  /* the watch on the file tells us if the file was replaced */
+	  reload = ssf->reload;
+	  mtime = ssf->mtime;
+	}
+      else if(ssf->reload == 1)
 	{
 	  /* stat the file so we have an mtime value for later */
 	  if(stat_mtime(ssf->filename, &mtime) == 0)
@@ -292,10 +346,15 @@ static void ssf_read(const int fd, void *param)
 
 	  /* close the existing file */
 	  close(fd);
+	  scamper_linepoll_setoff(ssf->lp, 0);
 
 	  /* update file details; ensure reload is reset to zero */
 	  ssf->mtime = mtime;
 	  ssf->reload = 0;
+
+	  /* watch the file that replaced the previous one */
+	  if(ssf->ifd != NULL)
+	    ssf_watch_reset(ssf);
 	}
       else
 	{
@@ -304,6 +363,7 @@ static void ssf_read(const int fd, void *param)
 	    {
 	      goto err;
 	    }
+	  scamper_linepoll_setoff(ssf->lp, 0);
 	}
 
       /* check to see if we should pause, or allow reading to continue */
@@ -345,6 +405,217 @@ static void ssf_read(const int fd, void *param)
   return;
 }
 
+#ifdef HAVE_INOTIFY
+/*
+ * ssf_watch_read
+ *
+ * the inotify fd has events to read.  if lines were appended to the file
+ * and the last cycle is waiting at the end of the file, read them now.  if
+ * the file was replaced, deleted, or renamed, either reload it at the next
+ * cycle point, or immediately if the last cycle is waiting at the end of
+ * the file.  if there is no file to reload yet, the watch on the
+ * directory says when one appears.
+ */
+static void ssf_watch_read(const int fd, void *param)
+{
+  scamper_source_file_t *ssf = (scamper_source_file_t *)param;
+  struct inotify_event ev;
+  uint8_t buf[4096];
+  const char *name, *base;
+  int append = 0, replace = 0, newfd, oldfd;
+  size_t off;
+  ssize_t rc;
+
+  if((rc = read(fd, buf, sizeof(buf))) <= 0)
+    {
+      if(rc == -1 && errno != EAGAIN && errno != EINTR)
+	{
+	  printerror(errno, strerror, __func__, "read failed fd %d", fd);
+	  ssf_watch_stop(ssf);
+	}
+      return;
+    }
+
+  if((base = string_lastof_char(ssf->filename, '/')) != NULL)
+    base++;
+  else
+    base = ssf->filename;
+
+  for(off = 0; off + sizeof(ev) <= (size_t)rc; off += sizeof(ev) + ev.len)
+    {
+      memcpy(&ev, buf+off, sizeof(ev));
+
+      /* events with a name are for entries in the file's directory */
+      if(ev.len > 0)
+	{
+	  if(off + sizeof(ev) + ev.len > (size_t)rc)
+	    break;
+	  name = (const char *)(buf + off + sizeof(ev));
+	  if((ev.mask & (IN_CREATE|IN_MOVED_TO)) != 0 && strcmp(name,base) == 0)
+	    replace = 1;
+	}
+      else if((ev.mask & (IN_DELETE_SELF|IN_MOVE_SELF)) != 0)
+	{
+	  replace = 1;
+	}
+      else if((ev.mask & IN_MODIFY) != 0)
+	{
+	  append = 1;
+	}
+    }
+
+  if(replace != 0)
+    {
+      ssf->reload = 1;
+      if(ssf->eof == 0 || (newfd = ssf_open(ssf->filename)) == -1)
+	return;
+
+      /* the last cycle continues with the file that replaced the old one */
+      oldfd = scamper_fd_fd_get(ssf->fd);
+      if(scamper_fd_fd_set(ssf->fd, newfd) == -1)
+	{
+	  close(newfd);
+	  ssf->cycles = 0;
+	  return;
+	}
+      close(oldfd);
+      scamper_linepoll_setoff(ssf->lp, 0);
+      ssf->reload = 0;
+      ssf_watch_reset(ssf);
+      append = 1;
+    }
+
+  if(append != 0 && ssf->eof != 0)
+    {
+      ssf->eof = 0;
+      scamper_fd_read_unpause(ssf->fd);
+    }
+
+  return;
+}
+
+/*
+ * scamper_source_file_watch_fd
+ *
+ * open an inotify fd that watches the file for appends and for being
+ * deleted or renamed, and its directory for a file with the same name
+ * being created or renamed into place.
+ */
+int scamper_source_file_watch_fd(const char *filename)
+{
+  char *dir = NULL, *ptr;
+  int fd = -1;
+
+  if((dir = strdup(filename)) == NULL)
+    return -1;
+  if((ptr = string_lastof_char(dir, '/')) == NULL)
+    {
+      dir[0] = '.'; dir[1] = '\0';
+    }
+  else if(ptr == dir)
+    ptr[1] = '\0';
+  else
+    ptr[0] = '\0';
+
+  if((fd = inotify_init()) != -1 &&
+     (inotify_add_watch(fd, filename,
+			IN_MODIFY | IN_DELETE_SELF | IN_MOVE_SELF) == -1 ||
+      inotify_add_watch(fd, dir, IN_CREATE | IN_MOVED_TO) == -1))
+    {
+      close(fd);
+      fd = -1;
+    }
+  free(dir);
+
+  return fd;
+}
+
+static int ssf_watch_open(const char *filename)
+{
+  int fd;
+
+#if defined(WITHOUT_PRIVSEP)
+  fd = scamper_source_file_watch_fd(filename);
+#else
+  fd = scamper_privsep_open_inotify(filename);
+#endif
+
+  if(fd == -1)
+    return -1;
+
+#ifdef O_NONBLOCK
+  if(fcntl_set(fd, O_NONBLOCK) == -1)
+    {
+      close(fd);
+      return -1;
+    }
+#endif
+
+  return fd;
+}
+#endif
+
+/*
+ * ssf_watch_start
+ *
+ * if the system supports it, watch the file so that appends and
+ * replacements are noticed as they happen.
+ */
+static int ssf_watch_start(scamper_source_file_t *ssf)
+{
+#ifdef HAVE_INOTIFY
+  int fd;
+
+  if(ssf->ifd != NULL || strcmp(ssf->filename, "-") == 0)
+    return 0;
+
+  if((fd = ssf_watch_open(ssf->filename)) == -1)
+    {
+      printerror(errno, strerror, __func__, "could not watch %s",
+		 ssf->filename);
+      return -1;
+    }
+
+  if((ssf->ifd = scamper_fd_private(fd, ssf_watch_read, ssf,
+				    NULL, NULL)) == NULL)
+    {
+      close(fd);
+      return -1;
+    }
+#endif
+
+  return 0;
+}
+
+/*
+ * ssf_watch_reset
+ *
+ * the file has been replaced, so watch the new file.
+ */
+static void ssf_watch_reset(scamper_source_file_t *ssf)
+{
+#ifdef HAVE_INOTIFY
+  int fd, oldfd;
+
+  if((fd = ssf_watch_open(ssf->filename)) == -1)
+    {
+      ssf_watch_stop(ssf);
+      return;
+    }
+
+  oldfd = scamper_fd_fd_get(ssf->ifd);
+  if(scamper_fd_fd_set(ssf->ifd, fd) == -1)
+    {
+      close(fd);
+      ssf_watch_stop(ssf);
+      return;
+    }
+  close(oldfd);
+#endif
+
+  return;
+}
+
 /*
  * ssf_tostr
  *
@@ -384,7 +655,7 @@ static int ssf_take(void *data)
 
   if(scamper_source_getcyclecount(ssf->source) < 2 &&
      scamper_source_getcommandcount(ssf->source) < scamper_pps_get() &&
-     ssf->cycles != 0)
+     ssf->cycles != 0 && ssf->eof == 0)
     {
       scamper_fd_read_unpause(ssf->fd);
     }
@@ -392,6 +663,22 @@ static int ssf_take(void *data)
   return 0;
 }
 
+/*
+ * ssf_getoff
+ *
+ * return the offset of the next line to be read from the file, so that the
+ * source can be checkpointed.  stdin cannot be resumed.
+ */
+static off_t ssf_getoff(void *data)
+{
+  scamper_source_file_t *ssf = (scamper_source_file_t *)data;
+
+  if(strcmp(ssf->filename, "-") == 0)
+    return -1;
+
+  return scamper_linepoll_getoff(ssf->lp);
+}
+
 static void ssf_freedata(void *data)
 {
   ssf_free((scamper_source_file_t *)data);
@@ -472,6 +759,22 @@ int scamper_source_file_update(scamper_source_t *source,
       sse.sse_update_flags |= 0x01;
       sse.sse_update_autoreload = *autoreload;
       ssf->autoreload = *autoreload;
+
+      if(ssf->autoreload != 0)
+	{
+	  ssf_watch_start(ssf);
+	}
+      else
+	{
+	  /* if the last cycle was waiting for lines, then it is done */
+	  ssf_watch_stop(ssf);
+	  if(ssf->eof != 0)
+	    {
+	      scamper_linepoll_flush(ssf->lp);
+	      ssf->eof = 0;
+	      ssf->cycles = 0;
+	    }
+	}
     }
 
   if(cycles != NULL)
@@ -479,6 +782,14 @@ int scamper_source_file_update(scamper_source_t *source,
       sse.sse_update_flags |= 0x02;
       sse.sse_update_cycles = *cycles;
       ssf->cycles = *cycles;
+
+      /* move past the end of the file to the next cycle, if there is one */
+      if(ssf->eof != 0 && ssf->cycles != 1)
+	{
+	  ssf->eof = 0;
+	  if(ssf->cycles != 0)
+	    scamper_fd_read_unpause(ssf->fd);
+	}
     }
 
   if(sse.sse_update_flags != 0)
@@ -495,6 +806,9 @@ scamper_source_t *scamper_source_file_alloc(scamper_source_params_t *ssp,
 					    int cycles, int autoreload)
 {
   scamper_source_file_t *ssf = NULL;
+  off_t off, *tasks = NULL;
+  uint32_t cycle_id;
+  int taskc, resume = 0;
   int fd = -1;
 
   /* sanity checks */
@@ -537,6 +851,10 @@ scamper_source_t *scamper_source_file_alloc(scamper_source_params_t *ssp,
       goto err;
     }
 
+  /* watch the file for changes if it is to be reloaded */
+  if(autoreload != 0)
+    ssf_watch_start(ssf);
+
   /*
    * data and callback functions that scamper_source_alloc needs to know about
    */
@@ -545,14 +863,33 @@ scamper_source_t *scamper_source_file_alloc(scamper_source_params_t *ssp,
   ssp->freedata    = ssf_freedata;
   ssp->isfinished  = ssf_isfinished;
   ssp->tostr       = ssf_tostr;
+  ssp->getoff      = ssf_getoff;
   ssp->type        = SCAMPER_SOURCE_TYPE_FILE;
 
+  /* if there is a checkpoint for this source, resume the cycle */
+  if(strcmp(filename, "-") != 0 &&
+     scamper_sources_resume_get(ssp->name, &cycle_id, &off,
+				&tasks, &taskc) == 0)
+    {
+      ssp->cycle_id = cycle_id;
+      resume = 1;
+    }
+
   /* allocate the parent source structure */
   if((ssf->source = scamper_source_alloc(ssp)) == NULL)
     {
       goto err;
     }
 
+  if(resume != 0 &&
+     scamper_source_resume(ssf->source, scamper_fd_fd_get(ssf->fd), ssf->lp,
+			   off, tasks, taskc, ssf_command, ssf) != 0)
+    {
+      printerror(0, NULL, __func__, "could not resume %s, starting over",
+		 filename);
+    }
+  if(tasks != NULL) free(tasks);
+
   return ssf->source;
 
  err:
@@ -561,6 +898,7 @@ scamper_source_t *scamper_source_file_alloc(scamper_source_params_t *ssp,
       assert(ssf->source == NULL);
       ssf_free(ssf);
     }
+  if(tasks != NULL) free(tasks);
   if(fd != -1) close(fd);
   return NULL;
 }
@@ -37,4 +37,9 @@ int scamper_source_file_getautoreload(const scamper_source_t *source);
 int scamper_source_file_update(scamper_source_t *source,
 			       const int *autoreload, const int *cycles);
 
+#ifdef HAVE_INOTIFY
+/* open an inotify fd watching the file.  for the benefit of privsep code */
+int scamper_source_file_watch_fd(const char *filename);
+#endif
+
 #endif /* __SCAMPER_SOURCE_FILE_H */
@@ -126,18 +126,17 @@ static int ssf_open(const char *filename)
 }
 
 /*
- * ssf_read_line
+ * ssf_command
  *
- * this callback receives a single line per call, which should contain an
+ * this function receives a single line per call, which should contain an
  * address in string form.  it combines that address with the source's
  * default command and then passes the string to source_command for further
  * processing.  the line eventually ends up in the commands queue.
  */
-static int ssf_read_line(void *param, uint8_t *buf, size_t len)
+static int ssf_command(void *param, char *str, size_t len, off_t lineoff)
 {
-  scamper_source_tsps_t *ssf = (scamper_source_tsps_t *)param;
+  scamper_source_tsps_t *ssf = param;
   scamper_source_t *source = ssf->source;
-  char *str = (char *)buf;
   char *bits[5];
   int   i, bitc = 0;
   char cb[256];
@@ -182,7 +181,7 @@ static int ssf_read_line(void *param, uint8_t *buf, size_t len)
     }
   string_concat(cb, sizeof(cb), &off, " %s", bits[0]);
 
-  if(scamper_source_command(source, cb) != 0)
+  if(scamper_source_command_off(source, cb, lineoff) != 0)
     goto err;
 
   return 0;
@@ -191,6 +190,18 @@ static int ssf_read_line(void *param, uint8_t *buf, size_t len)
   return -1;
 }
 
+/*
+ * ssf_read_line
+ *
+ * this callback receives a single line per call from the linepoll.
+ */
+static int ssf_read_line(void *param, uint8_t *buf, size_t len)
+{
+  scamper_source_tsps_t *ssf = (scamper_source_tsps_t *)param;
+  off_t off = scamper_linepoll_lineoff(ssf->lp);
+  return ssf_command(ssf, (char *)buf, len, off);
+}
+
 static void ssf_read(const int fd, void *param)
 {
   scamper_source_tsps_t *ssf = (scamper_source_tsps_t *)param;
@@ -253,6 +264,14 @@ static int ssf_take(void *data)
   return 0;
 }
 
+static off_t ssf_getoff(void *data)
+{
+  scamper_source_tsps_t *ssf = (scamper_source_tsps_t *)data;
+  if(strcmp(ssf->filename, "-") == 0)
+    return -1;
+  return scamper_linepoll_getoff(ssf->lp);
+}
+
 static void ssf_freedata(void *data)
 {
   ssf_free((scamper_source_tsps_t *)data);
@@ -277,6 +296,9 @@ scamper_source_t *scamper_source_tsps_alloc(scamper_source_params_t *ssp,
 					    const char *filename)
 {
   scamper_source_tsps_t *ssf = NULL;
+  off_t off, *tasks = NULL;
+  uint32_t cycle_id;
+  int taskc, resume = 0;
   int fd = -1;
 
   /* sanity checks */
@@ -316,14 +338,33 @@ scamper_source_t *scamper_source_tsps_alloc(scamper_source_params_t *ssp,
   ssp->take        = ssf_take;
   ssp->freedata    = ssf_freedata;
   ssp->isfinished  = ssf_isfinished;
+  ssp->getoff      = ssf_getoff;
   ssp->type        = SCAMPER_SOURCE_TYPE_TSPS;
 
+  /* if there is a checkpoint for this source, resume the cycle */
+  if(strcmp(filename, "-") != 0 &&
+     scamper_sources_resume_get(ssp->name, &cycle_id, &off,
+				&tasks, &taskc) == 0)
+    {
+      ssp->cycle_id = cycle_id;
+      resume = 1;
+    }
+
   /* allocate the parent source structure */
   if((ssf->source = scamper_source_alloc(ssp)) == NULL)
     {
       goto err;
     }
 
+  if(resume != 0 &&
+     scamper_source_resume(ssf->source, scamper_fd_fd_get(ssf->fd), ssf->lp,
+			   off, tasks, taskc, ssf_command, ssf) != 0)
+    {
+      printerror(0, NULL, __func__, "could not resume %s, starting over",
+		 filename);
+    }
+  if(tasks != NULL) free(tasks);
+
   return ssf->source;
 
  err:
@@ -332,6 +373,7 @@ scamper_source_t *scamper_source_tsps_alloc(scamper_source_params_t *ssp,
       assert(ssf->source == NULL);
       ssf_free(ssf);
     }
+  if(tasks != NULL) free(tasks);
   if(fd != -1) close(fd);
   return NULL;
 }
@@ -42,6 +42,9 @@ static const char rcsid[] =
 #include "scamper_outfiles.h"
 #include "scamper_sources.h"
 #include "scamper_cyclemon.h"
+#include "scamper_linepoll.h"
+#include "scamper_privsep.h"
+#include "scamper_savefile.h"
 
 #include "trace/scamper_trace_do.h"
 #include "ping/scamper_ping_do.h"
@@ -51,6 +54,7 @@ static const char rcsid[] =
 #include "neighbourdisc/scamper_neighbourdisc_do.h"
 #include "tbit/scamper_tbit_do.h"
 #include "sniff/scamper_sniff_do.h"
+#include "trace/scamper_tracemap_do.h"
 
 #include "scamper_debug.h"
 
@@ -87,6 +91,7 @@ struct scamper_source
    * tasks:        a list of tasks currently active from the source.
    * id:           the next id number to assign
    * idtree:       a tree of id numbers currently in use
+   * dedup_cycle:  the shared cycle the source's current cycle is in
    */
   dlist_t                      *commands;
   int                           cycle_points;
@@ -94,6 +99,7 @@ struct scamper_source
   dlist_t                      *tasks;
   uint32_t                      id;
   splaytree_t                  *idtree;
+  uint32_t                      dedup_cycle;
 
   /*
    * nodes to keep track of whether the source is in the active or blocked
@@ -109,8 +115,15 @@ struct scamper_source
   void                        (*freedata)(void *data);
   int                         (*isfinished)(void *data);
   char *                      (*tostr)(void *data, char *str, size_t len);
+  off_t                       (*getoff)(void *data);
 };
 
+/*
+ * scamper_sourcetask
+ *
+ * off: the offset in the source's input of the command, if known, so that
+ *      the command can be issued again if scamper resumes from a checkpoint.
+ */
 struct scamper_sourcetask
 {
   scamper_source_t *source;
@@ -118,8 +131,69 @@ struct scamper_sourcetask
   dlist_node_t     *node;
   uint32_t          id;
   splaytree_node_t *idnode;
+  off_t             off;
 };
 
+/*
+ * source_resume
+ *
+ * details of a source read from a checkpoint file, held until a source
+ * of the same name is allocated.
+ *
+ *  name:     the name of the source
+ *  cycle_id: the cycle that was underway when the checkpoint was written
+ *  off:      the offset of the first command not yet issued as a task
+ *  tasks:    the offsets of commands that were in flight
+ *  taskc:    the number of commands that were in flight
+ */
+typedef struct source_resume
+{
+  char             *name;
+  uint32_t          cycle_id;
+  off_t             off;
+  off_t            *tasks;
+  int               taskc;
+} source_resume_t;
+
+/*
+ * source_dedup
+ *
+ * a bloom filter of the (command, target) pairs issued as tasks, so that a
+ * target that is listed in several overlapping sources is only probed once
+ * in a cycle.  the filter is keyed on a cycle counter shared by all
+ * sources, as the cycle ids of different sources are unrelated.  a source
+ * joins the shared cycle underway when it begins, and the shared cycle
+ * advances when a source begins a cycle past it.  two generations are
+ * kept, so that a source that lags the others is still filtered, against
+ * the older generation.
+ *
+ * the filter is sized with DEDUP_BITSPER bits for each of the targets
+ * expected in a cycle, so that about 1% of distinct targets are taken
+ * as duplicates when it holds that many.  if a generation fills past
+ * DEDUP_FILLMAX percent of its bits, the rate has passed 1%, and the
+ * generation stops suppressing commands until it is cleared.
+ *
+ *  bits:     the bit arrays of the filter, indexed by the shared cycle
+ *  setc:     the number of bits set in each generation
+ *  full:     the generation has filled past DEDUP_FILLMAX
+ *  size:     the number of bits in each generation
+ *  cycle:    the most recent shared cycle
+ *  count:    the number of duplicate commands suppressed
+ */
+typedef struct source_dedup
+{
+  uint8_t          *bits[2];
+  uint32_t          setc[2];
+  uint8_t           full[2];
+  uint32_t          size;
+  uint32_t          cycle;
+  uint32_t          count;
+} source_dedup_t;
+
+#define DEDUP_BITSPER  10
+#define DEDUP_HASHES   7
+#define DEDUP_FILLMAX  51
+
 /*
  * scamper_source_observer
  *
@@ -201,6 +275,12 @@ static const command_func_t command_funcs[] = {
     scamper_do_sniff_alloctask,
     scamper_do_sniff_free,
   },
+  {
+    "tracemap", 8,
+    scamper_do_tracemap_alloc,
+    scamper_do_tracemap_alloctask,
+    scamper_do_tracemap_free,
+  },
 };
 
 static size_t command_funcc = sizeof(command_funcs) / sizeof(command_func_t);
@@ -211,6 +291,7 @@ static size_t command_funcc = sizeof(command_funcs) / sizeof(command_func_t);
  *  type:  COMMAND_PROBE or COMMAND_CYCLE or COMMAND_TASK
  *  funcs: pointer to appropriate command_func_t
  *  data:  pointer to data allocated for task
+ *  off:   offset of the command in the source's input, or -1
  *  param: additional parameters specific to the command's type.
  */
 typedef struct command
@@ -224,6 +305,7 @@ typedef struct command
       const command_func_t *funcs;
       void                 *data;
       scamper_cyclemon_t   *cyclemon;
+      off_t                 off;
     } pr;
     scamper_cycle_t        *cycle;
     scamper_sourcetask_t   *sourcetask;
@@ -278,6 +360,8 @@ static scamper_source_t *source_cur  = NULL;
 static uint32_t          source_cnt  = 0;
 static splaytree_t      *source_tree = NULL;
 static dlist_t          *observers   = NULL;
+static splaytree_t      *resume_tree = NULL;
+static source_dedup_t   *dedup       = NULL;
 
 /* forward declare */
 static void source_free(scamper_source_t *source);
@@ -429,6 +513,7 @@ static scamper_sourcetask_t *sourcetask_alloc(scamper_source_t *source,
     goto err;
   st->source = scamper_source_use(source);
   st->task = task;
+  st->off = -1;
   return st;
 
  err:
@@ -756,6 +841,92 @@ static int source_task_install(scamper_source_t *source,
   return 0;
 }
 
+/*
+ * dedup_cycle
+ *
+ * the source is beginning a cycle.  a source beginning its first cycle
+ * joins the shared cycle underway; otherwise the source moves on to the
+ * next shared cycle, which becomes the most recent if the source was
+ * leading.  the generation the new shared cycle uses is cleared.
+ */
+static void dedup_cycle(scamper_source_t *source)
+{
+  if(source->dedup_cycle == 0)
+    {
+      source->dedup_cycle = dedup->cycle;
+      return;
+    }
+
+  source->dedup_cycle++;
+  if(source->dedup_cycle > dedup->cycle)
+    {
+      dedup->cycle = source->dedup_cycle;
+      memset(dedup->bits[dedup->cycle & 1], 0, dedup->size / 8);
+      dedup->setc[dedup->cycle & 1] = 0;
+      dedup->full[dedup->cycle & 1] = 0;
+    }
+
+  return;
+}
+
+/*
+ * dedup_isdup
+ *
+ * check if the command for the destination has already been issued in the
+ * cycle.  if it has not, record that it has now.  a generation that has
+ * filled past its bound reports no duplicates, so that distinct targets
+ * are not thrown away.
+ */
+static int dedup_isdup(const command_func_t *funcs, uint32_t cycle,
+		       const scamper_addr_t *dst)
+{
+  const uint8_t *addr = dst->addr;
+  uint64_t hash = 14695981039346656037ULL;
+  uint32_t h1, h2, bit, gen;
+  size_t i, len = scamper_addr_size(dst);
+  uint8_t *bits;
+  int dup = 1;
+
+  /* a source lagging more than a cycle is filtered with the older one */
+  if(cycle + 1 < dedup->cycle)
+    cycle = dedup->cycle - 1;
+  gen = cycle & 1;
+  if(dedup->full[gen] != 0)
+    return 0;
+  bits = dedup->bits[gen];
+
+  /* FNV-1a over the command type, address type, and the address */
+  hash = (hash ^ (uint8_t)(funcs - command_funcs)) * 1099511628211ULL;
+  hash = (hash ^ (uint8_t)dst->type) * 1099511628211ULL;
+  for(i=0; i<len; i++)
+    hash = (hash ^ addr[i]) * 1099511628211ULL;
+
+  /* derive the bits to test with double hashing */
+  h1 = (uint32_t)hash;
+  h2 = (uint32_t)(hash >> 32) | 1;
+  for(i=0; i<DEDUP_HASHES; i++)
+    {
+      bit = (h1 + (uint32_t)i * h2) % dedup->size;
+      if((bits[bit / 8] & (1 << (bit % 8))) == 0)
+	{
+	  bits[bit / 8] |= (1 << (bit % 8));
+	  dedup->setc[gen]++;
+	  dup = 0;
+	}
+    }
+
+  if((uint64_t)dedup->setc[gen] * 100 >
+     (uint64_t)dedup->size * DEDUP_FILLMAX)
+    {
+      printerror(0, NULL, __func__,
+		 "filter is full, not suppressing duplicates this cycle;"
+		 " raise -O dedup=N above the number of targets");
+      dedup->full[gen] = 1;
+    }
+
+  return dup;
+}
+
 static int command_task_handle(scamper_source_t *source, command_t *command,
 			       scamper_task_t **task_out)
 {
@@ -771,6 +942,8 @@ static int command_probe_handle(scamper_source_t *source, command_t *command,
   scamper_sourcetask_t *st = NULL;
   scamper_cycle_t *cycle;
   scamper_task_t *task = NULL;
+  scamper_addr_t *dst;
+  off_t off = command->un.pr.off;
 
   sources_assert();
 
@@ -785,6 +958,17 @@ static int command_probe_handle(scamper_source_t *source, command_t *command,
   command_free(command);
   command = NULL;
 
+  /* drop the command if another source already issued it this cycle */
+  if(dedup != NULL && (dst = scamper_task_sig_dst(task)) != NULL &&
+     dedup_isdup(funcs, source->dedup_cycle, dst) != 0)
+    {
+      dedup->count++;
+      scamper_task_free(task);
+      *task_out = NULL;
+      sources_assert();
+      return 0;
+    }
+
   /*
    * keep a record in the source that this task is now active
    * pass the cyclemon structure to the task
@@ -792,6 +976,7 @@ static int command_probe_handle(scamper_source_t *source, command_t *command,
   if((st = sourcetask_alloc(source, task)) == NULL)
     goto err;
   task = NULL;
+  st->off = off;
   scamper_task_setsourcetask(st->task, st);
 
   if(source_task_install(source, st, task_out) != 0)
@@ -838,6 +1023,10 @@ static int command_cycle_handle(scamper_source_t *source, command_t *command)
       scamper_file_write_cycle_start(file, cycle);
     }
 
+  /* move the source on to the next cycle shared by the sources */
+  if(dedup != NULL)
+    dedup_cycle(source);
+
   /* post an event saying the cycle point just rolled around */
   memset(&sse, 0, sizeof(sse));
   sse.sse_cycle_cycle_id = cycle->id;
@@ -968,6 +1157,7 @@ static void source_flush_commands(scamper_source_t *source)
   source->freedata    = NULL;
   source->isfinished  = NULL;
   source->tostr       = NULL;
+  source->getoff      = NULL;
 
   if(source->commands != NULL)
     {
@@ -1383,6 +1573,41 @@ int scamper_source_halttask(scamper_source_t *source, uint32_t id)
  * the given command is created as a task immediately and assigned an id
  * which allows the command to be halted.  used by the control socket code.
  */
+/*
+ * source_idrange
+ *
+ * find a contiguous range of c ids, starting at or after s->id, none of
+ * which are in use by a task still in the idtree.  when the counter
+ * wraps, the search continues from 1.
+ */
+static int source_idrange(scamper_source_t *s, uint32_t c)
+{
+  scamper_sourcetask_t fm;
+  int wrapped = 0;
+  uint32_t i;
+
+  for(;;)
+    {
+      if(s->id == 0 || s->id + c < s->id)
+	{
+	  if(wrapped++ != 0)
+	    return -1;
+	  s->id = 1;
+	}
+      for(i=0; i<c; i++)
+	{
+	  fm.id = s->id + i;
+	  if(splaytree_find(s->idtree, &fm) != NULL)
+	    break;
+	}
+      if(i == c)
+	return 0;
+      s->id += i + 1;
+    }
+
+  return -1;
+}
+
 int scamper_source_command2(scamper_source_t *s, const char *command,
 			    uint32_t *id)
 {
@@ -1421,9 +1646,13 @@ int scamper_source_command2(scamper_source_t *s, const char *command,
   scamper_task_setcyclemon(task, s->cyclemon);
   task = NULL;
 
-  /* assign an id.  assume for now this will be enough to ensure uniqueness */
-  st->id = *id = s->id;
-  if(++s->id == 0) s->id = 1;
+  /* assign an id that is not used by another task of this source */
+  if(source_idrange(s, 1) != 0)
+    {
+      printerror(0, NULL, __func__, "no free id");
+      goto err;
+    }
+  st->id = *id = s->id++;
   if((st->idnode = splaytree_insert(s->idtree, st)) == NULL)
     {
       printerror(errno, strerror, __func__, "could not add to idtree");
@@ -1453,10 +1682,134 @@ int scamper_source_command2(scamper_source_t *s, const char *command,
 }
 
 /*
- * scamper_source_command
+ * scamper_source_commandv
  *
+ * a batch of commands are validated together and, only if all of them
+ * are acceptable, created as tasks with a contiguous range of ids.  if a
+ * command is not acceptable, its index is returned in bad.
  */
-int scamper_source_command(scamper_source_t *source, const char *command)
+int scamper_source_commandv(scamper_source_t *s, char **commands, int c,
+			    uint32_t *id, int *bad)
+{
+  const command_func_t **f = NULL;
+  scamper_sourcetask_t *st;
+  scamper_task_t *task = NULL;
+  command_t **cmds = NULL;
+  void **data = NULL;
+  int i, j = 0;
+
+  sources_assert();
+  *bad = -1;
+
+  if(s->idtree == NULL && (s->idtree = splaytree_alloc(idtree_cmp)) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not alloc idtree");
+      goto err;
+    }
+
+  if((f = malloc_zero(sizeof(command_func_t *) * c)) == NULL ||
+     (data = malloc_zero(sizeof(void *) * c)) == NULL ||
+     (cmds = malloc_zero(sizeof(command_t *) * c)) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not alloc batch");
+      goto err;
+    }
+
+  /* parse all of the commands before any are created as tasks */
+  for(i=0; i<c; i++)
+    {
+      if((f[i] = command_func_get(commands[i])) == NULL ||
+	 (data[i] = command_func_allocdata(f[i], commands[i])) == NULL)
+	{
+	  *bad = i;
+	  goto err;
+	}
+    }
+
+  /* the ids of the batch are contiguous and must not be in use */
+  if(source_idrange(s, (uint32_t)c) != 0)
+    {
+      printerror(0, NULL, __func__, "no free range of %d ids", c);
+      goto err;
+    }
+  *id = s->id;
+
+  for(j=0; j<c; j++)
+    {
+      if((task = f[j]->alloctask(data[j], s->list, s->cycle)) == NULL)
+	goto err;
+      data[j] = NULL;
+      if((st = sourcetask_alloc(s, task)) == NULL)
+	goto err;
+      scamper_task_setsourcetask(task, st);
+      scamper_task_setcyclemon(task, s->cyclemon);
+      st->id = s->id++;
+      if((st->idnode = splaytree_insert(s->idtree, st)) == NULL ||
+	 (cmds[j] = command_alloc(COMMAND_TASK)) == NULL)
+	goto err;
+      cmds[j]->un.sourcetask = st;
+      task = NULL;
+    }
+
+  /*
+   * the batch is queued all or nothing: if a command cannot be added to
+   * the list, pull back the commands of the batch already queued so that
+   * the caller is not told about ids that will never run.
+   */
+  for(i=0; i<c; i++)
+    {
+      if(dlist_tail_push(s->commands, cmds[i]) == NULL)
+	{
+	  printerror(errno, strerror, __func__, "could not add to commands");
+	  while(i-- > 0)
+	    dlist_tail_pop(s->commands);
+	  goto err;
+	}
+    }
+
+  if(s->id == 0) s->id = 1;
+  free(cmds);
+  free(data);
+  free(f);
+  source_active_attach(s);
+  sources_assert();
+  return 0;
+
+ err:
+  /* scamper_task_free will free the scamper_sourcetask_t */
+  if(task != NULL)
+    scamper_task_free(task);
+  if(cmds != NULL)
+    {
+      for(i=0; i<j; i++)
+	{
+	  if(cmds[i] == NULL)
+	    continue;
+	  scamper_task_free(cmds[i]->un.sourcetask->task);
+	  command_free(cmds[i]);
+	}
+      free(cmds);
+    }
+  if(data != NULL)
+    {
+      for(i=0; i<c; i++)
+	if(data[i] != NULL)
+	  f[i]->freedata(data[i]);
+      free(data);
+    }
+  if(f != NULL) free(f);
+  sources_assert();
+  return -1;
+}
+
+/*
+ * scamper_source_command_off
+ *
+ * add a command to the source, recording the offset in the source's
+ * input where the command came from.
+ */
+int scamper_source_command_off(scamper_source_t *source, const char *command,
+			       off_t off)
 {
   const command_func_t *func = NULL;
   command_t *cmd = NULL;
@@ -1475,6 +1828,7 @@ int scamper_source_command(scamper_source_t *source, const char *command)
   cmd->un.pr.funcs    = func;
   cmd->un.pr.data     = data;
   cmd->un.pr.cyclemon = scamper_cyclemon_use(source->cyclemon);
+  cmd->un.pr.off      = off;
 
   if(dlist_tail_push(source->commands, cmd) == NULL)
     goto err;
@@ -1491,6 +1845,15 @@ int scamper_source_command(scamper_source_t *source, const char *command)
   return -1;
 }
 
+/*
+ * scamper_source_command
+ *
+ */
+int scamper_source_command(scamper_source_t *source, const char *command)
+{
+  return scamper_source_command_off(source, command, -1);
+}
+
 /*
  * scamper_source_cycle
  *
@@ -1620,6 +1983,7 @@ scamper_source_t *scamper_source_alloc(const scamper_source_params_t *ssp)
   source->freedata    = ssp->freedata;
   source->isfinished  = ssp->isfinished;
   source->tostr       = ssp->tostr;
+  source->getoff      = ssp->getoff;
 
   if((source->list = scamper_list_alloc(ssp->list_id, ssp->name, ssp->descr,
 					scamper_monitorname_get())) == NULL)
@@ -1967,6 +2331,337 @@ int scamper_sources_add(scamper_source_t *source)
   return -1;
 }
 
+static int resume_cmp(const void *a, const void *b)
+{
+  return strcasecmp(((const source_resume_t *)a)->name,
+		    ((const source_resume_t *)b)->name);
+}
+
+static void resume_free(source_resume_t *sr)
+{
+  if(sr->name != NULL) free(sr->name);
+  if(sr->tasks != NULL) free(sr->tasks);
+  free(sr);
+  return;
+}
+
+static int checkpoint_write(int fd, char *buf, size_t len, const char *fs, ...)
+{
+  va_list ap;
+  int i;
+
+  va_start(ap, fs);
+  i = vsnprintf(buf, len, fs, ap);
+  va_end(ap);
+
+  if(i < 0 || (size_t)i >= len)
+    return -1;
+  return write_wrap(fd, buf, NULL, (size_t)i);
+}
+
+/*
+ * source_checkpoint
+ *
+ * write the position of the source into the checkpoint file.  the
+ * position of the source is the offset of the first command that has not
+ * been issued as a task yet, followed by the offsets of the commands
+ * that are in flight.
+ */
+static int source_checkpoint(void *param, void *item)
+{
+  scamper_source_t *source = item;
+  scamper_sourcetask_t *st;
+  scamper_cycle_t *cycle;
+  command_t *cmd = NULL;
+  dlist_node_t *dn;
+  char buf[512], offstr[32];
+  uint32_t cycle_id;
+  int *fd = param;
+  off_t off;
+
+  if(*fd == -1 || source->getoff == NULL || source->list == NULL)
+    return 0;
+
+  /* find the first command queued that came with an offset */
+  for(dn=dlist_head_node(source->commands); dn != NULL;
+      dn=dlist_node_next(dn))
+    {
+      cmd = dlist_node_item(dn);
+      if(cmd->type == COMMAND_PROBE && cmd->un.pr.off >= 0)
+	break;
+      cmd = NULL;
+    }
+
+  if(cmd != NULL)
+    {
+      off = cmd->un.pr.off;
+      cycle = scamper_cyclemon_cycle(cmd->un.pr.cyclemon);
+      cycle_id = cycle->id;
+    }
+  else if((off = source->getoff(source->data)) >= 0)
+    {
+      cycle_id = source->cycle->id;
+    }
+  else return 0;
+
+  if(offt_tostr(offstr, sizeof(offstr), off, 0, 'd') == NULL ||
+     checkpoint_write(*fd, buf, sizeof(buf), "source %u %s %s\n",
+		      cycle_id, offstr, source->list->name) != 0)
+    goto err;
+
+  for(dn=dlist_head_node(source->tasks); dn != NULL; dn=dlist_node_next(dn))
+    {
+      st = dlist_node_item(dn);
+      if(st->off < 0)
+	continue;
+      if(offt_tostr(offstr, sizeof(offstr), st->off, 0, 'd') == NULL ||
+	 checkpoint_write(*fd, buf, sizeof(buf), "task %s\n", offstr) != 0)
+	goto err;
+    }
+
+  return 0;
+
+ err:
+  printerror(errno, strerror, __func__, "could not write checkpoint");
+  *fd = -1;
+  return -1;
+}
+
+/*
+ * scamper_sources_checkpoint
+ *
+ * record the position of each source that is able to resume from a
+ * checkpoint in the specified file.  the checkpoint is written to a
+ * temporary file that replaces the file once it is complete, so that
+ * the previous checkpoint survives if scamper stops while writing.
+ */
+int scamper_sources_checkpoint(const char *filename)
+{
+  scamper_savefile_t *sf;
+  int wfd;
+
+  if((sf = scamper_savefile_open(filename)) == NULL)
+    return -1;
+
+  wfd = scamper_savefile_fd(sf);
+  splaytree_inorder(source_tree, source_checkpoint, &wfd);
+
+  if(wfd == -1)
+    {
+      scamper_savefile_abort(sf);
+      return -1;
+    }
+  return scamper_savefile_commit(sf);
+}
+
+/*
+ * resume_line
+ *
+ * parse a line out of a checkpoint file.  a source line begins a new
+ * record, and subsequent task lines record commands that were in flight.
+ */
+static int resume_line(char *line, source_resume_t **sr)
+{
+  source_resume_t *r = NULL;
+  char *cid, *off, *name;
+  long lo;
+
+  if(line[0] == '\0' || line[0] == '#')
+    return 0;
+
+  if(strncmp(line, "source ", 7) == 0)
+    {
+      if((cid = string_nextword(line)) == NULL ||
+	 (off = string_nextword(cid)) == NULL ||
+	 (name = string_nextword(off)) == NULL)
+	return -1;
+      if((r = malloc_zero(sizeof(source_resume_t))) == NULL ||
+	 (r->name = strdup(name)) == NULL)
+	goto err;
+      if(string_tolong(cid, &lo) != 0 || lo < 0)
+	goto err;
+      r->cycle_id = (uint32_t)lo;
+      if(string_tolong(off, &lo) != 0 || lo < 0)
+	goto err;
+      r->off = (off_t)lo;
+      if(splaytree_find(resume_tree, r) != NULL ||
+	 splaytree_insert(resume_tree, r) == NULL)
+	goto err;
+      *sr = r;
+      return 0;
+    }
+
+  if(strncmp(line, "task ", 5) == 0)
+    {
+      if((r = *sr) == NULL || (off = string_nextword(line)) == NULL ||
+	 string_tolong(off, &lo) != 0 || lo < 0)
+	return -1;
+      if(realloc_wrap((void **)&r->tasks, (r->taskc+1) * sizeof(off_t)) != 0)
+	return -1;
+      r->tasks[r->taskc++] = (off_t)lo;
+      return 0;
+    }
+
+  return -1;
+
+ err:
+  if(r != NULL) resume_free(r);
+  return -1;
+}
+
+/*
+ * scamper_sources_resume
+ *
+ * read a checkpoint file written by scamper_sources_checkpoint.  the
+ * details are held until a source with a matching name is allocated.
+ */
+int scamper_sources_resume(const char *filename)
+{
+  source_resume_t *sr = NULL;
+  struct stat sb;
+  char *buf = NULL, *line, *next;
+  int fd;
+
+#if defined(WITHOUT_PRIVSEP)
+  fd = open(filename, O_RDONLY);
+#else
+  fd = scamper_privsep_open_file(filename, O_RDONLY, 0);
+#endif
+
+  /* if there is no checkpoint file then there is nothing to resume */
+  if(fd == -1)
+    {
+      if(errno == ENOENT)
+	return 0;
+      printerror(errno, strerror, __func__, "could not open %s", filename);
+      return -1;
+    }
+
+  if(fstat(fd, &sb) != 0)
+    {
+      printerror(errno, strerror, __func__, "could not fstat %s", filename);
+      goto err;
+    }
+
+  if((resume_tree == NULL &&
+      (resume_tree = splaytree_alloc(resume_cmp)) == NULL) ||
+     (buf = malloc(sb.st_size + 1)) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not alloc resume state");
+      goto err;
+    }
+
+  if(read_wrap(fd, buf, NULL, sb.st_size) != 0)
+    {
+      printerror(errno, strerror, __func__, "could not read %s", filename);
+      goto err;
+    }
+  buf[sb.st_size] = '\0';
+  close(fd); fd = -1;
+
+  for(line = buf; line != NULL; line = next)
+    {
+      string_nullterm_char(line, '\n', &next);
+      if(resume_line(line, &sr) != 0)
+	{
+	  printerror(0, NULL, __func__, "invalid line in %s", filename);
+	  goto err;
+	}
+    }
+
+  free(buf);
+  return 0;
+
+ err:
+  if(buf != NULL) free(buf);
+  if(fd != -1) close(fd);
+  return -1;
+}
+
+/*
+ * scamper_sources_resume_get
+ *
+ * if the source has a checkpoint record, return the details of it to the
+ * caller.  the caller is responsible for freeing the tasks array.
+ */
+int scamper_sources_resume_get(const char *name, uint32_t *cycle_id,
+			       off_t *off, off_t **tasks, int *taskc)
+{
+  source_resume_t fm, *sr;
+
+  if(resume_tree == NULL)
+    return -1;
+
+  fm.name = (char *)name;
+  if((sr = splaytree_find(resume_tree, &fm)) == NULL)
+    return -1;
+  splaytree_remove_item(resume_tree, sr);
+
+  *cycle_id = sr->cycle_id;
+  *off      = sr->off;
+  *tasks    = sr->tasks; sr->tasks = NULL;
+  *taskc    = sr->taskc;
+  resume_free(sr);
+
+  return 0;
+}
+
+/*
+ * scamper_source_resume
+ *
+ * re-issue the commands that were in flight when the checkpoint was
+ * written, and then position the file at the first line that had not been
+ * issued as a task.  if that cannot be done, the commands re-issued are
+ * dropped and the file is positioned at the start, so that no command is
+ * issued twice.
+ */
+int scamper_source_resume(scamper_source_t *source, int fd,
+			  scamper_linepoll_t *lp, off_t off,
+			  const off_t *tasks, int taskc,
+			  int (*line)(void *, char *, size_t, off_t),
+			  void *param)
+{
+  command_t *command;
+  char buf[1024];
+  ssize_t rc;
+  size_t len;
+  int i, c;
+
+  c = dlist_count(source->commands);
+
+  for(i=0; i<taskc; i++)
+    {
+      if(lseek(fd, tasks[i], SEEK_SET) == -1 ||
+	 (rc = read(fd, buf, sizeof(buf)-1)) <= 0)
+	goto err;
+
+      for(len=0; len < (size_t)rc && buf[len] != '\n'; len++)
+	;
+      if(len == sizeof(buf)-1)
+	goto err;
+      buf[len] = '\0';
+      if(len > 0 && buf[len-1] == '\r')
+	buf[--len] = '\0';
+
+      if(len > 0 && line(param, buf, len, tasks[i]) != 0)
+	goto err;
+    }
+
+  if(lseek(fd, off, SEEK_SET) == -1)
+    goto err;
+  scamper_linepoll_setoff(lp, off);
+
+  return 0;
+
+ err:
+  while(dlist_count(source->commands) > c &&
+	(command = dlist_tail_pop(source->commands)) != NULL)
+    command_free(command);
+  lseek(fd, 0, SEEK_SET);
+  scamper_linepoll_setoff(lp, 0);
+  return -1;
+}
+
 /*
  * scamper_sources_init
  *
@@ -1974,6 +2669,8 @@ int scamper_sources_add(scamper_source_t *source)
  */
 int scamper_sources_init(void)
 {
+  uint32_t targets;
+
   if((active = clist_alloc()) == NULL)
     return -1;
 
@@ -1986,9 +2683,38 @@ int scamper_sources_init(void)
   if((source_tree = splaytree_alloc(source_cmp)) == NULL)
     return -1;
 
+  if((targets = scamper_option_dedup()) != 0)
+    {
+      if((dedup = malloc_zero(sizeof(source_dedup_t))) == NULL)
+	{
+	  printerror(errno, strerror, __func__, "could not alloc dedup");
+	  return -1;
+	}
+      dedup->size = ((targets * DEDUP_BITSPER) + 7) & ~7U;
+      if((dedup->bits[0] = malloc_zero(dedup->size / 8)) == NULL ||
+	 (dedup->bits[1] = malloc_zero(dedup->size / 8)) == NULL)
+	{
+	  printerror(errno, strerror, __func__, "could not alloc dedup");
+	  return -1;
+	}
+      dedup->cycle = 1;
+    }
+
   return 0;
 }
 
+/*
+ * scamper_sources_dedup_count
+ *
+ * return the number of duplicate commands that were suppressed.
+ */
+uint32_t scamper_sources_dedup_count(void)
+{
+  if(dedup == NULL)
+    return 0;
+  return dedup->count;
+}
+
 /*
  * scamper_sources_cleanup
  *
@@ -2029,5 +2755,20 @@ void scamper_sources_cleanup(void)
       finished = NULL;
     }
 
+  if(dedup != NULL)
+    {
+      scamper_debug(__func__, "suppressed %u duplicates", dedup->count);
+      if(dedup->bits[0] != NULL) free(dedup->bits[0]);
+      if(dedup->bits[1] != NULL) free(dedup->bits[1]);
+      free(dedup);
+      dedup = NULL;
+    }
+
+  if(resume_tree != NULL)
+    {
+      splaytree_free(resume_tree, (splaytree_free_t)resume_free);
+      resume_tree = NULL;
+    }
+
   return;
 }
@@ -25,6 +25,8 @@
 #ifndef __SCAMPER_SOURCE_H
 #define __SCAMPER_SOURCE_H
 
+struct scamper_linepoll;
+
 typedef struct scamper_source scamper_source_t;
 
 #define SCAMPER_SOURCE_TYPE_FILE    1
@@ -66,6 +68,13 @@ typedef struct scamper_source_params
   int              (*isfinished)(void *data);
   char *           (*tostr)(void *data, char *str, size_t len);
 
+  /*
+   * getoff: the offset in the source's input of the first line that has
+   *         not been passed to scamper_source_command_off.  sources that
+   *         can resume from a checkpoint supply this callback.
+   */
+  off_t            (*getoff)(void *data);
+
 } scamper_source_params_t;
 
 /* functions for allocating, referencing, and dereferencing scamper sources */
@@ -105,8 +114,12 @@ int scamper_source_isfinished(scamper_source_t *source);
 
 /* functions for adding stuff to the source's command queue */
 int scamper_source_command(scamper_source_t *source, const char *command);
+int scamper_source_command_off(scamper_source_t *source, const char *command,
+			       off_t off);
 int scamper_source_command2(scamper_source_t *source, const char *command,
 			    uint32_t *id);
+int scamper_source_commandv(scamper_source_t *source, char **commands,
+			    int c, uint32_t *id, int *bad);
 int scamper_source_cycle(scamper_source_t *source);
 int scamper_source_task(scamper_source_t *source, struct scamper_task *task);
 int scamper_source_halttask(scamper_source_t *source, uint32_t id);
@@ -124,6 +137,20 @@ int scamper_sources_isready(void);
 int scamper_sources_isempty(void);
 void scamper_sources_foreach(void *p, int (*func)(void *, scamper_source_t *));
 void scamper_sources_empty(void);
+
+/* functions for checkpointing sources, and resuming from a checkpoint */
+int scamper_sources_checkpoint(const char *filename);
+int scamper_sources_resume(const char *filename);
+int scamper_sources_resume_get(const char *name, uint32_t *cycle_id,
+			       off_t *off, off_t **tasks, int *taskc);
+int scamper_source_resume(scamper_source_t *source, int fd,
+			  struct scamper_linepoll *lp, off_t off,
+			  const off_t *tasks, int taskc,
+			  int (*line)(void *, char *, size_t, off_t),
+			  void *param);
+/* the number of duplicate commands suppressed across sources */
+uint32_t scamper_sources_dedup_count(void);
+
 int scamper_sources_init(void);
 void scamper_sources_cleanup(void);
 
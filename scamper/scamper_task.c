@@ -108,6 +108,7 @@ typedef struct task_onhold
 static splaytree_t *tx_ip = NULL;
 static splaytree_t *tx_nd = NULL;
 static dlist_t     *sniff = NULL;
+static dlist_t     *icmp  = NULL;
 
 static int tx_ip_cmp(const void *va, const void *vb)
 {
@@ -258,6 +259,31 @@ static void sniff_check(scamper_dl_rec_t *dl)
   return;
 }
 
+/*
+ * icmp_find
+ *
+ * find a task that sends ICMP echo requests with ICMP ids that overlap
+ * the id and mask supplied.  the bits of the id outside of a task's
+ * mask are the task's to use as it sees fit.
+ */
+static s2t_t *icmp_find(uint16_t id, uint16_t mask)
+{
+  scamper_task_sig_t *sig;
+  dlist_node_t *n;
+  s2t_t *s2t;
+  uint16_t m;
+
+  for(n = dlist_head_node(icmp); n != NULL; n = dlist_node_next(n))
+    {
+      s2t = dlist_node_item(n); sig = s2t->sig;
+      m = mask & sig->sig_icmp_mask;
+      if((sig->sig_icmp_id & m) == (id & m))
+	return s2t;
+    }
+
+  return NULL;
+}
+
 static void s2t_free(s2t_t *s2t)
 {
   scamper_task_sig_t *sig = s2t->sig;
@@ -273,6 +299,8 @@ static void s2t_free(s2t_t *s2t)
 	splaytree_remove_node(tx_nd, s2t->node);
       else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_SNIFF)
 	dlist_node_pop(sniff, s2t->node);
+      else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_ICMP)
+	dlist_node_pop(icmp, s2t->node);
     }
 
   free(s2t);
@@ -294,6 +322,9 @@ char *scamper_task_sig_tostr(scamper_task_sig_t *sig, char *buf, size_t len)
     string_concat(buf, len, &off, "sniff %s icmp-id %04x",
 		  scamper_addr_tostr(sig->sig_sniff_src, tmp, sizeof(tmp)),
 		  sig->sig_sniff_icmp_id);
+  else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_ICMP)
+    string_concat(buf, len, &off, "icmp-id %04x/%04x",
+		  sig->sig_icmp_id, sig->sig_icmp_mask);
   else
     return NULL;
 
@@ -372,6 +403,27 @@ int scamper_task_sig_add(scamper_task_t *task, scamper_task_sig_t *sig)
   return 0;
 }
 
+/*
+ * scamper_task_sig_dst
+ *
+ * return the destination of the first signature of the task that probes
+ * an IP address, if any.
+ */
+scamper_addr_t *scamper_task_sig_dst(const scamper_task_t *task)
+{
+  scamper_task_sig_t *sig;
+  slist_node_t *n;
+
+  for(n=slist_head_node(task->siglist); n != NULL; n = slist_node_next(n))
+    {
+      sig = ((s2t_t *)slist_node_item(n))->sig;
+      if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_IP)
+	return sig->sig_tx_ip_dst;
+    }
+
+  return NULL;
+}
+
 scamper_task_t *scamper_task_find(scamper_task_sig_t *sig)
 {
   s2t_t fm, *s2t;
@@ -381,6 +433,8 @@ scamper_task_t *scamper_task_find(scamper_task_sig_t *sig)
     s2t = splaytree_find(tx_ip, &fm);
   else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_TX_ND)
     s2t = splaytree_find(tx_nd, &fm);
+  else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_ICMP)
+    s2t = icmp_find(sig->sig_icmp_id, sig->sig_icmp_mask);
   else
     return NULL;
 
@@ -433,6 +487,8 @@ int scamper_task_sig_install(scamper_task_t *task)
 	s2t->node = splaytree_insert(tx_nd, s2t);
       else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_SNIFF)
 	s2t->node = dlist_tail_push(sniff, s2t);
+      else if(sig->sig_type == SCAMPER_TASK_SIG_TYPE_ICMP)
+	s2t->node = dlist_tail_push(icmp, s2t);
 
       if(s2t->node == NULL)
 	{
@@ -659,6 +715,49 @@ void scamper_task_write(scamper_task_t *task, scamper_file_t *file)
   return;
 }
 
+/*
+ * task_write
+ *
+ * write the result of a task to a file, for scamper_outfiles_write.
+ */
+static void task_write(void *task, scamper_file_t *sf)
+{
+  scamper_task_write(task, sf);
+  return;
+}
+
+/*
+ * scamper_task_output
+ *
+ * write the data held by the task to the outfile of the task's source.
+ * this is done when the task is done, but a task that collects a lot of
+ * data may call it to write out what it has so far.
+ */
+void scamper_task_output(scamper_task_t *task)
+{
+  scamper_outfile_t *sof, *sof2, *sofs[2];
+  scamper_source_t *source;
+  const char *sofname;
+  int sofc;
+
+  if((source = scamper_task_getsource(task)) == NULL ||
+     (sofname = scamper_source_getoutfile(source)) == NULL ||
+     (sof = scamper_outfiles_get(sofname)) == NULL)
+    return;
+  sofs[0] = sof; sofc = 1;
+
+  /*
+   * write a copy of the data out if asked to, and it has not
+   * already been written to this output file.
+   */
+  if(scamper_option_outcopy() != 0 &&
+     (sof2 = scamper_outfiles_get(NULL)) != NULL && sof != sof2)
+    sofs[sofc++] = sof2;
+
+  scamper_outfiles_write(sofs, sofc, task, task_write);
+  return;
+}
+
 void scamper_task_probe(scamper_task_t *task)
 {
   task->funcs->probe(task);
@@ -826,6 +925,8 @@ int scamper_task_init(void)
     return -1;
   if((sniff = dlist_alloc()) == NULL)
     return -1;
+  if((icmp = dlist_alloc()) == NULL)
+    return -1;
   return 0;
 }
 
@@ -849,5 +950,11 @@ void scamper_task_cleanup(void)
       sniff = NULL;
     }
 
+  if(icmp != NULL)
+    {
+      dlist_free(icmp);
+      icmp = NULL;
+    }
+
   return;
 }
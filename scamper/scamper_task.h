@@ -38,6 +38,7 @@ struct scamper_sourcetask;
 #define SCAMPER_TASK_SIG_TYPE_TX_IP 1
 #define SCAMPER_TASK_SIG_TYPE_TX_ND 2
 #define SCAMPER_TASK_SIG_TYPE_SNIFF 3
+#define SCAMPER_TASK_SIG_TYPE_ICMP  4
 
 typedef struct scamper_task scamper_task_t;
 typedef struct scamper_task_anc scamper_task_anc_t;
@@ -61,6 +62,11 @@ typedef struct scamper_task_sig
       struct scamper_addr *src;
       uint16_t             icmpid;
     } sniff;
+    struct tx_icmp
+    {
+      uint16_t             id;
+      uint16_t             mask;
+    } tx_icmp;
   } un;
 } scamper_task_sig_t;
 
@@ -69,6 +75,8 @@ typedef struct scamper_task_sig
 #define sig_tx_nd_ip      un.nd.ip
 #define sig_sniff_src     un.sniff.src
 #define sig_sniff_icmp_id un.sniff.icmpid
+#define sig_icmp_id       un.tx_icmp.id
+#define sig_icmp_mask     un.tx_icmp.mask
 
 typedef struct scamper_task_funcs
 {
@@ -112,6 +120,7 @@ void scamper_task_setcyclemon(scamper_task_t *t, struct scamper_cyclemon *cm);
 
 /* access the various functions registered with the task */
 void scamper_task_write(scamper_task_t *task, struct scamper_file *file);
+void scamper_task_output(scamper_task_t *task);
 void scamper_task_probe(scamper_task_t *task);
 void scamper_task_handleicmp(scamper_task_t *task,struct scamper_icmp_resp *r);
 void scamper_task_handletimeout(scamper_task_t *task);
@@ -153,6 +162,7 @@ scamper_task_t *scamper_task_sig_block(scamper_task_t *task);
 int scamper_task_sig_install(scamper_task_t *task);
 void scamper_task_sig_deinstall(scamper_task_t *task);
 scamper_task_t *scamper_task_find(scamper_task_sig_t *sig);
+struct scamper_addr *scamper_task_sig_dst(const scamper_task_t *task);
 char *scamper_task_sig_tostr(scamper_task_sig_t *sig, char *buf, size_t len);
 
 /* manage ancillary data attached to the task */
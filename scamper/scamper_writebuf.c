@@ -339,6 +339,56 @@ int scamper_writebuf_send(scamper_writebuf_t *wb, const void *data, size_t len)
   return -1;
 }
 
+/*
+ * scamper_writebuf_sendv
+ *
+ * register a set of buffers to send as a single iovec, so that a frame
+ * assembled from several pieces is copied only once.
+ */
+int scamper_writebuf_sendv(scamper_writebuf_t *wb, const struct iovec *vec,
+			   int vecc)
+{
+  struct iovec *iov = NULL;
+  uint8_t *bytes;
+  size_t len = 0;
+  int i;
+
+  for(i=0; i<vecc; i++)
+    len += vec[i].iov_len;
+  if(len < 1)
+    return 0;
+
+  if(wb->error != 0)
+    return -1;
+
+  if((iov = malloc_zero(sizeof(struct iovec))) == NULL ||
+     (iov->iov_base = malloc(len)) == NULL)
+    {
+      goto err;
+    }
+  bytes = iov->iov_base;
+  for(i=0; i<vecc; i++)
+    {
+      memcpy(bytes + iov->iov_len, vec[i].iov_base, vec[i].iov_len);
+      iov->iov_len += vec[i].iov_len;
+    }
+
+  if(slist_tail_push(wb->iovs, iov) == NULL)
+    goto err;
+
+  if(wb->fdn != NULL)
+    scamper_fd_write_unpause(wb->fdn);
+
+  return 0;
+
+ err:
+  if(iov == NULL)
+    return -1;
+  if(iov->iov_base != NULL) free(iov->iov_base);
+  free(iov);
+  return -1;
+}
+
 int scamper_writebuf_consume(scamper_writebuf_t *wb, void *cparam,
 			     int cfunc(void *param))
 {
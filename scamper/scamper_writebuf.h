@@ -26,12 +26,15 @@
 #define __SCAMPER_WRITEBUF_H
 
 typedef struct scamper_writebuf scamper_writebuf_t;
+struct iovec;
 
 scamper_writebuf_t *scamper_writebuf_alloc(void);
 void scamper_writebuf_free(scamper_writebuf_t *wb);
 
 /* queue data on the writebuf */
 int scamper_writebuf_send(scamper_writebuf_t *wb, const void *data,size_t len);
+int scamper_writebuf_sendv(scamper_writebuf_t *wb, const struct iovec *vec,
+			   int vecc);
 
 /* get the writebuf to ask for data to send */
 int scamper_writebuf_consume(scamper_writebuf_t *wb, void *param,
@@ -279,7 +279,7 @@ int scamper_file_warts_sniff_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   uint32_t off = 0;
   uint32_t i;
 
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   /* Read in the header */
   if(warts_read(sf, &buf, hdr->len) != 0)
@@ -331,12 +331,10 @@ int scamper_file_warts_sniff_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   assert(off == hdr->len);
   warts_addrtable_clean(&table);
   *sniff_out = sniff;
-  free(buf);
   return 0;
 
  err:
   warts_addrtable_clean(&table);
-  if(buf != NULL) free(buf);
   if(sniff != NULL) scamper_sniff_free(sniff);
   return -1;
 }
@@ -353,7 +351,7 @@ int scamper_file_warts_sniff_write(const scamper_file_t *sf,
   uint32_t len, i, off = 0;
   size_t size;
 
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   /* Set the sniff data (not including the packets) */
   warts_sniff_params(sniff, &table, flags, &flags_len, &params_len);
@@ -41,7 +41,6 @@ static const char rcsid[] =
 int scamper_file_text_sting_write(const scamper_file_t *sf,
 				  const scamper_sting_t *sting)
 {
-  int      fd = scamper_file_getfd(sf);
   char     buf[192], src[64], dst[64];
   size_t   len;
   uint32_t i, txc = 0;
@@ -54,7 +53,7 @@ int scamper_file_text_sting_write(const scamper_file_t *sf,
 	   sting->count, sting->mean, sting->dataackc, sting->holec);
 
   len = strlen(buf);
-  write_wrap(fd, buf, NULL, len);
+  scamper_file_write_bytes(sf, buf, len);
 
   if(sting->holec > 0)
     {
@@ -68,7 +67,7 @@ int scamper_file_text_sting_write(const scamper_file_t *sf,
 	    {
 	      snprintf(buf, sizeof(buf), "  probe %d hole\n", txc);
 	      len = strlen(buf);
-	      write_wrap(fd, buf, NULL, len);
+	      scamper_file_write_bytes(sf, buf, len);
 	    }
 	}
     }
@@ -346,7 +346,7 @@ int scamper_file_warts_sting_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   uint32_t off = 0;
   uint32_t i;
 
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   /* Read in the header */
   if(warts_read(sf, &buf, hdr->len) != 0)
@@ -398,12 +398,10 @@ int scamper_file_warts_sting_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   assert(off == hdr->len);
   warts_addrtable_clean(&table);
   *sting_out = sting;
-  free(buf);
   return 0;
 
  err:
   warts_addrtable_clean(&table);
-  if(buf != NULL) free(buf);
   if(sting != NULL) scamper_sting_free(sting);
   return -1;
 }
@@ -420,7 +418,7 @@ int scamper_file_warts_sting_write(const scamper_file_t *sf,
   uint32_t len, i, off = 0;
   size_t size;
 
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   /* Set the sting data (not including the packets) */
   warts_sting_params(sting, &table, flags, &flags_len, &params_len);
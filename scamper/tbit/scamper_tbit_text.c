@@ -52,7 +52,6 @@ int scamper_file_text_tbit_write(const scamper_file_t *sf,
   uint8_t proto, flags, iphlen, tcphlen, mf, ecn, u8, *ptr;
   size_t soff = 0, toff;
   int frag;
-  int fd = scamper_file_getfd(sf);
 
   ipid[0] = '\0';
 
@@ -271,6 +270,6 @@ int scamper_file_text_tbit_write(const scamper_file_t *sf,
       string_concat(buf, sizeof(buf), &soff, "\n");
     }
 
-  write_wrap(fd, buf, NULL, soff);
+  scamper_file_write_bytes(sf, buf, soff);
   return 0;
 }
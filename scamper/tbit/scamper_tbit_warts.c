@@ -648,7 +648,7 @@ int scamper_file_warts_tbit_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   uint32_t off = 0;
   uint32_t i;
 
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   /* Read in the header */
   if(warts_read(sf, &buf, hdr->len) != 0)
@@ -743,12 +743,10 @@ int scamper_file_warts_tbit_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   assert(off == hdr->len);
   warts_addrtable_clean(&table);
   *tbit_out = tbit;
-  free(buf);
   return 0;
 
  err:
   warts_addrtable_clean(&table);
-  if(buf != NULL) free(buf);
   if(tbit != NULL) scamper_tbit_free(tbit);
   return -1;
 }
@@ -769,7 +767,7 @@ int scamper_file_warts_tbit_write(const scamper_file_t *sf,
   uint32_t len, i, off = 0;
   size_t size;
 
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   /* Set the tbit data (not including the packets) */
   warts_tbit_params(tbit, &table, flags, &flags_len, &params_len);
@@ -253,7 +253,10 @@ int scamper_trace_hop_count(const scamper_trace_t *trace)
 {
   scamper_trace_hop_t *hop;
   int hops = 0;
-  uint8_t i;
+  uint16_t i;
+
+  if(SCAMPER_TRACE_IS_PACKED(trace))
+    return trace->hop_offs[trace->hop_count];
 
   for(i=0; i<trace->hop_count; i++)
     {
@@ -266,6 +269,92 @@ int scamper_trace_hop_count(const scamper_trace_t *trace)
   return hops;
 }
 
+/*
+ * scamper_trace_hops_pack
+ *
+ * copy the hop records into one array so that code walking the trace
+ * steps through contiguous memory rather than chasing a pointer to a
+ * separate allocation for each reply.  the copies take over the
+ * addresses and ICMP extensions of the originals, which are then freed.
+ */
+int scamper_trace_hops_pack(scamper_trace_t *trace)
+{
+  scamper_trace_hop_t *array, *hop, *hop_next;
+  uint32_t *offs, k;
+  uint16_t i;
+
+  if(SCAMPER_TRACE_IS_PACKED(trace) || trace->hops == NULL)
+    return 0;
+
+  if((offs = malloc_zero(sizeof(uint32_t) * (trace->hop_count + 1))) == NULL)
+    return -1;
+  for(i=0, k=0; i<trace->hop_count; i++)
+    {
+      offs[i] = k;
+      for(hop = trace->hops[i]; hop != NULL; hop = hop->hop_next)
+	k++;
+    }
+  offs[i] = k;
+
+  if(k == 0)
+    {
+      free(offs);
+      return 0;
+    }
+
+  if((array = malloc(sizeof(scamper_trace_hop_t) * k)) == NULL)
+    {
+      free(offs);
+      return -1;
+    }
+
+  for(i=0, k=0; i<trace->hop_count; i++)
+    {
+      for(hop = trace->hops[i]; hop != NULL; hop = hop_next)
+	{
+	  hop_next = hop->hop_next;
+	  memcpy(&array[k], hop, sizeof(scamper_trace_hop_t));
+	  array[k].hop_next = hop_next != NULL ? &array[k+1] : NULL;
+	  free(hop);
+	  k++;
+	}
+      trace->hops[i] = offs[i] != offs[i+1] ? &array[offs[i]] : NULL;
+    }
+
+  trace->hop_array = array;
+  trace->hop_offs  = offs;
+  return 0;
+}
+
+void scamper_trace_hop_iter_init(scamper_trace_hop_iter_t *it,
+				 const scamper_trace_t *trace)
+{
+  it->trace = trace;
+  it->hop   = NULL;
+  it->k     = 0;
+  it->i     = 0;
+  return;
+}
+
+scamper_trace_hop_t *scamper_trace_hop_iter_next(scamper_trace_hop_iter_t *it)
+{
+  const scamper_trace_t *trace = it->trace;
+
+  if(SCAMPER_TRACE_IS_PACKED(trace))
+    {
+      if(it->k >= trace->hop_offs[trace->hop_count])
+	return NULL;
+      return &trace->hop_array[it->k++];
+    }
+
+  if(it->hop != NULL)
+    it->hop = it->hop->hop_next;
+  while(it->hop == NULL && it->i < trace->hop_count)
+    it->hop = trace->hops[it->i++];
+
+  return it->hop;
+}
+
 int scamper_trace_hop_addr_cmp(const scamper_trace_hop_t *a,
 			       const scamper_trace_hop_t *b)
 {
@@ -504,7 +593,21 @@ void scamper_trace_free(scamper_trace_t *trace)
   if(trace == NULL) return;
 
   /* free hop records */
-  if(trace->hops != NULL)
+  if(SCAMPER_TRACE_IS_PACKED(trace))
+    {
+      for(i=0; i<trace->hop_count; i++)
+	{
+	  for(hop = trace->hops[i]; hop != NULL; hop = hop->hop_next)
+	    {
+	      scamper_icmpext_free(hop->hop_icmpext);
+	      scamper_addr_free(hop->hop_addr);
+	    }
+	}
+      free(trace->hop_array);
+      free(trace->hop_offs);
+      free(trace->hops);
+    }
+  else if(trace->hops != NULL)
     {
       for(i=0; i<trace->hop_count; i++)
 	{
@@ -50,6 +50,8 @@ struct scamper_addr;
 #define SCAMPER_TRACE_FLAG_IGNORETTLDST 0x08 /* ignore ttl exp. rx f/ dst */
 #define SCAMPER_TRACE_FLAG_DOUBLETREE   0x10 /* doubletree */
 #define SCAMPER_TRACE_FLAG_ICMPCSUMDP   0x20 /* icmp csum found in dport */
+#define SCAMPER_TRACE_FLAG_PREDICT      0x40 /* firsthop from prior traces */
+#define SCAMPER_TRACE_FLAG_RTTWAIT      0x80 /* wait from rtt estimates */
 
 #define SCAMPER_TRACE_TYPE_ICMP_ECHO       0x01 /* ICMP echo requests */
 #define SCAMPER_TRACE_TYPE_UDP             0x02 /* UDP to unused ports */
@@ -156,6 +158,12 @@ struct scamper_addr;
 #define SCAMPER_TRACE_IS_ALLATTEMPTS(trace) (			\
  (trace)->flags & SCAMPER_TRACE_FLAG_ALLATTEMPTS)
 
+#define SCAMPER_TRACE_IS_PREDICT(trace) (			\
+ (trace)->flags & SCAMPER_TRACE_FLAG_PREDICT)
+
+#define SCAMPER_TRACE_IS_RTTWAIT(trace) (			\
+ (trace)->flags & SCAMPER_TRACE_FLAG_RTTWAIT)
+
 /*
  * scamper hop flags:
  * these flags give extra meaning to fields found in the hop structure
@@ -167,6 +175,7 @@ struct scamper_addr;
 #define SCAMPER_TRACE_HOP_FLAG_TS_TSC     0x08 /* rtt computed w/ tsc clock */
 #define SCAMPER_TRACE_HOP_FLAG_REPLY_TTL  0x10 /* reply ttl included */
 #define SCAMPER_TRACE_HOP_FLAG_TCP        0x20 /* reply is TCP */
+#define SCAMPER_TRACE_HOP_FLAG_TS_MS      0x40 /* tx time to the nearest ms */
 
 /*
  * this macro is a more convenient way to check that the hop record
@@ -315,6 +324,13 @@ typedef struct scamper_trace
   scamper_trace_hop_t  **hops;
   uint16_t               hop_count;
 
+  /*
+   * if the hops have been packed, the hop records are held in one array
+   * in TTL order, and the records for hops[i] begin at hop_offs[i].
+   */
+  scamper_trace_hop_t   *hop_array;
+  uint32_t              *hop_offs;
+
   /* number of probes sent for this traceroute */
   uint16_t               probec;
 
@@ -336,6 +352,7 @@ typedef struct scamper_trace
   uint8_t                loops;
   uint8_t                loopaction;
   uint8_t                confidence;
+  uint8_t                burst;
   uint16_t               probe_size;
   uint16_t               sport;
   uint16_t               dport;
@@ -395,6 +412,32 @@ int scamper_trace_loop(const scamper_trace_t *trace, const int n,
 		       const scamper_trace_hop_t **a,
 		       const scamper_trace_hop_t **b);
 
+/*
+ * scamper_trace_hops_pack:
+ *  move the hop records into a single array, ordered by TTL and then in
+ *  the order of each TTL's list.  the hops[] lists and hop_next pointers
+ *  remain valid, but the hop records must not be freed or relinked
+ *  individually afterwards.
+ *
+ * scamper_trace_hop_iter_init, scamper_trace_hop_iter_next:
+ *  visit each hop record in the trace in TTL order.  on a packed trace
+ *  this steps through the array.
+ */
+typedef struct scamper_trace_hop_iter
+{
+  const scamper_trace_t *trace;
+  scamper_trace_hop_t   *hop;
+  uint32_t               k;
+  uint16_t               i;
+} scamper_trace_hop_iter_t;
+
+int scamper_trace_hops_pack(scamper_trace_t *trace);
+void scamper_trace_hop_iter_init(scamper_trace_hop_iter_t *iter,
+				 const scamper_trace_t *trace);
+scamper_trace_hop_t *scamper_trace_hop_iter_next(scamper_trace_hop_iter_t *it);
+
+#define SCAMPER_TRACE_IS_PACKED(trace) ((trace)->hop_array != NULL)
+
 /*
  * scamper_trace_hop_alloc:
  *  allocate a blank hop record
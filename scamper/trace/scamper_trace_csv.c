@@ -171,15 +171,10 @@ int scamper_file_csv_trace_write(const scamper_file_t *sf,
 				  const scamper_trace_t *trace) {
 
   scamper_trace_hop_t *hop;
-  int fd = scamper_file_getfd(sf);
-  size_t wc, len, off = 0;
-  off_t foff = 0;
+  size_t len, off = 0;
   char *str = NULL, *header = NULL, **hops = NULL;
   int i, j, hopc = 0, rc = -1;
 
-  if(fd != STDOUT_FILENO && (foff = lseek(fd, 0, SEEK_CUR)) == -1)
-    return -1;
-
   if((header = header_tostr()) == NULL) goto cleanup;
   len = strlen(header);
 
@@ -212,12 +207,8 @@ int scamper_file_csv_trace_write(const scamper_file_t *sf,
 
   assert(off+1 == len);
 
-  if(write_wrap(fd, str, &wc, off) != 0) {
-    if(fd != STDOUT_FILENO) {
-      if(ftruncate(fd, foff) != 0) goto cleanup;
-    }
+  if(scamper_file_write_bytes(sf, str, off) != 0)
     goto cleanup;
-  }
 
   rc = 0; /* we succeeded */
 
@@ -41,8 +41,10 @@ static const char rcsid[] =
 #include "scamper_list.h"
 #include "scamper_icmpext.h"
 #include "scamper_trace.h"
+#include "scamper_trace_lss.h"
 #include "scamper_task.h"
 #include "scamper_queue.h"
+#include "scamper_rtt.h"
 #include "scamper_icmp_resp.h"
 #include "scamper_dl.h"
 #include "scamper_fds.h"
@@ -62,6 +64,7 @@ static const char rcsid[] =
 #include "scamper_udp6.h"
 #include "scamper_if.h"
 #include "scamper_osinfo.h"
+#include "scamper_savefile.h"
 #include "mjl_splaytree.h"
 #include "mjl_list.h"
 #include "utils.h"
@@ -70,6 +73,9 @@ static const char rcsid[] =
 #define SCAMPER_DO_TRACE_ATTEMPTS_DEF  2
 #define SCAMPER_DO_TRACE_ATTEMPTS_MAX  20
 
+#define SCAMPER_DO_TRACE_BURST_MIN     1
+#define SCAMPER_DO_TRACE_BURST_MAX     255
+
 #define SCAMPER_DO_TRACE_DPORT_MIN     1
 #define SCAMPER_DO_TRACE_DPORT_DEF     (32768+666+1) /* probe_id starts at 0 */
 #define SCAMPER_DO_TRACE_DPORT_MAX     65535
@@ -125,6 +131,9 @@ static const char rcsid[] =
 #define SCAMPER_DO_TRACE_WAITPROBE_DEF 0
 #define SCAMPER_DO_TRACE_WAITPROBE_MAX 200 /* 2 seconds */
 
+/* the number of prefixes whose distance is remembered for -F */
+#define SCAMPER_DO_TRACE_TTLCACHE_MAX 65536
+
 /*
  * pmtud_L2_state
  *
@@ -172,11 +181,43 @@ typedef struct pmtud_L2
 
 typedef struct trace_lss
 {
-  char             *name;
-  splaytree_t      *tree;
-  splaytree_node_t *node;
+  char                *name;
+  char                *file;
+  scamper_trace_lss_t *set;
+  splaytree_node_t    *node;
 } trace_lss_t;
 
+/*
+ * trace_ttlcache
+ *
+ * what previous traces found about the path towards a prefix (a /24 for
+ * IPv4, a /48 for IPv6): the TTL of the furthest hop that replied.  it is
+ * used to begin a trace towards the prefix near its end.  node is the
+ * entry's position in a list ordered by when the entry was last used.
+ */
+typedef struct trace_ttlcache
+{
+  int               type;
+  uint8_t           prefix[6];
+  uint8_t           dist;
+  dlist_node_t     *node;
+} trace_ttlcache_t;
+
+/*
+ * trace_hopidx
+ *
+ * the TTLs an address has replied at in this trace.  for each TTL the
+ * first reply, in the order the hop records are kept, is recorded.  the
+ * records are kept in a hash table in the trace's state so that checking
+ * a reply for a loop does not have to compare it with every other reply.
+ */
+typedef struct trace_hopidx
+{
+  scamper_addr_t       *addr;
+  scamper_trace_hop_t **hops;
+  uint16_t              hopc;
+} trace_hopidx_t;
+
 /*
  * trace_probe
  *
@@ -186,6 +227,7 @@ typedef struct trace_probe
 {
   struct timeval  tx_tv;  /* the time we transmitted the probe */
   struct timeval  rx_tv;  /* the time we received the first answer */
+  struct timeval  to_tv;  /* the time the probe times out */
   uint16_t        rx;     /* how many responses scamper got to the probe */
   uint16_t        size;   /* the size of the probe sent */
   uint8_t         ttl;    /* the TTL that was set for the probe */
@@ -213,6 +255,20 @@ typedef struct trace_pmtud_state
   scamper_trace_pmtud_n_t *note;         /* note to fill out */
 } trace_pmtud_state_t;
 
+/*
+ * trace_burst_state
+ *
+ * these fields are used when probing a window of TTLs at once.  the
+ * window begins at the lowest TTL without an answer or a timeout, and
+ * the stop conditions are checked in TTL order as that TTL moves.
+ */
+typedef struct trace_burst_state
+{
+  uint8_t              top;           /* highest TTL worth probing */
+  uint8_t              tx[256];       /* probes sent at each TTL */
+  uint16_t             id[256];       /* last probe id sent at each TTL */
+} trace_burst_state_t;
+
 /*
  * trace_state
  *
@@ -254,6 +310,7 @@ typedef struct trace_state
   uint16_t             interfacec;    /* count of interfaces */
 
   trace_pmtud_state_t *pmtud;         /* pmtud state */
+  trace_burst_state_t *burst;         /* state when probing TTLs at once */
 
   /*
    * these fields are used for doubletree.
@@ -266,6 +323,11 @@ typedef struct trace_state
   scamper_addr_t     **lss;
   int                  lssc;
   trace_lss_t         *lsst;
+
+  /* index of the TTLs each address replied at, used to detect loops */
+  trace_hopidx_t      *hopidx;
+  int                  hopidxc;       /* count of addresses in the index */
+  int                  hopidxm;       /* size of the hash table */
 } trace_state_t;
 
 static const uint8_t MODE_RTSOCK           = 0;
@@ -286,6 +348,9 @@ static const uint8_t MODE_DTREE_BACK       = 10;
 /* the callback functions registered with the trace task */
 static scamper_task_funcs_t trace_funcs;
 
+/* replies to probes sent when probing a window of TTLs */
+static void trace_burst_hop(scamper_task_t *task, scamper_trace_hop_t *hop);
+
 /* address cache used to avoid reallocating the same address multiple times */
 extern scamper_addrcache_t *addrcache;
 
@@ -296,6 +361,16 @@ static size_t   pktbuf_len = 0;
 /* local stop sets */
 static splaytree_t *lsses = NULL;
 
+/*
+ * path lengths to prefixes, and near hops seen, for traces with -F.  if
+ * scamper was told of a directory to keep stop sets in, both are loaded
+ * from files there the first time they are used, and saved when scamper
+ * exits.
+ */
+static splaytree_t *ttlcache = NULL;
+static dlist_t     *ttlcache_lru = NULL;
+static trace_lss_t *nearhops = NULL;
+
 /* is this running on sunos */
 static int sunos = 0;
 
@@ -364,11 +439,17 @@ static const int         L2_cnt  = sizeof(L2) / sizeof(pmtud_L2_t);
 #define TRACE_OPT_GSSENTRY    21
 #define TRACE_OPT_LSSNAME     22
 #define TRACE_OPT_OFFSET      23
+#define TRACE_OPT_BURST       24
+#define TRACE_OPT_PREDICT     25
+#define TRACE_OPT_RTTWAIT     26
 
 static const scamper_option_in_t opts[] = {
+  {'A', NULL, TRACE_OPT_RTTWAIT,     SCAMPER_OPTION_TYPE_NULL},
+  {'b', NULL, TRACE_OPT_BURST,       SCAMPER_OPTION_TYPE_NUM},
   {'c', NULL, TRACE_OPT_CONFIDENCE,  SCAMPER_OPTION_TYPE_NUM},
   {'d', NULL, TRACE_OPT_DPORT,       SCAMPER_OPTION_TYPE_STR},
   {'f', NULL, TRACE_OPT_FIRSTHOP,    SCAMPER_OPTION_TYPE_NUM},
+  {'F', NULL, TRACE_OPT_PREDICT,     SCAMPER_OPTION_TYPE_NULL},
   {'g', NULL, TRACE_OPT_GAPLIMIT,    SCAMPER_OPTION_TYPE_NUM},
   {'G', NULL, TRACE_OPT_GAPACTION,   SCAMPER_OPTION_TYPE_NUM},
   {'l', NULL, TRACE_OPT_LOOPS,       SCAMPER_OPTION_TYPE_NUM},
@@ -394,7 +475,7 @@ static const int opts_cnt = SCAMPER_OPTION_COUNT(opts);
 
 const char *scamper_do_trace_usage(void)
 {
-  return "trace [-MQT] [-c confidence] [-d dport] [-f firsthop]\n"
+  return "trace [-AFMQT] [-b burst] [-c confidence] [-d dport] [-f firsthop]\n"
          "      [-g gaplimit] [-G gapaction] [-l loops] [-L loopaction]\n"
          "      [-m maxttl] [-o offset] [-p payload] [-P method]\n"
          "      [-q attempts] [-s sport] [-S srcaddr] [-t tos] [-U userid]\n"
@@ -486,10 +567,16 @@ static void trace_lss_free(trace_lss_t *lss)
   if(lss == NULL)
     return;
 
+  if(lss->set != NULL)
+    {
+      if(lss->file != NULL)
+	scamper_trace_lss_save(lss->set, lss->file);
+      scamper_trace_lss_free(lss->set);
+    }
+  if(lss->file != NULL)
+    free(lss->file);
   if(lss->name != NULL)
     free(lss->name);
-  if(lss->tree != NULL)
-    splaytree_free(lss->tree, (splaytree_free_t)scamper_addr_free);
 
   free(lss);
   return;
@@ -502,9 +589,26 @@ static int trace_lss_cmp(const void *va, const void *vb)
   return strcasecmp(a->name, b->name);
 }
 
+static size_t trace_lss_size(void)
+{
+  size_t size = scamper_option_lssmem();
+  if(size == 0)
+    size = SCAMPER_TRACE_LSS_SIZE_DEF;
+  return size;
+}
+
+/*
+ * trace_lss_get
+ *
+ * find the named local stop set.  if scamper was told of a directory to
+ * keep stop sets in, the set is loaded from a file there the first time
+ * it is used, and saved back to it when scamper exits.
+ */
 static trace_lss_t *trace_lss_get(char *name)
 {
   trace_lss_t findme, *lss;
+  const char *dir;
+  size_t len;
 
   /* allocate a local stop set tree if necessary */
   if(lsses == NULL &&
@@ -519,15 +623,325 @@ static trace_lss_t *trace_lss_get(char *name)
     return lss;
 
   if((lss = malloc_zero(sizeof(trace_lss_t))) == NULL ||
-     (lss->name = strdup(name)) == NULL ||
-     (lss->tree = splaytree_alloc((splaytree_cmp_t)scamper_addr_cmp))==NULL ||
-     (lss->node = splaytree_insert(lsses, lss)) == NULL)
+     (lss->name = strdup(name)) == NULL)
+    goto err;
+
+  if((dir = scamper_option_lssdir()) != NULL)
     {
-      trace_lss_free(lss);
-      return NULL;
+      /* the name has to be usable as a filename */
+      if(name[0] == '\0' || name[0] == '.' || strchr(name, '/') != NULL)
+	{
+	  printerror(0, NULL, __func__, "invalid lss name %s", name);
+	  goto err;
+	}
+      len = strlen(dir) + strlen(name) + 6;
+      if((lss->file = malloc(len)) == NULL)
+	goto err;
+      snprintf(lss->file, len, "%s/%s.lss", dir, name);
+      lss->set = scamper_trace_lss_load(lss->file, trace_lss_size());
     }
+  else lss->set = scamper_trace_lss_alloc(trace_lss_size());
+
+  if(lss->set == NULL || (lss->node = splaytree_insert(lsses, lss)) == NULL)
+    goto err;
 
   return lss;
+
+ err:
+  trace_lss_free(lss);
+  return NULL;
+}
+
+static int trace_ttlcache_cmp(const trace_ttlcache_t *a,
+			      const trace_ttlcache_t *b)
+{
+  if(a->type < b->type) return -1;
+  if(a->type > b->type) return  1;
+  return memcmp(a->prefix, b->prefix, sizeof(a->prefix));
+}
+
+static void trace_ttlcache_key(trace_ttlcache_t *tc, const scamper_addr_t *a)
+{
+  memset(tc, 0, sizeof(trace_ttlcache_t));
+  tc->type = a->type;
+  if(a->type == SCAMPER_ADDR_TYPE_IPV4)
+    memcpy(tc->prefix, a->addr, 3);
+  else
+    memcpy(tc->prefix, a->addr, 6);
+  return;
+}
+
+/*
+ * trace_ttlcache_dist
+ *
+ * return the distance recorded for the destination's prefix, or zero if
+ * nothing has been recorded.
+ */
+static uint8_t trace_ttlcache_dist(const scamper_addr_t *dst)
+{
+  trace_ttlcache_t findme, *tc;
+
+  if(ttlcache == NULL)
+    return 0;
+  trace_ttlcache_key(&findme, dst);
+  if((tc = splaytree_find(ttlcache, &findme)) == NULL)
+    return 0;
+  dlist_node_eject(ttlcache_lru, tc->node);
+  dlist_node_head_push(ttlcache_lru, tc->node);
+  return tc->dist;
+}
+
+/*
+ * trace_ttlcache_add
+ *
+ * add an entry for a prefix to the end of the list, forgetting the entry
+ * used least recently if the cache is full.
+ */
+static trace_ttlcache_t *trace_ttlcache_add(const trace_ttlcache_t *key)
+{
+  trace_ttlcache_t *tc;
+
+  if(ttlcache == NULL &&
+     (ttlcache = splaytree_alloc((splaytree_cmp_t)trace_ttlcache_cmp)) == NULL)
+    return NULL;
+  if(ttlcache_lru == NULL && (ttlcache_lru = dlist_alloc()) == NULL)
+    return NULL;
+
+  if(splaytree_count(ttlcache) >= SCAMPER_DO_TRACE_TTLCACHE_MAX &&
+     (tc = dlist_tail_pop(ttlcache_lru)) != NULL)
+    {
+      splaytree_remove_item(ttlcache, tc);
+      free(tc);
+    }
+
+  if((tc = memdup(key, sizeof(trace_ttlcache_t))) == NULL)
+    return NULL;
+  if((tc->node = dlist_tail_push(ttlcache_lru, tc)) == NULL)
+    {
+      free(tc);
+      return NULL;
+    }
+  if(splaytree_insert(ttlcache, tc) == NULL)
+    {
+      dlist_node_pop(ttlcache_lru, tc->node);
+      free(tc);
+      return NULL;
+    }
+
+  return tc;
+}
+
+/*
+ * trace_ttlcache_file
+ *
+ * the names of the files that hold the cache and the near hops.  they
+ * begin with a dot, which the name of a local stop set cannot.
+ */
+static char *trace_ttlcache_file(const char *name)
+{
+  const char *dir;
+  char *file;
+  size_t len;
+
+  if((dir = scamper_option_lssdir()) == NULL)
+    return NULL;
+  len = strlen(dir) + strlen(name) + 2;
+  if((file = malloc(len)) == NULL)
+    return NULL;
+  snprintf(file, len, "%s/%s", dir, name);
+  return file;
+}
+
+/*
+ * trace_ttlcache_load
+ *
+ * load the cache saved by trace_ttlcache_save.  the file begins with an
+ * eight byte header: the characters TTLC and a count of entries.  each
+ * entry is eight bytes: the address type, the prefix, and the distance.
+ * the entries are listed from the most to the least recently used.
+ */
+static void trace_ttlcache_load(void)
+{
+  trace_ttlcache_t key;
+  uint8_t hdr[8], *buf = NULL;
+  uint32_t i, count;
+  char *file;
+  int fd = -1;
+
+  if((file = trace_ttlcache_file(".ttlcache")) == NULL)
+    return;
+  if((fd = scamper_savefile_open_file(file, O_RDONLY, 0)) == -1)
+    goto done;
+
+  if(read_wrap(fd, hdr, NULL, 8) != 0 || memcmp(hdr, "TTLC", 4) != 0)
+    {
+      printerror(0, NULL, __func__, "ignoring %s: not a saved cache", file);
+      goto done;
+    }
+  if((count = bytes_ntohl(hdr+4)) > SCAMPER_DO_TRACE_TTLCACHE_MAX)
+    count = SCAMPER_DO_TRACE_TTLCACHE_MAX;
+  if(count == 0 || (buf = malloc(count * 8)) == NULL ||
+     read_wrap(fd, buf, NULL, count * 8) != 0)
+    goto done;
+
+  memset(&key, 0, sizeof(key));
+  for(i=0; i<count; i++)
+    {
+      key.type = buf[i*8];
+      memcpy(key.prefix, buf+(i*8)+1, 6);
+      key.dist = buf[(i*8)+7];
+      if((key.type != SCAMPER_ADDR_TYPE_IPV4 &&
+	  key.type != SCAMPER_ADDR_TYPE_IPV6) || key.dist == 0 ||
+	 (ttlcache != NULL && splaytree_find(ttlcache, &key) != NULL))
+	continue;
+      if(trace_ttlcache_add(&key) == NULL)
+	break;
+    }
+
+ done:
+  if(buf != NULL) free(buf);
+  if(fd != -1) close(fd);
+  free(file);
+  return;
+}
+
+/*
+ * trace_ttlcache_save
+ *
+ * replace the saved cache with the entries held.
+ */
+static void trace_ttlcache_save(void)
+{
+  scamper_savefile_t *sf = NULL;
+  trace_ttlcache_t *tc;
+  dlist_node_t *dn;
+  uint8_t *buf = NULL;
+  uint32_t count;
+  size_t off = 8;
+  char *file;
+
+  if(ttlcache_lru == NULL || (file = trace_ttlcache_file(".ttlcache")) == NULL)
+    return;
+
+  count = dlist_count(ttlcache_lru);
+  if((buf = malloc(8 + (count * 8))) == NULL)
+    goto done;
+  memcpy(buf, "TTLC", 4);
+  bytes_htonl(buf+4, count);
+  for(dn=dlist_head_node(ttlcache_lru); dn != NULL; dn=dlist_node_next(dn))
+    {
+      tc = dlist_node_item(dn);
+      buf[off] = tc->type;
+      memcpy(buf+off+1, tc->prefix, 6);
+      buf[off+7] = tc->dist;
+      off += 8;
+    }
+
+  if((sf = scamper_savefile_open(file)) == NULL)
+    goto done;
+  if(write_wrap(scamper_savefile_fd(sf), buf, NULL, off) != 0)
+    {
+      printerror(errno, strerror, __func__, "could not write %s", file);
+      scamper_savefile_abort(sf);
+      goto done;
+    }
+  if(scamper_savefile_commit(sf) != 0)
+    printerror(errno, strerror, __func__, "could not save %s", file);
+
+ done:
+  if(buf != NULL) free(buf);
+  free(file);
+  return;
+}
+
+/*
+ * trace_ttlcache_update
+ *
+ * a trace using the cache has finished.  record how far away the
+ * destination's prefix is, and add the interfaces the trace found to the
+ * set of near hops that halt backwards probing.
+ */
+static void trace_ttlcache_update(const scamper_trace_t *trace)
+{
+  trace_ttlcache_t findme, *tc;
+  scamper_trace_hop_t *hop;
+  uint8_t dist = 0;
+  uint16_t i;
+
+  if(trace->stop_reason == SCAMPER_TRACE_STOP_NONE ||
+     trace->stop_reason == SCAMPER_TRACE_STOP_HALTED ||
+     trace->stop_reason == SCAMPER_TRACE_STOP_ERROR ||
+     trace->stop_reason == SCAMPER_TRACE_STOP_GSS)
+    return;
+
+  for(i=0; i<trace->hop_count; i++)
+    {
+      for(hop = trace->hops[i]; hop != NULL; hop = hop->hop_next)
+	{
+	  dist = i + 1;
+	  if(nearhops != NULL &&
+	     scamper_addr_cmp(hop->hop_addr, trace->dst) != 0)
+	    scamper_trace_lss_add(nearhops->set, hop->hop_addr);
+	}
+    }
+
+  if(dist == 0)
+    return;
+
+  trace_ttlcache_key(&findme, trace->dst);
+  if((ttlcache == NULL || (tc = splaytree_find(ttlcache, &findme)) == NULL) &&
+     (tc = trace_ttlcache_add(&findme)) == NULL)
+    return;
+  dlist_node_eject(ttlcache_lru, tc->node);
+  dlist_node_head_push(ttlcache_lru, tc->node);
+  tc->dist = dist;
+  return;
+}
+
+/*
+ * trace_predict
+ *
+ * begin a trace two hops short of where the last trace to the prefix
+ * ended, so that doubletree probes forwards to the destination and
+ * backwards only until it reaches a near hop already seen.
+ */
+static int trace_predict(scamper_trace_t *trace)
+{
+  uint8_t dist, firsthop;
+
+  if(nearhops == NULL)
+    {
+      if((nearhops = malloc_zero(sizeof(trace_lss_t))) == NULL)
+	{
+	  printerror(errno, strerror, __func__, "could not alloc nearhops");
+	  return -1;
+	}
+      if((nearhops->file = trace_ttlcache_file(".nearhops.lss")) != NULL)
+	nearhops->set = scamper_trace_lss_load(nearhops->file,
+					       trace_lss_size());
+      else
+	nearhops->set = scamper_trace_lss_alloc(trace_lss_size());
+      if(nearhops->set == NULL)
+	{
+	  printerror(errno, strerror, __func__, "could not alloc nearhops");
+	  trace_lss_free(nearhops);
+	  nearhops = NULL;
+	  return -1;
+	}
+      trace_ttlcache_load();
+    }
+  if((dist = trace_ttlcache_dist(trace->dst)) <= 3)
+    return 0;
+  firsthop = dist - 2;
+  if(trace->hoplimit != 0 && firsthop > trace->hoplimit)
+    firsthop = trace->hoplimit;
+  if(firsthop <= trace->firsthop)
+    return 0;
+
+  trace->firsthop = firsthop;
+  trace->hop_count = firsthop - 1;
+  trace->dtree->firsthop = firsthop;
+  return 0;
 }
 
 /*
@@ -909,23 +1323,17 @@ static int pmtud_L2_search_end(scamper_task_t *task)
   return 0;
 }
 
-static int dtree_lss_add(trace_state_t *state, scamper_addr_t *iface)
+static void dtree_lss_add(trace_state_t *state, scamper_addr_t *iface)
 {
   assert(state != NULL && state->lsst != NULL);
-  if(splaytree_insert(state->lsst->tree, iface) != NULL)
-    {
-      scamper_addr_use(iface);
-      return 0;
-    }
-  return -1;
+  scamper_trace_lss_add(state->lsst->set, iface);
+  return;
 }
 
 static int dtree_lss_in(trace_state_t *state, scamper_addr_t *iface)
 {
   assert(state != NULL && state->lsst != NULL);
-  if(splaytree_find(state->lsst->tree, iface) != NULL)
-    return 1;
-  return 0;
+  return scamper_trace_lss_in(state->lsst->set, iface);
 }
 
 static int state_lss_in(trace_state_t *state, scamper_addr_t *iface)
@@ -1043,6 +1451,142 @@ static void trace_stop_hoplimit(scamper_trace_t *trace)
   return;
 }
 
+/*
+ * trace_hopidx_slot
+ *
+ * return the slot in the hash table holding the address, or the empty
+ * slot where it would go.  the table is never full.
+ */
+static trace_hopidx_t *trace_hopidx_slot(trace_hopidx_t *idx, int m,
+					 const scamper_addr_t *addr)
+{
+  const uint8_t *a = addr->addr;
+  uint32_t h = 2166136261U;
+  size_t i, len = scamper_addr_size(addr);
+
+  h = (h ^ (uint8_t)addr->type) * 16777619U;
+  for(i=0; i<len; i++)
+    h = (h ^ a[i]) * 16777619U;
+
+  for(i = h & (m-1); idx[i].addr != NULL; i = (i+1) & (m-1))
+    if(scamper_addr_cmp(idx[i].addr, addr) == 0)
+      break;
+
+  return &idx[i];
+}
+
+static trace_hopidx_t *trace_hopidx_find(const trace_state_t *state,
+					 const scamper_addr_t *addr)
+{
+  trace_hopidx_t *hi;
+
+  if(state->hopidxm == 0)
+    return NULL;
+  hi = trace_hopidx_slot(state->hopidx, state->hopidxm, addr);
+  if(hi->addr == NULL)
+    return NULL;
+  return hi;
+}
+
+/*
+ * trace_hopidx_add
+ *
+ * record that the address in the hop record replied at its TTL.  the
+ * table is doubled in size whenever it becomes half full.
+ */
+static int trace_hopidx_add(trace_state_t *state, scamper_trace_hop_t *hop)
+{
+  trace_hopidx_t *idx, *hi;
+  size_t len;
+  int i, m;
+
+  if((state->hopidxc + 1) * 2 > state->hopidxm)
+    {
+      m = state->hopidxm == 0 ? 64 : state->hopidxm * 2;
+      if((idx = malloc_zero(sizeof(trace_hopidx_t) * m)) == NULL)
+	{
+	  printerror(errno, strerror, __func__, "could not malloc hopidx");
+	  return -1;
+	}
+      for(i=0; i<state->hopidxm; i++)
+	{
+	  if(state->hopidx[i].addr == NULL)
+	    continue;
+	  hi = trace_hopidx_slot(idx, m, state->hopidx[i].addr);
+	  memcpy(hi, &state->hopidx[i], sizeof(trace_hopidx_t));
+	}
+      if(state->hopidx != NULL)
+	free(state->hopidx);
+      state->hopidx = idx;
+      state->hopidxm = m;
+    }
+
+  hi = trace_hopidx_slot(state->hopidx, state->hopidxm, hop->hop_addr);
+  if(hi->addr == NULL)
+    {
+      hi->addr = scamper_addr_use(hop->hop_addr);
+      state->hopidxc++;
+    }
+
+  /* keep the reply to the lowest attempt at the TTL */
+  for(i=0; i<hi->hopc; i++)
+    {
+      if(hi->hops[i]->hop_probe_ttl != hop->hop_probe_ttl)
+	continue;
+      if(hop->hop_probe_id < hi->hops[i]->hop_probe_id)
+	hi->hops[i] = hop;
+      return 0;
+    }
+
+  len = sizeof(scamper_trace_hop_t *) * (hi->hopc + 1);
+  if(realloc_wrap((void **)&hi->hops, len) != 0)
+    {
+      printerror(errno, strerror, __func__, "could not realloc hops");
+      return -1;
+    }
+  hi->hops[hi->hopc++] = hop;
+  return 0;
+}
+
+/*
+ * trace_hopidx_trim
+ *
+ * the hop records beyond the given TTL are about to be freed; remove
+ * them from the index.
+ */
+static void trace_hopidx_trim(trace_state_t *state, uint16_t ttl)
+{
+  trace_hopidx_t *hi;
+  int i, j, k;
+
+  for(i=0; i<state->hopidxm; i++)
+    {
+      hi = &state->hopidx[i];
+      for(j=0, k=0; j<hi->hopc; j++)
+	if(hi->hops[j]->hop_probe_ttl <= ttl)
+	  hi->hops[k++] = hi->hops[j];
+      hi->hopc = k;
+    }
+
+  return;
+}
+
+static void trace_hopidx_free(trace_state_t *state)
+{
+  int i;
+
+  for(i=0; i<state->hopidxm; i++)
+    {
+      if(state->hopidx[i].addr != NULL)
+	scamper_addr_free(state->hopidx[i].addr);
+      if(state->hopidx[i].hops != NULL)
+	free(state->hopidx[i].hops);
+    }
+  free(state->hopidx);
+  state->hopidx = NULL;
+  return;
+}
+
 /*
  * trace_isloop
  *
@@ -1052,7 +1596,8 @@ static int trace_isloop(const scamper_trace_t *trace,
 			const scamper_trace_hop_t *hop,
 			trace_state_t *state)
 {
-  scamper_trace_hop_t *tmp;
+  scamper_trace_hop_t *tmp = NULL, *x;
+  trace_hopidx_t *hi;
   int i;
 
   /* need at least a couple of probes first */
@@ -1061,63 +1606,68 @@ static int trace_isloop(const scamper_trace_t *trace,
       return 0;
     }
 
-  /*
-   * check to see if the address has already been seen this hop; if it is,
-   * then we've already checked this address for loops so we don't need to
-   * check it again.
-   */
-  for(tmp = trace->hops[hop->hop_probe_ttl-1]; tmp != hop; tmp = tmp->hop_next)
+  if((hi = trace_hopidx_find(state, hop->hop_addr)) == NULL)
+    {
+      return 0;
+    }
+
+  for(i=0; i<hi->hopc; i++)
     {
-      if(scamper_addr_cmp(hop->hop_addr, tmp->hop_addr) == 0)
+      x = hi->hops[i];
+
+      /*
+       * check to see if the address has already been seen this hop; if it
+       * is, then we've already checked this address for loops so we don't
+       * need to check it again.
+       */
+      if(x->hop_probe_ttl == hop->hop_probe_ttl)
 	{
-	  return 0;
+	  if(x != hop)
+	    return 0;
+	  continue;
 	}
+
+      /* find the closest hop prior to this one with the same address */
+      if(x->hop_probe_ttl < hop->hop_probe_ttl &&
+	 x->hop_probe_ttl >= trace->firsthop &&
+	 (tmp == NULL || x->hop_probe_ttl > tmp->hop_probe_ttl))
+	tmp = x;
     }
 
-  /* compare all hop records until the hop prior to this one */
-  for(i=hop->hop_probe_ttl-2; i>=trace->firsthop-1; i--)
+  /* the address has not been seen before, so there is no loop */
+  if(tmp == NULL)
     {
-      for(tmp = trace->hops[i]; tmp != NULL; tmp = tmp->hop_next)
-	{
-	  assert(i+1 == tmp->hop_probe_ttl);
+      return 0;
+    }
 
-	  /* if the addresses match, then there is a loop */
-	  if(scamper_addr_cmp(hop->hop_addr, tmp->hop_addr) == 0)
-	    {
-	      /*
-	       * if the loop is between adjacent hops
-	       */
-	      if(tmp->hop_probe_ttl + 1 == hop->hop_probe_ttl)
-		{
-		  /*
-		   * check for zero-ttl forwarding.  continue probing if
-		   * the condition is met.
-		   */
-		  if(tmp->hop_icmp_q_ttl == 0 && hop->hop_icmp_q_ttl == 1)
-		    return 0;
-
-		  /*
-		   * check the loopaction parameter for what we should do
-		   *
-		   * the loopaction parameter has values 0 .. 255; currently
-		   * the loopaction parameter counts the number of loops
-		   * between adjacent hops to ignore.
-		   */
-		  if(++state->iloopc <= trace->loopaction)
-		    return 0;
-		}
+  /*
+   * if the loop is between adjacent hops
+   */
+  if(tmp->hop_probe_ttl + 1 == hop->hop_probe_ttl)
+    {
+      /*
+       * check for zero-ttl forwarding.  continue probing if
+       * the condition is met.
+       */
+      if(tmp->hop_icmp_q_ttl == 0 && hop->hop_icmp_q_ttl == 1)
+	return 0;
 
-	      /* check if the loop condition is met */
-	      state->loopc++;
-	      if(state->loopc >= trace->loops)
-		{
-		  return 1;
-		}
+      /*
+       * check the loopaction parameter for what we should do
+       *
+       * the loopaction parameter has values 0 .. 255; currently
+       * the loopaction parameter counts the number of loops
+       * between adjacent hops to ignore.
+       */
+      if(++state->iloopc <= trace->loopaction)
+	return 0;
+    }
 
-	      /* count the loop just once for this hop */
-	      break;
-	    }
-	}
+  /* check if the loop condition is met */
+  state->loopc++;
+  if(state->loopc >= trace->loops)
+    {
+      return 1;
     }
 
   return 0;
@@ -1166,6 +1716,18 @@ static void trace_hopins(scamper_trace_hop_t **hops, scamper_trace_hop_t *hop)
   return;
 }
 
+/*
+ * trace_hopadd
+ *
+ * insert the hop record into the trace at its TTL, and index it.
+ */
+static int trace_hopadd(scamper_trace_t *trace, trace_state_t *state,
+			scamper_trace_hop_t *hop)
+{
+  trace_hopins(&trace->hops[hop->hop_probe_ttl-1], hop);
+  return trace_hopidx_add(state, hop);
+}
+
 /*
  * trace_handlerror
  *
@@ -1179,6 +1741,22 @@ static int trace_handleerror(scamper_task_t *task, const int error)
   return 0;
 }
 
+/*
+ * trace_rtt_sample
+ *
+ * the first reply to a probe is a sample of the RTT to that hop, and to
+ * the destination if it sent the reply.
+ */
+static void trace_rtt_sample(const scamper_trace_t *trace,
+			     const trace_probe_t *probe,
+			     const scamper_trace_hop_t *hop)
+{
+  scamper_rtt_sample(trace->dst, probe->ttl, &hop->hop_rtt);
+  if(scamper_addr_cmp(hop->hop_addr, trace->dst) == 0)
+    scamper_rtt_sample(trace->dst, SCAMPER_RTT_DST, &hop->hop_rtt);
+  return;
+}
+
 /*
  * trace_hop
  *
@@ -1281,6 +1859,9 @@ static scamper_trace_hop_t *trace_icmp_hop(scamper_trace_t *trace,
 	}
     }
 
+  if(probe->rx == 0)
+    trace_rtt_sample(trace, probe, hop);
+
   if(SCAMPER_ICMP_RESP_IS_PACKET_TOO_BIG(ir))
     hop->hop_icmp_nhmtu = ir->ir_icmp_nhmtu;
 
@@ -1321,7 +1902,8 @@ static scamper_trace_hop_t *trace_icmp_hop(scamper_trace_t *trace,
   return NULL;
 }
 
-static scamper_trace_hop_t *trace_tcp_hop(trace_probe_t *probe,
+static scamper_trace_hop_t *trace_tcp_hop(const scamper_trace_t *trace,
+					  trace_probe_t *probe,
 					  scamper_dl_rec_t *dl)
 {
   scamper_trace_hop_t *hop = NULL;
@@ -1335,6 +1917,8 @@ static scamper_trace_hop_t *trace_tcp_hop(trace_probe_t *probe,
   hop->hop_reply_ttl = dl->dl_ip_ttl;
   hop->hop_tcp_flags = dl->dl_tcp_flags;
   timeval_diff_tv(&hop->hop_rtt, &probe->tx_tv, &dl->dl_tv);
+  if(probe->rx == 0)
+    trace_rtt_sample(trace, probe, hop);
 
   /* set the flags that are known to apply to this hop record */
   hop->hop_flags |= (SCAMPER_TRACE_HOP_FLAG_REPLY_TTL |
@@ -1545,7 +2129,16 @@ static int handleicmp_trace(scamper_task_t *task,
     {
       return -1;
     }
-  trace_hopins(&trace->hops[hop->hop_probe_ttl-1], hop);
+  if(trace_hopadd(trace, state, hop) != 0)
+    {
+      return -1;
+    }
+
+  if(state->burst != NULL)
+    {
+      trace_burst_hop(task, hop);
+      return 0;
+    }
 
   /*
    * if the response is not for the current working hop (i.e. a late reply)
@@ -1802,7 +2395,10 @@ static int handleicmp_dtree_first(scamper_task_t *task,scamper_icmp_resp_t *ir,
     {
       return -1;
     }
-  trace_hopins(&trace->hops[hop->hop_probe_ttl-1], hop);
+  if(trace_hopadd(trace, state, hop) != 0)
+    {
+      return -1;
+    }
 
   /* this many hops */
   trace->hop_count = hop->hop_probe_ttl;
@@ -1861,6 +2457,7 @@ static int handleicmp_lastditch(scamper_task_t *task,
 				trace_probe_t *probe)
 {
   scamper_trace_t *trace = trace_getdata(task);
+  trace_state_t *state = trace_getstate(task);
   scamper_trace_hop_t *hop;
 
   if(probe->mode == MODE_TRACE)
@@ -1870,7 +2467,8 @@ static int handleicmp_lastditch(scamper_task_t *task,
 	{
 	  return -1;
 	}
-      trace_hopins(&trace->hops[hop->hop_probe_ttl-1], hop);
+      if(trace_hopadd(trace, state, hop) != 0)
+	return -1;
     }
   else if(probe->mode == MODE_LASTDITCH)
     {
@@ -2455,6 +3053,286 @@ static void timeout_trace(scamper_task_t *task)
   return;
 }
 
+/*
+ * trace_burst_end
+ *
+ * the trace has stopped, or has gone into another mode.  discard the
+ * replies to probes sent beyond the hop the trace stopped at, as a trace
+ * that probed one TTL at a time would not have sent them.
+ */
+static void trace_burst_end(scamper_trace_t *trace, trace_state_t *state)
+{
+  scamper_trace_hop_t *hop;
+  int i;
+
+  trace_hopidx_trim(state, trace->hop_count);
+  for(i=trace->hop_count; i<state->alloc_hops; i++)
+    {
+      while((hop = trace->hops[i]) != NULL)
+	{
+	  trace->hops[i] = hop->hop_next;
+	  scamper_trace_hop_free(hop);
+	}
+    }
+
+  free(state->burst);
+  state->burst = NULL;
+  return;
+}
+
+/*
+ * trace_burst_isend
+ *
+ * return non-zero if the hop record says the path ends at this TTL, so
+ * that there is no point probing beyond it.
+ */
+static int trace_burst_isend(const scamper_trace_t *trace,
+			     const scamper_trace_hop_t *hop)
+{
+  if(SCAMPER_TRACE_HOP_IS_TCP(hop))
+    return 1;
+  if(SCAMPER_TRACE_HOP_IS_ICMP_TTL_EXP(hop))
+    return SCAMPER_TRACE_IS_IGNORETTLDST(trace) == 0 &&
+      scamper_addr_cmp(trace->dst, hop->hop_addr) == 0;
+  if(SCAMPER_TRACE_HOP_IS_ICMP_ECHO_REPLY(hop))
+    return SCAMPER_TRACE_TYPE_IS_ICMP(trace);
+  return 1;
+}
+
+/*
+ * trace_burst_top
+ *
+ * the highest TTL that the window currently covers.
+ */
+static int trace_burst_top(const scamper_trace_t *trace,
+			   const trace_state_t *state)
+{
+  int top = state->ttl + trace->burst - 1;
+  if(top > state->burst->top)
+    top = state->burst->top;
+  return top;
+}
+
+/*
+ * trace_burst_ttl
+ *
+ * return the TTL to send the next probe with, or zero if each TTL in the
+ * window has a reply, or is waiting for one.
+ */
+static uint8_t trace_burst_ttl(const scamper_trace_t *trace,
+			       trace_state_t *state)
+{
+  trace_burst_state_t *burst = state->burst;
+  trace_probe_t *probe;
+  int ttl, top;
+
+  /* a reply thought to be from the end of the path was not */
+  if(state->ttl > burst->top)
+    burst->top = trace->hoplimit != 0 ? trace->hoplimit : 255;
+
+  top = trace_burst_top(trace, state);
+  for(ttl = state->ttl; ttl <= top; ttl++)
+    {
+      if(trace->hops[ttl-1] != NULL || burst->tx[ttl] >= trace->attempts)
+	continue;
+      if(burst->tx[ttl] != 0)
+	{
+	  probe = state->probes[burst->id[ttl]];
+	  if((probe->flags & TRACE_PROBE_FLAG_TIMEOUT) == 0)
+	    continue;
+	}
+      return ttl;
+    }
+
+  return 0;
+}
+
+/*
+ * trace_burst_wait
+ *
+ * find when the oldest probe without a reply will time out.
+ */
+static int trace_burst_wait(const scamper_trace_t *trace,
+			    const trace_state_t *state, struct timeval *tv)
+{
+  trace_burst_state_t *burst = state->burst;
+  trace_probe_t *probe;
+  int ttl, top, rc = -1;
+
+  top = trace_burst_top(trace, state);
+  for(ttl = state->ttl; ttl <= top; ttl++)
+    {
+      if(trace->hops[ttl-1] != NULL || burst->tx[ttl] == 0)
+	continue;
+      probe = state->probes[burst->id[ttl]];
+      if(probe->flags & TRACE_PROBE_FLAG_TIMEOUT)
+	continue;
+      if(rc != 0 || timeval_cmp(&probe->to_tv, tv) < 0)
+	{
+	  timeval_cpy(tv, &probe->to_tv);
+	  rc = 0;
+	}
+    }
+
+  return rc;
+}
+
+/*
+ * trace_burst_next
+ *
+ * send another probe if there is a TTL in the window to send it to,
+ * otherwise wait for the oldest outstanding probe to time out.
+ */
+static void trace_burst_next(scamper_task_t *task)
+{
+  scamper_trace_t *trace = trace_getdata(task);
+  trace_state_t *state = trace_getstate(task);
+  struct timeval tv;
+
+  if(trace_burst_ttl(trace, state) != 0)
+    trace_queue(task);
+  else if(trace_burst_wait(trace, state, &tv) == 0)
+    scamper_task_queue_wait_tv(task, &tv);
+  else
+    scamper_task_queue_wait(task, trace->wait * 1000);
+  return;
+}
+
+/*
+ * trace_burst_advance
+ *
+ * move the window past each TTL, starting at the lowest, that has a
+ * reply or has run out of attempts.  the stop conditions are checked
+ * for each TTL in turn, just as when probing one TTL at a time.
+ */
+static void trace_burst_advance(scamper_task_t *task)
+{
+  scamper_trace_t *trace = trace_getdata(task);
+  trace_state_t *state = trace_getstate(task);
+  trace_burst_state_t *burst = state->burst;
+  scamper_trace_hop_t *hop;
+  trace_probe_t *probe;
+  uint8_t stop_reason, stop_data;
+
+  for(;;)
+    {
+      if((hop = trace->hops[state->ttl-1]) != NULL)
+	{
+	  trace->hop_count++;
+	  state->ttl++;
+
+	  while(hop != NULL)
+	    {
+	      trace_stop_reason(trace, hop, state, &stop_reason, &stop_data);
+	      if(stop_reason != SCAMPER_TRACE_STOP_NONE)
+		{
+		  trace_stop(trace, stop_reason, stop_data);
+		  trace_burst_end(trace, state);
+		  trace_next_mode(task);
+		  return;
+		}
+	      hop = hop->hop_next;
+	    }
+
+	  if(trace->hop_count == 255 || trace->hop_count == trace->hoplimit)
+	    {
+	      trace_stop_hoplimit(trace);
+	      trace_burst_end(trace, state);
+	      trace_next_mode(task);
+	      return;
+	    }
+	  continue;
+	}
+
+      if(burst->tx[state->ttl] < trace->attempts)
+	break;
+      probe = state->probes[burst->id[state->ttl]];
+      if((probe->flags & TRACE_PROBE_FLAG_TIMEOUT) == 0)
+	break;
+
+      /* there is nothing at this TTL; check hoplimit and gaplimit */
+      timeout_trace(task);
+      if(state->mode != MODE_TRACE ||
+	 trace->stop_reason != SCAMPER_TRACE_STOP_NONE)
+	{
+	  trace_burst_end(trace, state);
+	  return;
+	}
+    }
+
+  return;
+}
+
+/*
+ * trace_burst_hop
+ *
+ * a reply was received to a probe sent when probing a window of TTLs.
+ */
+static void trace_burst_hop(scamper_task_t *task, scamper_trace_hop_t *hop)
+{
+  scamper_trace_t *trace = trace_getdata(task);
+  trace_state_t *state = trace_getstate(task);
+  uint8_t stop_reason, stop_data;
+
+  /* a late reply for a TTL the window has already moved past */
+  if(hop->hop_probe_ttl < state->ttl)
+    {
+      trace_stop_reason(trace, hop, state, &stop_reason, &stop_data);
+      if(stop_reason != SCAMPER_TRACE_STOP_NONE)
+	{
+	  trace_stop(trace, stop_reason, stop_data);
+	  trace_burst_end(trace, state);
+	  trace_next_mode(task);
+	}
+      return;
+    }
+
+  /* there is no need to probe beyond the end of the path */
+  if(hop->hop_probe_ttl < state->burst->top && trace_burst_isend(trace, hop))
+    state->burst->top = hop->hop_probe_ttl;
+
+  trace_burst_advance(task);
+
+  if(state->burst != NULL)
+    trace_burst_next(task);
+  else if(state->mode == MODE_LASTDITCH)
+    trace_queue(task);
+  return;
+}
+
+/*
+ * trace_burst_timeout
+ *
+ * mark each probe in the window that has gone unanswered for too long
+ * as timed out, and see if the window can move.
+ */
+static void trace_burst_timeout(scamper_task_t *task)
+{
+  scamper_trace_t *trace = trace_getdata(task);
+  trace_state_t *state = trace_getstate(task);
+  trace_burst_state_t *burst = state->burst;
+  trace_probe_t *probe;
+  struct timeval now;
+  int ttl, top;
+
+  gettimeofday_wrap(&now);
+  top = trace_burst_top(trace, state);
+  for(ttl = state->ttl; ttl <= top; ttl++)
+    {
+      if(trace->hops[ttl-1] != NULL || burst->tx[ttl] == 0)
+	continue;
+      probe = state->probes[burst->id[ttl]];
+      if(timeval_cmp(&probe->to_tv, &now) <= 0)
+	probe->flags |= TRACE_PROBE_FLAG_TIMEOUT;
+    }
+
+  trace_burst_advance(task);
+
+  if(state->burst != NULL)
+    trace_burst_next(task);
+  return;
+}
+
 static void timeout_dtree_back(scamper_task_t *task)
 {
   scamper_trace_t     *trace = trace_getdata(task);
@@ -2670,6 +3548,12 @@ static void do_trace_handle_timeout(scamper_task_t *task)
       return;
     }
 
+  if(state->burst != NULL)
+    {
+      trace_burst_timeout(task);
+      return;
+    }
+
   probe = state->probes[state->id_next-1];
   if(probe->rx == 0)
     {
@@ -2713,11 +3597,14 @@ static int handletcp_trace(scamper_task_t *task, scamper_dl_rec_t *dl,
     }
 
   /* create a hop record based off the TCP data */
-  if((hop = trace_tcp_hop(probe, dl)) == NULL)
+  if((hop = trace_tcp_hop(trace, probe, dl)) == NULL)
+    {
+      return -1;
+    }
+  if(trace_hopadd(trace, state, hop) != 0)
     {
       return -1;
     }
-  trace_hopins(&trace->hops[hop->hop_probe_ttl-1], hop);
 
   /* make sure we don't wrap */
   if(probe->rx != 65535)
@@ -2725,6 +3612,12 @@ static int handletcp_trace(scamper_task_t *task, scamper_dl_rec_t *dl,
       probe->rx++;
     }
 
+  if(state->burst != NULL)
+    {
+      trace_burst_hop(task, hop);
+      return 0;
+    }
+
   /* if we are sending all allotted probes to the target */
   if(SCAMPER_TRACE_IS_ALLATTEMPTS(trace))
     {
@@ -2786,6 +3679,7 @@ static int handletcp_lastditch(scamper_task_t *task, scamper_dl_rec_t *dl,
 			       trace_probe_t *probe)
 {
   scamper_trace_t *trace = trace_getdata(task);
+  trace_state_t *state = trace_getstate(task);
   scamper_trace_hop_t *hop;
 
   /* only handle TCP responses in these two states */
@@ -2797,7 +3691,7 @@ static int handletcp_lastditch(scamper_task_t *task, scamper_dl_rec_t *dl,
   if(probe->rx != 65535) probe->rx++;
 
   /* create a hop record based off the TCP data */
-  if((hop = trace_tcp_hop(probe, dl)) == NULL)
+  if((hop = trace_tcp_hop(trace, probe, dl)) == NULL)
     {
       return -1;
     }
@@ -2809,7 +3703,8 @@ static int handletcp_lastditch(scamper_task_t *task, scamper_dl_rec_t *dl,
     }
   else
     {
-      trace_hopins(&trace->hops[hop->hop_probe_ttl-1], hop);
+      if(trace_hopadd(trace, state, hop) != 0)
+	return -1;
       trace_stop_completed(trace);
     }
 
@@ -3347,7 +4242,13 @@ static void trace_handle_rt(scamper_route_t *rt)
 
 static void do_trace_write(scamper_file_t *sf, scamper_task_t *task)
 {
-  scamper_file_write_trace(sf, trace_getdata(task));
+  scamper_trace_t *trace = trace_getdata(task);
+
+  /* probing has finished, so the hop records can be packed together */
+  if(scamper_trace_hops_pack(trace) != 0)
+    printerror(errno, strerror, __func__, "could not pack hops");
+
+  scamper_file_write_trace(sf, trace);
   return;
 }
 
@@ -3389,6 +4290,8 @@ static void trace_state_free(trace_state_t *state)
   if(state->interfaces != NULL) free(state->interfaces);
   if(state->lss != NULL)        free(state->lss);
   if(state->pmtud != NULL)      trace_pmtud_state_free(state->pmtud);
+  if(state->burst != NULL)      free(state->burst);
+  if(state->hopidx != NULL)     trace_hopidx_free(state);
 
   free(state);
   return;
@@ -3413,6 +4316,9 @@ static int trace_state_alloc(scamper_task_t *task)
   if(trace->confidence == 99)
     state->confidence = 1;
 
+  if(SCAMPER_TRACE_IS_PREDICT(trace) && trace_predict(trace) != 0)
+    goto err;
+
   /* allocate memory to record hops */
   state->alloc_hops = TRACE_ALLOC_HOPS;
   if(trace->firsthop >= state->alloc_hops)
@@ -3427,12 +4333,31 @@ static int trace_state_alloc(scamper_task_t *task)
 	}
     }
 
+  /*
+   * when probing a window of TTLs at once, replies can arrive for any TTL
+   * in the path, so allocate space for them all now.
+   */
+  if(trace->burst != 0)
+    {
+      if((state->burst = malloc_zero(sizeof(trace_burst_state_t))) == NULL)
+	{
+	  printerror(errno, strerror, __func__, "could not malloc burst");
+	  goto err;
+	}
+      state->burst->top = trace->hoplimit != 0 ? trace->hoplimit : 255;
+      state->alloc_hops = 256;
+    }
+
   if(trace->dtree != NULL && trace->dtree->lss != NULL)
     {
       if((state->lsst = trace_lss_get(trace->dtree->lss)) == NULL)
 	goto err;
     }
 
+  /* backwards probing stops at the near hops, unless given an lss */
+  if(SCAMPER_TRACE_IS_PREDICT(trace) && state->lsst == NULL)
+    state->lsst = nearhops;
+
   if(scamper_trace_hops_alloc(trace, state->alloc_hops) == -1)
     {
       printerror(errno, strerror, __func__, "could not malloc hops");
@@ -3540,6 +4465,9 @@ static void do_trace_free(scamper_task_t *task)
   scamper_trace_t *trace = trace_getdata(task);
   trace_state_t *state = trace_getstate(task);
 
+  if(state != NULL && trace != NULL && SCAMPER_TRACE_IS_PREDICT(trace))
+    trace_ttlcache_update(trace);
+
   if(state != NULL)
     trace_state_free(state);
   if(trace != NULL)
@@ -3561,6 +4489,7 @@ static void do_trace_probe(scamper_task_t *task)
   trace_probe_t   *tp = NULL;
   scamper_probe_t  probe;
   uint16_t         u16, i;
+  uint8_t          ttl;
   size_t           size;
 
   assert(trace != NULL);
@@ -3614,6 +4543,17 @@ static void do_trace_probe(scamper_task_t *task)
 	}
     }
 
+  /* when probing a window of TTLs, pick the TTL to probe next */
+  if(state->burst != NULL && state->mode == MODE_TRACE)
+    {
+      if((ttl = trace_burst_ttl(trace, state)) == 0)
+	{
+	  trace_burst_next(task);
+	  return;
+	}
+    }
+  else ttl = state->ttl;
+
   /* allocate some more space in the trace to store replies, if necessary */
   if(trace->hop_count == state->alloc_hops)
     {
@@ -3667,7 +4607,7 @@ static void do_trace_probe(scamper_task_t *task)
   probe.pr_ip_src    = trace->src;
   probe.pr_ip_dst    = trace->dst;
   probe.pr_ip_tos    = trace->tos;
-  probe.pr_ip_ttl    = state->ttl;
+  probe.pr_ip_ttl    = ttl;
   probe.pr_data      = pktbuf;
   probe.pr_len       = state->payload_size;
   probe.pr_fd        = scamper_fd_fd_get(state->probe);
@@ -3837,22 +4777,42 @@ static void do_trace_probe(scamper_task_t *task)
   trace->probec++;
 
   timeval_cpy(&tp->tx_tv, &probe.pr_tx);
+  if(SCAMPER_TRACE_IS_RTTWAIT(trace))
+    timeval_add_ms(&tp->to_tv, &probe.pr_tx,
+		   scamper_rtt_wait(trace->dst, probe.pr_ip_ttl,
+				    trace->wait * 1000));
+  else
+    timeval_add_s(&tp->to_tv, &probe.pr_tx, trace->wait);
   tp->ttl   = probe.pr_ip_ttl;
   tp->size  = probe.pr_len + state->header_size;
   tp->mode  = state->mode;
-  tp->id    = state->attempt;
+
+  if(state->burst != NULL && state->mode == MODE_TRACE)
+    {
+      tp->id = state->burst->tx[ttl]++;
+      state->burst->id[ttl] = state->id_next;
+    }
+  else
+    {
+      tp->id = state->attempt;
+      state->attempt++;
+    }
 
   state->probes[state->id_next] = tp;
   state->id_next++;
-  state->attempt++;
 
   /* define the lower bounds on when the next probe will be transmitted */
   if(trace->wait_probe > 0)
     timeval_add_cs(&state->next_tx, &probe.pr_tx, trace->wait_probe);
 
+  if(state->burst != NULL && state->mode == MODE_TRACE)
+    {
+      trace_burst_next(task);
+      return;
+    }
+
   /* queue the traceroute to wait for any response */
-  probe.pr_tx.tv_sec += trace->wait;
-  scamper_task_queue_wait_tv(task, &probe.pr_tx);
+  scamper_task_queue_wait_tv(task, &tp->to_tv);
 
   return;
 
@@ -4006,6 +4966,14 @@ static int trace_arg_param_validate(int optid, char *param, long *out)
 	}
       break;
 
+    case TRACE_OPT_BURST:
+      if(string_tolong(param, &tmp) != 0 ||
+	 tmp < SCAMPER_DO_TRACE_BURST_MIN || tmp > SCAMPER_DO_TRACE_BURST_MAX)
+	{
+	  goto err;
+	}
+      break;
+
     case TRACE_OPT_WAITPROBE:
       if(string_tolong(param, &tmp) == -1 ||
 	 tmp < SCAMPER_DO_TRACE_WAITPROBE_MIN ||
@@ -4029,6 +4997,8 @@ static int trace_arg_param_validate(int optid, char *param, long *out)
     case TRACE_OPT_PMTUD:
     case TRACE_OPT_ALLATTEMPTS:
     case TRACE_OPT_TTLDST:
+    case TRACE_OPT_PREDICT:
+    case TRACE_OPT_RTTWAIT:
       /* these options don't have parameters */
       break;
 
@@ -4068,6 +5038,7 @@ void *scamper_do_trace_alloc(char *str)
   uint8_t  loops       = SCAMPER_DO_TRACE_LOOPS_DEF;
   uint8_t  loopaction  = SCAMPER_DO_TRACE_LOOPACTION_DEF;
   uint8_t  confidence  = 0;
+  uint8_t  burst       = 0;
   uint16_t sport       = scamper_sport_default();
   uint16_t dport       = SCAMPER_DO_TRACE_DPORT_DEF;
   uint16_t offset      = SCAMPER_DO_TRACE_OFFSET_DEF;
@@ -4174,6 +5145,10 @@ void *scamper_do_trace_alloc(char *str)
 	  flags |= SCAMPER_TRACE_FLAG_ALLATTEMPTS;
 	  break;
 
+	case TRACE_OPT_PREDICT:
+	  flags |= SCAMPER_TRACE_FLAG_PREDICT;
+	  break;
+
 	case TRACE_OPT_SPORT:
 	  sport = (uint16_t)tmp;
 	  break;
@@ -4186,6 +5161,10 @@ void *scamper_do_trace_alloc(char *str)
 	  flags |= SCAMPER_TRACE_FLAG_IGNORETTLDST;
 	  break;
 
+	case TRACE_OPT_RTTWAIT:
+	  flags |= SCAMPER_TRACE_FLAG_RTTWAIT;
+	  break;
+
 	case TRACE_OPT_WAIT:
 	  wait = (uint8_t)tmp;
 	  break;
@@ -4200,6 +5179,10 @@ void *scamper_do_trace_alloc(char *str)
 	  confidence = (uint8_t)tmp;
 	  break;
 
+	case TRACE_OPT_BURST:
+	  burst = (uint8_t)tmp;
+	  break;
+
 	case TRACE_OPT_USERID:
 	  userid = (uint32_t)tmp;
 	  break;
@@ -4231,7 +5214,8 @@ void *scamper_do_trace_alloc(char *str)
 
   /* can't really do pmtud properly without all of the path */
   if((flags & SCAMPER_TRACE_FLAG_PMTUD) != 0 &&
-     (firsthop > 1 || gss != NULL || lss != NULL))
+     (firsthop > 1 || gss != NULL || lss != NULL ||
+      (flags & SCAMPER_TRACE_FLAG_PREDICT)))
     {
       goto err;
     }
@@ -4242,6 +5226,14 @@ void *scamper_do_trace_alloc(char *str)
       goto err;
     }
 
+  /* probing a window of TTLs at once only works with the basic method */
+  if(burst != 0 && (confidence != 0 || gss != NULL || lss != NULL ||
+		    (flags & (SCAMPER_TRACE_FLAG_ALLATTEMPTS |
+			      SCAMPER_TRACE_FLAG_PREDICT))))
+    {
+      goto err;
+    }
+
   /* can't really do pmtud properly without a UDP traceroute method */
   if((flags & SCAMPER_TRACE_FLAG_PMTUD) != 0 &&
      type != SCAMPER_TRACE_TYPE_UDP && type != SCAMPER_TRACE_TYPE_UDP_PARIS)
@@ -4275,6 +5267,7 @@ void *scamper_do_trace_alloc(char *str)
   trace->payload     = payload; payload = NULL;
   trace->payload_len = payload_len;
   trace->confidence  = confidence;
+  trace->burst       = burst;
   trace->wait_probe  = wait_probe;
   trace->offset      = offset;
   trace->userid      = userid;
@@ -4288,6 +5281,14 @@ void *scamper_do_trace_alloc(char *str)
       goto err;
     }
 
+  /* tracemap claims replies to echo requests with these ICMP ids */
+  if(SCAMPER_TRACE_TYPE_IS_ICMP(trace) &&
+     scamper_icmpid_isreserved(trace->sport) != 0)
+    {
+      scamper_debug(__func__, "icmp id %d is reserved", trace->sport);
+      goto err;
+    }
+
   /* don't allow fragment traceroute with IPv4 for now */
   if(trace->offset != 0 && trace->dst->type == SCAMPER_ADDR_TYPE_IPV4)
     {
@@ -4355,8 +5356,11 @@ void *scamper_do_trace_alloc(char *str)
       trace->flags |= SCAMPER_TRACE_FLAG_DL;
     }
 
-  /* add the nodes to the global stop set for this trace */
-  if(gss != NULL || lss != NULL)
+  /*
+   * add the nodes to the global stop set for this trace.  a trace that
+   * predicts where to begin is also a doubletree trace.
+   */
+  if(gss != NULL || lss != NULL || SCAMPER_TRACE_IS_PREDICT(trace))
     {
       if(scamper_trace_dtree_alloc(trace) != 0)
 	goto err;
@@ -4414,7 +5418,7 @@ int scamper_do_trace_dtree_lss_clear(char *name)
   if((lss = splaytree_find(lsses, &findme)) == NULL)
     return -1;
 
-  splaytree_empty(lss->tree, (splaytree_free_t)scamper_addr_free);
+  scamper_trace_lss_clear(lss->set);
   return 0;
 }
 
@@ -4475,6 +5479,24 @@ void scamper_do_trace_cleanup(void)
       lsses = NULL;
     }
 
+  if(ttlcache != NULL)
+    {
+      trace_ttlcache_save();
+      splaytree_free(ttlcache, free);
+      ttlcache = NULL;
+    }
+  if(ttlcache_lru != NULL)
+    {
+      dlist_free(ttlcache_lru);
+      ttlcache_lru = NULL;
+    }
+
+  if(nearhops != NULL)
+    {
+      trace_lss_free(nearhops);
+      nearhops = NULL;
+    }
+
   return;
 }
 
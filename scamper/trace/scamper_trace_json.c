@@ -38,57 +38,67 @@ static const char rcsid[] =
 #include "scamper_list.h"
 #include "scamper_trace.h"
 #include "scamper_file.h"
+#include "scamper_file_json.h"
 #include "scamper_trace_json.h"
 #include "utils.h"
 
-static char *hop_tostr(scamper_trace_hop_t *hop)
+static void hop_tostr(json_buf_t *jb, const scamper_trace_hop_t *hop)
 {
-  char buf[512], tmp[128];
-  size_t off = 0;
-
-  string_concat(buf, sizeof(buf), &off,	"{\"addr\":\"%s\"",
-		scamper_addr_tostr(hop->hop_addr, tmp, sizeof(tmp)));
-  string_concat(buf, sizeof(buf), &off,
-		", \"probe_ttl\":%u, \"probe_id\":%u, \"probe_size\":%u", 
-		hop->hop_probe_ttl, hop->hop_probe_id, hop->hop_probe_size);
-  string_concat(buf, sizeof(buf), &off, ", \"rtt\":%s",
-		timeval_tostr(&hop->hop_rtt, tmp, sizeof(tmp)));
-  string_concat(buf, sizeof(buf), &off,
-		", \"reply_ttl\":%u, \"reply_tos\":%u, \"reply_size\":%u",
-		hop->hop_reply_ttl, hop->hop_reply_tos, hop->hop_reply_size);
-  string_concat(buf, sizeof(buf), &off,	", \"reply_ipid\":%u",
-		hop->hop_reply_ipid);
+  json_buf_lit(jb, "{\"addr\":\"");
+  json_buf_addr(jb, hop->hop_addr);
+  json_buf_lit(jb, "\", \"probe_ttl\":");
+  json_buf_u32(jb, hop->hop_probe_ttl);
+  json_buf_lit(jb, ", \"probe_id\":");
+  json_buf_u32(jb, hop->hop_probe_id);
+  json_buf_lit(jb, ", \"probe_size\":");
+  json_buf_u32(jb, hop->hop_probe_size);
+  json_buf_lit(jb, ", \"rtt\":");
+  json_buf_rtt(jb, &hop->hop_rtt);
+  json_buf_lit(jb, ", \"reply_ttl\":");
+  json_buf_u32(jb, hop->hop_reply_ttl);
+  json_buf_lit(jb, ", \"reply_tos\":");
+  json_buf_u32(jb, hop->hop_reply_tos);
+  json_buf_lit(jb, ", \"reply_size\":");
+  json_buf_u32(jb, hop->hop_reply_size);
+  json_buf_lit(jb, ", \"reply_ipid\":");
+  json_buf_u32(jb, hop->hop_reply_ipid);
 
   if(SCAMPER_TRACE_HOP_IS_ICMP(hop))
     {
-      string_concat(buf, sizeof(buf), &off,
-		    ", \"icmp_type\":%u, \"icmp_code\":%u",
-		    hop->hop_icmp_type, hop->hop_icmp_code);
+      json_buf_lit(jb, ", \"icmp_type\":");
+      json_buf_u32(jb, hop->hop_icmp_type);
+      json_buf_lit(jb, ", \"icmp_code\":");
+      json_buf_u32(jb, hop->hop_icmp_code);
       if(SCAMPER_TRACE_HOP_IS_ICMP_Q(hop))
 	{
-	  string_concat(buf, sizeof(buf), &off,
-			", \"icmp_q_ttl\":%u, \"icmp_q_ipl\":%u",
-			hop->hop_icmp_q_ttl, hop->hop_icmp_q_ipl);
+	  json_buf_lit(jb, ", \"icmp_q_ttl\":");
+	  json_buf_u32(jb, hop->hop_icmp_q_ttl);
+	  json_buf_lit(jb, ", \"icmp_q_ipl\":");
+	  json_buf_u32(jb, hop->hop_icmp_q_ipl);
 	  if(SCAMPER_ADDR_TYPE_IS_IPV4(hop->hop_addr))
-	    string_concat(buf, sizeof(buf), &off, ", \"icmp_q_tos\":%u",
-			  hop->hop_icmp_q_tos);
+	    {
+	      json_buf_lit(jb, ", \"icmp_q_tos\":");
+	      json_buf_u32(jb, hop->hop_icmp_q_tos);
+	    }
 	}
       if(SCAMPER_TRACE_HOP_IS_ICMP_PTB(hop))
-	string_concat(buf, sizeof(buf), &off, ", \"icmp_nhmtu:\":%u",
-		      hop->hop_icmp_nhmtu);
+	{
+	  json_buf_lit(jb, ", \"icmp_nhmtu:\":");
+	  json_buf_u32(jb, hop->hop_icmp_nhmtu);
+	}
     }
   else
     {
-      string_concat(buf, sizeof(buf), &off,
-		    ", \"tcp_flags\":%u", hop->hop_tcp_flags);
+      json_buf_lit(jb, ", \"tcp_flags\":");
+      json_buf_u32(jb, hop->hop_tcp_flags);
     }
-  string_concat(buf, sizeof(buf), &off, "}");
-  return strdup(buf);
+  json_buf_lit(jb, "}");
+  return;
 }
 
-static char *stop_reason_tostr(uint8_t reason, char *buf, size_t len)
+static void stop_reason_tostr(json_buf_t *jb, uint8_t reason)
 {
-  static char *r[] = {
+  static const char *r[] = {
     "NONE",
     "COMPLETED",
     "UNREACH",
@@ -99,134 +109,102 @@ static char *stop_reason_tostr(uint8_t reason, char *buf, size_t len)
     "HOPLIMIT",
     "GSS",
   };
-  if(reason > sizeof(r) / sizeof(char *))
-    {
-      snprintf(buf, len, "%d", reason);
-      return buf;
-    }
-  return r[reason];
+  if(reason >= sizeof(r) / sizeof(char *))
+    json_buf_u32(jb, reason);
+  else
+    json_buf_str(jb, r[reason]);
+  return;
 }
 
-static char *header_tostr(const scamper_trace_t *trace)
+static void header_tostr(json_buf_t *jb, const scamper_trace_t *trace)
 {
-  char buf[512], tmp[64];
+  char tmp[64];
   const char *ptr;
-  size_t off = 0;
   time_t tt = trace->start.tv_sec;
 
-  string_concat(buf, sizeof(buf), &off, "\"version\":\"0.1\",\"type\":\"trace\"");
-  string_concat(buf, sizeof(buf), &off, ", \"userid\":%u", trace->userid);
+  json_buf_lit(jb, "\"version\":\"0.1\",\"type\":\"trace\", \"userid\":");
+  json_buf_u32(jb, trace->userid);
+  json_buf_lit(jb, ", \"method\":\"");
   if((ptr = scamper_trace_type_tostr(trace)) != NULL)
-    string_concat(buf, sizeof(buf), &off, ", \"method\":\"%s\"", ptr);
+    json_buf_str(jb, ptr);
   else
-    string_concat(buf, sizeof(buf), &off, ", \"method\":\"%u\"", trace->type);
-  string_concat(buf, sizeof(buf), &off, ", \"src\":\"%s\"",
-		scamper_addr_tostr(trace->src, tmp, sizeof(tmp)));
-  string_concat(buf, sizeof(buf), &off, ", \"dst\":\"%s\"",
-		scamper_addr_tostr(trace->dst, tmp, sizeof(tmp)));
+    json_buf_u32(jb, trace->type);
+  json_buf_lit(jb, "\", \"src\":\"");
+  json_buf_addr(jb, trace->src);
+  json_buf_lit(jb, "\", \"dst\":\"");
+  json_buf_addr(jb, trace->dst);
+  json_buf_lit(jb, "\"");
   if(SCAMPER_TRACE_TYPE_IS_UDP(trace) || SCAMPER_TRACE_TYPE_IS_TCP(trace))
-    string_concat(buf, sizeof(buf), &off, ", \"sport\":%u, \"dport\":%u",
-		  trace->sport, trace->dport);
+    {
+      json_buf_lit(jb, ", \"sport\":");
+      json_buf_u32(jb, trace->sport);
+      json_buf_lit(jb, ", \"dport\":");
+      json_buf_u32(jb, trace->dport);
+    }
   else if(trace->flags & SCAMPER_TRACE_FLAG_ICMPCSUMDP)
-    string_concat(buf, sizeof(buf), &off, ", \"icmp_sum\":%u", trace->dport);
-  string_concat(buf, sizeof(buf), &off,
-		", \"stop_reason\":\"%s\", \"stop_data\":%u",
-		stop_reason_tostr(trace->stop_reason, tmp, sizeof(tmp)),
-		trace->stop_data);
+    {
+      json_buf_lit(jb, ", \"icmp_sum\":");
+      json_buf_u32(jb, trace->dport);
+    }
+  json_buf_lit(jb, ", \"stop_reason\":\"");
+  stop_reason_tostr(jb, trace->stop_reason);
+  json_buf_lit(jb, "\", \"stop_data\":");
+  json_buf_u32(jb, trace->stop_data);
   strftime(tmp, sizeof(tmp), "%Y-%m-%d %H:%M:%S", localtime(&tt));
-  string_concat(buf, sizeof(buf), &off,
-		", \"start\":{\"sec\":%u, \"usec\":%u, \"ftime\":\"%s\"}",
-		trace->start.tv_sec, trace->start.tv_usec, tmp);
-  string_concat(buf, sizeof(buf), &off,
-		", \"hop_count\":%u, \"attempts\":%u, \"hoplimit\":%u",
-		trace->hop_count, trace->attempts, trace->hoplimit);
-  string_concat(buf, sizeof(buf), &off,
-		", \"firsthop\":%u, \"wait\":%u, \"wait_probe\":%u",
-		trace->firsthop, trace->wait, trace->wait_probe);
-  string_concat(buf, sizeof(buf), &off,	", \"tos\":%u, \"probe_size\":%u",
-		trace->tos, trace->probe_size);
-
-  return strdup(buf);
+  json_buf_lit(jb, ", \"start\":{\"sec\":");
+  json_buf_u32(jb, trace->start.tv_sec);
+  json_buf_lit(jb, ", \"usec\":");
+  json_buf_u32(jb, trace->start.tv_usec);
+  json_buf_lit(jb, ", \"ftime\":\"");
+  json_buf_str(jb, tmp);
+  json_buf_lit(jb, "\"}, \"hop_count\":");
+  json_buf_u32(jb, trace->hop_count);
+  json_buf_lit(jb, ", \"attempts\":");
+  json_buf_u32(jb, trace->attempts);
+  json_buf_lit(jb, ", \"hoplimit\":");
+  json_buf_u32(jb, trace->hoplimit);
+  json_buf_lit(jb, ", \"firsthop\":");
+  json_buf_u32(jb, trace->firsthop);
+  json_buf_lit(jb, ", \"wait\":");
+  json_buf_u32(jb, trace->wait);
+  json_buf_lit(jb, ", \"wait_probe\":");
+  json_buf_u32(jb, trace->wait_probe);
+  json_buf_lit(jb, ", \"tos\":");
+  json_buf_u32(jb, trace->tos);
+  json_buf_lit(jb, ", \"probe_size\":");
+  json_buf_u32(jb, trace->probe_size);
+  return;
 }
 
 int scamper_file_json_trace_write(const scamper_file_t *sf,
 				  const scamper_trace_t *trace)
 {
   scamper_trace_hop_t *hop;
-  int fd = scamper_file_getfd(sf);
-  size_t wc, len, off = 0;
-  off_t foff = 0;
-  char *str = NULL, *header = NULL, **hops = NULL;
-  int i, j, hopc = 0, rc = -1;
-
-  if(fd != STDOUT_FILENO && (foff = lseek(fd, 0, SEEK_CUR)) == -1)
-    return -1;
+  json_buf_t jb;
+  char buf[4096];
+  int i, hopc = 0, rc;
 
-  if((header = header_tostr(trace)) == NULL)
-    goto cleanup;
-  len = strlen(header);
+  json_buf_init(&jb, buf, sizeof(buf));
+  json_buf_lit(&jb, "{");
+  header_tostr(&jb, trace);
 
   for(i=trace->firsthop-1; i<trace->hop_count; i++)
-    for(hop = trace->hops[i]; hop != NULL; hop = hop->hop_next)
-      hopc++;
-  if(hopc > 0)
     {
-      len += 11; /* , "hops":[] */
-      if((hops = malloc_zero(sizeof(char *) * hopc)) == NULL)
-	goto cleanup;
-      for(i=trace->firsthop-1, j=0; i<trace->hop_count; i++)
+      for(hop = trace->hops[i]; hop != NULL; hop = hop->hop_next)
 	{
-	  for(hop = trace->hops[i]; hop != NULL; hop = hop->hop_next)
-	    {
-	      if(j > 0) len++; /* , */
-	      if((hops[j] = hop_tostr(hop)) == NULL)
-		goto cleanup;
-	      len += strlen(hops[j]);
-	      j++;
-	    }
+	  if(hopc == 0)
+	    json_buf_lit(&jb, ", \"hops\":[");
+	  else
+	    json_buf_lit(&jb, ",");
+	  hop_tostr(&jb, hop);
+	  hopc++;
 	}
     }
-  len += 4; /* {}\n\0 */
-
-  if((str = malloc(len)) == NULL)
-    goto cleanup;
-
-  string_concat(str, len, &off, "{%s", header);
   if(hopc > 0)
-    {
-      string_concat(str, len, &off, ", \"hops\":[");
-      for(j=0; j<hopc; j++)
-	{
-	  if(j > 0) string_concat(str, len, &off, ",");
-	  string_concat(str, len, &off, "%s", hops[j]);
-	}
-      string_concat(str, len, &off, "]");
-    }
-  string_concat(str, len, &off, "}\n");
-  assert(off+1 == len);
-
-  if(write_wrap(fd, str, &wc, off) != 0)
-    {
-      if(fd != STDOUT_FILENO)
-	{
-	  if(ftruncate(fd, foff) != 0)
-	    goto cleanup;
-	}
-      goto cleanup;
-    }
-
-  rc = 0; /* we succeeded */
-
- cleanup:
-  if(hops != NULL)
-    {
-      for(i=0; i<hopc; i++)
-	if(hops[i] != NULL)
-	  free(hops[i]);
-      free(hops);
-    }
-  if(header != NULL) free(header);
-  if(str != NULL) free(str);
+    json_buf_lit(&jb, "]");
+  json_buf_lit(&jb, "}\n");
 
+  rc = json_buf_write(&jb, sf);
+  json_buf_free(&jb);
   return rc;
 }
@@ -0,0 +1,370 @@
+/*
+ * scamper_trace_lss.c
+ *
+ * a doubletree local stop set kept as a blocked bloom filter: each
+ * interface sets eight bits in a single 32 byte block, so a lookup
+ * touches one cache line, and the memory used is fixed when the set is
+ * allocated.
+ *
+ * $Id: scamper_trace_lss.c,v 1.1 2014/03/26 00:00:00 mjl Exp $
+ *
+ * Copyright (C) 2014 The Regents of the University of California
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef lint
+static const char rcsid[] =
+  "$Id: scamper_trace_lss.c,v 1.1 2014/03/26 00:00:00 mjl Exp $";
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper_addr.h"
+#include "scamper_privsep.h"
+#include "scamper_debug.h"
+#include "scamper_savefile.h"
+#include "scamper_trace_lss.h"
+#include "utils.h"
+
+/*
+ * the file begins with a 16 byte header: an eight byte magic string, a
+ * four byte version, and a four byte count of the blocks that follow.
+ * the blocks are stored as they are held in memory; the bit positions
+ * are defined in bytes, so the file does not depend on byte order.
+ */
+#define LSS_MAGIC      "scamplss"
+#define LSS_VERSION    1
+#define LSS_HDRLEN     16
+#define LSS_BLOCKLEN   32
+#define LSS_BLOCKC_MAX (1 << 24)
+
+struct scamper_trace_lss
+{
+  uint8_t  *blocks;
+  uint32_t  blockc;
+  void     *map;
+  size_t    maplen;
+};
+
+static const uint32_t salt[8] = {
+  0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+  0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+};
+
+/*
+ * lss_hash
+ *
+ * FNV-1a over the address, with the bits mixed afterwards so that the
+ * upper half, which selects the block, depends on every input byte.
+ */
+static uint64_t lss_hash(const scamper_addr_t *addr)
+{
+  const uint8_t *a = addr->addr;
+  uint64_t h = 14695981039346656037ULL;
+  size_t i, len = scamper_addr_size(addr);
+
+  h = (h ^ (uint8_t)addr->type) * 1099511628211ULL;
+  for(i=0; i<len; i++)
+    h = (h ^ a[i]) * 1099511628211ULL;
+
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/*
+ * lss_block
+ *
+ * return the block the address hashes to, and the key used to pick the
+ * eight bits within it.
+ */
+static uint8_t *lss_block(const scamper_trace_lss_t *lss,
+			  const scamper_addr_t *addr, uint32_t *key)
+{
+  uint64_t h = lss_hash(addr);
+  *key = (uint32_t)h;
+  return lss->blocks + (((uint32_t)(h >> 32) & (lss->blockc-1)) *
+			LSS_BLOCKLEN);
+}
+
+int scamper_trace_lss_in(const scamper_trace_lss_t *lss,
+			 const scamper_addr_t *addr)
+{
+  uint8_t *block;
+  uint32_t key, bit;
+  int i;
+
+  block = lss_block(lss, addr, &key);
+  for(i=0; i<8; i++)
+    {
+      bit = (key * salt[i]) >> 27;
+      if((block[(i*4) + (bit >> 3)] & (1 << (bit & 7))) == 0)
+	return 0;
+    }
+  return 1;
+}
+
+void scamper_trace_lss_add(scamper_trace_lss_t *lss,
+			   const scamper_addr_t *addr)
+{
+  uint8_t *block;
+  uint32_t key, bit;
+  int i;
+
+  block = lss_block(lss, addr, &key);
+  for(i=0; i<8; i++)
+    {
+      bit = (key * salt[i]) >> 27;
+      block[(i*4) + (bit >> 3)] |= (1 << (bit & 7));
+    }
+  return;
+}
+
+void scamper_trace_lss_clear(scamper_trace_lss_t *lss)
+{
+  memset(lss->blocks, 0, (size_t)lss->blockc * LSS_BLOCKLEN);
+  return;
+}
+
+static int lss_open(const char *file, int flags)
+{
+  mode_t mode;
+
+#ifndef _WIN32
+  mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+#else
+  mode = _S_IREAD | _S_IWRITE;
+  flags |= O_BINARY;
+#endif
+
+#if defined(WITHOUT_PRIVSEP)
+  return open(file, flags, mode);
+#else
+  return scamper_privsep_open_file(file, flags, mode);
+#endif
+}
+
+/*
+ * lss_hdr_blockc
+ *
+ * check the header, and return the number of blocks that follow it, or
+ * zero if the header is not one this code wrote.
+ */
+static uint32_t lss_hdr_blockc(const uint8_t *hdr)
+{
+  uint32_t blockc;
+
+  if(memcmp(hdr, LSS_MAGIC, 8) != 0 || bytes_ntohl(hdr+8) != LSS_VERSION)
+    return 0;
+  blockc = bytes_ntohl(hdr+12);
+  if(blockc == 0 || blockc > LSS_BLOCKC_MAX || (blockc & (blockc-1)) != 0)
+    return 0;
+  return blockc;
+}
+
+/*
+ * scamper_trace_lss_alloc
+ *
+ * allocate an empty set that uses no more than size bytes.  the number
+ * of blocks is a power of two so that a block is found with a mask.
+ */
+scamper_trace_lss_t *scamper_trace_lss_alloc(size_t size)
+{
+  scamper_trace_lss_t *lss;
+  uint32_t blockc = 1;
+
+  while(blockc < LSS_BLOCKC_MAX && (size_t)blockc * 2 * LSS_BLOCKLEN <= size)
+    blockc *= 2;
+
+  if((lss = malloc_zero(sizeof(scamper_trace_lss_t))) == NULL ||
+     (lss->blocks = malloc_zero((size_t)blockc * LSS_BLOCKLEN)) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not alloc lss");
+      if(lss != NULL) free(lss);
+      return NULL;
+    }
+  lss->blockc = blockc;
+  return lss;
+}
+
+/*
+ * scamper_trace_lss_load
+ *
+ * load a set saved to the file.  the file is mapped copy-on-write so
+ * that pages are shared with other processes using the same file until
+ * an interface is added to them.  a save replaces the file rather than
+ * writing into it, so the mapping stays valid.  if the file does not
+ * exist or is not a saved set, an empty set of the given size is
+ * returned.
+ */
+scamper_trace_lss_t *scamper_trace_lss_load(const char *file, size_t size)
+{
+  scamper_trace_lss_t *lss = NULL;
+  uint8_t hdr[LSS_HDRLEN];
+  uint32_t blockc;
+  struct stat sb;
+  size_t len;
+  int fd = -1;
+
+  if((fd = lss_open(file, O_RDONLY)) == -1)
+    {
+      scamper_debug(__func__, "new lss %s", file);
+      return scamper_trace_lss_alloc(size);
+    }
+
+  if(fstat(fd, &sb) != 0 || read_wrap(fd, hdr, NULL, LSS_HDRLEN) != 0 ||
+     (blockc = lss_hdr_blockc(hdr)) == 0 ||
+     (off_t)LSS_HDRLEN + ((off_t)blockc * LSS_BLOCKLEN) != sb.st_size)
+    {
+      printerror(0, NULL, __func__, "ignoring %s: not a saved lss", file);
+      close(fd);
+      return scamper_trace_lss_alloc(size);
+    }
+
+  if((lss = malloc_zero(sizeof(scamper_trace_lss_t))) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not alloc lss");
+      goto err;
+    }
+  lss->blockc = blockc;
+  len = (size_t)blockc * LSS_BLOCKLEN;
+
+#ifdef HAVE_SYS_MMAN_H
+  lss->map = mmap(NULL, LSS_HDRLEN + len, PROT_READ | PROT_WRITE,
+		  MAP_PRIVATE, fd, 0);
+  if(lss->map == MAP_FAILED)
+    {
+      printerror(errno, strerror, __func__, "could not mmap %s", file);
+      lss->map = NULL;
+      goto err;
+    }
+  lss->maplen = LSS_HDRLEN + len;
+  lss->blocks = (uint8_t *)lss->map + LSS_HDRLEN;
+#else
+  if((lss->blocks = malloc(len)) == NULL ||
+     read_wrap(fd, lss->blocks, NULL, len) != 0)
+    {
+      printerror(errno, strerror, __func__, "could not read %s", file);
+      goto err;
+    }
+#endif
+
+  close(fd);
+  return lss;
+
+ err:
+  if(fd != -1) close(fd);
+  if(lss != NULL) scamper_trace_lss_free(lss);
+  return NULL;
+}
+
+/*
+ * scamper_trace_lss_save
+ *
+ * write the set to the file.  if the file holds a set of the same size,
+ * perhaps saved by another process since this one loaded it, the two
+ * are merged so that neither process loses what the other added.  the
+ * merge is done holding a lock so that processes save one at a time,
+ * and the merged set is written to a temporary file that is renamed
+ * over the file, so a process with the old file mapped keeps its copy.
+ */
+int scamper_trace_lss_save(const scamper_trace_lss_t *lss, const char *file)
+{
+  scamper_savefile_t *sf = NULL;
+  uint8_t hdr[LSS_HDRLEN], buf[LSS_BLOCKLEN * 128];
+  size_t off, len, i, total;
+  int fd = -1, out, lock, rc;
+
+  if((lock = scamper_savefile_lock(file)) == -1)
+    return -1;
+
+  if((sf = scamper_savefile_open(file)) == NULL)
+    goto err;
+  out = scamper_savefile_fd(sf);
+
+  total = (size_t)lss->blockc * LSS_BLOCKLEN;
+  memcpy(hdr, LSS_MAGIC, 8);
+  bytes_htonl(hdr+8, LSS_VERSION);
+  bytes_htonl(hdr+12, lss->blockc);
+  if(write_wrap(out, hdr, NULL, LSS_HDRLEN) != 0)
+    goto err;
+
+  if((fd = lss_open(file, O_RDONLY)) != -1 &&
+     (read_wrap(fd, hdr, NULL, LSS_HDRLEN) != 0 ||
+      lss_hdr_blockc(hdr) != lss->blockc))
+    {
+      close(fd);
+      fd = -1;
+    }
+
+  for(off=0; off<total; off += len)
+    {
+      len = total - off;
+      if(len > sizeof(buf))
+	len = sizeof(buf);
+      if(fd != -1)
+	{
+	  if(read_wrap(fd, buf, NULL, len) != 0)
+	    goto err;
+	  for(i=0; i<len; i++)
+	    buf[i] |= lss->blocks[off+i];
+	}
+      else memcpy(buf, lss->blocks+off, len);
+      if(write_wrap(out, buf, NULL, len) != 0)
+	goto err;
+    }
+
+  if(fd != -1)
+    close(fd);
+  fd = -1;
+
+  rc = scamper_savefile_commit(sf);
+  sf = NULL;
+  if(rc != 0)
+    goto err;
+
+  scamper_savefile_unlock(lock);
+  return 0;
+
+ err:
+  printerror(errno, strerror, __func__, "could not save %s", file);
+  if(fd != -1) close(fd);
+  if(sf != NULL) scamper_savefile_abort(sf);
+  scamper_savefile_unlock(lock);
+  return -1;
+}
+
+void scamper_trace_lss_free(scamper_trace_lss_t *lss)
+{
+  if(lss == NULL)
+    return;
+
+#ifdef HAVE_SYS_MMAN_H
+  if(lss->map != NULL)
+    munmap(lss->map, lss->maplen);
+  else
+#endif
+  if(lss->blocks != NULL)
+    free(lss->blocks);
+
+  free(lss);
+  return;
+}
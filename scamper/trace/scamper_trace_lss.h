@@ -0,0 +1,52 @@
+/*
+ * scamper_trace_lss.h
+ *
+ * $Id: scamper_trace_lss.h,v 1.1 2014/03/26 00:00:00 mjl Exp $
+ *
+ * Copyright (C) 2014 The Regents of the University of California
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __SCAMPER_TRACE_LSS_H
+#define __SCAMPER_TRACE_LSS_H
+
+/*
+ * scamper_trace_lss_t
+ *
+ * the set of interfaces in a doubletree local stop set, kept as a blocked
+ * bloom filter of fixed size.  a set can be loaded from a file, in which
+ * case the file is mapped into memory copy-on-write so that scamper
+ * processes using the same set share the pages they have not added to.
+ */
+typedef struct scamper_trace_lss scamper_trace_lss_t;
+
+#define SCAMPER_TRACE_LSS_SIZE_DEF (1024 * 1024)
+#define SCAMPER_TRACE_LSS_SIZE_MIN 1024
+#define SCAMPER_TRACE_LSS_SIZE_MAX (512 * 1024 * 1024)
+
+scamper_trace_lss_t *scamper_trace_lss_alloc(size_t size);
+scamper_trace_lss_t *scamper_trace_lss_load(const char *file, size_t size);
+int scamper_trace_lss_save(const scamper_trace_lss_t *lss, const char *file);
+void scamper_trace_lss_free(scamper_trace_lss_t *lss);
+
+int scamper_trace_lss_in(const scamper_trace_lss_t *lss,
+			 const scamper_addr_t *addr);
+void scamper_trace_lss_add(scamper_trace_lss_t *lss,
+			   const scamper_addr_t *addr);
+void scamper_trace_lss_clear(scamper_trace_lss_t *lss);
+
+#endif /* __SCAMPER_TRACE_LSS_H */
@@ -652,19 +652,6 @@ int scamper_file_text_trace_write(const scamper_file_t *sf,
   char   **hops     = NULL;
   char   **mtus     = NULL;
 
-  /* variables for writing to the file */
-  off_t  foff = 0;
-  int    fd;
-  size_t wc;
-
-  /*
-   * get the current offset into the file, incase the write fails and a
-   * truncation is required
-   */
-  fd = scamper_file_getfd(sf);
-  if(fd != STDOUT_FILENO && (foff = lseek(fd, 0, SEEK_CUR)) == -1)
-    goto cleanup;
-
   if((hops = malloc_zero(sizeof(char *) * trace->hop_count)) == NULL)
     goto cleanup;
 
@@ -709,19 +696,9 @@ int scamper_file_text_trace_write(const scamper_file_t *sf,
       string_concat(str, len, &off, "\n");
     }
 
-  /*
-   * try and write the string to disk.  if it fails, then truncate the
-   * write and fail
-   */
-  if(write_wrap(fd, str, &wc, off) != 0)
-    {
-      if(fd != STDOUT_FILENO)
-	{
-	  if(ftruncate(fd, foff) != 0)
-	    goto cleanup;
-	}
-      goto cleanup;
-    }
+  /* try and write the string out */
+  if(scamper_file_write_bytes(sf, str, off) != 0)
+    goto cleanup;
 
   rc = 0; /* we succeeded */
 
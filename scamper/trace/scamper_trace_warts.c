@@ -87,6 +87,7 @@ static const char rcsid[] =
 #define WARTS_TRACE_ADDR_DST       27  /* destination address key */
 #define WARTS_TRACE_USERID         28  /* user id */
 #define WARTS_TRACE_OFFSET         29  /* IP offset to use in fragments */
+#define WARTS_TRACE_BURST          30  /* number of TTLs probed at once */
 
 static const warts_var_t trace_vars[] =
 {
@@ -119,6 +120,7 @@ static const warts_var_t trace_vars[] =
   {WARTS_TRACE_ADDR_DST,    -1, -1},
   {WARTS_TRACE_USERID,       4, -1},
   {WARTS_TRACE_OFFSET,       2, -1},
+  {WARTS_TRACE_BURST,        1, -1},
 };
 #define trace_vars_mfb WARTS_VAR_MFB(trace_vars)
 
@@ -284,6 +286,12 @@ static void warts_trace_params(const scamper_trace_t *trace,
 	    continue;
 	}
 
+      if(var->id == WARTS_TRACE_BURST)
+	{
+	  if(trace->burst == 0)
+	    continue;
+	}
+
       flag_set(flags, var->id, &max_id);
 
       if(var->id == WARTS_TRACE_ADDR_SRC)
@@ -339,6 +347,7 @@ static int warts_trace_params_read(scamper_trace_t *trace,warts_state_t *state,
     {&trace->dst,         (wpr_t)extract_addr,     table},
     {&trace->userid,      (wpr_t)extract_uint32,   NULL},
     {&trace->offset,      (wpr_t)extract_uint16,   NULL},
+    {&trace->burst,       (wpr_t)extract_byte,     NULL},
   };
   const int handler_cnt = sizeof(handlers)/sizeof(warts_param_reader_t);
 
@@ -385,6 +394,7 @@ static int warts_trace_params_write(const scamper_trace_t *trace,
     {trace->dst,          (wpw_t)insert_addr,    table},
     {&trace->userid,      (wpw_t)insert_uint32,  NULL},
     {&trace->offset,      (wpw_t)insert_uint16,  NULL},
+    {&trace->burst,       (wpw_t)insert_byte,    NULL},
   };
   const int handler_cnt = sizeof(handlers)/sizeof(warts_param_writer_t);
 
@@ -1140,7 +1150,7 @@ int scamper_file_warts_trace_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   uint16_t             u16;
   warts_addrtable_t    table;
 
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   if(warts_read(sf, &buf, hdr->len) != 0)
     {
@@ -1229,6 +1239,9 @@ int scamper_file_warts_trace_read(scamper_file_t *sf, const warts_hdr_t *hdr,
     }
   hops = NULL;
 
+  if(scamper_trace_hops_pack(trace) != 0)
+    goto err;
+
   for(;;)
     {
       if(extract_uint16(buf, &off, hdr->len, &u16, NULL) != 0)
@@ -1266,14 +1279,12 @@ int scamper_file_warts_trace_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
  done:
   warts_addrtable_clean(&table);
-  free(buf);
   *trace_out = trace;
   return 0;
 
  err:
   warts_addrtable_clean(&table);
   if(hops != NULL) free(hops);
-  if(buf != NULL) free(buf);
   if(trace != NULL) scamper_trace_free(trace);
   return -1;
 }
@@ -1281,6 +1292,7 @@ int scamper_file_warts_trace_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 int scamper_file_warts_trace_write(const scamper_file_t *sf,
 				   const scamper_trace_t *trace)
 {
+  scamper_trace_hop_iter_t it;
   scamper_trace_hop_t *hop;
   uint8_t             *buf = NULL;
   uint8_t              trace_flags[trace_vars_mfb];
@@ -1300,7 +1312,7 @@ int scamper_file_warts_trace_write(const scamper_file_t *sf,
   warts_addrtable_t    table;
 
   /* make sure the table is nulled out */
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
   memset(&dtree_state, 0, sizeof(dtree_state));
 
   /* figure out which trace data items we'll store in this record */
@@ -1323,17 +1335,15 @@ int scamper_file_warts_trace_write(const scamper_file_t *sf,
 	  goto err;
 	}
 
-      for(i=0, j=0; i<trace->hop_count; i++)
+      scamper_trace_hop_iter_init(&it, trace);
+      for(j=0; (hop = scamper_trace_hop_iter_next(&it)) != NULL; j++)
 	{
-	  for(hop = trace->hops[i]; hop != NULL; hop = hop->hop_next)
-	    {
-	      /* record basic hop state */
-	      len2 = len;
-	      warts_trace_hop_state(trace,hop,&hop_state[j++],&table,&len2);
-	      if(len2 < len)
-		goto err;
-	      len = len2;
-	    }
+	  /* record basic hop state */
+	  len2 = len;
+	  warts_trace_hop_state(trace, hop, &hop_state[j], &table, &len2);
+	  if(len2 < len)
+	    goto err;
+	  len = len2;
 	}
     }
 
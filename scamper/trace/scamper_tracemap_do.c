@@ -0,0 +1,903 @@
+/*
+ * scamper_tracemap_do.c
+ *
+ * $Id: scamper_tracemap_do.c,v 1.1 2014/03/24 00:00:00 mjl Exp $
+ *
+ * Copyright (C) 2014 The Regents of the University of California
+ * Author: Matthew Luckie
+ *
+ * tracemap probes a large set of destinations at every TTL in a range
+ * without keeping state for each destination.  the (destination, TTL)
+ * pairs are visited in a pseudo-random order, and everything needed to
+ * interpret a reply is carried in the probe and recovered from the
+ * reply or the ICMP quotation:
+ *
+ *  - the ICMP id: a high byte that other measurements do not use for
+ *    echo requests, and the probe TTL in the low byte.
+ *  - the ICMP seq: the millisecond the probe was sent, relative to the
+ *    start of the task, modulo 65536.  the RTTs are therefore only as
+ *    precise as a millisecond, and each hop is marked as such.
+ *  - the IPv4 ID: a checksum of the destination, so that a quotation of
+ *    a probe whose destination was rewritten is discarded.
+ *
+ * each reply is recorded as a trace with a single hop; the traces for a
+ * destination can be put back together afterwards.  the traces are
+ * written out in batches while the measurement runs, so that the memory
+ * held does not grow with the number of destinations.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef lint
+static const char rcsid[] =
+  "$Id: scamper_tracemap_do.c,v 1.1 2014/03/24 00:00:00 mjl Exp $";
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper.h"
+#include "scamper_addr.h"
+#include "scamper_list.h"
+#include "scamper_icmpext.h"
+#include "scamper_trace.h"
+#include "scamper_task.h"
+#include "scamper_icmp_resp.h"
+#include "scamper_dl.h"
+#include "scamper_fds.h"
+#include "scamper_probe.h"
+#include "scamper_getsrc.h"
+#include "scamper_file.h"
+#include "scamper_options.h"
+#include "scamper_debug.h"
+#include "scamper_tracemap_do.h"
+#include "mjl_list.h"
+#include "utils.h"
+
+#define SCAMPER_DO_TRACEMAP_FIRSTHOP_MIN 1
+#define SCAMPER_DO_TRACEMAP_FIRSTHOP_DEF 1
+#define SCAMPER_DO_TRACEMAP_FIRSTHOP_MAX 255
+
+#define SCAMPER_DO_TRACEMAP_HOPLIMIT_MIN 1
+#define SCAMPER_DO_TRACEMAP_HOPLIMIT_DEF 32
+#define SCAMPER_DO_TRACEMAP_HOPLIMIT_MAX 255
+
+#define SCAMPER_DO_TRACEMAP_WAIT_MIN     1
+#define SCAMPER_DO_TRACEMAP_WAIT_DEF     5
+#define SCAMPER_DO_TRACEMAP_WAIT_MAX     20
+
+/* the number of traces held before they are written out */
+#define SCAMPER_DO_TRACEMAP_TRACES_MAX   1000
+
+/*
+ * tracemap_target_t
+ *
+ * a single destination, or an IPv4 prefix that contributes one
+ * destination in each /24 it covers.  off is the index of the entry's
+ * first destination in the set of all destinations.
+ */
+typedef struct tracemap_target
+{
+  scamper_addr_t *addr;
+  uint32_t        net;
+  uint32_t        off;
+  uint32_t        cnt;
+} tracemap_target_t;
+
+/*
+ * tracemap_t
+ *
+ * the parameters of the measurement, and the traces recorded from the
+ * replies received.
+ */
+typedef struct tracemap
+{
+  scamper_list_t    *list;
+  scamper_cycle_t   *cycle;
+  uint32_t           userid;
+  scamper_addr_t    *src;
+  int                af;
+
+  tracemap_target_t *targets;
+  int                targetc;
+  uint32_t           dstc;
+
+  uint16_t           icmpid;
+  uint8_t            hostid;
+  uint8_t            firsthop;
+  uint8_t            hoplimit;
+  uint8_t            wait;
+
+  struct timeval     start;
+  uint64_t           probec;
+  slist_t           *traces;
+} tracemap_t;
+
+/*
+ * tracemap_state_t
+ *
+ * the position in the permutation of (destination, TTL) pairs.  x walks
+ * a full-period linear congruential sequence modulo 2^k, skipping values
+ * that are not smaller than the number of pairs.
+ */
+typedef struct tracemap_state
+{
+  scamper_fd_t      *icmp;
+  uint64_t           pairc;
+  uint64_t           mask;
+  uint64_t           inc;
+  uint64_t           x;
+  uint64_t           sent;
+} tracemap_state_t;
+
+#define TRACEMAP_OPT_FIRSTHOP 1
+#define TRACEMAP_OPT_MAXTTL   2
+#define TRACEMAP_OPT_SRCADDR  3
+#define TRACEMAP_OPT_USERID   4
+#define TRACEMAP_OPT_WAIT     5
+
+static const scamper_option_in_t opts[] = {
+  {'f', NULL, TRACEMAP_OPT_FIRSTHOP, SCAMPER_OPTION_TYPE_NUM},
+  {'m', NULL, TRACEMAP_OPT_MAXTTL,   SCAMPER_OPTION_TYPE_NUM},
+  {'S', NULL, TRACEMAP_OPT_SRCADDR,  SCAMPER_OPTION_TYPE_STR},
+  {'U', NULL, TRACEMAP_OPT_USERID,   SCAMPER_OPTION_TYPE_NUM},
+  {'w', NULL, TRACEMAP_OPT_WAIT,     SCAMPER_OPTION_TYPE_NUM},
+};
+
+static const int opts_cnt = SCAMPER_OPTION_COUNT(opts);
+
+/* the callback functions registered with the tracemap task */
+static scamper_task_funcs_t tracemap_funcs;
+
+/* address cache used to avoid reallocating the same address multiple times */
+extern scamper_addrcache_t *addrcache;
+
+const char *scamper_do_tracemap_usage(void)
+{
+  return "tracemap [-f firsthop] [-m maxttl] [-S srcaddr] [-U userid]\n"
+         "         [-w wait] <addr|prefix> ...\n";
+}
+
+static tracemap_t *tracemap_getdata(const scamper_task_t *task)
+{
+  return scamper_task_getdata(task);
+}
+
+static tracemap_state_t *tracemap_getstate(const scamper_task_t *task)
+{
+  return scamper_task_getstate(task);
+}
+
+static void tracemap_free(tracemap_t *tm)
+{
+  scamper_trace_t *trace;
+  int i;
+
+  if(tm == NULL)
+    return;
+
+  if(tm->targets != NULL)
+    {
+      for(i=0; i<tm->targetc; i++)
+	if(tm->targets[i].addr != NULL)
+	  scamper_addr_free(tm->targets[i].addr);
+      free(tm->targets);
+    }
+
+  if(tm->traces != NULL)
+    {
+      while((trace = slist_head_pop(tm->traces)) != NULL)
+	scamper_trace_free(trace);
+      slist_free(tm->traces);
+    }
+
+  if(tm->src != NULL) scamper_addr_free(tm->src);
+  if(tm->list != NULL) scamper_list_free(tm->list);
+  if(tm->cycle != NULL) scamper_cycle_free(tm->cycle);
+  free(tm);
+  return;
+}
+
+/*
+ * tracemap_dst
+ *
+ * fill out addr with the destination at index i.  the caller supplies
+ * the memory to hold an IPv4 address for a destination within a prefix.
+ */
+static void tracemap_dst(const tracemap_t *tm, uint32_t i,
+			 scamper_addr_t *addr, struct in_addr *in)
+{
+  const tracemap_target_t *t;
+  int l = 0, r = tm->targetc - 1, k = 0;
+
+  while(l <= r)
+    {
+      k = (l + r) / 2;
+      t = &tm->targets[k];
+      if(i < t->off)
+	r = k - 1;
+      else if(i >= t->off + t->cnt)
+	l = k + 1;
+      else
+	break;
+    }
+  t = &tm->targets[k];
+
+  if(t->addr != NULL)
+    {
+      memcpy(addr, t->addr, sizeof(scamper_addr_t));
+      return;
+    }
+
+  in->s_addr = htonl(t->net + ((i - t->off) << 8) + tm->hostid);
+  memset(addr, 0, sizeof(scamper_addr_t));
+  addr->type = SCAMPER_ADDR_TYPE_IPV4;
+  addr->addr = in;
+  return;
+}
+
+/*
+ * tracemap_cksum
+ *
+ * the value placed in the IPv4 ID field of a probe to the destination.
+ */
+static uint16_t tracemap_cksum(const tracemap_t *tm, const void *addr)
+{
+  const uint8_t *a = addr;
+  return (((a[0] << 8) | a[1]) ^ ((a[2] << 8) | a[3]) ^ tm->icmpid);
+}
+
+static void tracemap_finish(scamper_task_t *task)
+{
+  scamper_task_queue_done(task, 0);
+  return;
+}
+
+/*
+ * tracemap_output
+ *
+ * write out the traces recorded so far, and free them.
+ */
+static void tracemap_output(scamper_task_t *task)
+{
+  tracemap_t *tm = tracemap_getdata(task);
+  scamper_trace_t *trace;
+
+  scamper_task_output(task);
+  while((trace = slist_head_pop(tm->traces)) != NULL)
+    scamper_trace_free(trace);
+  return;
+}
+
+/*
+ * tracemap_reply
+ *
+ * build a single hop trace from a reply to one of the probes.
+ */
+static int tracemap_reply(scamper_task_t *task, scamper_icmp_resp_t *ir,
+			  scamper_addr_t *dst, uint8_t ttl, uint16_t seq)
+{
+  tracemap_t *tm = tracemap_getdata(task);
+  scamper_trace_t *trace = NULL;
+  scamper_trace_hop_t *hop = NULL;
+  struct timeval tx;
+  scamper_addr_t addr;
+  uint32_t rx_ms, tx_ms;
+
+  /*
+   * the ICMP seq holds the low 16 bits of the millisecond the probe
+   * was sent; the most recent time with those bits is the one.
+   */
+  rx_ms = timeval_diff_ms(&ir->ir_rx, &tm->start);
+  tx_ms = rx_ms - ((uint16_t)(rx_ms - seq));
+  timeval_add_ms(&tx, &tm->start, tx_ms);
+
+  if(scamper_icmp_resp_src(ir, &addr) != 0)
+    goto err;
+
+  if((trace = scamper_trace_alloc()) == NULL ||
+     scamper_trace_hops_alloc(trace, ttl) != 0 ||
+     (hop = scamper_trace_hop_alloc()) == NULL ||
+     (trace->dst = scamper_addrcache_get(addrcache, dst->type,
+					 dst->addr)) == NULL ||
+     (hop->hop_addr = scamper_addrcache_get(addrcache, addr.type,
+					    addr.addr)) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not alloc trace");
+      goto err;
+    }
+
+  trace->list      = scamper_list_use(tm->list);
+  trace->cycle     = scamper_cycle_use(tm->cycle);
+  trace->userid    = tm->userid;
+  trace->src       = scamper_addr_use(tm->src);
+  trace->type      = SCAMPER_TRACE_TYPE_ICMP_ECHO;
+  trace->attempts  = 1;
+  trace->hoplimit  = tm->hoplimit;
+  trace->firsthop  = ttl;
+  trace->wait      = tm->wait;
+  trace->sport     = tm->icmpid | ttl;
+  trace->probec    = 1;
+  trace->hop_count = ttl;
+  timeval_cpy(&trace->start, &tx);
+
+  if(tm->af == AF_INET)
+    trace->probe_size = 20 + 8;
+  else
+    trace->probe_size = 40 + 8;
+
+  if(SCAMPER_ICMP_RESP_IS_ECHO_REPLY(ir))
+    trace->stop_reason = SCAMPER_TRACE_STOP_COMPLETED;
+  else if(SCAMPER_ICMP_RESP_IS_UNREACH(ir))
+    {
+      trace->stop_reason = SCAMPER_TRACE_STOP_UNREACH;
+      trace->stop_data   = ir->ir_icmp_code;
+    }
+
+  hop->hop_probe_ttl  = ttl;
+  hop->hop_probe_size = trace->probe_size;
+  hop->hop_reply_size = ir->ir_ip_size;
+  hop->hop_icmp_type  = ir->ir_icmp_type;
+  hop->hop_icmp_code  = ir->ir_icmp_code;
+  hop->hop_flags      = SCAMPER_TRACE_HOP_FLAG_TS_MS;
+  timeval_diff_tv(&hop->hop_rtt, &tx, &ir->ir_rx);
+
+  if(ir->ir_ip_ttl != -1)
+    {
+      hop->hop_reply_ttl = (uint8_t)ir->ir_ip_ttl;
+      hop->hop_flags |= SCAMPER_TRACE_HOP_FLAG_REPLY_TTL;
+    }
+  if(ir->ir_flags & SCAMPER_ICMP_RESP_FLAG_KERNRX)
+    hop->hop_flags |= SCAMPER_TRACE_HOP_FLAG_TS_SOCK_RX;
+
+  if(ir->ir_af == AF_INET)
+    {
+      hop->hop_reply_ipid = ir->ir_ip_id;
+      hop->hop_reply_tos  = ir->ir_ip_tos;
+    }
+
+  if(SCAMPER_ICMP_RESP_INNER_IS_SET(ir))
+    {
+      hop->hop_icmp_q_ttl = ir->ir_inner_ip_ttl;
+      hop->hop_icmp_q_ipl = ir->ir_inner_ip_size;
+      if(ir->ir_af == AF_INET)
+	hop->hop_icmp_q_tos = ir->ir_inner_ip_tos;
+    }
+
+  if(ir->ir_ext != NULL &&
+     scamper_icmpext_parse(&hop->hop_icmpext,ir->ir_ext,ir->ir_extlen) != 0)
+    goto err;
+
+  trace->hops[ttl-1] = hop; hop = NULL;
+
+  if(slist_tail_push(tm->traces, trace) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not push trace");
+      goto err;
+    }
+
+  if(slist_count(tm->traces) >= SCAMPER_DO_TRACEMAP_TRACES_MAX)
+    tracemap_output(task);
+
+  return 0;
+
+ err:
+  if(hop != NULL) scamper_trace_hop_free(hop);
+  if(trace != NULL) scamper_trace_free(trace);
+  return -1;
+}
+
+static void do_tracemap_handle_icmp(scamper_task_t *task,
+				    scamper_icmp_resp_t *ir)
+{
+  tracemap_t *tm = tracemap_getdata(task);
+  scamper_addr_t dst;
+  uint16_t id, seq;
+  uint8_t ttl;
+
+  if(SCAMPER_ICMP_RESP_IS_ECHO_REPLY(ir))
+    {
+      if(scamper_icmp_resp_src(ir, &dst) != 0)
+	return;
+      id  = ir->ir_icmp_id;
+      seq = ir->ir_icmp_seq;
+    }
+  else if((SCAMPER_ICMP_RESP_IS_TTL_EXP(ir) ||
+	   SCAMPER_ICMP_RESP_IS_UNREACH(ir)) &&
+	  SCAMPER_ICMP_RESP_INNER_IS_SET(ir) &&
+	  SCAMPER_ICMP_RESP_INNER_IS_ICMP_ECHO_REQ(ir))
+    {
+      if(scamper_icmp_resp_inner_dst(ir, &dst) != 0)
+	return;
+
+      /* the destination was rewritten on the way */
+      if(ir->ir_af == AF_INET &&
+	 ir->ir_inner_ip_id != tracemap_cksum(tm, dst.addr))
+	return;
+
+      id  = ir->ir_inner_icmp_id;
+      seq = ir->ir_inner_icmp_seq;
+    }
+  else return;
+
+  if((id & 0xff00) != tm->icmpid || scamper_addr_af(&dst) != tm->af)
+    return;
+  ttl = id & 0xff;
+  if(ttl < tm->firsthop || ttl > tm->hoplimit)
+    return;
+
+  if(tracemap_reply(task, ir, &dst, ttl, seq) != 0)
+    tracemap_finish(task);
+  return;
+}
+
+static void do_tracemap_handle_timeout(scamper_task_t *task)
+{
+  tracemap_state_t *state = tracemap_getstate(task);
+
+  /* wait for replies to the last probes sent before finishing */
+  if(state->sent == state->pairc)
+    tracemap_finish(task);
+  return;
+}
+
+static void tracemap_state_free(tracemap_state_t *state)
+{
+  if(state == NULL)
+    return;
+  if(state->icmp != NULL)
+    scamper_fd_free(state->icmp);
+  free(state);
+  return;
+}
+
+static int tracemap_state_alloc(scamper_task_t *task)
+{
+  tracemap_t *tm = tracemap_getdata(task);
+  tracemap_state_t *state = NULL;
+  uint32_t u32[2];
+
+  if((state = malloc_zero(sizeof(tracemap_state_t))) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not malloc state");
+      goto err;
+    }
+  scamper_task_setstate(task, state);
+
+  if(tm->af == AF_INET)
+    state->icmp = scamper_fd_icmp4(tm->src->addr);
+  else
+    state->icmp = scamper_fd_icmp6(tm->src->addr);
+  if(state->icmp == NULL)
+    goto err;
+
+  state->pairc = (uint64_t)tm->dstc * (tm->hoplimit - tm->firsthop + 1);
+  while(state->mask < state->pairc - 1)
+    state->mask = (state->mask << 1) | 1;
+
+  if(random_u32(&u32[0]) != 0 || random_u32(&u32[1]) != 0)
+    goto err;
+  state->x = (((uint64_t)u32[0] << 32) | u32[1]) & state->mask;
+  if(random_u32(&u32[0]) != 0 || random_u32(&u32[1]) != 0)
+    goto err;
+  state->inc = (((uint64_t)u32[0] << 32) | u32[1]) | 1;
+
+  return 0;
+
+ err:
+  return -1;
+}
+
+/*
+ * tracemap_next
+ *
+ * return the index of the next (destination, TTL) pair to probe.
+ */
+static uint64_t tracemap_next(tracemap_state_t *state)
+{
+  do
+    {
+      state->x = (state->x * 6364136223846793005ULL + state->inc);
+      state->x &= state->mask;
+    }
+  while(state->x >= state->pairc);
+  return state->x;
+}
+
+static void do_tracemap_probe(scamper_task_t *task)
+{
+  tracemap_t *tm = tracemap_getdata(task);
+  tracemap_state_t *state = tracemap_getstate(task);
+  scamper_probe_t probe;
+  scamper_addr_t dst;
+  struct in_addr in;
+  struct timeval tv;
+  uint64_t i, ttlc;
+  uint32_t ms;
+  uint8_t ttl;
+
+  if(state == NULL)
+    {
+      gettimeofday_wrap(&tm->start);
+      if(tracemap_state_alloc(task) != 0)
+	{
+	  tracemap_finish(task);
+	  return;
+	}
+      state = tracemap_getstate(task);
+    }
+
+  ttlc = tm->hoplimit - tm->firsthop + 1;
+  i    = tracemap_next(state);
+  ttl  = tm->firsthop + (i % ttlc);
+  tracemap_dst(tm, i / ttlc, &dst, &in);
+
+  gettimeofday_wrap(&tv);
+  ms = timeval_diff_ms(&tv, &tm->start);
+
+  memset(&probe, 0, sizeof(probe));
+  probe.pr_ip_src = tm->src;
+  probe.pr_ip_dst = &dst;
+  probe.pr_ip_ttl = ttl;
+  probe.pr_fd     = scamper_fd_fd_get(state->icmp);
+  if(tm->af == AF_INET)
+    {
+      probe.pr_ip_proto = IPPROTO_ICMP;
+      probe.pr_ip_id    = tracemap_cksum(tm, dst.addr);
+    }
+  else
+    {
+      probe.pr_ip_proto = IPPROTO_ICMPV6;
+    }
+  SCAMPER_PROBE_ICMP_ECHO(&probe, tm->icmpid | ttl, ms & 0xffff);
+
+  /* an error sending a single probe does not stop the measurement */
+  if(scamper_probe(&probe) == 0)
+    tm->probec++;
+
+  if(++state->sent < state->pairc)
+    scamper_task_queue_probe(task);
+  else
+    scamper_task_queue_wait(task, tm->wait * 1000);
+  return;
+}
+
+static void do_tracemap_write(scamper_file_t *sf, scamper_task_t *task)
+{
+  tracemap_t *tm = tracemap_getdata(task);
+  slist_node_t *n;
+
+  for(n=slist_head_node(tm->traces); n != NULL; n=slist_node_next(n))
+    scamper_file_write_trace(sf, slist_node_item(n));
+  return;
+}
+
+static void do_tracemap_halt(scamper_task_t *task)
+{
+  tracemap_finish(task);
+  return;
+}
+
+static void do_tracemap_free(scamper_task_t *task)
+{
+  tracemap_t *tm;
+  tracemap_state_t *state;
+
+  if((tm = tracemap_getdata(task)) != NULL)
+    tracemap_free(tm);
+
+  if((state = tracemap_getstate(task)) != NULL)
+    tracemap_state_free(state);
+
+  return;
+}
+
+static int tracemap_arg_param_validate(int optid, char *param, long *out)
+{
+  long tmp = 0;
+
+  switch(optid)
+    {
+    case TRACEMAP_OPT_FIRSTHOP:
+      if(string_tolong(param, &tmp) != 0 ||
+	 tmp < SCAMPER_DO_TRACEMAP_FIRSTHOP_MIN ||
+	 tmp > SCAMPER_DO_TRACEMAP_FIRSTHOP_MAX)
+	goto err;
+      break;
+
+    case TRACEMAP_OPT_MAXTTL:
+      if(string_tolong(param, &tmp) != 0 ||
+	 tmp < SCAMPER_DO_TRACEMAP_HOPLIMIT_MIN ||
+	 tmp > SCAMPER_DO_TRACEMAP_HOPLIMIT_MAX)
+	goto err;
+      break;
+
+    case TRACEMAP_OPT_SRCADDR:
+      break;
+
+    case TRACEMAP_OPT_USERID:
+      if(string_tolong(param, &tmp) != 0 || tmp < 0)
+	goto err;
+      break;
+
+    case TRACEMAP_OPT_WAIT:
+      if(string_tolong(param, &tmp) != 0 ||
+	 tmp < SCAMPER_DO_TRACEMAP_WAIT_MIN ||
+	 tmp > SCAMPER_DO_TRACEMAP_WAIT_MAX)
+	goto err;
+      break;
+
+    default:
+      return -1;
+    }
+
+  if(out != NULL)
+    *out = tmp;
+  return 0;
+
+ err:
+  return -1;
+}
+
+int scamper_do_tracemap_arg_validate(int argc, char *argv[], int *stop)
+{
+  return scamper_options_validate(opts, opts_cnt, argc, argv, stop,
+				  tracemap_arg_param_validate);
+}
+
+/*
+ * tracemap_target_add
+ *
+ * parse an address, or an IPv4 prefix no longer than a /24, and add it
+ * to the set of destinations.
+ */
+static int tracemap_target_add(tracemap_t *tm, char *str)
+{
+  tracemap_target_t *t;
+  scamper_addr_t *sa = NULL;
+  char *pf = NULL;
+  size_t len;
+  long plen;
+  uint32_t cnt;
+
+  string_nullterm_char(str, '/', &pf);
+
+  if((sa = scamper_addrcache_resolve(addrcache, AF_UNSPEC, str)) == NULL)
+    goto err;
+
+  if(pf != NULL)
+    {
+      if(sa->type != SCAMPER_ADDR_TYPE_IPV4 ||
+	 string_tolong(pf, &plen) != 0 || plen < 0 || plen > 24)
+	goto err;
+      cnt = 1 << (24 - plen);
+    }
+  else cnt = 1;
+
+  if(tm->targetc == 0)
+    tm->af = scamper_addr_af(sa);
+  else if(scamper_addr_af(sa) != tm->af)
+    goto err;
+
+  if(tm->dstc > 0xffffffff - cnt)
+    goto err;
+
+  len = sizeof(tracemap_target_t) * (tm->targetc + 1);
+  if(realloc_wrap((void **)&tm->targets, len) != 0)
+    goto err;
+  t = &tm->targets[tm->targetc++];
+  memset(t, 0, sizeof(tracemap_target_t));
+  t->off = tm->dstc;
+  t->cnt = cnt;
+  if(pf != NULL)
+    {
+      t->net = ntohl(((struct in_addr *)sa->addr)->s_addr);
+      t->net &= (0xffffffff << (32 - plen)) & 0xffffff00;
+      scamper_addr_free(sa);
+    }
+  else t->addr = sa;
+  tm->dstc += cnt;
+
+  return 0;
+
+ err:
+  if(sa != NULL) scamper_addr_free(sa);
+  return -1;
+}
+
+void *scamper_do_tracemap_alloc(char *str)
+{
+  scamper_option_out_t *opts_out = NULL, *opt;
+  tracemap_t *tm = NULL;
+  scamper_addr_t dst;
+  struct in_addr in;
+  uint8_t firsthop = SCAMPER_DO_TRACEMAP_FIRSTHOP_DEF;
+  uint8_t hoplimit = SCAMPER_DO_TRACEMAP_HOPLIMIT_DEF;
+  uint8_t wait = SCAMPER_DO_TRACEMAP_WAIT_DEF;
+  uint32_t userid = 0;
+  char *expr = NULL, *next;
+  char *src = NULL;
+  uint8_t u8;
+  long tmp = 0;
+
+  /* try and parse the string passed in */
+  if(scamper_options_parse(str, opts, opts_cnt, &opts_out, &expr) != 0)
+    goto err;
+
+  if(expr == NULL)
+    goto err;
+
+  /* parse the options, do preliminary sanity checks */
+  for(opt = opts_out; opt != NULL; opt = opt->next)
+    {
+      if(opt->type != SCAMPER_OPTION_TYPE_NULL &&
+	 tracemap_arg_param_validate(opt->id, opt->str, &tmp) != 0)
+	{
+	  scamper_debug(__func__, "validation of optid %d failed", opt->id);
+	  goto err;
+	}
+
+      switch(opt->id)
+	{
+	case TRACEMAP_OPT_FIRSTHOP:
+	  firsthop = (uint8_t)tmp;
+	  break;
+
+	case TRACEMAP_OPT_MAXTTL:
+	  hoplimit = (uint8_t)tmp;
+	  break;
+
+	case TRACEMAP_OPT_SRCADDR:
+	  src = opt->str;
+	  break;
+
+	case TRACEMAP_OPT_USERID:
+	  userid = (uint32_t)tmp;
+	  break;
+
+	case TRACEMAP_OPT_WAIT:
+	  wait = (uint8_t)tmp;
+	  break;
+	}
+    }
+  scamper_options_free(opts_out); opts_out = NULL;
+
+  if(firsthop > hoplimit)
+    goto err;
+
+  if((tm = malloc_zero(sizeof(tracemap_t))) == NULL ||
+     (tm->traces = slist_alloc()) == NULL)
+    {
+      printerror(errno, strerror, __func__, "could not alloc tracemap");
+      goto err;
+    }
+
+  /* the destinations are separated by white space */
+  while(*expr != '\0')
+    {
+      while(isspace((int)*expr))
+	expr++;
+      if(*expr == '\0')
+	break;
+      next = expr;
+      while(*next != '\0' && isspace((int)*next) == 0)
+	next++;
+      if(*next != '\0')
+	*next++ = '\0';
+      if(tracemap_target_add(tm, expr) != 0)
+	{
+	  scamper_debug(__func__, "invalid destination %s", expr);
+	  goto err;
+	}
+      expr = next;
+    }
+  if(tm->targetc == 0)
+    goto err;
+
+  /* use a host in each /24 that is neither the network nor broadcast */
+  if(random_u8(&u8) != 0)
+    goto err;
+  tm->hostid = 1 + (u8 % 254);
+
+  if(src != NULL)
+    {
+      if((tm->src = scamper_addrcache_resolve(addrcache, tm->af, src)) == NULL)
+	goto err;
+    }
+  else
+    {
+      tracemap_dst(tm, 0, &dst, &in);
+      if((tm->src = scamper_getsrc(&dst, 0)) == NULL)
+	goto err;
+    }
+
+  /*
+   * the low byte of the ICMP id carries the TTL.  the high byte is one
+   * that ping and trace do not use for echo requests.
+   */
+  tm->icmpid   = scamper_icmpid_reserved();
+  tm->firsthop = firsthop;
+  tm->hoplimit = hoplimit;
+  tm->wait     = wait;
+  tm->userid   = userid;
+
+  return tm;
+
+ err:
+  if(tm != NULL) tracemap_free(tm);
+  if(opts_out != NULL) scamper_options_free(opts_out);
+  return NULL;
+}
+
+scamper_task_t *scamper_do_tracemap_alloctask(void *data,
+					      scamper_list_t *list,
+					      scamper_cycle_t *cycle)
+{
+  tracemap_t *tm = (tracemap_t *)data;
+  scamper_task_t *task = NULL;
+  scamper_task_sig_t *sig = NULL;
+
+  /* allocate a task structure and store the tracemap with it */
+  if((task = scamper_task_alloc(tm, &tracemap_funcs)) == NULL)
+    goto err;
+
+  /* replies are matched by the high byte of the ICMP id */
+  if((sig = scamper_task_sig_alloc(SCAMPER_TASK_SIG_TYPE_ICMP)) == NULL)
+    goto err;
+  sig->sig_icmp_id   = tm->icmpid;
+  sig->sig_icmp_mask = 0xff00;
+  if(scamper_task_sig_add(task, sig) != 0)
+    goto err;
+  sig = NULL;
+
+  /* associate the list and cycle with the tracemap */
+  tm->list  = scamper_list_use(list);
+  tm->cycle = scamper_cycle_use(cycle);
+
+  return task;
+
+ err:
+  if(sig != NULL) scamper_task_sig_free(sig);
+  if(task != NULL)
+    {
+      scamper_task_setdatanull(task);
+      scamper_task_free(task);
+    }
+  return NULL;
+}
+
+void scamper_do_tracemap_free(void *data)
+{
+  tracemap_free((tracemap_t *)data);
+  return;
+}
+
+void scamper_do_tracemap_cleanup(void)
+{
+  return;
+}
+
+int scamper_do_tracemap_init(void)
+{
+  tracemap_funcs.probe          = do_tracemap_probe;
+  tracemap_funcs.handle_icmp    = do_tracemap_handle_icmp;
+  tracemap_funcs.handle_timeout = do_tracemap_handle_timeout;
+  tracemap_funcs.write          = do_tracemap_write;
+  tracemap_funcs.task_free      = do_tracemap_free;
+  tracemap_funcs.halt           = do_tracemap_halt;
+  return 0;
+}
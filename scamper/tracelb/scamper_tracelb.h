@@ -49,6 +49,14 @@ typedef struct scamper_tracelb_probeset scamper_tracelb_probeset_t;
 #define SCAMPER_TRACELB_TYPE_TCP_SPORT      0x04 /* vary tcp-sport */
 #define SCAMPER_TRACELB_TYPE_TCP_ACK_SPORT  0x05 /* tcp-ack, vary sport */
 
+/*
+ * these values give the 'flags' member of a scamper_tracelb_t structure
+ * some meaning.
+ */
+#define SCAMPER_TRACELB_FLAG_MDALITE        0x01 /* probe with MDA-Lite */
+#define SCAMPER_TRACELB_FLAG_MDALITE_FULL   0x02 /* fell back to full MDA */
+#define SCAMPER_TRACELB_FLAG_RTTWAIT        0x04 /* wait from rtt estimates */
+
 /*
  * these values give the 'flags' member of a scamper_tracelb_node_t
  * structure some meaning.
@@ -223,6 +231,7 @@ typedef struct scamper_tracelb
   uint8_t                    confidence;   /* confidence level to attain */
   uint8_t                    tos;          /* type-of-service byte to use */
   uint8_t                    gaplimit;     /* max consecutive unresp. hops */
+  uint8_t                    flags;        /* flags */
   uint32_t                   probec_max;   /* max number of probes to send */
 
   /*
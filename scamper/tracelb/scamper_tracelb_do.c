@@ -57,6 +57,7 @@ static const char rcsid[] =
 #include "scamper_file.h"
 #include "scamper_options.h"
 #include "scamper_debug.h"
+#include "scamper_rtt.h"
 #include "scamper_tracelb_do.h"
 #include "utils.h"
 #include "mjl_list.h"
@@ -211,8 +212,28 @@ typedef struct tracelb_branch
   int                      newnodec;
   tracelb_probe_t        **probes;
   int                      probec;
+  int                      litestop;     /* stopped by the MDA-Lite rule */
+  int                      reprobe;      /* re-probing a hop with full MDA */
 } tracelb_branch_t;
 
+/*
+ * tracelb_lite
+ *
+ * with MDA-Lite, the branches probing forward from each of the successors
+ * of a load balancer at the same TTL share the count of probes sent to
+ * that hop, and the count of distinct interfaces that replied at it, to
+ * decide when the hop has been probed enough.
+ */
+typedef struct tracelb_lite
+{
+  scamper_tracelb_node_t  *node;         /* the load balancer */
+  uint8_t                  ttl;          /* ttl of the hop probed */
+  int                      k;            /* # of probes replied to or lost */
+  scamper_addr_t         **addrs;        /* distinct interfaces at the hop */
+  int                      addrc;        /* count of interfaces */
+  int                      succ;         /* # of successors of a branch */
+} tracelb_lite_t;
+
 /*
  * tracelb_probe
  *
@@ -257,6 +278,10 @@ typedef struct tracelb_state
   int                      linkc;        /* count of links */
   tracelb_path_t         **paths;        /* paths established */
   int                      pathc;        /* count of paths */
+  tracelb_lite_t         **lites;        /* MDA-Lite hops probed */
+  int                      litec;        /* count of MDA-Lite hops */
+  tracelb_link_t         **held;         /* links to hops MDA-Lite stopped */
+  int                      heldc;        /* count of held links */
 } tracelb_state_t;
 
 /* address cache used to avoid reallocating the same address multiple times */
@@ -281,12 +306,14 @@ static scamper_task_funcs_t funcs;
 #define TRACE_OPT_USERID       10
 #define TRACE_OPT_WAITTIMEOUT  11
 #define TRACE_OPT_WAITPROBE    12
+#define TRACE_OPT_OPTION       13
 
 static const scamper_option_in_t opts[] = {
   {'c', NULL, TRACE_OPT_CONFIDENCE,  SCAMPER_OPTION_TYPE_NUM},
   {'d', NULL, TRACE_OPT_DPORT,       SCAMPER_OPTION_TYPE_NUM},
   {'f', NULL, TRACE_OPT_FIRSTHOP,    SCAMPER_OPTION_TYPE_NUM},
   {'g', NULL, TRACE_OPT_GAPLIMIT,    SCAMPER_OPTION_TYPE_NUM},
+  {'O', NULL, TRACE_OPT_OPTION,      SCAMPER_OPTION_TYPE_STR},
   {'P', NULL, TRACE_OPT_PROTOCOL,    SCAMPER_OPTION_TYPE_STR},
   {'q', NULL, TRACE_OPT_ATTEMPTS,    SCAMPER_OPTION_TYPE_NUM},
   {'Q', NULL, TRACE_OPT_PROBECMAX,   SCAMPER_OPTION_TYPE_NUM},
@@ -301,8 +328,9 @@ static const int opts_cnt = SCAMPER_OPTION_COUNT(opts);
 const char *scamper_do_tracelb_usage(void)
 {
   return "tracelb [-c confidence] [-d dport] [-f firsthop] [-g gaplimit]\n"
-         "        [-P method] [-q attempts] [-Q maxprobec] [-s sport]\n"
-         "        [-t tos] [-U userid] [-w wait-timeout] [-W wait-probe]";
+         "        [-O option] [-P method] [-q attempts] [-Q maxprobec]\n"
+         "        [-s sport] [-t tos] [-U userid] [-w wait-timeout]\n"
+         "        [-W wait-probe]";
 }
 
 static tracelb_state_t *tracelb_getstate(const scamper_task_t *task)
@@ -366,6 +394,201 @@ static void tracelb_handleerror(scamper_task_t *task, int err)
   return;
 }
 
+/*
+ * tracelb_mdalite
+ *
+ * return non-zero if the tracelb was asked to use MDA-Lite and has not
+ * yet switched to the full MDA.
+ */
+static int tracelb_mdalite(const scamper_tracelb_t *trace)
+{
+  return (trace->flags & (SCAMPER_TRACELB_FLAG_MDALITE |
+			  SCAMPER_TRACELB_FLAG_MDALITE_FULL)) ==
+    SCAMPER_TRACELB_FLAG_MDALITE;
+}
+
+/*
+ * tracelb_mdalite_full
+ *
+ * the topology does not fit the assumptions MDA-Lite makes, so probe the
+ * rest of the way with the full MDA.
+ */
+static void tracelb_mdalite_full(scamper_tracelb_t *trace, const char *why)
+{
+  scamper_debug(__func__, "%s, using full MDA", why);
+  trace->flags |= SCAMPER_TRACELB_FLAG_MDALITE_FULL;
+  return;
+}
+
+static void tracelb_lite_free(tracelb_lite_t *lite)
+{
+  int i;
+
+  if(lite->addrs != NULL)
+    {
+      for(i=0; i<lite->addrc; i++)
+	scamper_addr_free(lite->addrs[i]);
+      free(lite->addrs);
+    }
+  free(lite);
+  return;
+}
+
+/*
+ * tracelb_lite_get
+ *
+ * return the MDA-Lite record for the hop the branch is probing, if the
+ * branch is probing forward from one of the successors of a load
+ * balancer.  the record is shared with the branches probing forward from
+ * the load balancer's other successors at the same TTL.
+ */
+static tracelb_lite_t *tracelb_lite_get(scamper_tracelb_t *trace,
+					tracelb_state_t *state,
+					tracelb_branch_t *br, int create)
+{
+  scamper_tracelb_node_t *node;
+  tracelb_path_t *path = br->path;
+  tracelb_lite_t *lite = NULL;
+  uint8_t ttl = 0;
+  int i;
+
+  if(tracelb_mdalite(trace) == 0 ||
+     (br->mode != MODE_HOPPROBE && br->mode != MODE_PERPACKET) ||
+     path == NULL || path->linkc == 0)
+    return NULL;
+
+  node = path->links[0]->link->from;
+  if(node->linkc < 2)
+    return NULL;
+
+  for(i=br->probec-1; i>=0; i--)
+    {
+      if(br->probes[i]->mode == MODE_HOPPROBE)
+	{
+	  ttl = br->probes[i]->probe->ttl;
+	  break;
+	}
+    }
+  if(ttl == 0)
+    return NULL;
+
+  for(i=0; i<state->litec; i++)
+    if(state->lites[i]->node == node && state->lites[i]->ttl == ttl)
+      return state->lites[i];
+
+  if(create == 0)
+    return NULL;
+
+  if((lite = malloc_zero(sizeof(tracelb_lite_t))) == NULL ||
+     array_insert((void ***)&state->lites, &state->litec, lite, NULL) != 0)
+    {
+      printerror(errno, strerror, __func__, "could not alloc lite");
+      if(lite != NULL) free(lite);
+      return NULL;
+    }
+  lite->node = node;
+  lite->ttl  = ttl;
+
+  return lite;
+}
+
+/*
+ * tracelb_lite_reply
+ *
+ * note a reply at the hop, and the interface it came from if it has not
+ * been seen at the hop before.
+ */
+static int tracelb_lite_reply(tracelb_lite_t *lite, scamper_addr_t *addr)
+{
+  int i;
+
+  lite->k++;
+  for(i=0; i<lite->addrc; i++)
+    if(scamper_addr_cmp(lite->addrs[i], addr) == 0)
+      return 0;
+
+  if(array_insert((void ***)&lite->addrs, &lite->addrc, addr, NULL) != 0)
+    {
+      printerror(errno, strerror, __func__, "could not add addr");
+      return -1;
+    }
+  scamper_addr_use(addr);
+  return 0;
+}
+
+/*
+ * tracelb_lite_done
+ *
+ * MDA-Lite assumes the diamond is uniform and unmeshed: each successor of
+ * the load balancer forwards to its own set of interfaces at the hop, the
+ * sets are the same size, and no interface is reached from more than one
+ * successor.  flows are then spread evenly over all of the interfaces at
+ * the hop, so the hop has been probed enough once the probes sent from
+ * all of the successors together reach the confidence level for the
+ * number of interfaces seen at the hop, and each branch has had a reply.
+ * if the diamond turns out to be unequal or meshed, the hops stopped this
+ * way are probed again with the full MDA.
+ */
+static int tracelb_lite_done(scamper_tracelb_t *trace, tracelb_state_t *state,
+			     tracelb_branch_t *br)
+{
+  tracelb_lite_t *lite;
+  int n;
+
+  if(br->k < 1 || (lite = tracelb_lite_get(trace, state, br, 0)) == NULL ||
+     lite->addrc < 1)
+    return 0;
+
+  n = TRACELB_CONFIDENCE_NLIMIT(lite->addrc+1);
+  if(lite->k < k(state, n))
+    return 0;
+
+  br->litestop = 1;
+  return 1;
+}
+
+/*
+ * tracelb_node_link
+ *
+ * return the link from one node directly to another, if there is one.
+ */
+static scamper_tracelb_link_t *tracelb_node_link(scamper_tracelb_node_t *from,
+						 scamper_tracelb_node_t *to)
+{
+  int i;
+
+  for(i=0; i<from->linkc; i++)
+    if(from->links[i]->to == to && from->links[i]->hopc == 1)
+      return from->links[i];
+
+  return NULL;
+}
+
+/*
+ * tracelb_paths_meshed
+ *
+ * return non-zero if a path segment is reached from a path segment that
+ * also leads somewhere else, which happens when the successors of one
+ * hop in a diamond each forward to more than one interface in the next.
+ */
+static int tracelb_paths_meshed(const tracelb_state_t *state)
+{
+  tracelb_path_t *path;
+  int i, j;
+
+  for(i=0; i<state->pathc; i++)
+    {
+      path = state->paths[i];
+      if(path->backc < 2)
+	continue;
+      for(j=0; j<path->backc; j++)
+	if(path->back[j]->fwdc > 1)
+	  return 1;
+    }
+
+  return 0;
+}
+
 #ifdef NDEBUG
 #define tracelb_paths_assert(state) ((void)0)
 #define tracelb_paths_dump(state) ((void)0)
@@ -1390,6 +1613,47 @@ static void tracelb_branch_reset(tracelb_branch_t *branch)
   return;
 }
 
+/*
+ * tracelb_reprobe_discard
+ *
+ * free the records of probes a branch sent to re-probe a hop that were not
+ * recorded with a link, as nothing else will: either all of the probes
+ * sent to the hop, or those sent with a flowid that never got a reply.
+ * the branch no longer references the records once it is freed.
+ */
+static void tracelb_reprobe_discard(tracelb_branch_t *br, int all)
+{
+  tracelb_probe_t *pr;
+  int i, j, rx;
+
+  for(i=0; i<br->probec; i=j)
+    {
+      rx = 0;
+      for(j=i; j<br->probec; j++)
+	{
+	  pr = br->probes[j];
+	  if(pr->probe->flowid != br->probes[i]->probe->flowid)
+	    break;
+	  if(pr->mode == MODE_HOPPROBE && pr->probe->rxc > 0)
+	    rx = 1;
+	}
+
+      if(all == 0 && rx != 0)
+	continue;
+
+      while(i<j)
+	{
+	  pr = br->probes[i++];
+	  if(pr->mode != MODE_HOPPROBE)
+	    continue;
+	  scamper_tracelb_probe_free(pr->probe);
+	  pr->probe = NULL;
+	}
+    }
+
+  return;
+}
+
 static void tracelb_branch_free(tracelb_state_t *state, tracelb_branch_t *br)
 {
   int i;
@@ -1500,16 +1764,17 @@ static void tracelb_path_distance(tracelb_state_t *state,
 }
 
 /*
- * tracelb_paths_splice
+ * tracelb_path_split
  *
- * `path0' shares a link or node in common with `path'.  take path, split
- * it into two parts.
+ * split `path' into two parts after the first linkc links.  the new path
+ * returned holds the first part, and `path' is left with the second part
+ * and the new path as its only back path.
  */
-static int tracelb_paths_splice(tracelb_state_t *state, tracelb_path_t *path0,
-				tracelb_path_t *path, int linkc)
+static tracelb_path_t *tracelb_path_split(tracelb_state_t *state,
+					  tracelb_path_t *path, int linkc)
 {
   tracelb_path_t *newp;
-  int i, j, d;
+  int i, j;
 
   /*
    * allocate a new path.  the new path will have the first half of `path'
@@ -1517,7 +1782,7 @@ static int tracelb_paths_splice(tracelb_state_t *state, tracelb_path_t *path0,
    */
   if((newp = tracelb_path_alloc(state, linkc)) == NULL)
     {
-      return -1;
+      return NULL;
     }
 
   /* the new path inherits the back paths from the existing `path' */
@@ -1558,20 +1823,33 @@ static int tracelb_paths_splice(tracelb_state_t *state, tracelb_path_t *path0,
       path->linkc = 0;
     }
 
-  /* the path now has two back pointers; add them */
-  if(tracelb_path_add_back(path, newp)  != 0 ||
+  if(tracelb_path_add_back(path, newp) != 0)
+    return NULL;
+
+  /* make sure the measure of distance for path segments are correct */
+  newp->distance = path->distance;
+  tracelb_path_distance(state, path, path->distance + 1);
+
+  return newp;
+}
+
+/*
+ * tracelb_paths_splice
+ *
+ * `path0' shares a link or node in common with `path'.  take path, split
+ * it into two parts, the second of which is reached from both.
+ */
+static int tracelb_paths_splice(tracelb_state_t *state, tracelb_path_t *path0,
+				tracelb_path_t *path, int linkc)
+{
+  if(tracelb_path_split(state, path, linkc) == NULL ||
      tracelb_path_add_back(path, path0) != 0)
     {
       return -1;
     }
 
-  /* make sure the measure of distance for path segments are correct */
-  newp->distance = path->distance;
-  if(path0->distance > path->distance)
-    d = path0->distance + 1;
-  else
-    d = path->distance + 1;
-  tracelb_path_distance(state, path, d);
+  if(path0->distance + 1 > path->distance)
+    tracelb_path_distance(state, path, path0->distance + 1);
 
   return 0;
 }
@@ -1637,6 +1915,59 @@ static int tracelb_paths_splice_bynode(tracelb_state_t *state,
   return 0;
 }
 
+/*
+ * tracelb_held_reprobe
+ *
+ * tracelb has fallen back to the full MDA, so the hops MDA-Lite stopped
+ * probing early have not been probed to the confidence level.  probe each
+ * of them again from the interface before it: the path is split after
+ * the link to that interface if it has been extended past it, and a
+ * branch is queued on the part ending at the interface.
+ */
+static int tracelb_held_reprobe(tracelb_state_t *state)
+{
+  tracelb_branch_t *branch;
+  tracelb_path_t *path;
+  tracelb_link_t *tlbl;
+  int i, j;
+
+  for(i=0; i<state->heldc; i++)
+    {
+      tlbl = state->held[i];
+      path = tlbl->path;
+      for(j=0; j<path->linkc; j++)
+	if(path->links[j] == tlbl)
+	  break;
+      assert(j != path->linkc);
+
+      if(j+1 < path->linkc &&
+	 (path = tracelb_path_split(state, path, j+1)) == NULL)
+	return -1;
+
+      if((branch = malloc_zero(sizeof(tracelb_branch_t))) == NULL)
+	{
+	  printerror(errno, strerror, __func__, "could not alloc branch");
+	  return -1;
+	}
+      branch->mode    = MODE_HOPPROBE;
+      branch->path    = path;
+      branch->reprobe = 1;
+      tracelb_branch_reset(branch);
+      if(tracelb_branch_waiting(state, branch) != 0)
+	{
+	  tracelb_branch_free(state, branch);
+	  return -1;
+	}
+    }
+
+  free(state->held);
+  state->held = NULL;
+  state->heldc = 0;
+
+  tracelb_paths_assert(state);
+  return 0;
+}
+
 /*
  * tracelb_queue
  *
@@ -1698,15 +2029,29 @@ static int tracelb_process_hops(scamper_task_t *task, tracelb_branch_t *br)
   scamper_tracelb_probeset_t *set;
   scamper_tracelb_probe_t *probe;
   scamper_tracelb_node_t *from, *to;
-  scamper_tracelb_link_t *link;
+  scamper_tracelb_link_t *link, *dup;
   tracelb_link_t *tlbl;
   tracelb_path_t *newp;
   tracelb_probe_t *pr;
+  tracelb_lite_t *lite;
   uint16_t flowid;
   slist_t *flowids = NULL;
   int i, j, k, splice, record, timxceed;
 
   assert(br->probec > 0);
+  lite = tracelb_lite_get(trace, state, br, 0);
+
+  /*
+   * keep the link to the interface this branch probed forward from if
+   * MDA-Lite stopped it early, in case the hop has to be probed again.
+   */
+  if(lite != NULL && br->litestop != 0 &&
+     array_insert((void ***)&state->held, &state->heldc,
+		  path0->links[path0->linkc-1], NULL) != 0)
+    {
+      printerror(errno, strerror, __func__, "could not hold link");
+      goto err;
+    }
 
   /*
    * get the from node.  the algorithm to obtain it depends on exactly what
@@ -1740,8 +2085,21 @@ static int tracelb_process_hops(scamper_task_t *task, tracelb_branch_t *br)
       free(br->newnodes[i]);
       br->newnodes[i] = NULL;
 
+      /*
+       * a hop probed again may reply from interfaces already linked, in
+       * which case the probes are recorded with the existing link.
+       */
+      if(br->reprobe != 0 && splice != 0)
+	dup = tracelb_node_link(from, to);
+      else
+	dup = NULL;
+
       /* create a link to store in the trace */
-      if(br->mode != MODE_CLUMP)
+      if(dup != NULL)
+	{
+	  link = dup;
+	}
+      else if(br->mode != MODE_CLUMP)
 	{
 	  assert(from != NULL);
 	  if((link = scamper_tracelb_link_alloc()) == NULL)
@@ -1762,10 +2120,13 @@ static int tracelb_process_hops(scamper_task_t *task, tracelb_branch_t *br)
        * try and allocate a probeset to record details of probes.
        * if it fails, then we have to free the link allocated above
        */
-      if((set = scamper_tracelb_probeset_alloc()) == NULL ||
-	 (flowids = slist_alloc()) == NULL)
+      if(dup != NULL)
+	set = dup->sets[0];
+      else
+	set = scamper_tracelb_probeset_alloc();
+      if(set == NULL || (flowids = slist_alloc()) == NULL)
 	{
-	  if(br->mode != MODE_CLUMP)
+	  if(br->mode != MODE_CLUMP && dup == NULL)
 	    scamper_tracelb_link_free(link);
 	  goto err;
 	}
@@ -1861,6 +2222,20 @@ static int tracelb_process_hops(scamper_task_t *task, tracelb_branch_t *br)
 	    }
 	}
 
+      /* the flowids can be used to probe past the existing link */
+      if(dup != NULL)
+	{
+	  for(j=0; j<state->linkc; j++)
+	    if(state->links[j]->link == dup)
+	      break;
+	  if(j != state->linkc)
+	    tracelb_link_flowids_add_list(state->links[j], flowids);
+	  else
+	    tracelb_flowids_list_free(flowids);
+	  flowids = NULL;
+	  continue;
+	}
+
       /* record the probeset with the link */
       if(scamper_tracelb_link_probeset(link, set) != 0)
 	{
@@ -1891,7 +2266,7 @@ static int tracelb_process_hops(scamper_task_t *task, tracelb_branch_t *br)
 	  tracelb_link_flowids_inc(tlbl);
 	  newp = path0;
 	}
-      else if(br->newnodec == 1)
+      else if(br->newnodec == 1 && path0->fwdc == 0)
 	{
 	  /*
 	   * (1) allocate a tracelb_link_t structure to keep link state with
@@ -1942,6 +2317,25 @@ static int tracelb_process_hops(scamper_task_t *task, tracelb_branch_t *br)
 	}
     }
 
+  /*
+   * MDA-Lite expects each successor of a load balancer to have the same
+   * number of successors itself, and the diamond to not be meshed.
+   */
+  if(lite != NULL && tracelb_mdalite(trace) != 0)
+    {
+      if(lite->succ == 0)
+	lite->succ = br->newnodec;
+      else if(lite->succ != br->newnodec)
+	tracelb_mdalite_full(trace, "unequal diamond");
+    }
+  if(tracelb_mdalite(trace) != 0 && tracelb_paths_meshed(state) != 0)
+    tracelb_mdalite_full(trace, "meshed diamond");
+  if(state->heldc > 0 && tracelb_mdalite(trace) == 0 &&
+     tracelb_held_reprobe(state) != 0)
+    goto err;
+
+  if(br->reprobe != 0)
+    tracelb_reprobe_discard(br, 0);
   tracelb_branch_free(state, br);
   tracelb_paths_assert(state);
   return 0;
@@ -2294,7 +2688,24 @@ static void tracelb_process_probes(scamper_task_t *task, tracelb_branch_t *br)
 	}
     }
 
-  if(br->mode == MODE_PERPACKET)
+  if(br->reprobe != 0)
+    {
+      /*
+       * a hop probed again after falling back from MDA-Lite was already
+       * found not to be a clump or per-packet load balancer, so only look
+       * for interfaces that were missed.  give up on the hop if the probes
+       * now suggest otherwise.
+       */
+      if(c > 0)
+	{
+	  tracelb_reprobe_discard(br, 1);
+	  tracelb_branch_free(state, br);
+	  tracelb_queue(task);
+	  return;
+	}
+      mode = MODE_HOPPROBE;
+    }
+  else if(br->mode == MODE_PERPACKET)
     {
       if(br->k <= k(state, 2) || c > 0 || n > 0)
 	mode = MODE_CLUMP;
@@ -2702,6 +3113,8 @@ static int hopprobe_handlereply(scamper_task_t *task, tracelb_probe_t *pr,
   tracelb_branch_t *branch = pr->branch;
   scamper_tracelb_t *trace = tracelb_getdata(task);
   tracelb_state_t *state = tracelb_getstate(task);
+  tracelb_lite_t *lite;
+  struct timeval rtt;
 
   if(scamper_tracelb_probe_reply(pr->probe, reply) != 0)
     {
@@ -2710,6 +3123,18 @@ static int hopprobe_handlereply(scamper_task_t *task, tracelb_probe_t *pr,
       return -1;
     }
 
+  /*
+   * the first reply to a probe is a sample of the RTT to that hop, and
+   * to the destination if it sent the reply
+   */
+  if(pr->probe->rxc == 1)
+    {
+      timeval_diff_tv(&rtt, &pr->probe->tx, &reply->reply_rx);
+      scamper_rtt_sample(trace->dst, pr->probe->ttl, &rtt);
+      if(scamper_addr_cmp(reply->reply_from, trace->dst) == 0)
+	scamper_rtt_sample(trace->dst, SCAMPER_RTT_DST, &rtt);
+    }
+
   /*
    * if this was not the most recent probe to be sent, or it was not the first
    * response to the probe, we're done.
@@ -2734,18 +3159,25 @@ static int hopprobe_handlereply(scamper_task_t *task, tracelb_probe_t *pr,
   heap_delete(state->active, branch->heapnode);
   branch->k++;
 
+  if((lite = tracelb_lite_get(trace, state, branch, 1)) != NULL &&
+     tracelb_lite_reply(lite, reply->reply_from) != 0)
+    return -1;
+
   /*
    * if a reply from the destination is received, assume that there is only
    * one link used to forward to the destination (in this case the directly
    * connected interface) and process that link now.
    *
    * otherwise, if the hop has been probed enough to the appropriate level
-   * of confidence, process the links discovered.
+   * of confidence, process the links discovered.  with MDA-Lite, the hop
+   * may have been probed enough by the probes sent from this branch and
+   * its siblings together.
    */
   if(branch->n >= TRACELB_CONFIDENCE_MAX_N ||
      (scamper_addr_cmp(reply->reply_from, trace->dst) == 0 &&
       branch->newnodec < 2) ||
-     branch->k >= k(state, branch->n))
+     branch->k >= k(state, branch->n) ||
+     tracelb_lite_done(trace, state, branch) != 0)
     {
       tracelb_process_probes(task, branch);
     }
@@ -3250,18 +3682,24 @@ static void handletimeout_abandon(scamper_task_t *task, tracelb_branch_t *br)
  */
 static void handletimeout_hopprobe(scamper_task_t *task, tracelb_branch_t *br)
 {
+  scamper_tracelb_t *trace = tracelb_getdata(task);
   tracelb_state_t *state = tracelb_getstate(task);
+  tracelb_lite_t *lite;
 
   br->l++;
 
   assert(br->mode == MODE_FIRSTHOP || br->mode == MODE_HOPPROBE ||
 	 br->mode == MODE_CLUMP);
 
+  if((lite = tracelb_lite_get(trace, state, br, 1)) != NULL)
+    lite->k++;
+
   /*
    * stop probing the link when the number of replies and the number of
    * lost probes reach the required confidence level
    */
-  if((br->k + br->l) >= k(state, br->n))
+  if((br->k + br->l) >= k(state, br->n) ||
+     tracelb_lite_done(trace, state, br) != 0)
     {
       tracelb_process_probes(task, br);
     }
@@ -3716,6 +4154,20 @@ static void tracelb_state_free(scamper_tracelb_t *trace,tracelb_state_t *state)
       free(state->paths);
     }
 
+  /* free the MDA-Lite hop records */
+  if(state->lites != NULL)
+    {
+      for(i=0; i<state->litec; i++)
+	{
+	  tracelb_lite_free(state->lites[i]);
+	}
+      free(state->lites);
+    }
+
+  /* the held links are freed with the rest of the links below */
+  if(state->held != NULL)
+    free(state->held);
+
   /* free the link records */
   if(state->links != NULL)
     {
@@ -4023,6 +4475,17 @@ static void do_tracelb_probe(scamper_task_t *task)
     }
   else tpl = NULL;
 
+  /*
+   * with MDA-Lite, the siblings of this branch may have probed the hop
+   * enough since this branch last had a reply.
+   */
+  if(branch->mode == MODE_HOPPROBE && tpl != NULL && tpl->probe->rxc > 0 &&
+     tracelb_lite_done(trace, state, branch) != 0)
+    {
+      tracelb_process_probes(task, branch);
+      return;
+    }
+
   /* allocate a probe structure to record state of the probe to be sent */
   if((tp = malloc_zero(sizeof(tracelb_probe_t))) == NULL ||
      (tp->probe = scamper_tracelb_probe_alloc()) == NULL)
@@ -4201,8 +4664,12 @@ static void do_tracelb_probe(scamper_task_t *task)
    * timestamps
    */
   timeval_cpy(&branch->last_tx, &probe.pr_tx);
-  branch->next_tx.tv_sec  = probe.pr_tx.tv_sec + trace->wait_timeout;
-  branch->next_tx.tv_usec = probe.pr_tx.tv_usec;
+  if((trace->flags & SCAMPER_TRACELB_FLAG_RTTWAIT) != 0)
+    timeval_add_ms(&branch->next_tx, &probe.pr_tx,
+		   scamper_rtt_wait(trace->dst, probe.pr_ip_ttl,
+				    trace->wait_timeout * 1000));
+  else
+    timeval_add_s(&branch->next_tx, &probe.pr_tx, trace->wait_timeout);
   if(tracelb_branch_active(state, branch) != 0)
     goto err;
 
@@ -4256,6 +4723,15 @@ static int tracelb_arg_param_validate(int optid, char *param, long *out)
 	}
       break;
 
+    case TRACE_OPT_OPTION:
+      if(strcasecmp(param, "mda-lite") == 0)
+	tmp = SCAMPER_TRACELB_FLAG_MDALITE;
+      else if(strcasecmp(param, "rtt-wait") == 0)
+	tmp = SCAMPER_TRACELB_FLAG_RTTWAIT;
+      else
+	goto err;
+      break;
+
     case TRACE_OPT_PROTOCOL:
       if(strcasecmp(param, "udp-dport") == 0)
 	tmp = SCAMPER_TRACELB_TYPE_UDP_DPORT;
@@ -4358,6 +4834,7 @@ void *scamper_do_tracelb_alloc(char *str)
   uint32_t probec_max   = SCAMPER_DO_TRACELB_PROBECMAX_DEF;
   uint8_t  gaplimit     = SCAMPER_DO_TRACELB_GAPLIMIT_DEF;
   uint32_t userid       = 0;
+  uint8_t  flags        = 0;
   char *addr;
   long tmp = 0;
 
@@ -4400,6 +4877,10 @@ void *scamper_do_tracelb_alloc(char *str)
 	  gaplimit = (uint8_t)tmp;
 	  break;
 
+	case TRACE_OPT_OPTION:
+	  flags |= (uint8_t)tmp;
+	  break;
+
 	case TRACE_OPT_PROTOCOL:
 	  type = (uint8_t)tmp;
 	  break;
@@ -4460,6 +4941,15 @@ void *scamper_do_tracelb_alloc(char *str)
   trace->probec_max   = probec_max;
   trace->gaplimit     = gaplimit;
   trace->userid       = userid;
+  trace->flags        = flags;
+
+  /* tracemap claims replies to echo requests with these ICMP ids */
+  if(SCAMPER_TRACELB_TYPE_IS_ICMP(trace) &&
+     scamper_icmpid_isreserved(trace->sport) != 0)
+    {
+      scamper_debug(__func__, "icmp id %d is reserved", trace->sport);
+      goto err;
+    }
 
   switch(trace->dst->type)
     {
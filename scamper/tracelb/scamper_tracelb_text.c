@@ -142,7 +142,6 @@ int scamper_file_text_tracelb_write(const scamper_file_t *sf,
   size_t len;
   size_t off;
   char buf[1024], src[64], dst[64];
-  int fd = scamper_file_getfd(sf);
   int i, j;
 
   snprintf(buf, sizeof(buf),
@@ -152,7 +151,7 @@ int scamper_file_text_tracelb_write(const scamper_file_t *sf,
 	   trace->nodec, trace->linkc, trace->probec, trace->confidence);
 
   len = strlen(buf);
-  write_wrap(fd, buf, NULL, len);
+  scamper_file_write_bytes(sf, buf, len);
 
   for(i=0; i<trace->nodec; i++)
     {
@@ -170,7 +169,7 @@ int scamper_file_text_tracelb_write(const scamper_file_t *sf,
 	      scamper_addr_tostr(node->links[j]->to->addr, dst, sizeof(dst));
 	      snprintf(buf, sizeof(buf), "%s -> %s\n", src, dst);
 	      len = strlen(buf);
-	      write_wrap(fd, buf, NULL, len);
+	      scamper_file_write_bytes(sf, buf, len);
 	    }
 	}
       else if(node->linkc == 1)
@@ -203,7 +202,7 @@ int scamper_file_text_tracelb_write(const scamper_file_t *sf,
 	    }
 
 	  string_concat(buf, len, &off, "\n");
-	  write_wrap(fd, buf, NULL, off);
+	  scamper_file_write_bytes(sf, buf, off);
 	}
     }
 
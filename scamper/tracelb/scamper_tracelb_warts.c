@@ -67,6 +67,7 @@ static const char rcsid[] =
 #define WARTS_TRACELB_ADDR_SRC     21       /* src address */
 #define WARTS_TRACELB_ADDR_DST     22       /* dst address */
 #define WARTS_TRACELB_USERID       23       /* user id */
+#define WARTS_TRACELB_FLAGS        24       /* flags */
 
 static const warts_var_t tracelb_vars[] =
 {
@@ -93,6 +94,7 @@ static const warts_var_t tracelb_vars[] =
   {WARTS_TRACELB_ADDR_SRC,    -1, -1},
   {WARTS_TRACELB_ADDR_DST,    -1, -1},
   {WARTS_TRACELB_USERID,       4, -1},
+  {WARTS_TRACELB_FLAGS,        1, -1},
 };
 #define tracelb_vars_mfb WARTS_VAR_MFB(tracelb_vars)
 
@@ -179,6 +181,8 @@ static const warts_var_t tracelb_probeset_vars[] =
 
 typedef struct warts_tracelb_node
 {
+  const scamper_tracelb_node_t *node;
+  uint16_t              id;
   uint8_t               flags[WARTS_VAR_MFB(tracelb_node_vars)];
   uint16_t              flags_len;
   uint16_t              params_len;
@@ -248,6 +252,12 @@ static void warts_tracelb_params(const scamper_tracelb_t *trace,
 	    continue;
 	}
 
+      if(var->id == WARTS_TRACELB_FLAGS)
+	{
+	  if(trace->flags == 0)
+	    continue;
+	}
+
       flag_set(flags, var->id, &max_id);
 
       if(var->id == WARTS_TRACELB_ADDR_SRC)
@@ -298,6 +308,7 @@ static int warts_tracelb_params_read(scamper_tracelb_t *trace,
     {&trace->src,          (wpr_t)extract_addr,      table},
     {&trace->dst,          (wpr_t)extract_addr,      table},
     {&trace->userid,       (wpr_t)extract_uint32,    NULL},
+    {&trace->flags,        (wpr_t)extract_byte,      NULL},
   };
   const int handler_cnt = sizeof(handlers)/sizeof(warts_param_reader_t);
   return warts_params_read(buf, off, len, handlers, handler_cnt);
@@ -337,6 +348,7 @@ static int warts_tracelb_params_write(const scamper_tracelb_t *trace,
     {trace->src,           (wpw_t)insert_addr,    table},
     {trace->dst,           (wpw_t)insert_addr,    table},
     {&trace->userid,       (wpw_t)insert_uint32,  NULL},
+    {&trace->flags,        (wpw_t)insert_byte,    NULL},
   };
   const int handler_cnt = sizeof(handlers)/sizeof(warts_param_writer_t);
 
@@ -853,40 +865,54 @@ static void warts_tracelb_link_free(warts_tracelb_link_t *state)
   return;
 }
 
+static int warts_tracelb_node_cmp(const warts_tracelb_node_t *a,
+				  const warts_tracelb_node_t *b)
+{
+  if(a->node < b->node) return -1;
+  if(a->node > b->node) return  1;
+  return 0;
+}
+
+/*
+ * warts_tracelb_node_id
+ *
+ * find the index into the nodes array of the given node, using the
+ * node state sorted by node.
+ */
+static int warts_tracelb_node_id(warts_tracelb_node_t **nodes, int nodec,
+				 const scamper_tracelb_node_t *node,
+				 uint16_t *id)
+{
+  warts_tracelb_node_t fm, *f;
+  fm.node = node;
+  if((f = array_find((void **)nodes, nodec, &fm,
+		     (array_cmp_t)warts_tracelb_node_cmp)) == NULL)
+    return -1;
+  *id = f->id;
+  return 0;
+}
+
 static int warts_tracelb_link_state(const scamper_file_t *sf,
-				    const scamper_tracelb_t *trace,
+				    warts_tracelb_node_t **nodes, int nodec,
 				    const scamper_tracelb_link_t *link,
 				    warts_tracelb_link_t *state,
 				    warts_addrtable_t *table, uint32_t *len)
 {
   const warts_var_t *var;
   size_t size;
-  int i, j, max_id = 0;
+  int i, max_id = 0;
   uint8_t s;
 
   state->hopc = link->hopc;
 
   /*
    * get the index into the nodes array for each of the nodes represented
-   * in the link.  the loop finishes when j reaches 2, i.e. both nodes have
-   * been identified.
+   * in the link.
    */
-  for(i=0, j=0; i<trace->nodec; i++)
-    {
-      if(link->from == trace->nodes[i])
-	{
-	  state->from = i;
-	  j++;
-	}
-      if(link->to == trace->nodes[i])
-	{
-	  state->to = i;
-	  j++;
-	}
-
-      if(j == 2 || (link->to == NULL && j == 1))
-	break;
-    }
+  if(warts_tracelb_node_id(nodes, nodec, link->from, &state->from) != 0 ||
+     (link->to != NULL &&
+      warts_tracelb_node_id(nodes, nodec, link->to, &state->to) != 0))
+    return -1;
 
   /* unset all the flags possible */
   memset(state->flags, 0, tracelb_link_vars_mfb);
@@ -930,6 +956,7 @@ static int warts_tracelb_link_state(const scamper_file_t *sf,
 
 static int warts_tracelb_link_read(scamper_tracelb_t *trace,
 				   scamper_tracelb_link_t *link,
+				   uint16_t *from_out,
 				   warts_state_t *state,
 				   warts_addrtable_t *table,
 				   const uint8_t *buf,
@@ -950,12 +977,18 @@ static int warts_tracelb_link_read(scamper_tracelb_t *trace,
     {
       return -1;
     }
+  if(from >= trace->nodec)
+    return -1;
   link->from = trace->nodes[from];
+  *from_out = from;
 
   if(flag_isset(&buf[o], WARTS_TRACELB_LINK_TO) != 0)
-    link->to = trace->nodes[to];
-  else
-    link->to = NULL;
+    {
+      if(to >= trace->nodec)
+	return -1;
+      link->to = trace->nodes[to];
+    }
+  else link->to = NULL;
 
   if(link->hopc > 0)
     {
@@ -1012,11 +1045,11 @@ int scamper_file_warts_tracelb_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   scamper_tracelb_t      *trace = NULL;
   uint8_t                *buf = NULL;
   uint32_t                i, off = 0;
-  uint16_t               *nlc = NULL, j;
+  uint16_t               *nlc = NULL, *lfrom = NULL, j;
   scamper_tracelb_node_t *node;
   warts_addrtable_t       table;
 
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   if(warts_read(sf, &buf, hdr->len) != 0)
     {
@@ -1060,7 +1093,8 @@ int scamper_file_warts_tracelb_read(scamper_file_t *sf, const warts_hdr_t *hdr,
   /* read the links */
   if(trace->linkc > 0)
     {
-      if(scamper_tracelb_links_alloc(trace, trace->linkc) != 0)
+      if(scamper_tracelb_links_alloc(trace, trace->linkc) != 0 ||
+	 (lfrom = malloc_zero(sizeof(uint16_t) * trace->linkc)) == NULL)
 	{
 	  goto err;
 	}
@@ -1069,15 +1103,12 @@ int scamper_file_warts_tracelb_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 	  if((trace->links[i] = scamper_tracelb_link_alloc()) == NULL)
 	    goto err;
 
-	  if(warts_tracelb_link_read(trace, trace->links[i], state, &table,
-				     buf, &off, hdr->len) != 0)
+	  if(warts_tracelb_link_read(trace, trace->links[i], &lfrom[i],
+				     state, &table, buf, &off, hdr->len) != 0)
 	    goto err;
 	}
     }
 
-  /* don't need the buf any more */
-  free(buf); buf = NULL;
-
   /*
    * add the links to their respective nodes.
    */
@@ -1089,15 +1120,7 @@ int scamper_file_warts_tracelb_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 	}
       for(i=0; i<trace->linkc; i++)
 	{
-	  for(j=0; j<trace->nodec; j++)
-	    {
-	      if(trace->links[i]->from == trace->nodes[j])
-		break;
-	    }
-
-	  if(j == trace->nodec)
-	    goto err;
-
+	  j = lfrom[i];
 	  node = trace->nodes[j];
 
 	  if(node->links == NULL &&
@@ -1118,6 +1141,11 @@ int scamper_file_warts_tracelb_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
       free(nlc); nlc = NULL;
     }
+  if(lfrom != NULL)
+    {
+      free(lfrom);
+      lfrom = NULL;
+    }
 
   warts_addrtable_clean(&table);
   *trace_out = trace;
@@ -1125,8 +1153,8 @@ int scamper_file_warts_tracelb_read(scamper_file_t *sf, const warts_hdr_t *hdr,
 
  err:
   warts_addrtable_clean(&table);
-  if(buf != NULL) free(buf);
   if(nlc != NULL) free(nlc);
+  if(lfrom != NULL) free(lfrom);
   if(trace != NULL) scamper_tracelb_free(trace);
   return -1;
 }
@@ -1141,13 +1169,14 @@ int scamper_file_warts_tracelb_write(const scamper_file_t *sf,
   uint8_t                       trace_flags[tracelb_vars_mfb];
   uint16_t                      trace_flags_len, trace_params_len;
   warts_tracelb_node_t         *node_state = NULL;
+  warts_tracelb_node_t        **node_idx = NULL;
   warts_tracelb_link_t         *link_state = NULL;
   size_t                        size;
   int                           i;
   warts_addrtable_t             table;
 
   /* make sure the table is nulled out */
-  memset(&table, 0, sizeof(table));
+  warts_addrtable_init(sf, &table);
 
   /* figure out which tracelb data items we'll store in this record */
   warts_tracelb_params(trace, &table, trace_flags, &trace_flags_len,
@@ -1165,6 +1194,11 @@ int scamper_file_warts_tracelb_write(const scamper_file_t *sf,
 	{
 	  goto err;
 	}
+      size = trace->nodec * sizeof(warts_tracelb_node_t *);
+      if((node_idx = (warts_tracelb_node_t **)malloc_zero(size)) == NULL)
+	{
+	  goto err;
+	}
 
       for(i=0; i<trace->nodec; i++)
 	{
@@ -1180,7 +1214,15 @@ int scamper_file_warts_tracelb_write(const scamper_file_t *sf,
 	  if(len2 < len)
 	    goto err;
 	  len = len2;
+
+	  node_state[i].node = node;
+	  node_state[i].id = i;
+	  node_idx[i] = &node_state[i];
 	}
+
+      /* sort the nodes so links can find the index of their nodes */
+      array_qsort((void **)node_idx, trace->nodec,
+		  (array_cmp_t)warts_tracelb_node_cmp);
     }
 
   /* record the link records */
@@ -1196,8 +1238,8 @@ int scamper_file_warts_tracelb_write(const scamper_file_t *sf,
 	{
 	  len2 = len;
 	  link = trace->links[i];
-	  if(warts_tracelb_link_state(sf, trace, link, &link_state[i],
-				      &table, &len2) != 0)
+	  if(warts_tracelb_link_state(sf, node_idx, trace->nodec, link,
+				      &link_state[i], &table, &len2) != 0)
 	    {
 	      goto err;
 	    }
@@ -1234,6 +1276,11 @@ int scamper_file_warts_tracelb_write(const scamper_file_t *sf,
       free(node_state);
       node_state = NULL;
     }
+  if(node_idx != NULL)
+    {
+      free(node_idx);
+      node_idx = NULL;
+    }
 
   /* write trace links */
   for(i=0; i<trace->linkc; i++)
@@ -1262,6 +1309,7 @@ int scamper_file_warts_tracelb_write(const scamper_file_t *sf,
  err:
   warts_addrtable_clean(&table);
   if(node_state != NULL) free(node_state);
+  if(node_idx != NULL) free(node_idx);
   if(link_state != NULL) free(link_state);
   if(buf != NULL) free(buf);
   return -1;
@@ -30,11 +30,14 @@ static const char rcsid[] =
 #define OPT_PRIORITY    0x0080
 #define OPT_DAEMON      0x0100
 #define OPT_COMMAND     0x0200
+#define OPT_BINARY      0x0400
+#define OPT_WINDOW      0x0800
 
 static uint32_t               options       = 0;
 static char                  *infile        = NULL;
 static unsigned int           port          = 0;
 static uint32_t               priority      = 1;
+static uint32_t               window        = 0;
 static int                    scamper_fd    = -1;
 static int                    stdin_fd      = -1;
 static char                  *readbuf       = NULL;
@@ -44,9 +47,11 @@ static size_t                 stdinbuf_len  = 0;
 static char                  *outfile_name  = NULL;
 static int                    outfile_fd    = -1;
 static int                    data_left     = 0;
+static size_t                 bdata_left    = 0;
 static int                    more          = 0;
 static slist_t               *commands      = NULL;
-static char                  *lastcommand   = NULL;
+static slist_t               *sent          = NULL;
+static int                    attached      = 0;
 static char                  *opt_command   = NULL;
 static int                    done          = 0;
 
@@ -54,10 +59,14 @@ static void cleanup(void)
 {
   char *command;
 
-  if(lastcommand != NULL)
+  if(sent != NULL)
     {
-      free(lastcommand);
-      lastcommand = NULL;
+      while((command = slist_head_pop(sent)) != NULL)
+	{
+	  free(command);
+	}
+      slist_free(sent);
+      sent = NULL;
     }
 
   if(commands != NULL)
@@ -100,8 +109,8 @@ static void cleanup(void)
 static void usage(uint32_t opt_mask)
 {
   fprintf(stderr,
-	  "usage: sc_attach [-?dDv] [-c command] [-i infile] [-o outfile]\n"
-	  "                 [-p port] [-P priority]\n");
+	  "usage: sc_attach [-?bdDv] [-c command] [-i infile] [-o outfile]\n"
+	  "                 [-p port] [-P priority] [-w window]\n");
 
   if(opt_mask == 0) return;
 
@@ -110,6 +119,9 @@ static void usage(uint32_t opt_mask)
   if(opt_mask & OPT_HELP)
     fprintf(stderr, "     -? give an overview of the usage of sc_attach\n");
 
+  if(opt_mask & OPT_BINARY)
+    fprintf(stderr, "     -b receive results without uuencoding\n");
+
   if(opt_mask & OPT_DEBUG)
     fprintf(stderr, "     -d output debugging information to stderr\n");
 
@@ -134,6 +146,9 @@ static void usage(uint32_t opt_mask)
   if(opt_mask & OPT_PRIORITY)
     fprintf(stderr, "     -P priority\n");
 
+  if(opt_mask & OPT_WINDOW)
+    fprintf(stderr, "     -w number of commands to keep outstanding\n");
+
   return;
 }
 
@@ -141,14 +156,18 @@ static int check_options(int argc, char *argv[])
 {
   int       ch;
   long      lo;
-  char     *opts = "c:dDi:o:p:P:v?";
-  char     *opt_port = NULL, *opt_priority = NULL;
+  char     *opts = "bc:dDi:o:p:P:vw:?";
+  char     *opt_port = NULL, *opt_priority = NULL, *opt_window = NULL;
   uint32_t  mandatory = OPT_INFILE | OPT_OUTFILE | OPT_PORT;
 
   while((ch = getopt(argc, argv, opts)) != -1)
     {
       switch(ch)
 	{
+	case 'b':
+	  options |= OPT_BINARY;
+	  break;
+
 	case 'c':
 	  opt_command = optarg;
 	  break;
@@ -191,6 +210,11 @@ static int check_options(int argc, char *argv[])
 	  opt_priority = optarg;
 	  break;
 
+	case 'w':
+	  options |= OPT_WINDOW;
+	  opt_window = optarg;
+	  break;
+
 	case 'v':
 	  printf("$Id: sc_attach.c,v 1.14 2013/09/04 19:19:47 mjl Exp $\n");
 	  return -1;
@@ -228,6 +252,16 @@ static int check_options(int argc, char *argv[])
       priority = lo;
     }
 
+  if((options & OPT_WINDOW) != 0)
+    {
+      if(string_tolong(opt_window, &lo) != 0 || lo < 1 || lo > 100000)
+	{
+	  usage(OPT_WINDOW);
+	  return -1;
+	}
+      window = lo;
+    }
+
   if((options & OPT_DAEMON) != 0 &&
      ((options & (OPT_STDOUT|OPT_DEBUG)) != 0 || stdin_fd != -1))
     {
@@ -268,7 +302,7 @@ static int command_new(char *line, void *param)
  */
 static int do_infile(void)
 {
-  if((commands = slist_alloc()) == NULL)
+  if((commands = slist_alloc()) == NULL || (sent = slist_alloc()) == NULL)
     {
       fprintf(stderr, "could not alloc commands list\n");
       return -1;
@@ -347,9 +381,9 @@ static int do_method(void)
   if((options & OPT_DEBUG) != 0)
     fprintf(stderr, "%ld: %s", (long int)tv.tv_sec, command);
 
-  if(lastcommand != NULL)
-    free(lastcommand);
-  lastcommand = command;
+  /* keep the command until scamper says whether it was accepted */
+  if(slist_tail_push(sent, command) == NULL)
+    free(command);
 
   if(slist_count(commands) == 0 && stdin_fd == -1 && done == 0)
     {
@@ -480,7 +514,7 @@ static int do_scamperread(void)
 {
   ssize_t rc;
   uint8_t uu[64];
-  char   *ptr, *head;
+  char   *ptr, *head, *command;
   char    buf[512];
   void   *tmp;
   long    l;
@@ -531,6 +565,22 @@ static int do_scamperread(void)
   head = readbuf;
   for(i=0; i<readbuf_len; i++)
     {
+      /* if currently receiving binary data, pass it straight through */
+      if(bdata_left > 0)
+	{
+	  uus = readbuf_len - i;
+	  if(uus > bdata_left)
+	    uus = bdata_left;
+	  if(outfile_fd != -1)
+	    write_wrap(outfile_fd, &readbuf[i], NULL, uus);
+	  if(options & OPT_STDOUT)
+	    write_wrap(STDOUT_FILENO, &readbuf[i], NULL, uus);
+	  bdata_left -= uus;
+	  i += uus - 1;
+	  head = &readbuf[i+1];
+	  continue;
+	}
+
       if(readbuf[i] != '\n')
 	continue;
 
@@ -569,6 +619,18 @@ static int do_scamperread(void)
 	{
 	  more++;
 	}
+      /* the scamper process has granted a number of credits */
+      else if(linelen > 5 && strncasecmp(head, "MORE ", 5) == 0)
+	{
+	  l = strtol(head+5, &ptr, 10);
+	  if(*ptr != '\n' || l < 1)
+	    {
+	      head[linelen] = '\0';
+	      fprintf(stderr, "could not parse %s\n", head);
+	      goto err;
+	    }
+	  more += l;
+	}
       /* new piece of data */
       else if(linelen > 5 && strncasecmp(head, "DATA ", 5) == 0)
 	{
@@ -582,23 +644,40 @@ static int do_scamperread(void)
 
 	  data_left = l;
 	}
-      /* feedback letting us know that the command was accepted */
+      /* new piece of binary data */
+      else if(linelen > 6 && strncasecmp(head, "BDATA ", 6) == 0)
+	{
+	  l = strtol(head+6, &ptr, 10);
+	  if(*ptr != '\n' || l < 1)
+	    {
+	      head[linelen] = '\0';
+	      fprintf(stderr, "could not parse %s\n", head);
+	      goto err;
+	    }
+
+	  bdata_left = l;
+	}
+      /*
+       * feedback letting us know that the command was accepted.  scamper
+       * replies to the attach and to each command in the order they were
+       * sent, so the reply is for the oldest command still outstanding.
+       */
       else if(linelen >= 2 && strncasecmp(head, "OK", 2) == 0)
 	{
-	  /* err, nothing to do */
+	  if(attached == 0)
+	    attached = 1;
+	  else if((command = slist_head_pop(sent)) != NULL)
+	    free(command);
 	}
       /* feedback letting us know that the command was not accepted */
       else if(linelen >= 3 && strncasecmp(head, "ERR", 3) == 0)
 	{
-	  if(lastcommand != NULL)
-	    {
-	      fprintf(stderr, "command not accepted: %s", lastcommand);
-	      more++;
-	    }
-	  else
-	    {
-	      goto err;
-	    }
+	  if(attached == 0 || (command = slist_head_pop(sent)) == NULL)
+	    goto err;
+	  fprintf(stderr, "command not accepted: %s", command);
+	  free(command);
+	  if(window == 0)
+	    more++;
 	}
       else
 	{
@@ -637,6 +716,10 @@ static int do_attach(void)
   size_t off = 0;
 
   string_concat(buf, sizeof(buf), &off, "attach");
+  if((options & OPT_BINARY) != 0)
+    string_concat(buf, sizeof(buf), &off, " format binary");
+  if((options & OPT_WINDOW) != 0)
+    string_concat(buf, sizeof(buf), &off, " window %u", window);
   if((options & OPT_PRIORITY) != 0)
     string_concat(buf, sizeof(buf), &off, " priority %d", priority);
   string_concat(buf, sizeof(buf), &off, "\n");
@@ -711,7 +794,7 @@ int main(int argc, char *argv[])
 	    nfds = stdin_fd;
 	}
 
-      if(more > 0)
+      while(more > 0 && slist_count(commands) > 0)
 	{
 	  do_method();
 	}
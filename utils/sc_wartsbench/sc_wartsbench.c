@@ -0,0 +1,341 @@
+/*
+ * sc_wartsbench
+ *
+ * This is a utility program to time how long it takes to encode and
+ * decode warts records with many distinct addresses.  It builds a
+ * synthetic tracelb record, writes copies of it to a warts file, and
+ * then reads them back.
+ *
+ * $Id: sc_wartsbench.c,v 1.1 2014/04/04 00:00:00 mjl Exp $
+ *
+ * Copyright (C) 2014 The Regents of the University of California
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef lint
+static const char rcsid[] =
+  "$Id: sc_wartsbench.c,v 1.1 2014/04/04 00:00:00 mjl Exp $";
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper_addr.h"
+#include "scamper_list.h"
+#include "tracelb/scamper_tracelb.h"
+#include "scamper_file.h"
+#include "utils.h"
+
+#define OPT_COUNT 0x00000001 /* c: */
+#define OPT_NODES 0x00000002 /* n: */
+#define OPT_PROBES 0x00000004 /* p: */
+#define OPT_HELP  0x00000008 /* ?: */
+
+static uint32_t           options      = 0;
+static char              *outfile_name = NULL;
+static long               count        = 100;
+static long               nodec        = 4096;
+static long               probec       = 2;
+static scamper_file_t    *file         = NULL;
+static scamper_tracelb_t *trace        = NULL;
+
+static void usage(const char *argv0, uint32_t opt_mask)
+{
+  fprintf(stderr,
+	  "usage: sc_wartsbench [-?] [-c count] [-n nodes] [-p probes] <file>\n");
+
+  if(opt_mask == 0) return;
+
+  fprintf(stderr, "\n");
+
+  if(opt_mask & OPT_HELP)
+    fprintf(stderr, "    -? give an overview of the usage of sc_wartsbench\n");
+
+  if(opt_mask & OPT_COUNT)
+    fprintf(stderr, "    -c number of records to write and read\n");
+
+  if(opt_mask & OPT_NODES)
+    fprintf(stderr, "    -n number of nodes, each a distinct address\n");
+
+  if(opt_mask & OPT_PROBES)
+    fprintf(stderr, "    -p number of probes recorded for each link\n");
+
+  return;
+}
+
+static int check_options(int argc, char *argv[])
+{
+  int   i, ch;
+  char *opts = "c:n:p:?";
+
+  while((i = getopt(argc, argv, opts)) != -1)
+    {
+      ch = (char)i;
+      switch(ch)
+	{
+	case 'c':
+	  if(string_isnumber(optarg) == 0 ||
+	     string_tolong(optarg, &count) != 0 || count < 1)
+	    {
+	      usage(argv[0], OPT_COUNT);
+	      return -1;
+	    }
+	  options |= OPT_COUNT;
+	  break;
+
+	case 'n':
+	  if(string_isnumber(optarg) == 0 ||
+	     string_tolong(optarg, &nodec) != 0 ||
+	     nodec < 2 || nodec > 65535)
+	    {
+	      usage(argv[0], OPT_NODES);
+	      return -1;
+	    }
+	  options |= OPT_NODES;
+	  break;
+
+	case 'p':
+	  if(string_isnumber(optarg) == 0 ||
+	     string_tolong(optarg, &probec) != 0 ||
+	     probec < 1 || probec > 65535)
+	    {
+	      usage(argv[0], OPT_PROBES);
+	      return -1;
+	    }
+	  options |= OPT_PROBES;
+	  break;
+
+	case '?':
+	default:
+	  usage(argv[0], 0xffffffff);
+	  return -1;
+	}
+    }
+
+  if(argc - optind != 1)
+    {
+      usage(argv[0], 0);
+      return -1;
+    }
+  outfile_name = argv[optind];
+
+  return 0;
+}
+
+static void cleanup(void)
+{
+  if(trace != NULL)
+    {
+      scamper_tracelb_free(trace);
+      trace = NULL;
+    }
+
+  if(file != NULL)
+    {
+      scamper_file_close(file);
+      file = NULL;
+    }
+
+  return;
+}
+
+/*
+ * node_addr
+ *
+ * return a distinct IPv4 address for each node, starting at 10.0.0.1.
+ */
+static scamper_addr_t *node_addr(uint32_t i)
+{
+  uint8_t buf[4];
+  bytes_htonl(buf, 0x0a000001 + i);
+  return scamper_addr_alloc_ipv4(buf);
+}
+
+/*
+ * build_trace
+ *
+ * build a tracelb record of a path through nodec distinct nodes, where
+ * each link has a set of probes that each got a reply from the far end.
+ * every address in the record is distinct except where a reply repeats
+ * the address of a node, as it does in a real record.
+ */
+static int build_trace(void)
+{
+  scamper_tracelb_probeset_t *set;
+  scamper_tracelb_probe_t *probe;
+  scamper_tracelb_reply_t *reply;
+  scamper_tracelb_node_t *node;
+  scamper_tracelb_link_t *link;
+  scamper_addr_t *addr;
+  long i, j;
+
+  if((trace = scamper_tracelb_alloc()) == NULL ||
+     (trace->list = scamper_list_alloc(1, "bench", NULL, NULL)) == NULL ||
+     (trace->cycle = scamper_cycle_alloc(trace->list)) == NULL ||
+     (trace->src = scamper_addr_resolve(AF_INET, "192.0.2.1")) == NULL ||
+     (trace->dst = node_addr(nodec - 1)) == NULL ||
+     scamper_tracelb_nodes_alloc(trace, nodec) != 0 ||
+     scamper_tracelb_links_alloc(trace, nodec - 1) != 0)
+    return -1;
+
+  gettimeofday_wrap(&trace->start);
+  trace->type = SCAMPER_TRACELB_TYPE_UDP_DPORT;
+  trace->sport = 32768;
+  trace->dport = 33435;
+  trace->probe_size = 44;
+  trace->firsthop = 1;
+  trace->wait_timeout = 5;
+  trace->attempts = 2;
+  trace->confidence = 95;
+
+  for(i=0; i<nodec; i++)
+    {
+      if((addr = node_addr(i)) == NULL)
+	return -1;
+      node = scamper_tracelb_node_alloc(addr);
+      scamper_addr_free(addr);
+      if(node == NULL)
+	return -1;
+      trace->nodes[i] = node;
+      trace->nodec++;
+    }
+
+  for(i=0; i<nodec-1; i++)
+    {
+      if((link = scamper_tracelb_link_alloc()) == NULL)
+	return -1;
+      link->from = trace->nodes[i];
+      link->to = trace->nodes[i+1];
+      trace->links[i] = link;
+      trace->linkc++;
+
+      if(scamper_tracelb_node_links_alloc(link->from, 1) != 0)
+	return -1;
+      link->from->links[0] = link;
+      link->from->linkc = 1;
+
+      if(scamper_tracelb_link_probesets_alloc(link, 1) != 0 ||
+	 (set = scamper_tracelb_probeset_alloc()) == NULL)
+	return -1;
+      link->sets[0] = set;
+      link->hopc = 1;
+      if(scamper_tracelb_probeset_probes_alloc(set, probec) != 0)
+	return -1;
+
+      for(j=0; j<probec; j++)
+	{
+	  if((probe = scamper_tracelb_probe_alloc()) == NULL)
+	    return -1;
+	  set->probes[set->probec++] = probe;
+	  probe->tx = trace->start;
+	  probe->flowid = j + 1;
+	  probe->ttl = i + 2;
+	  probe->attempt = 0;
+	  if((reply = scamper_tracelb_reply_alloc(link->to->addr)) == NULL)
+	    return -1;
+	  reply->reply_rx = trace->start;
+	  if(scamper_tracelb_probe_reply(probe, reply) != 0)
+	    {
+	      scamper_tracelb_reply_free(reply);
+	      return -1;
+	    }
+	  trace->probec++;
+	}
+    }
+
+  return 0;
+}
+
+static void print_rate(const char *what, const struct timeval *start,
+		       const struct timeval *finish)
+{
+  double s = timeval_diff_us(finish, start) / 1000000.0;
+  printf("%s %ld records in %.3fs, %.1f records/s, %.1fus/record\n",
+	 what, count, s, s > 0 ? count / s : 0, s * 1000000.0 / count);
+  return;
+}
+
+int main(int argc, char *argv[])
+{
+  scamper_file_filter_t *filter;
+  struct timeval start, finish;
+  uint16_t type = SCAMPER_FILE_OBJ_TRACELB;
+  void *data;
+  long i;
+
+#if defined(DMALLOC)
+  free(malloc(1));
+#endif
+
+  atexit(cleanup);
+
+  if(check_options(argc, argv) == -1)
+    return -1;
+
+  if(build_trace() != 0)
+    {
+      fprintf(stderr, "could not build tracelb record\n");
+      return -1;
+    }
+  printf("tracelb record with %d nodes, %d links, %u probes\n",
+	 trace->nodec, trace->linkc, trace->probec);
+
+  if((file = scamper_file_open(outfile_name, 'w', "warts")) == NULL)
+    {
+      fprintf(stderr, "could not open %s\n", outfile_name);
+      return -1;
+    }
+
+  gettimeofday_wrap(&start);
+  for(i=0; i<count; i++)
+    {
+      if(scamper_file_write_tracelb(file, trace) != 0)
+	{
+	  fprintf(stderr, "could not write record %ld\n", i);
+	  return -1;
+	}
+    }
+  scamper_file_close(file); file = NULL;
+  gettimeofday_wrap(&finish);
+  print_rate("wrote", &start, &finish);
+
+  if((filter = scamper_file_filter_alloc(&type, 1)) == NULL ||
+     (file = scamper_file_open(outfile_name, 'r', "warts")) == NULL)
+    {
+      fprintf(stderr, "could not open %s\n", outfile_name);
+      return -1;
+    }
+
+  gettimeofday_wrap(&start);
+  for(i=0; i<count; i++)
+    {
+      if(scamper_file_read(file, filter, &type, &data) != 0 || data == NULL)
+	{
+	  fprintf(stderr, "could not read record %ld\n", i);
+	  scamper_file_filter_free(filter);
+	  return -1;
+	}
+      scamper_tracelb_free(data);
+    }
+  gettimeofday_wrap(&finish);
+  scamper_file_filter_free(filter);
+  print_rate("read", &start, &finish);
+
+  return 0;
+}
@@ -205,6 +205,8 @@ static void dump_trace_hop(scamper_trace_hop_t *hop)
 	printf(" tscrtt");
       if(hop->hop_flags & SCAMPER_TRACE_HOP_FLAG_REPLY_TTL)
 	printf(" replyttl");
+      if(hop->hop_flags & SCAMPER_TRACE_HOP_FLAG_TS_MS)
+	printf(" msts");
       printf(" )");
     }
   printf("\n");
@@ -348,6 +350,10 @@ static void dump_trace(scamper_trace_t *trace)
 	printf(" doubletree");
       if(trace->flags & SCAMPER_TRACE_FLAG_ICMPCSUMDP)
 	printf(" icmp-csum-dport");
+      if(trace->flags & SCAMPER_TRACE_FLAG_PREDICT)
+	printf(" predict");
+      if(trace->flags & SCAMPER_TRACE_FLAG_RTTWAIT)
+	printf(" rttwait");
       printf(" )");
     }
   printf("\n");
@@ -586,6 +592,19 @@ static void dump_tracelb(scamper_tracelb_t *trace)
 	 trace->probe_size, trace->wait_probe * 10, trace->wait_timeout);
   printf(" nodec: %d, linkc: %d, probec: %d, probec_max: %d\n",
 	 trace->nodec, trace->linkc, trace->probec, trace->probec_max);
+  printf(" flags: 0x%02x", trace->flags);
+  if(trace->flags != 0)
+    {
+      printf(" (");
+      if(trace->flags & SCAMPER_TRACELB_FLAG_MDALITE)
+	printf(" mda-lite");
+      if(trace->flags & SCAMPER_TRACELB_FLAG_MDALITE_FULL)
+	printf(" mda-full");
+      if(trace->flags & SCAMPER_TRACELB_FLAG_RTTWAIT)
+	printf(" rtt-wait");
+      printf(" )");
+    }
+  printf("\n");
 
   for(i=0; i<trace->nodec; i++)
     {
@@ -772,6 +791,8 @@ static void dump_ping(scamper_ping_t *ping)
       printf(".%u", u32);
     }
   printf(", timeout: %u, ttl: %u", ping->probe_timeout, ping->probe_ttl);
+  if((ping->flags & SCAMPER_PING_FLAG_RTTWAIT) != 0)
+    printf(", rtt-wait");
   printf("\n");
 
   printf(" method: %s", scamper_ping_method2str(ping, buf, sizeof(buf)));
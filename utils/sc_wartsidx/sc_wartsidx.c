@@ -0,0 +1,444 @@
+/*
+ * sc_wartsidx
+ *
+ * This is a utility program to build an index of the records in a warts
+ * file, and to use that index to extract the records that measured a
+ * given destination, or that started in a given window of time, without
+ * reading the whole file.
+ *
+ * $Id: sc_wartsidx.c,v 1.1 2014/03/10 00:00:00 mjl Exp $
+ *
+ * Copyright (C) 2014 The University of Waikato
+ * Author: Matthew Luckie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef lint
+static const char rcsid[] =
+  "$Id: sc_wartsidx.c,v 1.1 2014/03/10 00:00:00 mjl Exp $";
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include "internal.h"
+
+#include "scamper_addr.h"
+#include "scamper_list.h"
+#include "trace/scamper_trace.h"
+#include "tracelb/scamper_tracelb.h"
+#include "ping/scamper_ping.h"
+#include "dealias/scamper_dealias.h"
+#include "tbit/scamper_tbit.h"
+#include "neighbourdisc/scamper_neighbourdisc.h"
+#include "sting/scamper_sting.h"
+#include "sniff/scamper_sniff.h"
+#include "scamper_file.h"
+#include "utils.h"
+
+#define OPT_IDXFILE 0x00000001 /* o: */
+#define OPT_DST     0x00000002 /* d: */
+#define OPT_TIME    0x00000004 /* t: */
+#define OPT_TYPE    0x00000008 /* T: */
+#define OPT_OUTFILE 0x00000010 /* w: */
+#define OPT_HELP    0x00000020 /* ?: */
+
+static uint32_t                options     = 0;
+static char                   *infile_name = NULL;
+static scamper_file_t         *infile      = NULL;
+static scamper_file_t         *outfile     = NULL;
+static char                   *opt_idxfile = NULL;
+static char                   *opt_outfile = NULL;
+static scamper_addr_t         *dst         = NULL;
+static uint16_t                type        = 0;
+static time_t                  start       = 0;
+static time_t                  finish      = 0;
+static scamper_file_filter_t  *filter      = NULL;
+
+static const struct
+{
+  const char *name;
+  uint16_t    type;
+} types[] = {
+  {"trace",         SCAMPER_FILE_OBJ_TRACE},
+  {"ping",          SCAMPER_FILE_OBJ_PING},
+  {"tracelb",       SCAMPER_FILE_OBJ_TRACELB},
+  {"dealias",       SCAMPER_FILE_OBJ_DEALIAS},
+  {"neighbourdisc", SCAMPER_FILE_OBJ_NEIGHBOURDISC},
+  {"tbit",          SCAMPER_FILE_OBJ_TBIT},
+  {"sting",         SCAMPER_FILE_OBJ_STING},
+  {"sniff",         SCAMPER_FILE_OBJ_SNIFF},
+};
+static const int types_cnt = sizeof(types) / sizeof(types[0]);
+
+static void usage(const char *argv0, uint32_t opt_mask)
+{
+  fprintf(stderr,
+	  "usage: sc_wartsidx [-?] [-o idxfile] <infile>\n"
+	  "       sc_wartsidx [-d dst] [-t start[,finish]] [-T type]\n"
+	  "                   [-w outfile] <infile>\n");
+
+  if(opt_mask == 0) return;
+
+  fprintf(stderr, "\n");
+
+  if(opt_mask & OPT_HELP)
+    fprintf(stderr, "    -? give an overview of the usage of sc_wartsidx\n");
+
+  if(opt_mask & OPT_IDXFILE)
+    fprintf(stderr, "    -o name of the index file to write\n");
+
+  if(opt_mask & OPT_DST)
+    fprintf(stderr, "    -d extract records that measured this address\n");
+
+  if(opt_mask & OPT_TIME)
+    fprintf(stderr, "    -t extract records started in this unix time range\n");
+
+  if(opt_mask & OPT_TYPE)
+    fprintf(stderr, "    -T only extract records of this type\n");
+
+  if(opt_mask & OPT_OUTFILE)
+    fprintf(stderr, "    -w warts file to write extracted records to\n");
+
+  return;
+}
+
+static int check_options_time(char *str)
+{
+  char *ptr = str;
+  long lo, hi;
+
+  while(*ptr != '\0' && *ptr != ',')
+    ptr++;
+
+  if(*ptr == ',')
+    {
+      *ptr = '\0'; ptr++;
+      if(string_tolong(ptr, &hi) != 0 || hi < 1)
+	return -1;
+    }
+  else hi = 0x7fffffff;
+
+  if(string_tolong(str, &lo) != 0 || lo < 0 || hi < lo)
+    return -1;
+
+  start = lo;
+  finish = hi;
+  return 0;
+}
+
+static int check_options(int argc, char *argv[])
+{
+  int   i, ch;
+  char *opts = "d:o:t:T:w:?";
+  char *opt_dst = NULL, *opt_time = NULL, *opt_type = NULL;
+
+  while((i = getopt(argc, argv, opts)) != -1)
+    {
+      ch = (char)i;
+      switch(ch)
+	{
+	case 'd':
+	  options |= OPT_DST;
+	  opt_dst = optarg;
+	  break;
+
+	case 'o':
+	  options |= OPT_IDXFILE;
+	  opt_idxfile = optarg;
+	  break;
+
+	case 't':
+	  options |= OPT_TIME;
+	  opt_time = optarg;
+	  break;
+
+	case 'T':
+	  options |= OPT_TYPE;
+	  opt_type = optarg;
+	  break;
+
+	case 'w':
+	  options |= OPT_OUTFILE;
+	  opt_outfile = optarg;
+	  break;
+
+	case '?':
+	default:
+	  usage(argv[0], 0xffffffff);
+	  return -1;
+	}
+    }
+
+  if(argc - optind != 1)
+    {
+      usage(argv[0], 0);
+      return -1;
+    }
+  infile_name = argv[optind];
+
+  /* building an index and querying one are exclusive */
+  if((options & OPT_IDXFILE) && (options & ~OPT_IDXFILE) != 0)
+    {
+      usage(argv[0], OPT_IDXFILE);
+      return -1;
+    }
+
+  if((options & (OPT_DST|OPT_TIME)) == (OPT_DST|OPT_TIME))
+    {
+      usage(argv[0], OPT_DST|OPT_TIME);
+      return -1;
+    }
+
+  if((options & (OPT_TYPE|OPT_OUTFILE)) != 0 &&
+     (options & (OPT_DST|OPT_TIME)) == 0)
+    {
+      usage(argv[0], OPT_DST|OPT_TIME);
+      return -1;
+    }
+
+  if(opt_dst != NULL &&
+     (dst = scamper_addr_resolve(AF_UNSPEC, opt_dst)) == NULL)
+    {
+      usage(argv[0], OPT_DST);
+      return -1;
+    }
+
+  if(opt_time != NULL && check_options_time(opt_time) != 0)
+    {
+      usage(argv[0], OPT_TIME);
+      return -1;
+    }
+
+  if(opt_type != NULL)
+    {
+      for(i=0; i<types_cnt; i++)
+	if(strcasecmp(opt_type, types[i].name) == 0)
+	  break;
+      if(i == types_cnt)
+	{
+	  usage(argv[0], OPT_TYPE);
+	  return -1;
+	}
+      type = types[i].type;
+    }
+
+  return 0;
+}
+
+static void cleanup(void)
+{
+  if(filter != NULL)
+    {
+      scamper_file_filter_free(filter);
+      filter = NULL;
+    }
+
+  if(dst != NULL)
+    {
+      scamper_addr_free(dst);
+      dst = NULL;
+    }
+
+  if(outfile != NULL)
+    {
+      scamper_file_close(outfile);
+      outfile = NULL;
+    }
+
+  if(infile != NULL)
+    {
+      scamper_file_close(infile);
+      infile = NULL;
+    }
+
+  return;
+}
+
+static void free_obj(uint16_t obj_type, void *data)
+{
+  switch(obj_type)
+    {
+    case SCAMPER_FILE_OBJ_TRACE:
+      scamper_trace_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_PING:
+      scamper_ping_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_TRACELB:
+      scamper_tracelb_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_DEALIAS:
+      scamper_dealias_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_NEIGHBOURDISC:
+      scamper_neighbourdisc_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_TBIT:
+      scamper_tbit_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_STING:
+      scamper_sting_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_SNIFF:
+      scamper_sniff_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_CYCLE_START:
+    case SCAMPER_FILE_OBJ_CYCLE_DEF:
+    case SCAMPER_FILE_OBJ_CYCLE_STOP:
+      scamper_cycle_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_LIST:
+      scamper_list_free(data);
+      break;
+
+    case SCAMPER_FILE_OBJ_ADDR:
+      scamper_addr_free(data);
+      break;
+    }
+
+  return;
+}
+
+/*
+ * do_index
+ *
+ * read the whole file and write an index of the records it contains.
+ */
+static int do_index(void)
+{
+  if(scamper_file_index(infile, opt_idxfile) != 0)
+    {
+      fprintf(stderr, "could not index %s\n", infile_name);
+      return -1;
+    }
+  return 0;
+}
+
+/*
+ * do_extract
+ *
+ * use the index to position the file at each record that matches, and
+ * write the record out.
+ */
+static int do_extract(void)
+{
+  uint16_t filter_types[sizeof(types) / sizeof(types[0])];
+  uint16_t obj_type;
+  void *data;
+  int i, rc;
+
+  for(i=0; i<types_cnt; i++)
+    filter_types[i] = types[i].type;
+  if((filter = scamper_file_filter_alloc(filter_types, types_cnt)) == NULL)
+    {
+      fprintf(stderr, "could not allocate filter\n");
+      return -1;
+    }
+
+  if(opt_outfile != NULL)
+    {
+      if((outfile = scamper_file_open(opt_outfile, 'w', "warts")) == NULL)
+	{
+	  fprintf(stderr, "could not open %s\n", opt_outfile);
+	  return -1;
+	}
+    }
+  else
+    {
+      /* writing to stdout; don't dump a binary structure to a tty. */
+      if(isatty(1) != 0)
+	{
+	  fprintf(stderr, "not going to dump warts to a tty, sorry\n");
+	  return -1;
+	}
+
+      if((outfile = scamper_file_openfd(1, "-", 'w', "warts")) == NULL)
+	{
+	  fprintf(stderr, "could not wrap scamper_file around stdout\n");
+	  return -1;
+	}
+    }
+
+  for(;;)
+    {
+      if(options & OPT_DST)
+	rc = scamper_file_seek_dst(infile, type, dst);
+      else
+	rc = scamper_file_seek_time(infile, type, start, finish);
+
+      if(rc == 0)
+	break;
+      if(rc < 0)
+	{
+	  fprintf(stderr, "could not seek in %s; is there an index?\n",
+		  infile_name);
+	  return -1;
+	}
+
+      if(scamper_file_read(infile, filter, &obj_type, &data) != 0)
+	{
+	  fprintf(stderr, "could not read from %s\n", infile_name);
+	  return -1;
+	}
+      if(data == NULL)
+	break;
+
+      rc = scamper_file_write_obj(outfile, obj_type, data);
+      free_obj(obj_type, data);
+      if(rc != 0)
+	{
+	  fprintf(stderr, "could not write record\n");
+	  return -1;
+	}
+    }
+
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+#if defined(DMALLOC)
+  free(malloc(1));
+#endif
+
+  atexit(cleanup);
+
+  if(check_options(argc, argv) == -1)
+    {
+      return -1;
+    }
+
+  if((infile = scamper_file_open(infile_name, 'r', "warts")) == NULL)
+    {
+      fprintf(stderr, "could not open %s\n", infile_name);
+      return -1;
+    }
+
+  if(options & (OPT_DST|OPT_TIME))
+    return do_extract();
+
+  return do_index();
+}